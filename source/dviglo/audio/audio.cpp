@@ -38,7 +38,7 @@ Audio::Audio()
     // Register Audio library object factories
     RegisterAudioLibrary();
 
-    SubscribeToEvent(E_RENDERUPDATE, DV_HANDLER(Audio, HandleRenderUpdate));
+    SubscribeToTypedEvent(&Audio::HandleRenderUpdate);
 }
 
 Audio::~Audio()
@@ -294,11 +294,9 @@ void Audio::MixOutput(void* dest, u32 samples)
     }
 }
 
-void Audio::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
+void Audio::HandleRenderUpdate(RenderUpdateEvent& event)
 {
-    using namespace RenderUpdate;
-
-    Update(eventData[P_TIMESTEP].GetFloat());
+    Update(event.timeStep_);
 }
 
 void Audio::Release()
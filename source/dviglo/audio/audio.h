@@ -18,6 +18,7 @@ class AudioImpl;
 class Sound;
 class SoundListener;
 class SoundSource;
+struct RenderUpdateEvent;
 
 /// %Audio subsystem.
 class DV_API Audio : public Object
@@ -100,7 +101,7 @@ public:
 
 private:
     /// Handle render update event.
-    void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleRenderUpdate(RenderUpdateEvent& event);
     /// Stop sound output and release the sound buffer.
     void Release();
     /// Actually update sound sources with the specific timestep. Called internally.
@@ -0,0 +1,89 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "arena_allocator.h"
+
+#include <cassert>
+#include <cstdint>
+
+#include "../common/debug_new.h"
+
+namespace dviglo
+{
+
+ArenaAllocator::ArenaAllocator(i32 blockSize) :
+    blockSize_(blockSize)
+{
+    assert(blockSize > 0);
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+    while (block_)
+    {
+        Block* prev = block_->prev_;
+        delete[] reinterpret_cast<u8*>(block_);
+        block_ = prev;
+    }
+}
+
+void* ArenaAllocator::Allocate(i32 size, i32 alignment)
+{
+    assert(size >= 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    uintptr_t address = ((uintptr_t)position_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+    if (!block_ || address + size > (uintptr_t)end_)
+    {
+        // Padding is reserved, because the data of a block is only aligned to the header size
+        AllocateBlock(size + alignment);
+        address = ((uintptr_t)position_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+
+    u8* ptr = reinterpret_cast<u8*>(address);
+    usedSize_ += (i32)(ptr + size - position_);
+    position_ = ptr + size;
+    return ptr;
+}
+
+void ArenaAllocator::Reset()
+{
+    if (block_ && block_->prev_)
+    {
+        // Merge the blocks into one
+        while (block_)
+        {
+            Block* prev = block_->prev_;
+            delete[] reinterpret_cast<u8*>(block_);
+            block_ = prev;
+        }
+
+        i32 totalSize = capacity_;
+        capacity_ = 0;
+        AllocateBlock(totalSize);
+    }
+    else if (block_)
+    {
+        position_ = reinterpret_cast<u8*>(block_ + 1);
+    }
+
+    usedSize_ = 0;
+}
+
+void ArenaAllocator::AllocateBlock(i32 size)
+{
+    if (size < blockSize_)
+        size = blockSize_;
+
+    Block* block = reinterpret_cast<Block*>(new u8[sizeof(Block) + size]);
+    block->prev_ = block_;
+    block_ = block;
+
+    position_ = reinterpret_cast<u8*>(block + 1);
+    end_ = position_ + size;
+    capacity_ += size;
+    ++numHeapAllocations_;
+}
+
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../common/config.h"
+#include "../common/primitive_types.h"
+
+#include <cstddef>
+
+namespace dviglo
+{
+
+/// Linear allocator. Memory is allocated by moving a pointer forward and is released all at once by Reset().
+/// Destructors of the allocated objects are not called. Not thread-safe: each thread must use its own allocator.
+class DV_API ArenaAllocator
+{
+public:
+    /// Default size of a memory block.
+    static constexpr i32 DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    /// Construct. Memory is not allocated until needed.
+    explicit ArenaAllocator(i32 blockSize = DEFAULT_BLOCK_SIZE);
+    /// Destruct. Free all memory blocks.
+    ~ArenaAllocator();
+
+    /// Prevent copy construction.
+    ArenaAllocator(const ArenaAllocator& rhs) = delete;
+    /// Prevent assignment.
+    ArenaAllocator& operator =(const ArenaAllocator& rhs) = delete;
+
+    /// Allocate memory. Alignment must be a power of two.
+    void* Allocate(i32 size, i32 alignment = (i32)alignof(std::max_align_t));
+
+    /// Allocate uninitialized memory for an array of objects.
+    template <class T> T* Allocate(i32 count)
+    {
+        return static_cast<T*>(Allocate(count * (i32)sizeof(T), (i32)alignof(T)));
+    }
+
+    /// Release all allocated memory. If more than one block was used, they are replaced by one block of the total size,
+    /// so that the same amount of memory is allocated without heap allocations next time.
+    void Reset();
+
+    /// Return number of bytes allocated since the last reset, including alignment padding.
+    i32 GetUsedSize() const { return usedSize_; }
+    /// Return total size of the memory blocks.
+    i32 GetCapacity() const { return capacity_; }
+    /// Return number of heap allocations made by the allocator. Does not change when the usage does not grow.
+    i32 GetNumHeapAllocations() const { return numHeapAllocations_; }
+
+private:
+    /// Memory block header. Data follows.
+    struct Block
+    {
+        /// Previously used block.
+        Block* prev_;
+    };
+
+    /// Allocate a new block with at least the specified data size and make it current.
+    void AllocateBlock(i32 size);
+
+    /// Current block.
+    Block* block_ = nullptr;
+    /// Next free byte in the current block.
+    u8* position_ = nullptr;
+    /// End of the current block.
+    u8* end_ = nullptr;
+    /// Minimal size of a new block.
+    i32 blockSize_;
+    /// Number of bytes allocated since the last reset.
+    i32 usedSize_ = 0;
+    /// Total size of the blocks.
+    i32 capacity_ = 0;
+    /// Number of heap allocations.
+    i32 numHeapAllocations_ = 0;
+};
+
+}
@@ -0,0 +1,210 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "arena_allocator.h"
+#include "iter.h"
+
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace dviglo
+{
+
+/// %Vector which allocates its buffer from an ArenaAllocator. When the vector grows, the old buffer is not freed,
+/// all memory is released by resetting the allocator. The vector must not be used after that.
+/// Only for trivially copyable and destructible types, as elements are copied with memcpy() and never destructed.
+template <class T> class ArenaVector
+{
+    static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value);
+
+public:
+    using ValueType = T;
+    using Iterator = RandomAccessIterator<T>;
+    using ConstIterator = RandomAccessConstIterator<T>;
+
+    /// Construct empty without an allocator. SetAllocator() must be called before adding elements.
+    ArenaVector() noexcept = default;
+
+    /// Construct empty with an allocator.
+    explicit ArenaVector(ArenaAllocator* allocator) noexcept :
+        allocator_(allocator)
+    {
+    }
+
+    /// Copy-construct from another vector. The buffer is allocated from the same allocator.
+    ArenaVector(const ArenaVector<T>& vector) :
+        allocator_(vector.allocator_)
+    {
+        *this = vector;
+    }
+
+    /// Move-construct from another vector.
+    ArenaVector(ArenaVector<T>&& vector) noexcept
+    {
+        Swap(vector);
+    }
+
+    /// Assign from another vector.
+    ArenaVector<T>& operator =(const ArenaVector<T>& rhs)
+    {
+        if (&rhs != this)
+        {
+            if (!allocator_)
+                allocator_ = rhs.allocator_;
+
+            Resize(rhs.size_);
+            if (size_)
+                memcpy(buffer_, rhs.buffer_, size_ * sizeof(T));
+        }
+
+        return *this;
+    }
+
+    /// Move-assign from another vector.
+    ArenaVector<T>& operator =(ArenaVector<T>&& rhs) noexcept
+    {
+        Swap(rhs);
+        return *this;
+    }
+
+    /// Return element at index.
+    T& operator [](i32 index)
+    {
+        assert(index >= 0 && index < size_);
+        return buffer_[index];
+    }
+
+    /// Return const element at index.
+    const T& operator [](i32 index) const
+    {
+        assert(index >= 0 && index < size_);
+        return buffer_[index];
+    }
+
+    /// Set the allocator. Can only be done when there is no buffer.
+    void SetAllocator(ArenaAllocator* allocator)
+    {
+        assert(!buffer_);
+        allocator_ = allocator;
+    }
+
+    /// Add an element at the end.
+    void Push(const T& value)
+    {
+        if (size_ == capacity_)
+            Reserve(capacity_ ? capacity_ * 2 : MIN_CAPACITY);
+
+        buffer_[size_++] = value;
+    }
+
+    /// Create an element at the end.
+    template <class... Args> T& EmplaceBack(Args&&... args)
+    {
+        if (size_ == capacity_)
+            Reserve(capacity_ ? capacity_ * 2 : MIN_CAPACITY);
+
+        return *new(buffer_ + size_++) T(std::forward<Args>(args)...);
+    }
+
+    /// Remove the last element.
+    void Pop()
+    {
+        assert(size_ > 0);
+        --size_;
+    }
+
+    /// Resize the vector. New elements are not initialized.
+    void Resize(i32 newSize)
+    {
+        assert(newSize >= 0);
+
+        if (newSize > capacity_)
+            Reserve(newSize);
+
+        size_ = newSize;
+    }
+
+    /// Make sure that the capacity is at least the specified number of elements.
+    void Reserve(i32 newCapacity)
+    {
+        if (newCapacity <= capacity_)
+            return;
+
+        assert(allocator_);
+        T* newBuffer = allocator_->Allocate<T>(newCapacity);
+        if (size_)
+            memcpy(newBuffer, buffer_, size_ * sizeof(T));
+
+        buffer_ = newBuffer;
+        capacity_ = newCapacity;
+    }
+
+    /// Clear the vector. The buffer is kept.
+    void Clear() { size_ = 0; }
+
+    /// Swap with another vector.
+    void Swap(ArenaVector<T>& rhs)
+    {
+        std::swap(allocator_, rhs.allocator_);
+        std::swap(buffer_, rhs.buffer_);
+        std::swap(size_, rhs.size_);
+        std::swap(capacity_, rhs.capacity_);
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(buffer_); }
+    /// Return const iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(buffer_); }
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(buffer_ + size_); }
+    /// Return const iterator to the end.
+    ConstIterator End() const { return ConstIterator(buffer_ + size_); }
+
+    /// Return first element.
+    T& Front() { assert(size_ > 0); return buffer_[0]; }
+    /// Return const first element.
+    const T& Front() const { assert(size_ > 0); return buffer_[0]; }
+    /// Return last element.
+    T& Back() { assert(size_ > 0); return buffer_[size_ - 1]; }
+    /// Return const last element.
+    const T& Back() const { assert(size_ > 0); return buffer_[size_ - 1]; }
+
+    /// Return the buffer with right type.
+    T* Buffer() const { return buffer_; }
+    /// Return number of elements.
+    i32 Size() const { return size_; }
+    /// Return capacity of the buffer.
+    i32 Capacity() const { return capacity_; }
+    /// Return whether vector is empty.
+    bool Empty() const { return size_ == 0; }
+    /// Return the allocator.
+    ArenaAllocator* GetAllocator() const { return allocator_; }
+
+private:
+    /// Capacity of the first buffer.
+    static constexpr i32 MIN_CAPACITY = 8;
+
+    /// Allocator.
+    ArenaAllocator* allocator_ = nullptr;
+    /// Buffer.
+    T* buffer_ = nullptr;
+    /// Number of elements.
+    i32 size_ = 0;
+    /// Buffer capacity.
+    i32 capacity_ = 0;
+};
+
+template <class T> typename dviglo::ArenaVector<T>::ConstIterator begin(const dviglo::ArenaVector<T>& v) { return v.Begin(); }
+
+template <class T> typename dviglo::ArenaVector<T>::ConstIterator end(const dviglo::ArenaVector<T>& v) { return v.End(); }
+
+template <class T> typename dviglo::ArenaVector<T>::Iterator begin(dviglo::ArenaVector<T>& v) { return v.Begin(); }
+
+template <class T> typename dviglo::ArenaVector<T>::Iterator end(dviglo::ArenaVector<T>& v) { return v.End(); }
+
+}
@@ -0,0 +1,228 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../common/config.h"
+#include "../common/primitive_types.h"
+
+#include "hash.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DV_FLAT_HASH_SSE2
+    #include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace dviglo
+{
+
+/// Base class for open-addressing hash set/map. Slots are divided into groups of 16. Each slot has a control byte,
+/// which either marks the slot as empty or deleted, or holds 7 bits of the key hash. A group is searched for a key
+/// with one SIMD comparison of the control bytes, and the keys are compared only for the matching slots.
+class FlatHashBase
+{
+public:
+    /// Number of slots in a group.
+    static constexpr i32 GROUP_SIZE = 16;
+
+    /// Return number of elements.
+    i32 Size() const { return size_; }
+
+    /// Return number of slots.
+    i32 Capacity() const { return capacity_; }
+
+    /// Return whether has no elements.
+    bool Empty() const { return size_ == 0; }
+
+protected:
+    /// Bit mask of slots in a group.
+    using GroupMask = u32;
+
+    /// Control byte of an empty slot.
+    static constexpr i8 CTRL_EMPTY = -128;
+    /// Control byte of a slot whose element was erased.
+    static constexpr i8 CTRL_DELETED = -2;
+
+    /// Construct empty.
+    FlatHashBase() = default;
+
+    /// Mix bits of the key hash. MakeHash() of integers and pointers returns poorly distributed values.
+    static hash32 MixHash(hash32 hash)
+    {
+        // Finalizer of MurmurHash3
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    /// Return control byte of a full slot for the mixed hash.
+    static i8 GetHashTag(hash32 hash) { return (i8)(hash & 0x7f); }
+
+    /// Return index of the lowest set bit. The mask must not be zero.
+    static i32 GetLowestBit(GroupMask mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (i32)index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    /// Return mask of slots in the group with the specified control byte.
+    GroupMask MatchByte(i32 groupStart, i8 value) const
+    {
+#ifdef DV_FLAT_HASH_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl_ + groupStart));
+        return (GroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+#else
+        GroupMask mask = 0;
+        for (i32 i = 0; i < GROUP_SIZE; ++i)
+        {
+            if (ctrl_[groupStart + i] == value)
+                mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    /// Return mask of empty or deleted slots in the group.
+    GroupMask MatchFree(i32 groupStart) const
+    {
+#ifdef DV_FLAT_HASH_SSE2
+        // Only empty and deleted slots have the sign bit set
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl_ + groupStart));
+        return (GroupMask)_mm_movemask_epi8(ctrl);
+#else
+        GroupMask mask = 0;
+        for (i32 i = 0; i < GROUP_SIZE; ++i)
+        {
+            if (ctrl_[groupStart + i] < 0)
+                mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    /// Return index of the first group to probe for the mixed hash.
+    i32 GetFirstGroup(hash32 hash) const { return (i32)(hash >> 7) & (capacity_ / GROUP_SIZE - 1); }
+
+    /// Return index of the next group to probe. Probe is 1 for the first call and is incremented for each next call.
+    /// Triangular steps visit all groups, because the number of groups is a power of two.
+    i32 GetNextGroup(i32 group, i32 probe) const { return (group + probe) & (capacity_ / GROUP_SIZE - 1); }
+
+    /// Return index of an empty or deleted slot for a new element with the mixed hash. There must be such a slot.
+    i32 FindFreeSlot(hash32 hash) const
+    {
+        i32 group = GetFirstGroup(hash);
+
+        for (i32 probe = 1;; ++probe)
+        {
+            GroupMask mask = MatchFree(group * GROUP_SIZE);
+            if (mask)
+                return group * GROUP_SIZE + GetLowestBit(mask);
+
+            group = GetNextGroup(group, probe);
+        }
+    }
+
+    /// Return whether an element can be added without rehashing.
+    bool HasFreeSlot() const { return size_ + numDeleted_ < capacity_ - capacity_ / 8; }
+
+    /// Return number of slots for the specified number of elements.
+    static i32 GetCapacityFor(i32 numElements)
+    {
+        i32 capacity = GROUP_SIZE;
+        while (numElements >= capacity - capacity / 8)
+            capacity *= 2;
+        return capacity;
+    }
+
+    /// Return index of the first full slot starting from the specified index, or the capacity if there is none.
+    i32 FindFullSlot(i32 index) const
+    {
+        while (index < capacity_ && ctrl_[index] < 0)
+            ++index;
+        return index;
+    }
+
+    /// Mark a free slot as full with an element with the mixed hash.
+    void SetFull(i32 index, hash32 hash)
+    {
+        if (ctrl_[index] == CTRL_DELETED)
+            --numDeleted_;
+
+        ctrl_[index] = GetHashTag(hash);
+        ++size_;
+    }
+
+    /// Mark a full slot as free.
+    void SetFree(i32 index)
+    {
+        // If the group has an empty slot, search never continued past this group, so the slot can become empty.
+        // Otherwise a tombstone is needed to keep the probe sequences of other keys
+        i32 groupStart = index & ~(GROUP_SIZE - 1);
+        if (MatchByte(groupStart, CTRL_EMPTY))
+        {
+            ctrl_[index] = CTRL_EMPTY;
+        }
+        else
+        {
+            ctrl_[index] = CTRL_DELETED;
+            ++numDeleted_;
+        }
+
+        --size_;
+    }
+
+    /// Allocate control bytes with all slots empty.
+    void AllocateCtrl(i32 capacity)
+    {
+        capacity_ = capacity;
+        ctrl_ = new i8[capacity];
+        memset(ctrl_, CTRL_EMPTY, capacity);
+        size_ = 0;
+        numDeleted_ = 0;
+    }
+
+    /// Mark all slots empty.
+    void ResetCtrl()
+    {
+        if (ctrl_)
+            memset(ctrl_, CTRL_EMPTY, capacity_);
+
+        size_ = 0;
+        numDeleted_ = 0;
+    }
+
+    /// Swap with another hash set/map.
+    void Swap(FlatHashBase& rhs)
+    {
+        std::swap(ctrl_, rhs.ctrl_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(size_, rhs.size_);
+        std::swap(numDeleted_, rhs.numDeleted_);
+    }
+
+    /// Control bytes.
+    i8* ctrl_ = nullptr;
+    /// Number of slots. Zero or a power of two not less than GROUP_SIZE.
+    i32 capacity_ = 0;
+    /// Number of elements.
+    i32 size_ = 0;
+    /// Number of deleted slots.
+    i32 numDeleted_ = 0;
+};
+
+}
@@ -0,0 +1,473 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "flat_hash_base.h"
+#include "pair.h"
+#include "vector.h"
+
+#include <initializer_list>
+#include <new>
+
+namespace dviglo
+{
+
+/// Open-addressing hash map template class. Keys and values are stored in one array without per-element allocations.
+/// Unlike HashMap, the iteration order is not the insertion order, and inserting or rehashing invalidates iterators
+/// and pointers to the elements.
+template <class T, class U> class FlatHashMap : public FlatHashBase
+{
+public:
+    using KeyType = T;
+    using ValueType = U;
+
+    /// Hash map key-value pair with const key.
+    class KeyValue
+    {
+    public:
+        /// Construct with key and value.
+        KeyValue(const T& first, const U& second) :
+            first_(first),
+            second_(second)
+        {
+        }
+
+        /// Construct with key and default value.
+        explicit KeyValue(const T& first) :
+            first_(first),
+            second_()
+        {
+        }
+
+        /// Move-construct. Key is copied, because it is const.
+        KeyValue(KeyValue&& value) noexcept :
+            first_(value.first_),
+            second_(std::move(value.second_))
+        {
+        }
+
+        /// Prevent assignment.
+        KeyValue& operator =(const KeyValue& rhs) = delete;
+
+        /// Test for equality with another pair.
+        bool operator ==(const KeyValue& rhs) const { return first_ == rhs.first_ && second_ == rhs.second_; }
+
+        /// Test for inequality with another pair.
+        bool operator !=(const KeyValue& rhs) const { return first_ != rhs.first_ || second_ != rhs.second_; }
+
+        /// Key.
+        const T first_;
+        /// Value.
+        U second_;
+    };
+
+    /// Hash map iterator.
+    struct Iterator
+    {
+        /// Construct.
+        Iterator() = default;
+
+        /// Construct with a map and a slot index.
+        Iterator(FlatHashMap* map, i32 index) :
+            map_(map),
+            index_(index)
+        {
+        }
+
+        /// Preincrement the slot index.
+        Iterator& operator ++()
+        {
+            index_ = map_->FindFullSlot(index_ + 1);
+            return *this;
+        }
+
+        /// Postincrement the slot index.
+        Iterator operator ++(int)
+        {
+            Iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        /// Point to the pair.
+        KeyValue* operator ->() const { return map_->slots_ + index_; }
+
+        /// Dereference the pair.
+        KeyValue& operator *() const { return map_->slots_[index_]; }
+
+        /// Test for equality with another iterator.
+        bool operator ==(const Iterator& rhs) const { return index_ == rhs.index_ && map_ == rhs.map_; }
+
+        /// Test for inequality with another iterator.
+        bool operator !=(const Iterator& rhs) const { return index_ != rhs.index_ || map_ != rhs.map_; }
+
+        /// Map.
+        FlatHashMap* map_ = nullptr;
+        /// Slot index.
+        i32 index_ = 0;
+    };
+
+    /// Hash map const iterator.
+    struct ConstIterator
+    {
+        /// Construct.
+        ConstIterator() = default;
+
+        /// Construct with a map and a slot index.
+        ConstIterator(const FlatHashMap* map, i32 index) :
+            map_(map),
+            index_(index)
+        {
+        }
+
+        /// Construct from a non-const iterator.
+        ConstIterator(const Iterator& rhs) :        // NOLINT(google-explicit-constructor)
+            map_(rhs.map_),
+            index_(rhs.index_)
+        {
+        }
+
+        /// Preincrement the slot index.
+        ConstIterator& operator ++()
+        {
+            index_ = map_->FindFullSlot(index_ + 1);
+            return *this;
+        }
+
+        /// Postincrement the slot index.
+        ConstIterator operator ++(int)
+        {
+            ConstIterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        /// Point to the pair.
+        const KeyValue* operator ->() const { return map_->slots_ + index_; }
+
+        /// Dereference the pair.
+        const KeyValue& operator *() const { return map_->slots_[index_]; }
+
+        /// Test for equality with another iterator.
+        bool operator ==(const ConstIterator& rhs) const { return index_ == rhs.index_ && map_ == rhs.map_; }
+
+        /// Test for inequality with another iterator.
+        bool operator !=(const ConstIterator& rhs) const { return index_ != rhs.index_ || map_ != rhs.map_; }
+
+        /// Map.
+        const FlatHashMap* map_ = nullptr;
+        /// Slot index.
+        i32 index_ = 0;
+    };
+
+    /// Construct empty.
+    FlatHashMap() = default;
+
+    /// Construct from another hash map.
+    FlatHashMap(const FlatHashMap<T, U>& map)
+    {
+        Insert(map);
+    }
+
+    /// Move-construct from another hash map.
+    FlatHashMap(FlatHashMap<T, U>&& map) noexcept
+    {
+        Swap(map);
+    }
+
+    /// Aggregate initialization constructor.
+    FlatHashMap(const std::initializer_list<Pair<T, U>>& list)
+    {
+        Reserve((i32)list.size());
+        for (const Pair<T, U>& pair : list)
+            Insert(pair);
+    }
+
+    /// Destruct.
+    ~FlatHashMap()
+    {
+        Clear();
+        Deallocate();
+    }
+
+    /// Assign a hash map.
+    FlatHashMap& operator =(const FlatHashMap<T, U>& rhs)
+    {
+        if (&rhs != this)
+        {
+            Clear();
+            Insert(rhs);
+        }
+
+        return *this;
+    }
+
+    /// Move-assign a hash map.
+    FlatHashMap& operator =(FlatHashMap<T, U>&& rhs) noexcept
+    {
+        Swap(rhs);
+        return *this;
+    }
+
+    /// Index the map. Create a new pair if key not found.
+    U& operator [](const T& key)
+    {
+        bool exists;
+        i32 index = FindOrPrepareInsert(key, exists);
+        if (!exists)
+            new(slots_ + index) KeyValue(key);
+
+        return slots_[index].second_;
+    }
+
+    /// Index the map. Return null if key is not found, does not create a new pair.
+    U* operator [](const T& key) const
+    {
+        i32 index = FindIndex(key);
+        return index >= 0 ? &slots_[index].second_ : nullptr;
+    }
+
+    /// Insert a pair. Return an iterator to it. Existing value is overwritten.
+    Iterator Insert(const Pair<T, U>& pair)
+    {
+        bool exists;
+        return Insert(pair, exists);
+    }
+
+    /// Insert a pair. Return an iterator to it and set exists flag. Existing value is overwritten.
+    Iterator Insert(const Pair<T, U>& pair, bool& exists)
+    {
+        i32 index = FindOrPrepareInsert(pair.first_, exists);
+        if (exists)
+            slots_[index].second_ = pair.second_;
+        else
+            new(slots_ + index) KeyValue(pair.first_, pair.second_);
+
+        return Iterator(this, index);
+    }
+
+    /// Insert a map.
+    void Insert(const FlatHashMap<T, U>& map)
+    {
+        Reserve(size_ + map.Size());
+        for (ConstIterator i = map.Begin(); i != map.End(); ++i)
+            Insert(MakePair(i->first_, i->second_));
+    }
+
+    /// Erase a pair by key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        i32 index = FindIndex(key);
+        if (index < 0)
+            return false;
+
+        EraseSlot(index);
+        return true;
+    }
+
+    /// Erase a pair by iterator. Return iterator to the next pair.
+    Iterator Erase(const Iterator& it)
+    {
+        EraseSlot(it.index_);
+        return Iterator(this, FindFullSlot(it.index_ + 1));
+    }
+
+    /// Clear the map. Memory is kept for reuse.
+    void Clear()
+    {
+        if (!size_)
+            return;
+
+        for (i32 i = FindFullSlot(0); i < capacity_; i = FindFullSlot(i + 1))
+            slots_[i].~KeyValue();
+
+        ResetCtrl();
+    }
+
+    /// Reserve memory for the specified number of pairs, so that adding them does not rehash.
+    void Reserve(i32 numKeys)
+    {
+        if (numKeys > 0 && GetCapacityFor(numKeys) > capacity_)
+            Rehash(GetCapacityFor(numKeys));
+    }
+
+    /// Return iterator to the pair with key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        i32 index = FindIndex(key);
+        return index >= 0 ? Iterator(this, index) : End();
+    }
+
+    /// Return iterator to the pair with key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        i32 index = FindIndex(key);
+        return index >= 0 ? ConstIterator(this, index) : End();
+    }
+
+    /// Return whether contains a pair with key.
+    bool Contains(const T& key) const { return FindIndex(key) >= 0; }
+
+    /// Try to copy value to output. Return true if was found.
+    bool TryGetValue(const T& key, U& out) const
+    {
+        i32 index = FindIndex(key);
+        if (index < 0)
+            return false;
+
+        out = slots_[index].second_;
+        return true;
+    }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(size_);
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->first_);
+        return result;
+    }
+
+    /// Return all the values.
+    Vector<U> Values() const
+    {
+        Vector<U> result;
+        result.Reserve(size_);
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->second_);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(this, FindFullSlot(0)); }
+
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(this, FindFullSlot(0)); }
+
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(this, capacity_); }
+
+    /// Return iterator to the end.
+    ConstIterator End() const { return ConstIterator(this, capacity_); }
+
+    /// Swap with another hash map.
+    void Swap(FlatHashMap<T, U>& rhs)
+    {
+        FlatHashBase::Swap(rhs);
+        std::swap(slots_, rhs.slots_);
+    }
+
+private:
+    /// Return index of the slot with key, or -1 if not found.
+    i32 FindIndex(const T& key) const
+    {
+        return size_ ? FindIndex(key, MixHash(MakeHash(key))) : -1;
+    }
+
+    /// Return index of the slot with key and mixed hash, or -1 if not found.
+    i32 FindIndex(const T& key, hash32 hash) const
+    {
+        i8 tag = GetHashTag(hash);
+        i32 group = GetFirstGroup(hash);
+
+        for (i32 probe = 1;; ++probe)
+        {
+            i32 groupStart = group * GROUP_SIZE;
+
+            for (GroupMask mask = MatchByte(groupStart, tag); mask; mask &= mask - 1)
+            {
+                i32 index = groupStart + GetLowestBit(mask);
+                if (slots_[index].first_ == key)
+                    return index;
+            }
+
+            // Key would have been placed in this group
+            if (MatchByte(groupStart, CTRL_EMPTY))
+                return -1;
+
+            group = GetNextGroup(group, probe);
+        }
+    }
+
+    /// Return index of the slot with key. If not found, rehash if necessary, mark a free slot as full and return its index.
+    /// The caller must construct the pair in the new slot.
+    i32 FindOrPrepareInsert(const T& key, bool& exists)
+    {
+        hash32 hash = MixHash(MakeHash(key));
+        i32 index = size_ ? FindIndex(key, hash) : -1;
+        exists = index >= 0;
+        if (exists)
+            return index;
+
+        if (!HasFreeSlot())
+            Rehash(GetCapacityFor(size_ + 1));
+
+        index = FindFreeSlot(hash);
+        SetFull(index, hash);
+        return index;
+    }
+
+    /// Destroy the pair in a full slot.
+    void EraseSlot(i32 index)
+    {
+        slots_[index].~KeyValue();
+        SetFree(index);
+    }
+
+    /// Move the pairs to new storage. Also removes deleted slots.
+    void Rehash(i32 capacity)
+    {
+        i8* oldCtrl = ctrl_;
+        KeyValue* oldSlots = slots_;
+        i32 oldCapacity = capacity_;
+
+        AllocateCtrl(capacity);
+        slots_ = static_cast<KeyValue*>(::operator new(sizeof(KeyValue) * capacity, std::align_val_t(alignof(KeyValue))));
+
+        for (i32 i = 0; i < oldCapacity; ++i)
+        {
+            if (oldCtrl[i] < 0)
+                continue;
+
+            hash32 hash = MixHash(MakeHash(oldSlots[i].first_));
+            i32 index = FindFreeSlot(hash);
+            SetFull(index, hash);
+            new(slots_ + index) KeyValue(std::move(oldSlots[i]));
+            oldSlots[i].~KeyValue();
+        }
+
+        delete[] oldCtrl;
+        if (oldSlots)
+            ::operator delete(oldSlots, std::align_val_t(alignof(KeyValue)));
+    }
+
+    /// Free the storage. All pairs must be destroyed.
+    void Deallocate()
+    {
+        delete[] ctrl_;
+        ctrl_ = nullptr;
+
+        if (slots_)
+        {
+            ::operator delete(slots_, std::align_val_t(alignof(KeyValue)));
+            slots_ = nullptr;
+        }
+
+        capacity_ = 0;
+    }
+
+    /// Key-value pairs. Only full slots are constructed.
+    KeyValue* slots_ = nullptr;
+};
+
+template <class T, class U> typename dviglo::FlatHashMap<T, U>::ConstIterator begin(const dviglo::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename dviglo::FlatHashMap<T, U>::ConstIterator end(const dviglo::FlatHashMap<T, U>& v) { return v.End(); }
+
+template <class T, class U> typename dviglo::FlatHashMap<T, U>::Iterator begin(dviglo::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename dviglo::FlatHashMap<T, U>::Iterator end(dviglo::FlatHashMap<T, U>& v) { return v.End(); }
+
+}
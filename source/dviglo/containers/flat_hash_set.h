@@ -0,0 +1,315 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "flat_hash_base.h"
+#include "vector.h"
+
+#include <initializer_list>
+#include <new>
+
+namespace dviglo
+{
+
+/// Open-addressing hash set template class. Keys are stored in one array without per-element allocations.
+/// Unlike HashSet, the iteration order is not the insertion order, and inserting or rehashing invalidates iterators
+/// and pointers to the keys.
+template <class T> class FlatHashSet : public FlatHashBase
+{
+public:
+    using KeyType = T;
+
+    /// Hash set iterator.
+    struct Iterator
+    {
+        /// Construct.
+        Iterator() = default;
+
+        /// Construct with a set and a slot index.
+        Iterator(const FlatHashSet* set, i32 index) :
+            set_(set),
+            index_(index)
+        {
+        }
+
+        /// Preincrement the slot index.
+        Iterator& operator ++()
+        {
+            index_ = set_->FindFullSlot(index_ + 1);
+            return *this;
+        }
+
+        /// Postincrement the slot index.
+        Iterator operator ++(int)
+        {
+            Iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        /// Point to the key.
+        const T* operator ->() const { return set_->slots_ + index_; }
+
+        /// Dereference the key.
+        const T& operator *() const { return set_->slots_[index_]; }
+
+        /// Test for equality with another iterator.
+        bool operator ==(const Iterator& rhs) const { return index_ == rhs.index_ && set_ == rhs.set_; }
+
+        /// Test for inequality with another iterator.
+        bool operator !=(const Iterator& rhs) const { return index_ != rhs.index_ || set_ != rhs.set_; }
+
+        /// Set.
+        const FlatHashSet* set_ = nullptr;
+        /// Slot index.
+        i32 index_ = 0;
+    };
+
+    /// Keys can not be modified, so the const iterator is the same.
+    using ConstIterator = Iterator;
+
+    /// Construct empty.
+    FlatHashSet() = default;
+
+    /// Construct from another hash set.
+    FlatHashSet(const FlatHashSet<T>& set)
+    {
+        Insert(set);
+    }
+
+    /// Move-construct from another hash set.
+    FlatHashSet(FlatHashSet<T>&& set) noexcept
+    {
+        Swap(set);
+    }
+
+    /// Aggregate initialization constructor.
+    FlatHashSet(const std::initializer_list<T>& list)
+    {
+        Reserve((i32)list.size());
+        for (const T& key : list)
+            Insert(key);
+    }
+
+    /// Destruct.
+    ~FlatHashSet()
+    {
+        Clear();
+        Deallocate();
+    }
+
+    /// Assign a hash set.
+    FlatHashSet& operator =(const FlatHashSet<T>& rhs)
+    {
+        if (&rhs != this)
+        {
+            Clear();
+            Insert(rhs);
+        }
+
+        return *this;
+    }
+
+    /// Move-assign a hash set.
+    FlatHashSet& operator =(FlatHashSet<T>&& rhs) noexcept
+    {
+        Swap(rhs);
+        return *this;
+    }
+
+    /// Insert a key. Return an iterator to it.
+    Iterator Insert(const T& key)
+    {
+        bool exists;
+        return Insert(key, exists);
+    }
+
+    /// Insert a key. Return an iterator to it and set exists flag.
+    Iterator Insert(const T& key, bool& exists)
+    {
+        hash32 hash = MixHash(MakeHash(key));
+        i32 index = size_ ? FindIndex(key, hash) : -1;
+        exists = index >= 0;
+
+        if (!exists)
+        {
+            if (!HasFreeSlot())
+                Rehash(GetCapacityFor(size_ + 1));
+
+            index = FindFreeSlot(hash);
+            SetFull(index, hash);
+            new(slots_ + index) T(key);
+        }
+
+        return Iterator(this, index);
+    }
+
+    /// Insert a set.
+    void Insert(const FlatHashSet<T>& set)
+    {
+        Reserve(size_ + set.Size());
+        for (const T& key : set)
+            Insert(key);
+    }
+
+    /// Erase a key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        i32 index = FindIndex(key);
+        if (index < 0)
+            return false;
+
+        EraseSlot(index);
+        return true;
+    }
+
+    /// Erase a key by iterator. Return iterator to the next key.
+    Iterator Erase(const Iterator& it)
+    {
+        EraseSlot(it.index_);
+        return Iterator(this, FindFullSlot(it.index_ + 1));
+    }
+
+    /// Clear the set. Memory is kept for reuse.
+    void Clear()
+    {
+        if (!size_)
+            return;
+
+        for (i32 i = FindFullSlot(0); i < capacity_; i = FindFullSlot(i + 1))
+            slots_[i].~T();
+
+        ResetCtrl();
+    }
+
+    /// Reserve memory for the specified number of keys, so that adding them does not rehash.
+    void Reserve(i32 numKeys)
+    {
+        if (numKeys > 0 && GetCapacityFor(numKeys) > capacity_)
+            Rehash(GetCapacityFor(numKeys));
+    }
+
+    /// Return iterator to the key, or end iterator if not found.
+    Iterator Find(const T& key) const
+    {
+        i32 index = FindIndex(key);
+        return index >= 0 ? Iterator(this, index) : End();
+    }
+
+    /// Return whether contains a key.
+    bool Contains(const T& key) const { return FindIndex(key) >= 0; }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(size_);
+        for (const T& key : *this)
+            result.Push(key);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() const { return Iterator(this, FindFullSlot(0)); }
+
+    /// Return iterator to the end.
+    Iterator End() const { return Iterator(this, capacity_); }
+
+    /// Swap with another hash set.
+    void Swap(FlatHashSet<T>& rhs)
+    {
+        FlatHashBase::Swap(rhs);
+        std::swap(slots_, rhs.slots_);
+    }
+
+private:
+    /// Return index of the slot with key, or -1 if not found.
+    i32 FindIndex(const T& key) const
+    {
+        return size_ ? FindIndex(key, MixHash(MakeHash(key))) : -1;
+    }
+
+    /// Return index of the slot with key and mixed hash, or -1 if not found.
+    i32 FindIndex(const T& key, hash32 hash) const
+    {
+        i8 tag = GetHashTag(hash);
+        i32 group = GetFirstGroup(hash);
+
+        for (i32 probe = 1;; ++probe)
+        {
+            i32 groupStart = group * GROUP_SIZE;
+
+            for (GroupMask mask = MatchByte(groupStart, tag); mask; mask &= mask - 1)
+            {
+                i32 index = groupStart + GetLowestBit(mask);
+                if (slots_[index] == key)
+                    return index;
+            }
+
+            // Key would have been placed in this group
+            if (MatchByte(groupStart, CTRL_EMPTY))
+                return -1;
+
+            group = GetNextGroup(group, probe);
+        }
+    }
+
+    /// Destroy the key in a full slot.
+    void EraseSlot(i32 index)
+    {
+        slots_[index].~T();
+        SetFree(index);
+    }
+
+    /// Move the keys to new storage. Also removes deleted slots.
+    void Rehash(i32 capacity)
+    {
+        i8* oldCtrl = ctrl_;
+        T* oldSlots = slots_;
+        i32 oldCapacity = capacity_;
+
+        AllocateCtrl(capacity);
+        slots_ = static_cast<T*>(::operator new(sizeof(T) * capacity, std::align_val_t(alignof(T))));
+
+        for (i32 i = 0; i < oldCapacity; ++i)
+        {
+            if (oldCtrl[i] < 0)
+                continue;
+
+            hash32 hash = MixHash(MakeHash(oldSlots[i]));
+            i32 index = FindFreeSlot(hash);
+            SetFull(index, hash);
+            new(slots_ + index) T(std::move(oldSlots[i]));
+            oldSlots[i].~T();
+        }
+
+        delete[] oldCtrl;
+        if (oldSlots)
+            ::operator delete(oldSlots, std::align_val_t(alignof(T)));
+    }
+
+    /// Free the storage. All keys must be destroyed.
+    void Deallocate()
+    {
+        delete[] ctrl_;
+        ctrl_ = nullptr;
+
+        if (slots_)
+        {
+            ::operator delete(slots_, std::align_val_t(alignof(T)));
+            slots_ = nullptr;
+        }
+
+        capacity_ = 0;
+    }
+
+    /// Keys. Only full slots are constructed.
+    T* slots_ = nullptr;
+};
+
+template <class T> typename dviglo::FlatHashSet<T>::ConstIterator begin(const dviglo::FlatHashSet<T>& v) { return v.Begin(); }
+
+template <class T> typename dviglo::FlatHashSet<T>::ConstIterator end(const dviglo::FlatHashSet<T>& v) { return v.End(); }
+
+}
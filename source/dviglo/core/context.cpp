@@ -9,6 +9,9 @@
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_gesture.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "../common/debug_new.h"
 
 namespace dviglo
@@ -33,34 +36,143 @@ void EventReceiverGroup::EndSendEvent()
         for (i32 i = receivers_.Size() - 1; i >= 0; --i)
         {
             if (!receivers_[i])
+            {
                 receivers_.Erase(i);
+                sequences_.Erase(i);
+            }
+        }
+
+        dirty_ = false;
+    }
+}
+
+void TypedEventHandlerGroup::EndSendEvent()
+{
+    assert(inSend_ > 0);
+    --inSend_;
+
+    if (inSend_ == 0 && dirty_)
+    {
+        for (i32 i = handlers_.Size() - 1; i >= 0; --i)
+        {
+            if (!handlers_[i])
+            {
+                handlers_.Erase(i);
+                sequences_.Erase(i);
+            }
         }
 
         dirty_ = false;
     }
 }
 
-void EventReceiverGroup::Add(Object* object)
+void TypedEventHandlerGroup::Add(TypedEventHandler* handler, u64 sequence)
+{
+    if (handler)
+    {
+        handlers_.Push(handler);
+        sequences_.Push(sequence);
+    }
+}
+
+void TypedEventHandlerGroup::Replace(TypedEventHandler* oldHandler, TypedEventHandler* newHandler)
+{
+    i32 index = handlers_.IndexOf(oldHandler);
+    if (index < handlers_.Size())
+        handlers_[index] = newHandler;
+}
+
+void TypedEventHandlerGroup::Remove(TypedEventHandler* handler)
+{
+    i32 index = handlers_.IndexOf(handler);
+    if (index == handlers_.Size())
+        return;
+
+    if (inSend_ > 0)
+    {
+        handlers_[index] = nullptr;
+        dirty_ = true;
+    }
+    else
+    {
+        handlers_.Erase(index);
+        sequences_.Erase(index);
+    }
+}
+
+void EventReceiverGroup::Add(Object* object, u64 sequence)
 {
     if (object)
+    {
         receivers_.Push(object);
+        sequences_.Push(sequence);
+    }
 }
 
 void EventReceiverGroup::Remove(Object* object)
 {
+    i32 index = receivers_.IndexOf(object);
+    if (index == receivers_.Size())
+        return;
+
     if (inSend_ > 0)
     {
-        Vector<Object*>::Iterator i = receivers_.Find(object);
-        if (i != receivers_.End())
-        {
-            (*i) = nullptr;
-            dirty_ = true;
-        }
+        receivers_[index] = nullptr;
+        dirty_ = true;
     }
     else
-        receivers_.Remove(object);
+    {
+        receivers_.Erase(index);
+        sequences_.Erase(index);
+    }
 }
 
+/// Event posted with Object::PostEvent().
+struct PostedEvent
+{
+    /// Next event in the buffer.
+    PostedEvent* next_;
+    /// Global sequence number.
+    u64 sequence_;
+    /// Sender. Null if the sender was destroyed.
+    Object* sender_;
+    /// Event type.
+    StringHash eventType_;
+    /// Event data.
+    VariantMap eventData_;
+    /// Function to send typed event. If null, the event data is sent.
+    std::function<void(Object*)> send_;
+};
+
+/// Lock-free stack of events posted by one thread. Only the owning thread pushes, the main thread takes all events at once.
+struct PostedEventBuffer
+{
+    /// Last posted event.
+    std::atomic<PostedEvent*> head_{nullptr};
+    /// Owning thread is posting an event.
+    std::atomic<bool> posting_{false};
+    /// Buffer is owned by a running thread.
+    std::atomic<bool> owned_{true};
+    /// Next buffer in the list of the context. Does not change after the buffer is published.
+    PostedEventBuffer* next_ = nullptr;
+};
+
+/// Posted event buffer of a thread. Released for reuse when the thread exits.
+struct ThreadPostedEventBuffer
+{
+    /// Destruct.
+    ~ThreadPostedEventBuffer()
+    {
+        if (buffer_)
+            buffer_->owned_.store(false);
+    }
+
+    /// Buffer.
+    PostedEventBuffer* buffer_ = nullptr;
+};
+
+static thread_local ThreadPostedEventBuffer threadPostedEventBuffer;
+
 void RemoveNamedAttribute(HashMap<StringHash, Vector<AttributeInfo>>& attributes, StringHash objectType, const char* name)
 {
     HashMap<StringHash, Vector<AttributeInfo>>::Iterator i = attributes.Find(objectType);
@@ -92,6 +204,10 @@ Context& Context::get_instance()
 }
 
 Context::Context() :
+    postedEventBuffers_(nullptr),
+    postedEventSequence_(0),
+    numPostedEvents_(0),
+    sendingPostedEvents_(false),
     eventHandler_(nullptr)
 {
 #ifdef __ANDROID__
@@ -120,6 +236,21 @@ Context::~Context()
     for (Vector<VariantMap*>::Iterator i = eventDataMaps_.Begin(); i != eventDataMaps_.End(); ++i)
         delete *i;
     eventDataMaps_.Clear();
+
+    // Delete posted events which were never sent
+    CollectPostedEvents(false);
+    for (PostedEvent* event : pendingPostedEvents_)
+        delete event;
+    pendingPostedEvents_.Clear();
+
+    PostedEventBuffer* buffer = postedEventBuffers_.load();
+    while (buffer)
+    {
+        PostedEventBuffer* next = buffer->next_;
+        delete buffer;
+        buffer = next;
+    }
+    postedEventBuffers_ = nullptr;
 }
 
 SharedPtr<Object> Context::CreateObject(StringHash objectType)
@@ -352,7 +483,7 @@ void Context::AddEventReceiver(Object* receiver, StringHash eventType)
     SharedPtr<EventReceiverGroup>& group = eventReceivers_[eventType];
     if (!group)
         group = new EventReceiverGroup();
-    group->Add(receiver);
+    group->Add(receiver, ++lastSubscription_);
 }
 
 void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash eventType)
@@ -360,7 +491,7 @@ void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash even
     SharedPtr<EventReceiverGroup>& group = specificEventReceivers_[sender][eventType];
     if (!group)
         group = new EventReceiverGroup();
-    group->Add(receiver);
+    group->Add(receiver, ++lastSubscription_);
 }
 
 void Context::RemoveEventSender(Object* sender)
@@ -379,6 +510,210 @@ void Context::RemoveEventSender(Object* sender)
         }
         specificEventReceivers_.Erase(i);
     }
+
+    if (typedEventSenders_.Contains(sender))
+    {
+        // Collect first, as removing the handlers modifies the groups
+        Vector<Object*> receivers;
+        for (const SharedPtr<TypedEventHandlerGroup>& group : typedEventHandlers_)
+        {
+            if (!group)
+                continue;
+
+            for (TypedEventHandler* handler : group->handlers_)
+            {
+                if (handler && handler->GetSender() == sender && !receivers.Contains(handler->GetReceiver()))
+                    receivers.Push(handler->GetReceiver());
+            }
+        }
+
+        for (Object* receiver : receivers)
+            receiver->RemoveEventSender(sender);
+
+        typedEventSenders_.Erase(sender);
+    }
+
+    if (numPostedEvents_.load(std::memory_order_relaxed) && Thread::IsMainThread())
+        CancelPostedEvents(sender);
+}
+
+i32 Context::GetTypedEventId(StringHash eventType)
+{
+    HashMap<StringHash, i32>::Iterator i = typedEventIds_.Find(eventType);
+    if (i != typedEventIds_.End())
+        return i->second_;
+
+    i32 typedEventId = typedEventIds_.Size();
+    typedEventIds_[eventType] = typedEventId;
+    return typedEventId;
+}
+
+i32 Context::FindTypedEventId(StringHash eventType) const
+{
+    HashMap<StringHash, i32>::ConstIterator i = typedEventIds_.Find(eventType);
+    return i != typedEventIds_.End() ? i->second_ : NINDEX;
+}
+
+void Context::AddTypedEventHandler(TypedEventHandler* handler)
+{
+    i32 typedEventId = handler->GetTypedEventId();
+    if (typedEventId >= typedEventHandlers_.Size())
+        typedEventHandlers_.Resize(typedEventId + 1);
+
+    SharedPtr<TypedEventHandlerGroup>& group = typedEventHandlers_[typedEventId];
+    if (!group)
+        group = new TypedEventHandlerGroup();
+    group->Add(handler, ++lastSubscription_);
+
+    if (handler->GetSender())
+        ++typedEventSenders_[handler->GetSender()];
+}
+
+void Context::ReplaceTypedEventHandler(TypedEventHandler* oldHandler, TypedEventHandler* newHandler)
+{
+    TypedEventHandlerGroup* group = GetTypedEventHandlers(oldHandler->GetTypedEventId());
+    if (group)
+        group->Replace(oldHandler, newHandler);
+}
+
+void Context::RemoveTypedEventHandler(TypedEventHandler* handler)
+{
+    TypedEventHandlerGroup* group = GetTypedEventHandlers(handler->GetTypedEventId());
+    if (group)
+        group->Remove(handler);
+
+    if (handler->GetSender())
+    {
+        HashMap<Object*, i32>::Iterator i = typedEventSenders_.Find(handler->GetSender());
+        if (i != typedEventSenders_.End() && --i->second_ == 0)
+            typedEventSenders_.Erase(i);
+    }
+}
+
+void Context::PostEvent(Object* sender, StringHash eventType, const VariantMap& eventData, std::function<void(Object*)> send)
+{
+    auto* event = new PostedEvent();
+    event->sender_ = sender;
+    event->eventType_ = eventType;
+    event->eventData_ = eventData;
+    event->send_ = std::move(send);
+
+    PostedEventBuffer* buffer = GetPostedEventBuffer();
+
+    // Main thread waits while the flag is set, so all events with smaller sequence numbers are visible to it
+    buffer->posting_.store(true);
+    event->sequence_ = postedEventSequence_.fetch_add(1);
+    ++numPostedEvents_;
+
+    PostedEvent* head = buffer->head_.load(std::memory_order_relaxed);
+    do
+    {
+        event->next_ = head;
+    }
+    while (!buffer->head_.compare_exchange_weak(head, event, std::memory_order_release, std::memory_order_relaxed));
+
+    buffer->posting_.store(false);
+}
+
+PostedEventBuffer* Context::GetPostedEventBuffer()
+{
+    if (threadPostedEventBuffer.buffer_)
+        return threadPostedEventBuffer.buffer_;
+
+    // Reuse a buffer of an exited thread
+    for (PostedEventBuffer* buffer = postedEventBuffers_.load(); buffer; buffer = buffer->next_)
+    {
+        bool owned = false;
+        if (buffer->owned_.compare_exchange_strong(owned, true))
+        {
+            threadPostedEventBuffer.buffer_ = buffer;
+            return buffer;
+        }
+    }
+
+    auto* buffer = new PostedEventBuffer();
+    PostedEventBuffer* head = postedEventBuffers_.load(std::memory_order_relaxed);
+    do
+    {
+        buffer->next_ = head;
+    }
+    while (!postedEventBuffers_.compare_exchange_weak(head, buffer));
+
+    threadPostedEventBuffer.buffer_ = buffer;
+    return buffer;
+}
+
+void Context::CollectPostedEvents(bool waitPosting)
+{
+    for (PostedEventBuffer* buffer = postedEventBuffers_.load(); buffer; buffer = buffer->next_)
+    {
+        if (waitPosting)
+        {
+            while (buffer->posting_.load())
+                std::this_thread::yield();
+        }
+
+        PostedEvent* event = buffer->head_.exchange(nullptr, std::memory_order_acquire);
+        while (event)
+        {
+            pendingPostedEvents_.Push(event);
+            event = event->next_;
+        }
+    }
+}
+
+void Context::CancelPostedEvents(Object* sender)
+{
+    CollectPostedEvents(false);
+
+    for (PostedEvent* event : pendingPostedEvents_)
+    {
+        if (event->sender_ == sender)
+            event->sender_ = nullptr;
+    }
+}
+
+void Context::SendPostedEvents()
+{
+    assert(Thread::IsMainThread());
+
+    if (!numPostedEvents_.load(std::memory_order_relaxed) || sendingPostedEvents_)
+        return;
+
+    sendingPostedEvents_ = true;
+
+    // Events posted after this point are sent on the next call. All events with smaller sequence numbers are collected,
+    // so events are sent in the order they were posted, also when posted from different threads
+    u64 limit = postedEventSequence_.load();
+    CollectPostedEvents(true);
+
+    std::sort(pendingPostedEvents_.Begin(), pendingPostedEvents_.End(),
+        [](const PostedEvent* lhs, const PostedEvent* rhs) { return lhs->sequence_ < rhs->sequence_; });
+
+    i32 numEvents = 0;
+    while (numEvents < pendingPostedEvents_.Size() && pendingPostedEvents_[numEvents]->sequence_ < limit)
+        ++numEvents;
+
+    // Note: event handlers may destroy senders of subsequent events, which cancels them. Handlers may also collect
+    // more events to the end of the vector, so access by index
+    for (i32 i = 0; i < numEvents; ++i)
+    {
+        PostedEvent* event = pendingPostedEvents_[i];
+        if (!event->sender_)
+            continue;
+
+        if (event->send_)
+            event->send_(event->sender_);
+        else
+            event->sender_->SendEvent(event->eventType_, event->eventData_);
+    }
+
+    for (i32 i = 0; i < numEvents; ++i)
+        delete pendingPostedEvents_[i];
+
+    pendingPostedEvents_.Erase(0, numEvents);
+    numPostedEvents_ -= numEvents;
+    sendingPostedEvents_ = false;
 }
 
 void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
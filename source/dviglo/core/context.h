@@ -4,13 +4,19 @@
 
 #pragma once
 
+#include "../containers/flat_hash_map.h"
 #include "../containers/hash_set.h"
 #include "attribute.h"
 #include "object.h"
 
+#include <atomic>
+
 namespace dviglo
 {
 
+struct PostedEvent;
+struct PostedEventBuffer;
+
 /// Tracking structure for event receivers.
 class DV_API EventReceiverGroup : public RefCounted
 {
@@ -28,14 +34,16 @@ public:
     /// End event send. Clean up if necessary.
     void EndSendEvent();
 
-    /// Add receiver. Same receiver must not be double-added!
-    void Add(Object* object);
+    /// Add receiver with its subscription sequence number. Same receiver must not be double-added!
+    void Add(Object* object, u64 sequence);
 
     /// Remove receiver. Leave holes during send, which requires later cleanup.
     void Remove(Object* object);
 
     /// Receivers. May contain holes during sending.
     Vector<Object*> receivers_;
+    /// Subscription sequence numbers of the receivers. Typed event handlers are ordered with the receivers by them.
+    Vector<u64> sequences_;
 
 private:
     /// "In send" recursion counter.
@@ -44,6 +52,44 @@ private:
     bool dirty_;
 };
 
+/// Tracking structure for typed event handlers of one event type.
+class DV_API TypedEventHandlerGroup : public RefCounted
+{
+public:
+    /// Construct.
+    TypedEventHandlerGroup() :
+        inSend_(0),
+        dirty_(false)
+    {
+    }
+
+    /// Begin event send. When handlers are removed during send, group has to be cleaned up afterward.
+    void BeginSendEvent() { ++inSend_; }
+
+    /// End event send. Clean up if necessary.
+    void EndSendEvent();
+
+    /// Add handler with its subscription sequence number.
+    void Add(TypedEventHandler* handler, u64 sequence);
+
+    /// Replace handler keeping its place in the subscription order.
+    void Replace(TypedEventHandler* oldHandler, TypedEventHandler* newHandler);
+
+    /// Remove handler. Leave holes during send, which requires later cleanup.
+    void Remove(TypedEventHandler* handler);
+
+    /// Handlers in subscription order. May contain holes during sending.
+    Vector<TypedEventHandler*> handlers_;
+    /// Subscription sequence numbers of the handlers.
+    Vector<u64> sequences_;
+
+private:
+    /// "In send" recursion counter.
+    i32 inSend_;
+    /// Cleanup required flag.
+    bool dirty_;
+};
+
 /// Urho3D execution context. Provides access to subsystems, object factories and attributes, and event receivers.
 class DV_API Context
 {
@@ -181,13 +227,41 @@ public:
     /// Return event receivers for an event type, or null if they do not exist.
     EventReceiverGroup* GetEventReceivers(StringHash eventType)
     {
-        HashMap<StringHash, SharedPtr<EventReceiverGroup>>::Iterator i = eventReceivers_.Find(eventType);
+        FlatHashMap<StringHash, SharedPtr<EventReceiverGroup>>::Iterator i = eventReceivers_.Find(eventType);
         return i != eventReceivers_.End() ? i->second_ : nullptr;
     }
 
+    /// Send events posted with Object::PostEvent() in the order they were posted. Called by the Engine once per frame.
+    void SendPostedEvents();
+
+    /// Return typed event handlers for a typed event index, or null if they do not exist.
+    TypedEventHandlerGroup* GetTypedEventHandlers(i32 typedEventId)
+    {
+        return typedEventId < typedEventHandlers_.Size() ? typedEventHandlers_[typedEventId].Get() : nullptr;
+    }
+
+    /// Return index of a typed event. Indices are assigned on first use and are dense, so handler lists can be stored in an array.
+    i32 GetTypedEventId(StringHash eventType);
+    /// Return index of a typed event, or NINDEX if the event has no typed version or it has not been used yet.
+    i32 FindTypedEventId(StringHash eventType) const;
+
 private:
     /// Add event receiver.
     void AddEventReceiver(Object* receiver, StringHash eventType);
+    /// Add typed event handler.
+    void AddTypedEventHandler(TypedEventHandler* handler);
+    /// Replace typed event handler of the same receiver, sender and event type.
+    void ReplaceTypedEventHandler(TypedEventHandler* oldHandler, TypedEventHandler* newHandler);
+    /// Remove typed event handler.
+    void RemoveTypedEventHandler(TypedEventHandler* handler);
+    /// Post event from any thread. If the send function is null, the event is sent with event data.
+    void PostEvent(Object* sender, StringHash eventType, const VariantMap& eventData, std::function<void(Object*)> send);
+    /// Return posted event buffer of the calling thread.
+    PostedEventBuffer* GetPostedEventBuffer();
+    /// Move posted events from thread buffers to the pending events. Optionally wait for posts which are in progress.
+    void CollectPostedEvents(bool waitPosting);
+    /// Cancel posted events of a sender which is being destroyed.
+    void CancelPostedEvents(Object* sender);
     /// Add event receiver for specific event.
     void AddEventReceiver(Object* receiver, Object* sender, StringHash eventType);
     /// Remove an event sender from all receivers. Called on its destruction.
@@ -213,9 +287,27 @@ private:
     /// Network replication attribute descriptions per object type.
     HashMap<StringHash, Vector<AttributeInfo>> networkAttributes_;
     /// Event receivers for non-specific events.
-    HashMap<StringHash, SharedPtr<EventReceiverGroup>> eventReceivers_;
+    FlatHashMap<StringHash, SharedPtr<EventReceiverGroup>> eventReceivers_;
     /// Event receivers for specific senders' events.
     HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup>>> specificEventReceivers_;
+    /// Typed event indices by event type. Stored in the context, because objects send events while the context is destroyed.
+    HashMap<StringHash, i32> typedEventIds_;
+    /// Typed event handlers indexed by typed event index.
+    Vector<SharedPtr<TypedEventHandlerGroup>> typedEventHandlers_;
+    /// Number of typed event handlers per specific sender.
+    HashMap<Object*, i32> typedEventSenders_;
+    /// Sequence number of the last subscription.
+    u64 lastSubscription_ = 0;
+    /// Posted event buffers of all threads which have posted events.
+    std::atomic<PostedEventBuffer*> postedEventBuffers_;
+    /// Sequence number of the next posted event.
+    std::atomic<u64> postedEventSequence_;
+    /// Number of posted events which are not sent yet.
+    std::atomic<i32> numPostedEvents_;
+    /// Posted events collected from thread buffers but not sent yet. Accessed only from the main thread.
+    Vector<PostedEvent*> pendingPostedEvents_;
+    /// Posted events are being sent.
+    bool sendingPostedEvents_;
     /// Event sender stack.
     Vector<Object*> eventSenders_;
     /// Event data stack.
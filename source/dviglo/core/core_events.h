@@ -22,24 +22,80 @@ DV_EVENT(E_UPDATE, Update)
     DV_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed version of E_UPDATE.
+struct UpdateEvent
+{
+    DV_TYPED_EVENT(E_UPDATE)
+
+    /// Timestep.
+    float timeStep_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const { eventData[Update::P_TIMESTEP] = timeStep_; }
+    /// Read parameters sent with SendEvent().
+    void FromVariantMap(VariantMap& eventData) { timeStep_ = eventData[Update::P_TIMESTEP].GetFloat(); }
+};
+
 /// Application-wide logic post-update event.
 DV_EVENT(E_POSTUPDATE, PostUpdate)
 {
     DV_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed version of E_POSTUPDATE.
+struct PostUpdateEvent
+{
+    DV_TYPED_EVENT(E_POSTUPDATE)
+
+    /// Timestep.
+    float timeStep_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const { eventData[PostUpdate::P_TIMESTEP] = timeStep_; }
+    /// Read parameters sent with SendEvent().
+    void FromVariantMap(VariantMap& eventData) { timeStep_ = eventData[PostUpdate::P_TIMESTEP].GetFloat(); }
+};
+
 /// Render update event.
 DV_EVENT(E_RENDERUPDATE, RenderUpdate)
 {
     DV_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed version of E_RENDERUPDATE.
+struct RenderUpdateEvent
+{
+    DV_TYPED_EVENT(E_RENDERUPDATE)
+
+    /// Timestep.
+    float timeStep_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const { eventData[RenderUpdate::P_TIMESTEP] = timeStep_; }
+    /// Read parameters sent with SendEvent().
+    void FromVariantMap(VariantMap& eventData) { timeStep_ = eventData[RenderUpdate::P_TIMESTEP].GetFloat(); }
+};
+
 /// Post-render update event.
 DV_EVENT(E_POSTRENDERUPDATE, PostRenderUpdate)
 {
     DV_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed version of E_POSTRENDERUPDATE.
+struct PostRenderUpdateEvent
+{
+    DV_TYPED_EVENT(E_POSTRENDERUPDATE)
+
+    /// Timestep.
+    float timeStep_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const { eventData[PostRenderUpdate::P_TIMESTEP] = timeStep_; }
+    /// Read parameters sent with SendEvent().
+    void FromVariantMap(VariantMap& eventData) { timeStep_ = eventData[PostRenderUpdate::P_TIMESTEP].GetFloat(); }
+};
+
 /// Frame end event.
 DV_EVENT(E_ENDFRAME, EndFrame)
 {
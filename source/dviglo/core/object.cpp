@@ -6,6 +6,7 @@
 #include "process_utils.h"
 #include "thread.h"
 #include "profiler.h"
+#include "../containers/flat_hash_set.h"
 #include "../io/log.h"
 
 #include "../common/debug_new.h"
@@ -76,7 +77,7 @@ void Object::OnEvent(Object* sender, StringHash eventType, VariantMap& eventData
     EventHandler* handler = eventHandlers_.First();
     while (handler)
     {
-        if (handler->GetEventType() == eventType)
+        if (handler->GetEventType() == eventType && !handler->IsTyped())
         {
             if (!handler->GetSender())
                 nonSpecific = handler;
@@ -124,7 +125,7 @@ void Object::SubscribeToEvent(StringHash eventType, EventHandler* handler)
     handler->SetSenderAndEventType(nullptr, eventType);
     // Remove old event handler first
     EventHandler* previous;
-    EventHandler* oldHandler = FindSpecificEventHandler(nullptr, eventType, &previous);
+    EventHandler* oldHandler = FindEventHandler(nullptr, eventType, false, &previous);
     if (oldHandler)
     {
         eventHandlers_.Erase(oldHandler, previous);
@@ -149,7 +150,7 @@ void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler
     handler->SetSenderAndEventType(sender, eventType);
     // Remove old event handler first
     EventHandler* previous;
-    EventHandler* oldHandler = FindSpecificEventHandler(sender, eventType, &previous);
+    EventHandler* oldHandler = FindEventHandler(sender, eventType, false, &previous);
     if (oldHandler)
     {
         eventHandlers_.Erase(oldHandler, previous);
@@ -172,6 +173,27 @@ void Object::SubscribeToEvent(Object* sender, StringHash eventType, const std::f
     SubscribeToEvent(sender, eventType, new EventHandler11Impl(function, userData));
 }
 
+void Object::SubscribeToTypedEvent(Object* sender, TypedEventHandler* handler)
+{
+    StringHash eventType = handler->GetEventType();
+    handler->SetSenderAndEventType(sender, eventType);
+
+    // Replace old event handler. Like with VariantMap handlers, the place in the subscription order does not change
+    EventHandler* previous;
+    EventHandler* oldHandler = FindEventHandler(sender, eventType, true, &previous);
+    if (oldHandler)
+    {
+        DV_CONTEXT.ReplaceTypedEventHandler(static_cast<TypedEventHandler*>(oldHandler), handler);
+        eventHandlers_.Erase(oldHandler, previous);
+        eventHandlers_.InsertFront(handler);
+    }
+    else
+    {
+        eventHandlers_.InsertFront(handler);
+        DV_CONTEXT.AddTypedEventHandler(handler);
+    }
+}
+
 void Object::UnsubscribeFromEvent(StringHash eventType)
 {
     for (;;)
@@ -180,10 +202,7 @@ void Object::UnsubscribeFromEvent(StringHash eventType)
         EventHandler* handler = FindEventHandler(eventType, &previous);
         if (handler)
         {
-            if (handler->GetSender())
-                DV_CONTEXT.RemoveEventReceiver(this, handler->GetSender(), eventType);
-            else
-                DV_CONTEXT.RemoveEventReceiver(this, eventType);
+            RemoveEventHandlerFromContext(handler);
             eventHandlers_.Erase(handler, previous);
         }
         else
@@ -196,12 +215,18 @@ void Object::UnsubscribeFromEvent(Object* sender, StringHash eventType)
     if (!sender)
         return;
 
-    EventHandler* previous;
-    EventHandler* handler = FindSpecificEventHandler(sender, eventType, &previous);
-    if (handler)
+    // There may be both VariantMap and typed handler
+    for (;;)
     {
-        DV_CONTEXT.RemoveEventReceiver(this, handler->GetSender(), eventType);
-        eventHandlers_.Erase(handler, previous);
+        EventHandler* previous;
+        EventHandler* handler = FindSpecificEventHandler(sender, eventType, &previous);
+        if (handler)
+        {
+            RemoveEventHandlerFromContext(handler);
+            eventHandlers_.Erase(handler, previous);
+        }
+        else
+            break;
     }
 }
 
@@ -216,7 +241,7 @@ void Object::UnsubscribeFromEvents(Object* sender)
         EventHandler* handler = FindSpecificEventHandler(sender, &previous);
         if (handler)
         {
-            DV_CONTEXT.RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
+            RemoveEventHandlerFromContext(handler);
             eventHandlers_.Erase(handler, previous);
         }
         else
@@ -231,10 +256,7 @@ void Object::UnsubscribeFromAllEvents()
         EventHandler* handler = eventHandlers_.First();
         if (handler)
         {
-            if (handler->GetSender())
-                DV_CONTEXT.RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
-            else
-                DV_CONTEXT.RemoveEventReceiver(this, handler->GetEventType());
+            RemoveEventHandlerFromContext(handler);
             eventHandlers_.Erase(handler);
         }
         else
@@ -253,11 +275,7 @@ void Object::UnsubscribeFromAllEventsExcept(const Vector<StringHash>& exceptions
 
         if ((!onlyUserData || handler->GetUserData()) && !exceptions.Contains(handler->GetEventType()))
         {
-            if (handler->GetSender())
-                DV_CONTEXT.RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
-            else
-                DV_CONTEXT.RemoveEventReceiver(this, handler->GetEventType());
-
+            RemoveEventHandlerFromContext(handler);
             eventHandlers_.Erase(handler, previous);
         }
         else
@@ -292,9 +310,21 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     DV_PROFILE_STR(eventName.c_str(), eventName.Length());
 #endif
 
+    // If the event has typed handlers, they are merged with the receivers in the subscription order
+    i32 typedEventId = DV_CONTEXT.FindTypedEventId(eventType);
+    if (typedEventId != NINDEX)
+    {
+        TypedEventHandlerGroup* handlers = DV_CONTEXT.GetTypedEventHandlers(typedEventId);
+        if (handlers && !handlers->handlers_.Empty())
+        {
+            SendTypedEvent(typedEventId, eventType, nullptr, nullptr, &eventData);
+            return;
+        }
+    }
+
     // Make a weak pointer to self to check for destruction during event handling
     WeakPtr<Object> self(this);
-    HashSet<Object*> processed;
+    FlatHashSet<Object*> processed;
 
     DV_CONTEXT.BeginSendEvent(this, eventType);
 
@@ -381,6 +411,137 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     DV_CONTEXT.EndSendEvent();
 }
 
+void Object::SendTypedEvent(i32 typedEventId, StringHash eventType, void* event, void (*toVariantMap)(const void*, VariantMap&),
+    VariantMap* eventData)
+{
+    if (!Thread::IsMainThread())
+    {
+        DV_LOGERROR("Sending events is only supported from the main thread");
+        return;
+    }
+
+    if (blockEvents_)
+        return;
+
+    // Note: typed handler group is never destroyed before the context. Receiver groups are held alive with shared ptrs,
+    // as they may get destroyed along with the sender
+    TypedEventHandlerGroup* handlers = DV_CONTEXT.GetTypedEventHandlers(typedEventId);
+    SharedPtr<EventReceiverGroup> specificReceivers(DV_CONTEXT.GetEventReceivers(this, eventType));
+    SharedPtr<EventReceiverGroup> receivers(DV_CONTEXT.GetEventReceivers(eventType));
+
+    bool hasHandlers = handlers && !handlers->handlers_.Empty();
+    bool hasReceivers = (specificReceivers && !specificReceivers->receivers_.Empty()) || (receivers && !receivers->receivers_.Empty());
+    if (!hasHandlers && !hasReceivers)
+        return;
+
+    // Fill VariantMap only if somebody uses it
+    if (!eventData && hasReceivers)
+    {
+        eventData = &GetEventDataMap();
+        toVariantMap(event, *eventData);
+    }
+
+    // Make a weak pointer to self to check for destruction during event handling
+    WeakPtr<Object> self(this);
+    FlatHashSet<Object*> processed;
+    bool specificHandlerInvoked = false;
+
+    DV_CONTEXT.BeginSendEvent(this, eventType);
+
+    // Same order as in SendEvent(): first the specific subscribers, then the non-specific ones. Typed handlers and
+    // VariantMap receivers are merged by the subscription order
+    for (bool specific : {true, false})
+    {
+        EventReceiverGroup* group = specific ? specificReceivers.Get() : receivers.Get();
+        const i32 numHandlers = handlers ? handlers->handlers_.Size() : 0;
+        const i32 numReceivers = group ? group->receivers_.Size() : 0;
+        if (handlers)
+            handlers->BeginSendEvent();
+        if (group)
+            group->BeginSendEvent();
+
+        i32 handlerIndex = 0;
+        i32 receiverIndex = 0;
+
+        for (;;)
+        {
+            // Skip the typed handlers of other senders or of the other group
+            while (handlerIndex < numHandlers)
+            {
+                TypedEventHandler* handler = handlers->handlers_[handlerIndex];
+                if (handler && (specific ? handler->GetSender() == this : !handler->GetSender()))
+                    break;
+                ++handlerIndex;
+            }
+
+            bool hasHandler = handlerIndex < numHandlers;
+            bool hasReceiver = receiverIndex < numReceivers;
+            if (!hasHandler && !hasReceiver)
+                break;
+
+            if (hasHandler && (!hasReceiver || handlers->sequences_[handlerIndex] < group->sequences_[receiverIndex]))
+            {
+                TypedEventHandler* handler = handlers->handlers_[handlerIndex++];
+                Object* receiver = handler->GetReceiver();
+
+                // Specific event handlers have priority, so the receiver does not get the event twice
+                if (receiver->GetBlockEvents() || (!specific && specificHandlerInvoked &&
+                    receiver->FindEventHandler(this, eventType, true)))
+                    continue;
+
+                DV_CONTEXT.SetEventHandler(handler);
+                if (event)
+                    handler->InvokeTyped(event);
+                else
+                    handler->Invoke(*eventData);
+                DV_CONTEXT.SetEventHandler(nullptr);
+                specificHandlerInvoked |= specific;
+            }
+            else
+            {
+                Object* receiver = group->receivers_[receiverIndex++];
+                // Holes may exist if receivers removed during send. If there were specific receivers, check that
+                // the event is not sent doubly to them
+                if (!receiver || (!specific && processed.Contains(receiver)))
+                    continue;
+
+                receiver->OnEvent(this, eventType, *eventData);
+                if (specific)
+                    processed.Insert(receiver);
+            }
+
+            // If self has been destroyed as a result of event handling, exit
+            if (self.Expired())
+                break;
+        }
+
+        if (group)
+            group->EndSendEvent();
+        if (handlers)
+            handlers->EndSendEvent();
+
+        if (self.Expired())
+            break;
+    }
+
+    DV_CONTEXT.EndSendEvent();
+}
+
+void Object::PostEvent(StringHash eventType, const VariantMap& eventData)
+{
+    DV_CONTEXT.PostEvent(this, eventType, eventData, nullptr);
+}
+
+void Object::PostEvent(StringHash eventType)
+{
+    DV_CONTEXT.PostEvent(this, eventType, Variant::emptyVariantMap, nullptr);
+}
+
+void Object::PostTypedEvent(StringHash eventType, std::function<void(Object*)> send)
+{
+    DV_CONTEXT.PostEvent(this, eventType, Variant::emptyVariantMap, std::move(send));
+}
+
 VariantMap& Object::GetEventDataMap() const
 {
     return DV_CONTEXT.GetEventDataMap();
@@ -441,6 +602,16 @@ const String& Object::GetCategory() const
     return String::EMPTY;
 }
 
+void Object::RemoveEventHandlerFromContext(EventHandler* handler)
+{
+    if (handler->IsTyped())
+        DV_CONTEXT.RemoveTypedEventHandler(static_cast<TypedEventHandler*>(handler));
+    else if (handler->GetSender())
+        DV_CONTEXT.RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
+    else
+        DV_CONTEXT.RemoveEventReceiver(this, handler->GetEventType());
+}
+
 EventHandler* Object::FindEventHandler(StringHash eventType, EventHandler** previous) const
 {
     EventHandler* handler = eventHandlers_.First();
@@ -459,6 +630,24 @@ EventHandler* Object::FindEventHandler(StringHash eventType, EventHandler** prev
     return nullptr;
 }
 
+EventHandler* Object::FindEventHandler(Object* sender, StringHash eventType, bool typed, EventHandler** previous) const
+{
+    EventHandler* handler = eventHandlers_.First();
+    if (previous)
+        *previous = nullptr;
+
+    while (handler)
+    {
+        if (handler->GetSender() == sender && handler->GetEventType() == eventType && handler->IsTyped() == typed)
+            return handler;
+        if (previous)
+            *previous = handler;
+        handler = eventHandlers_.Next(handler);
+    }
+
+    return nullptr;
+}
+
 EventHandler* Object::FindSpecificEventHandler(Object* sender, EventHandler** previous) const
 {
     EventHandler* handler = eventHandlers_.First();
@@ -505,6 +694,8 @@ void Object::RemoveEventSender(Object* sender)
         if (handler->GetSender() == sender)
         {
             EventHandler* next = eventHandlers_.Next(handler);
+            if (handler->IsTyped())
+                DV_CONTEXT.RemoveTypedEventHandler(static_cast<TypedEventHandler*>(handler));
             eventHandlers_.Erase(handler, previous);
             handler = next;
         }
@@ -522,4 +713,9 @@ StringHashRegister& GetEventNameRegister()
     return eventNameRegister;
 }
 
+i32 GetTypedEventId(StringHash eventType)
+{
+    return DV_CONTEXT.GetTypedEventId(eventType);
+}
+
 }
@@ -15,6 +15,7 @@ namespace dviglo
 
 class Context;
 class EventHandler;
+class TypedEventHandler;
 
 /// Type info.
 class DV_API TypeInfo
@@ -112,7 +113,7 @@ public:
     void UnsubscribeFromAllEventsExcept(const Vector<StringHash>& exceptions, bool onlyUserData);
     /// Send event to all subscribers.
     void SendEvent(StringHash eventType);
-    /// Send event with parameters to all subscribers.
+    /// Send event with parameters to all subscribers. Typed handlers receive the event decoded from the parameters.
     void SendEvent(StringHash eventType, VariantMap& eventData);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap() const;
@@ -121,6 +122,38 @@ public:
     {
         SendEvent(eventType, GetEventDataMap().Populate(args...));
     }
+    /// Subscribe to a typed event that can be sent by any sender. Typed handlers receive only events sent with SendTypedEvent().
+    /// Typed and VariantMap subscriptions share one order: resubscribing keeps the place of the old handler.
+    template <class T, class E> void SubscribeToTypedEvent(void (T::*function)(E&));
+    /// Subscribe to a specific sender's typed event.
+    template <class T, class E> void SubscribeToTypedEvent(Object* sender, void (T::*function)(E&));
+    /// Subscribe to a typed event that can be sent by any sender.
+    template <class E> void SubscribeToTypedEvent(const std::function<void(E&)>& function);
+    /// Subscribe to a specific sender's typed event.
+    template <class E> void SubscribeToTypedEvent(Object* sender, const std::function<void(E&)>& function);
+    /// Post event to be sent from the main thread at the beginning of the next frame. Can be called from any thread.
+    /// Events are sent in the order they were posted. Event data must not hold reference-counted objects.
+    void PostEvent(StringHash eventType, const VariantMap& eventData);
+    /// Post event without parameters. Can be called from any thread.
+    void PostEvent(StringHash eventType);
+    /// Post event with variadic parameter pairs. Can be called from any thread.
+    template <typename... Args> void PostEvent(StringHash eventType, Args... args)
+    {
+        VariantMap eventData;
+        PostEvent(eventType, eventData.Populate(args...));
+    }
+    /// Post typed event. Can be called from any thread.
+    template <class E> void PostTypedEvent(const E& event)
+    {
+        PostTypedEvent(E::GetEventTypeStatic(), [copy = event](Object* sender) mutable { sender->SendTypedEvent(copy); });
+    }
+    /// Send typed event to typed subscribers without allocations. Subscribers which use VariantMap receive it too.
+    /// The order is the same as in SendEvent(): specific subscribers first, then non-specific ones, each in the subscription order.
+    template <class E> void SendTypedEvent(E& event)
+    {
+        SendTypedEvent(E::GetTypedEventIdStatic(), E::GetEventTypeStatic(), &event,
+            [](const void* e, VariantMap& eventData) { static_cast<const E*>(e)->ToVariantMap(eventData); });
+    }
 
     /// Return global variable based on key.
     const Variant& GetGlobalVar(StringHash key) const;
@@ -153,8 +186,20 @@ public:
     bool GetBlockEvents() const { return blockEvents_; }
 
 private:
+    /// Subscribe typed event handler. Sender is null for non-specific handlers.
+    void SubscribeToTypedEvent(Object* sender, TypedEventHandler* handler);
+    /// Send typed event. The function converts the event to VariantMap for subscribers which do not use typed handlers.
+    /// When the event is null, it is sent with the VariantMap, which the typed handlers decode.
+    void SendTypedEvent(i32 typedEventId, StringHash eventType, void* event, void (*toVariantMap)(const void*, VariantMap&),
+        VariantMap* eventData = nullptr);
+    /// Post typed event. The function sends the event from the main thread.
+    void PostTypedEvent(StringHash eventType, std::function<void(Object*)> send);
+    /// Remove event handler from the receiver structures of the context.
+    void RemoveEventHandlerFromContext(EventHandler* handler);
     /// Find the first event handler with no specific sender.
     EventHandler* FindEventHandler(StringHash eventType, EventHandler** previous = nullptr) const;
+    /// Find the first event handler with specific sender (null for non-specific), event type and kind.
+    EventHandler* FindEventHandler(Object* sender, StringHash eventType, bool typed, EventHandler** previous = nullptr) const;
     /// Find the first event handler with specific sender.
     EventHandler* FindSpecificEventHandler(Object* sender, EventHandler** previous = nullptr) const;
     /// Find the first event handler with specific sender and event type.
@@ -250,6 +295,12 @@ public:
     /// Return userdata.
     void* GetUserData() const { return userData_; }
 
+    /// Return typed event index. NINDEX if the handler receives events as VariantMap.
+    i32 GetTypedEventId() const { return typedEventId_; }
+
+    /// Return whether the handler receives typed events.
+    bool IsTyped() const { return typedEventId_ != NINDEX; }
+
 protected:
     /// Event receiver.
     Object* receiver_;
@@ -259,6 +310,8 @@ protected:
     StringHash eventType_;
     /// Userdata.
     void* userData_;
+    /// Typed event index.
+    i32 typedEventId_ = NINDEX;
 };
 
 /// Template implementation of the event handler invoke helper (stores a function pointer of specific class).
@@ -323,13 +376,144 @@ private:
     std::function<void(StringHash, VariantMap&)> function_;
 };
 
+/// Internal helper class for invoking typed event handler functions.
+class DV_API TypedEventHandler : public EventHandler
+{
+public:
+    /// Construct with receiver, event type and typed event index.
+    TypedEventHandler(Object* receiver, StringHash eventType, i32 typedEventId) :
+        EventHandler(receiver)
+    {
+        eventType_ = eventType;
+        typedEventId_ = typedEventId;
+    }
+
+    /// Invoke event handler function with a pointer to the event struct.
+    virtual void InvokeTyped(void* event) = 0;
+
+protected:
+    /// Invoke event handler function with the event decoded from VariantMap, then write the changes back.
+    template <class E> void InvokeDecoded(VariantMap& eventData)
+    {
+        E event{};
+        event.FromVariantMap(eventData);
+        InvokeTyped(&event);
+        event.ToVariantMap(eventData);
+    }
+};
+
+/// Template implementation of the typed event handler invoke helper (stores a function pointer of specific class).
+template <class T, class E> class TypedEventHandlerImpl : public TypedEventHandler
+{
+public:
+    using HandlerFunctionPtr = void (T::*)(E&);
+
+    /// Construct with receiver and function pointers.
+    TypedEventHandlerImpl(T* receiver, HandlerFunctionPtr function) :
+        TypedEventHandler(receiver, E::GetEventTypeStatic(), E::GetTypedEventIdStatic()),
+        function_(function)
+    {
+        assert(receiver_);
+        assert(function_);
+    }
+
+    /// Invoke event handler function.
+    void InvokeTyped(void* event) override
+    {
+        auto* receiver = static_cast<T*>(receiver_);
+        (receiver->*function_)(*static_cast<E*>(event));
+    }
+
+    /// Invoke event handler function with the event sent as VariantMap.
+    void Invoke(VariantMap& eventData) override
+    {
+        InvokeDecoded<E>(eventData);
+    }
+
+    /// Return a unique copy of the event handler.
+    EventHandler* Clone() const override
+    {
+        return new TypedEventHandlerImpl(static_cast<T*>(receiver_), function_);
+    }
+
+private:
+    /// Class-specific pointer to handler function.
+    HandlerFunctionPtr function_;
+};
+
+/// Template implementation of the typed event handler invoke helper (std::function instance).
+template <class E> class TypedEventHandler11Impl : public TypedEventHandler
+{
+public:
+    /// Construct with receiver and function.
+    TypedEventHandler11Impl(Object* receiver, std::function<void(E&)> function) :
+        TypedEventHandler(receiver, E::GetEventTypeStatic(), E::GetTypedEventIdStatic()),
+        function_(std::move(function))
+    {
+        assert(function_);
+    }
+
+    /// Invoke event handler function.
+    void InvokeTyped(void* event) override
+    {
+        function_(*static_cast<E*>(event));
+    }
+
+    /// Invoke event handler function with the event sent as VariantMap.
+    void Invoke(VariantMap& eventData) override
+    {
+        InvokeDecoded<E>(eventData);
+    }
+
+    /// Return a unique copy of the event handler.
+    EventHandler* Clone() const override
+    {
+        return new TypedEventHandler11Impl(receiver_, function_);
+    }
+
+private:
+    /// Handler function.
+    std::function<void(E&)> function_;
+};
+
+template <class T, class E> void Object::SubscribeToTypedEvent(void (T::*function)(E&))
+{
+    SubscribeToTypedEvent(nullptr, new TypedEventHandlerImpl<T, E>(static_cast<T*>(this), function));
+}
+
+template <class T, class E> void Object::SubscribeToTypedEvent(Object* sender, void (T::*function)(E&))
+{
+    // If a null sender was specified, the event can not be subscribed to
+    if (sender)
+        SubscribeToTypedEvent(sender, new TypedEventHandlerImpl<T, E>(static_cast<T*>(this), function));
+}
+
+template <class E> void Object::SubscribeToTypedEvent(const std::function<void(E&)>& function)
+{
+    SubscribeToTypedEvent(nullptr, new TypedEventHandler11Impl<E>(this, function));
+}
+
+template <class E> void Object::SubscribeToTypedEvent(Object* sender, const std::function<void(E&)>& function)
+{
+    if (sender)
+        SubscribeToTypedEvent(sender, new TypedEventHandler11Impl<E>(this, function));
+}
+
 /// Get register of event names.
 DV_API StringHashRegister& GetEventNameRegister();
+/// Return index of a typed event. Indices are assigned on first use and are dense, so handler lists can be stored in an array.
+DV_API i32 GetTypedEventId(StringHash eventType);
 
 /// Describe an event's hash ID and begin a namespace in which to define its parameters.
 #define DV_EVENT(eventID, eventName) static const dviglo::StringHash eventID(dviglo::GetEventNameRegister().RegisterString(#eventName)); namespace eventName
 /// Describe an event's parameter hash ID. Should be used inside an event namespace.
 #define DV_PARAM(paramID, paramName) static const dviglo::StringHash paramID(#paramName)
+/// Declare members of a typed event struct. The struct must also define ToVariantMap(VariantMap&) const, which fills the
+/// parameters of the event for subscribers which do not use typed handlers, and FromVariantMap(VariantMap&), which reads
+/// them for typed handlers when the event is sent with SendEvent().
+#define DV_TYPED_EVENT(eventID) \
+    static dviglo::StringHash GetEventTypeStatic() { return eventID; } \
+    static dviglo::i32 GetTypedEventIdStatic() { static const dviglo::i32 typedEventId = dviglo::GetTypedEventId(eventID); return typedEventId; }
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function.
 #define DV_HANDLER(className, function) (new dviglo::EventHandlerImpl<className>(this, &className::function))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function, and also defines a userdata pointer.
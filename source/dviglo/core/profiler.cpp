@@ -2,6 +2,7 @@
 // Copyright (c) 2022-2023 the Dviglo project
 // License: MIT
 
+#include "context.h"
 #include "profiler.h"
 
 #include <cstdio>
@@ -11,6 +12,14 @@
 namespace dviglo
 {
 
+AutoProfileBlock::AutoProfileBlock(const char* name) :
+    traceScope_(name),
+    profiler_(Thread::IsMainThread() ? DV_CONTEXT.GetSubsystem<Profiler>() : nullptr)
+{
+    if (profiler_)
+        profiler_->BeginBlock(name);
+}
+
 Profiler::Profiler() :
     current_(nullptr),
     root_(nullptr),
@@ -7,6 +7,7 @@
 #include "../containers/str.h"
 #include "thread.h"
 #include "timer.h"
+#include "trace_recorder.h"
 
 #ifdef DV_TRACY_PROFILING
 #define TRACY_ENABLE 1
@@ -214,12 +215,16 @@ protected:
     unsigned intervalFrames_;
 };
 
-/// Helper class for automatically beginning and ending a profiling block.
+/// Helper class for automatically beginning and ending a profiling block. The block is also recorded by the TraceRecorder.
 class DV_API AutoProfileBlock
 {
 public:
-    /// Construct. Begin a profiling block with the specified name and optional call count.
+    /// Construct. Begin a profiling block with the specified name in the profiler of the main thread. Can be used in any thread.
+    explicit AutoProfileBlock(const char* name);
+
+    /// Construct. Begin a profiling block with the specified name.
     AutoProfileBlock(Profiler* profiler, const char* name) :
+        traceScope_(name),
         profiler_(profiler)
     {
         if (profiler_)
@@ -234,6 +239,8 @@ public:
     }
 
 private:
+    /// Scope in the trace. Destructed after the profiling block is ended.
+    AutoTraceScope traceScope_;
     /// Profiler.
     Profiler* profiler_;
 };
@@ -243,7 +250,7 @@ private:
     #define DV_PROFILE(name) ZoneScopedN(#name)
 #elif defined(DV_PROFILING) // Use default profiler
     /// Macro for scoped profiling with a name.
-    #define DV_PROFILE(name) dviglo::AutoProfileBlock profile_ ## name (GetSubsystem<dviglo::Profiler>(), #name)
+    #define DV_PROFILE(name) dviglo::AutoProfileBlock profile_ ## name (#name)
 #else // Profiling off
     #define DV_PROFILE(name)
 #endif
@@ -268,7 +275,12 @@ private:
     #define DV_PROFILE_COLOR(name, color)
     #define DV_PROFILE_STR(nameStr, size)
     #define DV_PROFILE_FRAME()
+#ifdef DV_PROFILING
+    /// Macro for recording name of current thread.
+    #define DV_PROFILE_THREAD(name) dviglo::TraceRecorder::SetThreadName(name)
+#else
     #define DV_PROFILE_THREAD(name)
+#endif
     #define DV_PROFILE_FUNCTION()
 
     #define DV_PROFILE_EVENT_COLOR
@@ -0,0 +1,332 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "task_graph.h"
+
+#include "../common/debug_new.h"
+
+namespace dviglo
+{
+
+/// Maximum number of chunks per thread for parallel tasks. More chunks than threads allow idle threads to steal
+/// the remaining work when the cost of items is uneven.
+static constexpr i32 TASK_CHUNKS_PER_THREAD = 4;
+
+/// Return number of chunks which receive a part of the range. The rest of the chunks of the task are empty.
+static i32 GetNumUsedChunks(i32 count, i32 grain, i32 numChunks)
+{
+    if (!grain || count <= 0)
+        return 1;
+
+    return Clamp((count + grain - 1) / grain, 1, numChunks);
+}
+
+TaskGraph::TaskGraph(WorkQueue* queue) :
+    queue_(queue),
+    remainingTasks_(0),
+    priority_(WI_MAX_PRIORITY),
+    running_(false)
+{
+    assert(queue);
+}
+
+TaskGraph::~TaskGraph()
+{
+    if (running_)
+        Wait();
+
+    for (Task* task : taskPool_)
+        delete task;
+}
+
+i32 TaskGraph::AddTask(const TaskFunction& function)
+{
+    return AddTaskInternal(0, 1, 0, function);
+}
+
+i32 TaskGraph::AddParallelFor(i32 begin, i32 end, i32 grain, const TaskFunction& function)
+{
+    return AddTaskInternal(begin, end, Max(grain, 1), function);
+}
+
+i32 TaskGraph::AddParallelFor(i32 grain, const TaskFunction& function)
+{
+    i32 index = AddTaskInternal(0, 0, Max(grain, 1), function);
+    tasks_[index]->deferredRange_ = true;
+    return index;
+}
+
+i32 TaskGraph::AddMainThreadTask(const TaskFunction& function)
+{
+    i32 index = AddTaskInternal(0, 1, 0, function);
+    tasks_[index]->mainThread_ = true;
+    mainThreadTasks_.Push(index);
+    return index;
+}
+
+void TaskGraph::SetRange(i32 task, i32 begin, i32 end)
+{
+    assert(task >= 0 && task < tasks_.Size());
+    assert(tasks_[task]->grain_);
+
+    tasks_[task]->begin_ = begin;
+    tasks_[task]->end_ = end;
+}
+
+void TaskGraph::AddDependency(i32 task, i32 dependsOn)
+{
+    assert(!running_);
+    assert(task >= 0 && task < tasks_.Size());
+    assert(dependsOn >= 0 && dependsOn < tasks_.Size());
+    assert(task != dependsOn);
+
+    tasks_[dependsOn]->successors_.Push(task);
+    ++tasks_[task]->numDependencies_;
+}
+
+void TaskGraph::Clear()
+{
+    assert(!running_);
+
+    tasks_.Clear();
+    chunks_.Clear();
+    mainThreadTasks_.Clear();
+}
+
+void TaskGraph::Run(i32 priority/* = WI_MAX_PRIORITY*/)
+{
+    assert(!running_);
+
+    if (tasks_.Empty())
+        return;
+
+    i32 numThreads = queue_->GetNumThreads();
+    i32 maxChunks = numThreads ? (numThreads + 1) * TASK_CHUNKS_PER_THREAD : 1;
+    i32 numChunks = 0;
+
+    for (Task* task : tasks_)
+    {
+        if (task->mainThread_)
+            task->numChunks_ = 0;
+        else if (task->deferredRange_)
+            task->numChunks_ = maxChunks;
+        else
+            task->numChunks_ = GetNumUsedChunks(task->end_ - task->begin_, task->grain_, maxChunks);
+
+        task->firstChunk_ = numChunks;
+        numChunks += task->numChunks_;
+    }
+
+    chunks_.Resize(numChunks);
+    remainingTasks_.store(tasks_.Size(), std::memory_order_relaxed);
+    priority_ = priority;
+
+    for (Task* task : tasks_)
+    {
+        task->remainingDependencies_.store(task->numDependencies_, std::memory_order_relaxed);
+        // Main thread task counts as one chunk, which is finished when the task is executed
+        task->remainingChunks_.store(Max(task->numChunks_, 1), std::memory_order_relaxed);
+        task->started_ = false;
+
+        for (i32 i = 0; i < task->numChunks_; ++i)
+        {
+            Chunk& chunk = chunks_[task->firstChunk_ + i];
+            chunk.task_ = task;
+
+            SharedPtr<WorkItem> item = queue_->GetFreeItem();
+            item->priority_ = priority;
+            item->workFunction_ = ChunkWork;
+            item->start_ = &chunk;
+            item->aux_ = this;
+            queue_->RegisterItem(item);
+            chunk.item_ = item.Get();
+        }
+    }
+
+    running_ = true;
+
+    for (Task* task : tasks_)
+    {
+        if (!task->numDependencies_)
+            Launch(task, 0);
+    }
+
+    if (numThreads)
+        queue_->Resume();
+}
+
+void TaskGraph::Wait()
+{
+    if (!running_)
+        return;
+
+    while (!IsFinished())
+        ExecuteWork();
+
+    // Threads may still be finishing the work items after the last task function has returned
+    for (const Chunk& chunk : chunks_)
+    {
+        while (!chunk.item_->completed_)
+        {
+        }
+    }
+
+    running_ = false;
+    queue_->PurgeCompleted(priority_);
+
+    // Same as WorkQueue::Complete(), do not let the idle worker threads use up CPU time
+    if (queue_->GetNumThreads() && !queue_->HasPendingWork())
+        queue_->Pause();
+}
+
+void TaskGraph::Wait(i32 task)
+{
+    assert(task >= 0 && task < tasks_.Size());
+
+    if (!running_)
+        return;
+
+    while (!IsFinished(task))
+        ExecuteWork();
+}
+
+void TaskGraph::Wait(i32 task, i32 index)
+{
+    assert(task >= 0 && task < tasks_.Size());
+
+    if (!running_)
+        return;
+
+    const Task* waited = tasks_[task];
+    assert(waited->grain_ && index >= waited->begin_ && index < waited->end_);
+
+    // Find the chunk the same way as Launch() splits the range
+    i64 count = waited->end_ - waited->begin_;
+    i32 numUsedChunks = GetNumUsedChunks((i32)count, waited->grain_, waited->numChunks_);
+    i32 chunkIndex = 0;
+    while (waited->begin_ + (i32)(count * (chunkIndex + 1) / numUsedChunks) <= index)
+        ++chunkIndex;
+
+    const WorkItem* item = chunks_[waited->firstChunk_ + chunkIndex].item_;
+    while (!item->completed_)
+        ExecuteWork();
+}
+
+bool TaskGraph::IsFinished(i32 task) const
+{
+    assert(task >= 0 && task < tasks_.Size());
+    return tasks_[task]->remainingChunks_.load(std::memory_order_acquire) == 0;
+}
+
+i32 TaskGraph::AddTaskInternal(i32 begin, i32 end, i32 grain, const TaskFunction& function)
+{
+    assert(!running_);
+
+    Task* task;
+    if (tasks_.Size() < taskPool_.Size())
+    {
+        task = taskPool_[tasks_.Size()];
+    }
+    else
+    {
+        task = new Task();
+        taskPool_.Push(task);
+    }
+
+    task->function_ = function;
+    task->begin_ = begin;
+    task->end_ = end;
+    task->grain_ = grain;
+    task->deferredRange_ = false;
+    task->mainThread_ = false;
+    task->started_ = false;
+    task->successors_.Clear();
+    task->numDependencies_ = 0;
+    task->firstChunk_ = 0;
+    task->numChunks_ = 0;
+    task->remainingDependencies_.store(0, std::memory_order_relaxed);
+    task->remainingChunks_.store(1, std::memory_order_relaxed);
+
+    tasks_.Push(task);
+    return tasks_.Size() - 1;
+}
+
+void TaskGraph::Launch(Task* task, i32 threadIndex)
+{
+    // Main thread tasks are found ready by ExecuteMainThreadTasks()
+    if (task->mainThread_)
+        return;
+
+    // The range is split only now, because it may have been set by a task this task depends on. The unused chunks
+    // are empty, but they are still executed to finish the task
+    i64 count = Max(task->end_ - task->begin_, 0);
+    i32 numUsedChunks = GetNumUsedChunks((i32)count, task->grain_, task->numChunks_);
+
+    for (i32 i = 0; i < task->numChunks_; ++i)
+    {
+        Chunk& chunk = chunks_[task->firstChunk_ + i];
+        if (i < numUsedChunks)
+        {
+            chunk.begin_ = task->begin_ + (i32)(count * i / numUsedChunks);
+            chunk.end_ = task->begin_ + (i32)(count * (i + 1) / numUsedChunks);
+        }
+        else
+            chunk.begin_ = chunk.end_ = task->end_;
+    }
+
+    for (i32 i = 0; i < task->numChunks_; ++i)
+        queue_->EnqueueItem(chunks_[task->firstChunk_ + i].item_, threadIndex);
+}
+
+bool TaskGraph::ExecuteMainThreadTasks()
+{
+    bool executed = false;
+
+    for (i32 index : mainThreadTasks_)
+    {
+        Task* task = tasks_[index];
+        if (task->started_ || task->remainingDependencies_.load(std::memory_order_acquire))
+            continue;
+
+        task->started_ = true;
+        task->function_(0, 1, 0);
+        task->remainingChunks_.store(0, std::memory_order_release);
+        FinishTask(task, 0);
+        executed = true;
+    }
+
+    return executed;
+}
+
+void TaskGraph::ExecuteWork()
+{
+    if (!ExecuteMainThreadTasks())
+        queue_->ExecuteOne(priority_);
+}
+
+void TaskGraph::FinishTask(Task* task, i32 threadIndex)
+{
+    for (i32 successorIndex : task->successors_)
+    {
+        Task* successor = tasks_[successorIndex];
+        if (successor->remainingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            Launch(successor, threadIndex);
+    }
+
+    remainingTasks_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void TaskGraph::ChunkWork(const WorkItem* item, i32 threadIndex)
+{
+    auto* graph = static_cast<TaskGraph*>(item->aux_);
+    auto* chunk = static_cast<Chunk*>(item->start_);
+    Task* task = chunk->task_;
+
+    if (chunk->begin_ < chunk->end_)
+        task->function_(chunk->begin_, chunk->end_, threadIndex);
+
+    if (task->remainingChunks_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        graph->FinishTask(task, threadIndex);
+}
+
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "work_queue.h"
+
+namespace dviglo
+{
+
+/// Graph of tasks with dependencies, executed by the work queue. A task starts as soon as all tasks it depends on
+/// are finished, so independent tasks overlap instead of waiting for each other on WorkQueue::Complete().
+/// Tasks are added and the graph is run from the main thread. The graph can be cleared and reused every frame.
+/// Work which is not thread-safe is added as main thread tasks, which the main thread executes while waiting.
+class DV_API TaskGraph : public RefCounted
+{
+public:
+    /// Construct.
+    explicit TaskGraph(WorkQueue* queue);
+    /// Destruct. Wait for completion if running.
+    ~TaskGraph() override;
+
+    /// Add a task which is executed once. Function is called with range [0, 1). Return task index.
+    i32 AddTask(const TaskFunction& function);
+    /// Add a task which processes range [begin, end) in parallel chunks of at least grain items. Return task index.
+    i32 AddParallelFor(i32 begin, i32 end, i32 grain, const TaskFunction& function);
+    /// Add a parallel task whose range is set with SetRange() by a task it depends on. Return task index.
+    i32 AddParallelFor(i32 grain, const TaskFunction& function);
+    /// Add a task which is executed once by the main thread while it waits for the graph. Return task index.
+    i32 AddMainThreadTask(const TaskFunction& function);
+    /// Set the range of a parallel task. While running, can only be called by a task which it depends on.
+    void SetRange(i32 task, i32 begin, i32 end);
+    /// Make a task start only after another task is finished. Dependencies must not form cycles.
+    void AddDependency(i32 task, i32 dependsOn);
+    /// Remove all tasks. Can not be called while running.
+    void Clear();
+
+    /// Submit the tasks to the work queue. Tasks without dependencies start immediately.
+    void Run(i32 priority = WI_MAX_PRIORITY);
+    /// Wait until all tasks are finished. Main thread also executes work while waiting.
+    void Wait();
+    /// Wait until a task is finished. Main thread also executes work while waiting.
+    void Wait(i32 task);
+    /// Wait until an item of a parallel task is processed. The range of the task must not change anymore. Main thread
+    /// also executes work while waiting.
+    void Wait(i32 task, i32 index);
+
+    /// Return number of tasks.
+    i32 GetNumTasks() const { return tasks_.Size(); }
+    /// Return whether was run and not waited for yet.
+    bool IsRunning() const { return running_; }
+    /// Return whether all tasks are finished.
+    bool IsFinished() const { return remainingTasks_.load(std::memory_order_acquire) == 0; }
+    /// Return whether a task is finished.
+    bool IsFinished(i32 task) const;
+
+private:
+    /// Task of the graph.
+    struct Task
+    {
+        /// Task function.
+        TaskFunction function_;
+        /// Start of the range.
+        i32 begin_;
+        /// End of the range.
+        i32 end_;
+        /// Minimum number of items in a chunk. Zero for tasks which are executed once.
+        i32 grain_;
+        /// Whether the range is set while running. The chunks are then reserved for the largest split.
+        bool deferredRange_;
+        /// Whether is executed by the main thread.
+        bool mainThread_;
+        /// Whether the main thread has started executing the task.
+        bool started_;
+        /// Tasks which depend on this task.
+        Vector<i32> successors_;
+        /// Number of tasks this task depends on.
+        i32 numDependencies_;
+        /// Index of the first chunk.
+        i32 firstChunk_;
+        /// Number of chunks.
+        i32 numChunks_;
+        /// Number of tasks this task still waits for.
+        std::atomic<i32> remainingDependencies_;
+        /// Number of chunks which are not finished yet.
+        std::atomic<i32> remainingChunks_;
+    };
+
+    /// Part of a task range processed by one work item.
+    struct Chunk
+    {
+        /// Owner task.
+        Task* task_;
+        /// Start of the range.
+        i32 begin_;
+        /// End of the range.
+        i32 end_;
+        /// Work item. Is kept alive by the work queue until completed.
+        WorkItem* item_;
+    };
+
+    /// Add a task and return its index.
+    i32 AddTaskInternal(i32 begin, i32 end, i32 grain, const TaskFunction& function);
+    /// Split the range of a task to the chunks and make them available to the threads.
+    void Launch(Task* task, i32 threadIndex);
+    /// Execute the main thread tasks whose dependencies are finished. Return false if none was ready.
+    bool ExecuteMainThreadTasks();
+    /// Execute main thread tasks or one work item. Called by the main thread while waiting.
+    void ExecuteWork();
+    /// Mark a task finished and launch the tasks which depend on it.
+    void FinishTask(Task* task, i32 threadIndex);
+    /// Execute a chunk. Called by the work queue.
+    static void ChunkWork(const WorkItem* item, i32 threadIndex);
+
+    /// Work queue.
+    WorkQueue* queue_;
+    /// Tasks. Are not freed on Clear() to avoid allocations when the graph is reused.
+    Vector<Task*> tasks_;
+    /// Task storage. Includes the tasks left from previous runs.
+    Vector<Task*> taskPool_;
+    /// Chunks of all tasks.
+    Vector<Chunk> chunks_;
+    /// Indices of the main thread tasks.
+    Vector<i32> mainThreadTasks_;
+    /// Number of tasks which are not finished yet.
+    std::atomic<i32> remainingTasks_;
+    /// Priority of the work items.
+    i32 priority_;
+    /// Running flag.
+    bool running_;
+};
+
+}
@@ -0,0 +1,299 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "trace_recorder.h"
+
+#include "thread.h"
+#include "../io/file.h"
+#include "../io/log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include "../common/debug_new.h"
+
+namespace dviglo
+{
+
+/// Number of scopes in the ring buffer of one thread. Must be a power of two.
+static const i32 TRACE_BUFFER_SIZE = 32768;
+
+/// Recorded scope. Fields are atomic, because the main thread may read a scope which is being overwritten.
+struct TraceScope
+{
+    /// Name.
+    std::atomic<const char*> name_;
+    /// Beginning time.
+    std::atomic<i64> beginTicks_;
+    /// End time.
+    std::atomic<i64> endTicks_;
+};
+
+/// Ring buffer of one thread.
+struct TraceBuffer
+{
+    /// Scopes.
+    TraceScope scopes_[TRACE_BUFFER_SIZE];
+    /// Number of scopes ever written.
+    std::atomic<u64> writeIndex_{0};
+    /// Buffer is owned by a running thread.
+    std::atomic<bool> owned_{true};
+    /// Thread index in the trace.
+    i32 threadIndex_ = 0;
+    /// Thread name. Guarded by the names mutex.
+    String threadName_;
+    /// Next buffer in the list. Does not change after the buffer is published.
+    TraceBuffer* next_ = nullptr;
+};
+
+/// Trace buffer of a thread. Released for reuse when the thread exits.
+struct ThreadTraceBuffer
+{
+    /// Destruct.
+    ~ThreadTraceBuffer()
+    {
+        if (buffer_)
+            buffer_->owned_.store(false);
+    }
+
+    /// Buffer.
+    TraceBuffer* buffer_ = nullptr;
+};
+
+std::atomic<bool> TraceRecorder::enabled{false};
+
+static std::atomic<TraceBuffer*> traceBuffers{nullptr};
+static std::atomic<i32> numTraceBuffers{0};
+static std::mutex threadNamesMutex;
+static thread_local ThreadTraceBuffer threadTraceBuffer;
+static thread_local String threadName;
+
+static TraceBuffer* GetTraceBuffer()
+{
+    if (threadTraceBuffer.buffer_)
+        return threadTraceBuffer.buffer_;
+
+    TraceBuffer* buffer = nullptr;
+
+    // Reuse a buffer of an exited thread
+    for (TraceBuffer* i = traceBuffers.load(); i; i = i->next_)
+    {
+        bool owned = false;
+        if (i->owned_.compare_exchange_strong(owned, true))
+        {
+            buffer = i;
+            break;
+        }
+    }
+
+    if (!buffer)
+    {
+        buffer = new TraceBuffer();
+        buffer->threadIndex_ = numTraceBuffers.fetch_add(1) + 1;
+
+        TraceBuffer* head = traceBuffers.load(std::memory_order_relaxed);
+        do
+        {
+            buffer->next_ = head;
+        }
+        while (!traceBuffers.compare_exchange_weak(head, buffer));
+    }
+
+    {
+        std::scoped_lock lock(threadNamesMutex);
+        if (!threadName.Empty())
+            buffer->threadName_ = threadName;
+        else if (Thread::IsMainThread())
+            buffer->threadName_ = "Main thread";
+        else
+            buffer->threadName_ = "Thread " + String(buffer->threadIndex_);
+    }
+
+    threadTraceBuffer.buffer_ = buffer;
+    return buffer;
+}
+
+void TraceRecorder::SetThreadName(const String& name)
+{
+    // Buffer is allocated only when the thread records the first scope
+    threadName = name;
+
+    if (threadTraceBuffer.buffer_)
+    {
+        std::scoped_lock lock(threadNamesMutex);
+        threadTraceBuffer.buffer_->threadName_ = name;
+    }
+}
+
+void TraceRecorder::Record(const char* name, i64 beginTicks, i64 endTicks)
+{
+    TraceBuffer* buffer = GetTraceBuffer();
+
+    // Only the owning thread writes, so the index can be incremented without read-modify-write
+    u64 index = buffer->writeIndex_.load(std::memory_order_relaxed);
+    TraceScope& scope = buffer->scopes_[index & (TRACE_BUFFER_SIZE - 1)];
+    scope.name_.store(name, std::memory_order_relaxed);
+    scope.beginTicks_.store(beginTicks, std::memory_order_relaxed);
+    scope.endTicks_.store(endTicks, std::memory_order_relaxed);
+    buffer->writeIndex_.store(index + 1, std::memory_order_release);
+}
+
+void TraceRecorder::Clear()
+{
+    for (TraceBuffer* buffer = traceBuffers.load(); buffer; buffer = buffer->next_)
+        buffer->writeIndex_.store(0);
+}
+
+i64 TraceRecorder::GetTotalTime(const Vector<const char*>& names, i64 sinceTicks)
+{
+    i64 totalTicks = 0;
+
+    for (TraceBuffer* buffer = traceBuffers.load(); buffer; buffer = buffer->next_)
+    {
+        // The slot of the next scope may be partially written, when the buffer is full
+        u64 end = buffer->writeIndex_.load(std::memory_order_acquire);
+        u64 begin = end >= (u64)TRACE_BUFFER_SIZE ? end + 1 - TRACE_BUFFER_SIZE : 0;
+
+        // A thread records a scope when it ends, so the scopes are iterated from the last one by decreasing end time
+        // and a scope nested in a counted one goes after it and begins later
+        i64 countedBeginTicks = M_MAX_I64;
+
+        for (u64 i = end; i > begin; --i)
+        {
+            const TraceScope& scope = buffer->scopes_[(i - 1) & (TRACE_BUFFER_SIZE - 1)];
+            i64 endTicks = scope.endTicks_.load(std::memory_order_relaxed);
+            if (endTicks < sinceTicks)
+                break;
+
+            i64 beginTicks = scope.beginTicks_.load(std::memory_order_relaxed);
+            if (beginTicks >= countedBeginTicks)
+                continue;
+
+            const char* name = scope.name_.load(std::memory_order_relaxed);
+            for (const char* countedName : names)
+            {
+                if (name && !strcmp(name, countedName))
+                {
+                    totalTicks += endTicks - beginTicks;
+                    countedBeginTicks = beginTicks;
+                    break;
+                }
+            }
+        }
+    }
+
+    return totalTicks;
+}
+
+static void AppendJSONString(String& dest, const char* str)
+{
+    dest += '"';
+
+    for (; *str; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+            dest += '\\';
+
+        dest += *str;
+    }
+
+    dest += '"';
+}
+
+String TraceRecorder::GetChromeTrace(float seconds)
+{
+    struct CopiedScope
+    {
+        const char* name_;
+        i64 beginTicks_;
+        i64 endTicks_;
+    };
+
+    i64 nowTicks = GetTicks();
+    i64 minEndTicks = seconds > 0.0f ? nowTicks - (i64)(seconds * 1e9) : 0;
+    i64 originTicks = nowTicks;
+
+    Vector<CopiedScope> scopes;
+    Vector<Pair<i32, i32>> threadRanges; // Index of the first scope and thread index
+    String output = "{\"traceEvents\":[";
+    bool first = true;
+
+    for (TraceBuffer* buffer = traceBuffers.load(); buffer; buffer = buffer->next_)
+    {
+        u64 end = buffer->writeIndex_.load(std::memory_order_acquire);
+        u64 begin = end > (u64)TRACE_BUFFER_SIZE ? end - TRACE_BUFFER_SIZE : 0;
+        i32 firstScope = scopes.Size();
+
+        for (u64 i = begin; i < end; ++i)
+        {
+            const TraceScope& scope = buffer->scopes_[i & (TRACE_BUFFER_SIZE - 1)];
+            scopes.Push({scope.name_.load(std::memory_order_relaxed), scope.beginTicks_.load(std::memory_order_relaxed),
+                scope.endTicks_.load(std::memory_order_relaxed)});
+        }
+
+        // Discard the oldest scopes if the thread has overwritten them while copying. The slot of the next scope
+        // may be partially written
+        std::atomic_thread_fence(std::memory_order_acquire);
+        u64 newEnd = buffer->writeIndex_.load(std::memory_order_relaxed);
+        u64 firstValid = newEnd + 1 > (u64)TRACE_BUFFER_SIZE ? newEnd + 1 - TRACE_BUFFER_SIZE : 0;
+        if (firstValid > begin)
+            scopes.Erase(firstScope, (i32)Min(firstValid - begin, end - begin));
+
+        for (i32 i = firstScope; i < scopes.Size(); ++i)
+        {
+            if (scopes[i].beginTicks_ < originTicks && scopes[i].endTicks_ >= minEndTicks)
+                originTicks = scopes[i].beginTicks_;
+        }
+
+        threadRanges.Push(MakePair(firstScope, buffer->threadIndex_));
+
+        std::scoped_lock lock(threadNamesMutex);
+        output += first ? "\n" : ",\n";
+        first = false;
+        output.AppendWithFormat("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", buffer->threadIndex_);
+        AppendJSONString(output, buffer->threadName_.c_str());
+        output += "}}";
+    }
+
+    for (i32 i = 0; i < threadRanges.Size(); ++i)
+    {
+        i32 endScope = i + 1 < threadRanges.Size() ? threadRanges[i + 1].first_ : scopes.Size();
+
+        for (i32 j = threadRanges[i].first_; j < endScope; ++j)
+        {
+            const CopiedScope& scope = scopes[j];
+            if (!scope.name_ || scope.endTicks_ < minEndTicks)
+                continue;
+
+            // String::AppendWithFormat() does not support precision, so snprintf is used
+            char buffer[128];
+            snprintf(buffer, sizeof(buffer), ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", threadRanges[i].second_,
+                (scope.beginTicks_ - originTicks) / 1000.0, (scope.endTicks_ - scope.beginTicks_) / 1000.0);
+
+            output += ",\n{\"name\":";
+            AppendJSONString(output, scope.name_);
+            output.Append(buffer);
+        }
+    }
+
+    output += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return output;
+}
+
+bool TraceRecorder::SaveChromeTrace(const String& fileName, float seconds)
+{
+    String trace = GetChromeTrace(seconds);
+
+    File file;
+    if (!file.Open(fileName, FILE_WRITE))
+    {
+        DV_LOGERROR("Could not open trace file " + fileName);
+        return false;
+    }
+
+    return file.Write(trace.c_str(), trace.Length()) == trace.Length();
+}
+
+}
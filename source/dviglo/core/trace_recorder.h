@@ -0,0 +1,73 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "../containers/str.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace dviglo
+{
+
+/// Recorder of profiling scopes from all threads. Each thread writes to its own ring buffer without locks.
+/// Recorded scopes can be saved in Chrome trace format, which can be viewed in chrome://tracing or ui.perfetto.dev.
+class DV_API TraceRecorder
+{
+public:
+    /// Enable or disable recording. Disabled by default.
+    static void SetEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+    /// Return whether recording is enabled.
+    static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /// Set name of the calling thread in the trace.
+    static void SetThreadName(const String& name);
+    /// Record a scope of the calling thread. Name must be a string literal or otherwise outlive the recorder.
+    static void Record(const char* name, i64 beginTicks, i64 endTicks);
+    /// Discard recorded scopes of all threads. Should not be called while other threads record.
+    static void Clear();
+
+    /// Return total duration in nanoseconds of the scopes with the specified names, which ended on any thread since
+    /// the specified time. A scope nested in a counted scope of the same thread is not counted again.
+    static i64 GetTotalTime(const Vector<const char*>& names, i64 sinceTicks);
+
+    /// Return scopes which ended during the last seconds (all recorded scopes if zero) as Chrome trace JSON.
+    static String GetChromeTrace(float seconds = 0.0f);
+    /// Save scopes which ended during the last seconds (all recorded scopes if zero) as Chrome trace JSON. Return true if successful.
+    static bool SaveChromeTrace(const String& fileName, float seconds = 0.0f);
+
+    /// Return current time in nanoseconds.
+    static i64 GetTicks() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+private:
+    /// Recording enabled flag.
+    static std::atomic<bool> enabled;
+};
+
+/// Helper class for recording a scope.
+class AutoTraceScope
+{
+public:
+    /// Construct. Begin the scope if recording is enabled.
+    explicit AutoTraceScope(const char* name) :
+        name_(TraceRecorder::IsEnabled() ? name : nullptr),
+        beginTicks_(name_ ? TraceRecorder::GetTicks() : 0)
+    {
+    }
+
+    /// Destruct. Record the scope.
+    ~AutoTraceScope()
+    {
+        if (name_)
+            TraceRecorder::Record(name_, beginTicks_, TraceRecorder::GetTicks());
+    }
+
+private:
+    /// Scope name. Null if recording was disabled at the beginning.
+    const char* name_;
+    /// Beginning time.
+    i64 beginTicks_;
+};
+
+}
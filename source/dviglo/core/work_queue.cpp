@@ -5,12 +5,195 @@
 #include "core_events.h"
 #include "process_utils.h"
 #include "profiler.h"
+#include "task_graph.h"
 #include "work_queue.h"
 #include "../io/log.h"
 
 namespace dviglo
 {
 
+/// Size of the cache line. Frequently modified data of different threads is aligned to it to avoid false sharing.
+static constexpr i32 CACHE_LINE_SIZE = 64;
+
+/// Initial capacity of the per-thread queue.
+static constexpr i64 INITIAL_DEQUE_CAPACITY = 64;
+
+/// Index of the worker thread which runs the code. -1 in the threads which are not workers, including the main thread.
+static thread_local i32 currentThreadIndex = -1;
+
+/// Queue of work items. Taking is lock-free and can be done by any thread (including the main thread).
+/// Pushing is done mostly by the main thread, worker threads push only continuations of task graphs.
+/// Items are taken in FIFO order. The buffer grows when full, old buffers are kept until destruction because
+/// other threads may still read them.
+class WorkDeque
+{
+public:
+    /// Result of taking an item.
+    enum TakeResult
+    {
+        TAKE_EMPTY,
+        TAKE_SUCCESS,
+        /// Another thread took the item first.
+        TAKE_CONTENDED
+    };
+
+    /// Construct.
+    WorkDeque()
+    {
+        buffer_ = new Buffer(INITIAL_DEQUE_CAPACITY);
+    }
+
+    /// Destruct.
+    ~WorkDeque()
+    {
+        delete buffer_.load();
+
+        for (Buffer* buffer : retired_)
+            delete buffer;
+    }
+
+    /// Push an item. Can be called by any thread, pushing threads are serialized with a spin lock.
+    void Push(WorkItem* item, u32 ticket)
+    {
+        while (pushLock_.test_and_set(std::memory_order_acquire))
+        {
+        }
+
+        i64 bottom = bottom_.load(std::memory_order_relaxed);
+        i64 top = top_.load(std::memory_order_acquire);
+        Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+        if (bottom - top >= buffer->capacity_)
+        {
+            Buffer* newBuffer = new Buffer(buffer->capacity_ * 2);
+            for (i64 i = top; i < bottom; ++i)
+                newBuffer->Put(i, buffer->GetItem(i), buffer->GetTicket(i));
+
+            buffer_.store(newBuffer, std::memory_order_release);
+            retired_.Push(buffer);
+            buffer = newBuffer;
+        }
+
+        buffer->Put(bottom, item, ticket);
+        bottom_.store(bottom + 1, std::memory_order_release);
+
+        pushLock_.clear(std::memory_order_release);
+    }
+
+    /// Take the oldest item. Can be called by any thread.
+    TakeResult Take(WorkItem*& item, u32& ticket)
+    {
+        i64 top = top_.load(std::memory_order_acquire);
+        i64 bottom = bottom_.load(std::memory_order_acquire);
+
+        if (top >= bottom)
+            return TAKE_EMPTY;
+
+        Buffer* buffer = buffer_.load(std::memory_order_acquire);
+        item = buffer->GetItem(top);
+        ticket = buffer->GetTicket(top);
+
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return TAKE_CONTENDED;
+
+        return TAKE_SUCCESS;
+    }
+
+    /// Return whether has no items.
+    bool IsEmpty() const
+    {
+        return top_.load(std::memory_order_seq_cst) >= bottom_.load(std::memory_order_seq_cst);
+    }
+
+private:
+    /// Slot of the ring buffer.
+    struct Slot
+    {
+        std::atomic<WorkItem*> item_{};
+        std::atomic<u32> ticket_{};
+    };
+
+    /// Ring buffer. Capacity is a power of two.
+    struct Buffer
+    {
+        explicit Buffer(i64 capacity) :
+            capacity_(capacity),
+            slots_(new Slot[capacity])
+        {
+        }
+
+        void Put(i64 index, WorkItem* item, u32 ticket)
+        {
+            Slot& slot = slots_[index & (capacity_ - 1)];
+            slot.item_.store(item, std::memory_order_relaxed);
+            slot.ticket_.store(ticket, std::memory_order_relaxed);
+        }
+
+        WorkItem* GetItem(i64 index) const { return slots_[index & (capacity_ - 1)].item_.load(std::memory_order_relaxed); }
+        u32 GetTicket(i64 index) const { return slots_[index & (capacity_ - 1)].ticket_.load(std::memory_order_relaxed); }
+
+        i64 capacity_;
+        std::unique_ptr<Slot[]> slots_;
+    };
+
+    /// Index of the oldest item. Modified by the taking threads.
+    alignas(CACHE_LINE_SIZE) std::atomic<i64> top_{};
+    /// Index past the newest item. Modified only by the pushing thread.
+    alignas(CACHE_LINE_SIZE) std::atomic<i64> bottom_{};
+    /// Current buffer.
+    std::atomic<Buffer*> buffer_{};
+    /// Lock of the pushing side.
+    std::atomic_flag pushLock_ = ATOMIC_FLAG_INIT;
+    /// Replaced buffers. Accessed only by the pushing thread.
+    Vector<Buffer*> retired_;
+};
+
+/// Queues of the work items with the same priority.
+struct WorkQueueLane
+{
+    /// Construct.
+    WorkQueueLane(i32 priority, i32 numDeques) :
+        priority_(priority),
+        deques_(new WorkDeque[numDeques]),
+        numDeques_(numDeques)
+    {
+    }
+
+    /// Priority of the items.
+    const i32 priority_;
+    /// Number of submitted items which are not completed yet.
+    alignas(CACHE_LINE_SIZE) std::atomic<i32> pending_{};
+    /// Next lane with lower priority.
+    std::atomic<WorkQueueLane*> next_{};
+    /// Queue for each thread (0 = main thread).
+    std::unique_ptr<WorkDeque[]> deques_;
+    /// Number of queues.
+    const i32 numDeques_;
+    /// Queue which will receive the next item submitted by the main thread.
+    i32 nextDeque_{};
+};
+
+/// Scheduling state of a thread.
+struct alignas(CACHE_LINE_SIZE) WorkerState
+{
+    /// Set while the thread inspects the queues and may access the items which were removed.
+    std::atomic<bool> busy_{};
+    /// Number of executed items.
+    std::atomic<i64> executed_{};
+    /// Number of items taken from the queues of other threads.
+    std::atomic<i64> stolen_{};
+    /// Number of failed attempts to take an item.
+    std::atomic<i64> contended_{};
+    /// Number of times no work was found.
+    std::atomic<i64> idle_{};
+};
+
+/// Increment statistics counter. Only the owning thread writes to the counter, so atomic read-modify-write is not needed.
+static inline void IncrementStat(std::atomic<i64>& counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -26,7 +209,7 @@ public:
     /// Process work items until stopped.
     void ThreadFunction() override
     {
-#ifdef DV_TRACY_PROFILING
+#if defined(DV_TRACY_PROFILING) || defined(DV_PROFILING)
         String name;
         name.AppendWithFormat("WorkerThread #%d", index_);
         DV_PROFILE_THREAD(name.c_str());
@@ -47,6 +230,10 @@ private:
 };
 
 WorkQueue::WorkQueue() :
+    lanes_(nullptr),
+    workerStates_(new WorkerState[1]),
+    numWorkerStates_(1),
+    lastTicket_(0),
     shutDown_(false),
     pausing_(false),
     paused_(false),
@@ -66,6 +253,14 @@ WorkQueue::~WorkQueue()
 
     for (const SharedPtr<WorkerThread>& thread : threads_)
         thread->Stop();
+
+    WorkQueueLane* lane = lanes_.load();
+    while (lane)
+    {
+        WorkQueueLane* next = lane->next_.load();
+        delete lane;
+        lane = next;
+    }
 }
 
 void WorkQueue::CreateThreads(i32 numThreads)
@@ -81,6 +276,9 @@ void WorkQueue::CreateThreads(i32 numThreads)
     // Start threads in paused mode
     Pause();
 
+    workerStates_.reset(new WorkerState[numThreads + 1]);
+    numWorkerStates_ = numThreads + 1;
+
     for (i32 i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -96,8 +294,8 @@ SharedPtr<WorkItem> WorkQueue::GetFreeItem()
 {
     if (poolItems_.Size() > 0)
     {
-        SharedPtr<WorkItem> item = poolItems_.Front();
-        poolItems_.PopFront();
+        SharedPtr<WorkItem> item = poolItems_.Back();
+        poolItems_.Pop();
         return item;
     }
     else
@@ -117,89 +315,90 @@ void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
         return;
     }
 
+    RegisterItem(item);
+    EnqueueItem(item.Get(), 0);
+
+    if (threads_.Size())
+        Resume();
+}
+
+void WorkQueue::RegisterItem(const SharedPtr<WorkItem>& item)
+{
     // Check for duplicate items.
-    assert(!workItems_.Contains(item));
+    assert(!item->queued_);
 
     // Push to the main thread list to keep item alive
     // Clear completed flag in case item is reused
     workItems_.Push(item);
     item->completed_ = false;
+    item->queued_ = true;
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.lock();
+    // Ticket 0 means "taken", so skip it on overflow
+    if (++lastTicket_ == 0)
+        ++lastTicket_;
 
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
-    else
-    {
-        bool inserted = false;
+    WorkQueueLane* lane = GetLane(item->priority_);
+    item->lane_ = lane;
+    item->ticket_.store(lastTicket_, std::memory_order_relaxed);
+    lane->pending_.fetch_add(1, std::memory_order_relaxed);
+}
 
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
-        {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.Insert(i, item);
-                inserted = true;
-                break;
-            }
-        }
+void WorkQueue::EnqueueItem(WorkItem* item, i32 threadIndex)
+{
+    WorkQueueLane* lane = item->lane_;
+    i32 dequeIndex;
 
-        if (!inserted)
-            queue_.Push(item);
+    if (threadIndex == 0)
+    {
+        // Distribute the items of the main thread evenly between the threads, idle threads will steal the rest
+        dequeIndex = lane->nextDeque_;
+        lane->nextDeque_ = (lane->nextDeque_ + 1) % lane->numDeques_;
     }
-
-    if (threads_.Size())
+    else
     {
-        queueMutex_.unlock();
-        paused_ = false;
+        // Keep the continuations in the own queue of the worker thread, so they are likely to run while data is in cache
+        dequeIndex = threadIndex % lane->numDeques_;
     }
+
+    lane->deques_[dequeIndex].Push(item, item->ticket_.load(std::memory_order_relaxed));
 }
 
 bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 {
-    if (!item)
+    if (!item || !item->queued_)
         return false;
 
-    std::scoped_lock lock(queueMutex_);
-
     // Can only remove successfully if the item was not yet taken by threads for execution
-    List<WorkItem*>::Iterator i = queue_.Find(item.Get());
-    if (i != queue_.End())
+    u32 ticket = item->ticket_.load(std::memory_order_relaxed);
+    if (!ticket || !item->ticket_.compare_exchange_strong(ticket, 0))
+        return false;
+
+    item->lane_->pending_.fetch_sub(1, std::memory_order_release);
+    item->queued_ = false;
+
+    // The queue slot of the item stays until some thread skips it, so the item must be kept alive
+    removedItems_.Push(item);
+
+    for (i32 i = 0; i < workItems_.Size(); ++i)
     {
-        List<SharedPtr<WorkItem>>::Iterator j = workItems_.Find(item);
-        if (j != workItems_.End())
+        if (workItems_[i] == item)
         {
-            queue_.Erase(i);
-            ReturnToPool(item);
-            workItems_.Erase(j);
-            return true;
+            workItems_.Erase(i);
+            break;
         }
     }
 
-    return false;
+    return true;
 }
 
 i32 WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem>>& items)
 {
-    std::scoped_lock lock(queueMutex_);
     i32 removed = 0;
 
-    for (Vector<SharedPtr<WorkItem>>::ConstIterator i = items.Begin(); i != items.End(); ++i)
+    for (const SharedPtr<WorkItem>& item : items)
     {
-        List<WorkItem*>::Iterator j = queue_.Find(i->Get());
-        if (j != queue_.End())
-        {
-            List<SharedPtr<WorkItem>>::Iterator k = workItems_.Find(*i);
-            if (k != workItems_.End())
-            {
-                queue_.Erase(j);
-                ReturnToPool(*k);
-                workItems_.Erase(k);
-                ++removed;
-            }
-        }
+        if (RemoveWorkItem(item))
+            ++removed;
     }
 
     return removed;
@@ -238,23 +437,8 @@ void WorkQueue::Complete(i32 priority)
         Resume();
 
         // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.Empty())
-        {
-            queueMutex_.lock();
-            if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.unlock();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.unlock();
-                break;
-            }
-        }
+        while (WorkItem* item = TakeItem(0, priority))
+            ExecuteItem(item, 0);
 
         // Wait for threaded work to complete
         while (!IsCompleted(priority))
@@ -262,41 +446,117 @@ void WorkQueue::Complete(i32 priority)
         }
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
+        if (!HasPendingWork())
             Pause();
     }
     else
     {
         // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-        {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
-        }
+        while (WorkItem* item = TakeItem(0, priority))
+            ExecuteItem(item, 0);
     }
 
     PurgeCompleted(priority);
     completing_ = false;
 }
 
+void WorkQueue::ParallelFor(i32 begin, i32 end, i32 grain, const TaskFunction& function)
+{
+    // Not worth splitting. Worker threads can not wait for other work, so they process the range themselves
+    if (threads_.Empty() || end - begin <= Max(grain, 1) || !Thread::IsMainThread())
+    {
+        if (begin < end)
+        {
+            // Per-thread data of the function is indexed by the thread, other threads would share it with the main thread
+            i32 threadIndex = GetThreadIndex();
+            assert(threadIndex >= 0);
+            function(begin, end, threadIndex);
+        }
+
+        return;
+    }
+
+    if (!parallelForGraph_)
+        parallelForGraph_ = new TaskGraph(this);
+
+    // Nested call from a function which is executed by the main thread
+    SharedPtr<TaskGraph> graph = parallelForGraph_->IsRunning() ? SharedPtr<TaskGraph>(new TaskGraph(this)) : parallelForGraph_;
+
+    graph->Clear();
+    graph->AddParallelFor(begin, end, grain, function);
+    graph->Run();
+    graph->Wait();
+}
+
+i32 WorkQueue::GetThreadIndex()
+{
+    return Thread::IsMainThread() ? 0 : currentThreadIndex;
+}
+
 bool WorkQueue::IsCompleted(i32 priority) const
 {
     assert(priority >= 0);
-    for (List<SharedPtr<WorkItem>>::ConstIterator i = workItems_.Begin(); i != workItems_.End(); ++i)
+
+    // Lanes are sorted by descending priority
+    for (WorkQueueLane* lane = lanes_.load(std::memory_order_acquire); lane && lane->priority_ >= priority;
+         lane = lane->next_.load(std::memory_order_acquire))
     {
-        if ((*i)->priority_ >= priority && !(*i)->completed_)
+        if (lane->pending_.load(std::memory_order_acquire) > 0)
             return false;
     }
 
     return true;
 }
 
+WorkQueueStats WorkQueue::GetStats(i32 threadIndex) const
+{
+    WorkQueueStats ret;
+
+    if (threadIndex < 0 || threadIndex >= numWorkerStates_)
+        return ret;
+
+    const WorkerState& state = workerStates_[threadIndex];
+    ret.executed_ = state.executed_.load(std::memory_order_relaxed);
+    ret.stolen_ = state.stolen_.load(std::memory_order_relaxed);
+    ret.contended_ = state.contended_.load(std::memory_order_relaxed);
+    ret.idle_ = state.idle_.load(std::memory_order_relaxed);
+    return ret;
+}
+
+WorkQueueStats WorkQueue::GetTotalStats() const
+{
+    WorkQueueStats ret;
+
+    for (i32 i = 0; i < numWorkerStates_; ++i)
+    {
+        WorkQueueStats stats = GetStats(i);
+        ret.executed_ += stats.executed_;
+        ret.stolen_ += stats.stolen_;
+        ret.contended_ += stats.contended_;
+        ret.idle_ += stats.idle_;
+    }
+
+    return ret;
+}
+
+void WorkQueue::ResetStats()
+{
+    for (i32 i = 0; i < numWorkerStates_; ++i)
+    {
+        WorkerState& state = workerStates_[i];
+        state.executed_.store(0, std::memory_order_relaxed);
+        state.stolen_.store(0, std::memory_order_relaxed);
+        state.contended_.store(0, std::memory_order_relaxed);
+        state.idle_.store(0, std::memory_order_relaxed);
+    }
+}
+
 void WorkQueue::ProcessItems(i32 threadIndex)
 {
     assert(threadIndex >= 0);
 
+    currentThreadIndex = threadIndex;
+
     bool wasActive = false;
 
     for (;;)
@@ -308,21 +568,19 @@ void WorkQueue::ProcessItems(i32 threadIndex)
             Time::Sleep(0);
         else
         {
-            queueMutex_.lock();
-            if (!queue_.Empty())
+            WorkItem* item = TakeItem(threadIndex, M_MIN_INT);
+            if (item)
             {
                 wasActive = true;
-
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.unlock();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
+                ExecuteItem(item, threadIndex);
             }
             else
             {
                 wasActive = false;
+                IncrementStat(workerStates_[threadIndex].idle_);
 
+                // Wait here while the queue is paused
+                queueMutex_.lock();
                 queueMutex_.unlock();
                 Time::Sleep(0);
             }
@@ -330,32 +588,188 @@ void WorkQueue::ProcessItems(i32 threadIndex)
     }
 }
 
+WorkItem* WorkQueue::TakeItem(i32 threadIndex, i32 minPriority)
+{
+    WorkerState& state = workerStates_[threadIndex];
+    WorkItem* ret = nullptr;
+
+    state.busy_.store(true, std::memory_order_seq_cst);
+
+    for (WorkQueueLane* lane = lanes_.load(std::memory_order_acquire); lane && lane->priority_ >= minPriority && !ret;
+         lane = lane->next_.load(std::memory_order_acquire))
+    {
+        if (lane->pending_.load(std::memory_order_relaxed) <= 0)
+            continue;
+
+        i32 ownDeque = threadIndex % lane->numDeques_;
+
+        for (i32 i = 0; i < lane->numDeques_ && !ret; ++i)
+        {
+            WorkDeque& deque = lane->deques_[(ownDeque + i) % lane->numDeques_];
+
+            for (;;)
+            {
+                WorkItem* item;
+                u32 ticket;
+                WorkDeque::TakeResult result = deque.Take(item, ticket);
+
+                if (result == WorkDeque::TAKE_EMPTY)
+                    break;
+
+                if (result == WorkDeque::TAKE_CONTENDED)
+                {
+                    IncrementStat(state.contended_);
+                    continue;
+                }
+
+                // Slot may be stale if the item was removed from the queue
+                if (item->ticket_.compare_exchange_strong(ticket, 0))
+                {
+                    if (i > 0)
+                        IncrementStat(state.stolen_);
+
+                    ret = item;
+                    break;
+                }
+            }
+        }
+    }
+
+    state.busy_.store(false, std::memory_order_seq_cst);
+    return ret;
+}
+
+void WorkQueue::ExecuteItem(WorkItem* item, i32 threadIndex)
+{
+    // Item can be reused by the main thread as soon as it is marked completed
+    WorkQueueLane* lane = item->lane_;
+
+    item->workFunction_(item, threadIndex);
+    item->completed_ = true;
+    lane->pending_.fetch_sub(1, std::memory_order_release);
+
+    IncrementStat(workerStates_[threadIndex].executed_);
+}
+
+bool WorkQueue::ExecuteOne(i32 minPriority)
+{
+    WorkItem* item = TakeItem(0, minPriority);
+    if (!item)
+        return false;
+
+    ExecuteItem(item, 0);
+    return true;
+}
+
+WorkQueueLane* WorkQueue::GetLane(i32 priority)
+{
+    WorkQueueLane* prev = nullptr;
+    WorkQueueLane* lane = lanes_.load(std::memory_order_relaxed);
+
+    while (lane && lane->priority_ > priority)
+    {
+        prev = lane;
+        lane = lane->next_.load(std::memory_order_relaxed);
+    }
+
+    if (lane && lane->priority_ == priority)
+        return lane;
+
+    // Lists are only modified by the main thread, other threads see either the old or the new list
+    WorkQueueLane* newLane = new WorkQueueLane(priority, numWorkerStates_);
+    newLane->next_.store(lane, std::memory_order_relaxed);
+
+    if (prev)
+        prev->next_.store(newLane, std::memory_order_release);
+    else
+        lanes_.store(newLane, std::memory_order_release);
+
+    return newLane;
+}
+
+bool WorkQueue::IsQueueEmpty() const
+{
+    for (WorkQueueLane* lane = lanes_.load(std::memory_order_acquire); lane; lane = lane->next_.load(std::memory_order_acquire))
+    {
+        for (i32 i = 0; i < lane->numDeques_; ++i)
+        {
+            if (!lane->deques_[i].IsEmpty())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool WorkQueue::HasPendingWork() const
+{
+    for (WorkQueueLane* lane = lanes_.load(std::memory_order_acquire); lane; lane = lane->next_.load(std::memory_order_acquire))
+    {
+        if (lane->pending_.load(std::memory_order_acquire) > 0)
+            return true;
+    }
+
+    return false;
+}
+
 void WorkQueue::PurgeCompleted(i32 priority)
 {
     assert(priority >= 0);
 
     // Purge completed work items and send completion events. Do not signal items lower than priority threshold,
     // as those may be user submitted and lead to eg. scene manipulation that could happen in the middle of the
-    // render update, which is not allowed
-    for (List<SharedPtr<WorkItem>>::Iterator i = workItems_.Begin(); i != workItems_.End();)
+    // render update, which is not allowed. Event handlers may submit new items, so the size is checked every iteration
+    i32 dest = 0;
+
+    for (i32 i = 0; i < workItems_.Size(); ++i)
     {
-        if ((*i)->completed_ && (*i)->priority_ >= priority)
+        SharedPtr<WorkItem> item = workItems_[i];
+
+        if (item->completed_ && item->priority_ >= priority)
         {
-            if ((*i)->sendEvent_)
+            if (item->sendEvent_)
             {
                 using namespace WorkItemCompleted;
 
                 VariantMap& eventData = GetEventDataMap();
-                eventData[P_ITEM] = i->Get();
+                eventData[P_ITEM] = item.Get();
                 SendEvent(E_WORKITEMCOMPLETED, eventData);
             }
 
-            ReturnToPool(*i);
-            i = workItems_.Erase(i);
+            item->queued_ = false;
+            ReturnToPool(item);
         }
         else
-            ++i;
+        {
+            workItems_[dest++] = item;
+        }
+    }
+
+    workItems_.Resize(dest);
+
+    PurgeRemoved();
+}
+
+void WorkQueue::PurgeRemoved()
+{
+    if (removedItems_.Empty() || !IsQueueEmpty())
+        return;
+
+    // No stale slots remain. Make sure no thread is still inspecting an item taken from a slot
+    for (i32 i = 0; i < numWorkerStates_; ++i)
+    {
+        if (workerStates_[i].busy_.load(std::memory_order_seq_cst))
+            return;
     }
+
+    for (SharedPtr<WorkItem>& item : removedItems_)
+    {
+        // Item could have been submitted again
+        if (!item->queued_)
+            ReturnToPool(item);
+    }
+
+    removedItems_.Clear();
 }
 
 void WorkQueue::PurgePool()
@@ -365,7 +779,7 @@ void WorkQueue::PurgePool()
 
     // Difference tolerance, should be fairly significant to reduce the pool size.
     for (i32 i = 0; poolItems_.Size() > 0 && difference > tolerance_ && i < difference; i++)
-        poolItems_.PopFront();
+        poolItems_.Pop();
 
     lastSize_ = currentSize;
 }
@@ -386,6 +800,7 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
         item->priority_ = WI_MAX_PRIORITY;
         item->sendEvent_ = false;
         item->completed_ = false;
+        item->lane_ = nullptr;
 
         poolItems_.Push(item);
     }
@@ -394,18 +809,19 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.Empty() && !queue_.Empty())
+    if (threads_.Empty() && !IsQueueEmpty())
     {
         DV_PROFILE(CompleteWorkNonthreaded);
 
         HiresTimer timer;
 
-        while (!queue_.Empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* item = TakeItem(0, M_MIN_INT);
+            if (!item)
+                break;
+
+            ExecuteItem(item, 0);
         }
     }
 
@@ -4,10 +4,11 @@
 
 #pragma once
 
-#include "../containers/list.h"
 #include "object.h"
 
 #include <atomic>
+#include <functional>
+#include <memory>
 #include <mutex>
 
 namespace dviglo
@@ -21,7 +22,10 @@ DV_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 
 inline constexpr i32 WI_MAX_PRIORITY = M_MAX_INT;
 
+class TaskGraph;
 class WorkerThread;
+struct WorkQueueLane;
+struct WorkerState;
 
 /// Work queue item.
 struct WorkItem : public RefCounted
@@ -46,6 +50,28 @@ public:
 
 private:
     bool pooled_{};
+    /// Whether the item is submitted and not yet purged. Accessed only by the main thread.
+    bool queued_{};
+    /// Ticket of the queue slot that may execute the item. Zero when the item is taken or removed.
+    std::atomic<u32> ticket_{};
+    /// Priority lane the item was submitted to.
+    WorkQueueLane* lane_{};
+};
+
+/// Function of a parallel task. Called with the range of items to process and thread index (0 = main thread).
+using TaskFunction = std::function<void(i32 begin, i32 end, i32 threadIndex)>;
+
+/// Work queue scheduling statistics of one thread.
+struct WorkQueueStats
+{
+    /// Number of executed work items.
+    i64 executed_{};
+    /// Number of work items taken from the queues of other threads.
+    i64 stolen_{};
+    /// Number of failed attempts to take an item because another thread took it first.
+    i64 contended_{};
+    /// Number of times the thread found no work.
+    i64 idle_{};
 };
 
 /// Work queue subsystem for multithreading.
@@ -53,6 +79,7 @@ class DV_API WorkQueue : public Object
 {
     DV_OBJECT(WorkQueue, Object);
 
+    friend class TaskGraph;
     friend class WorkerThread;
 
 public:
@@ -77,6 +104,8 @@ public:
     void Resume();
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(i32 priority);
+    /// Process range [begin, end) in parallel in chunks of at least grain items and wait for completion. Main thread also processes chunks. When called from a worker thread, the range is processed by the calling thread.
+    void ParallelFor(i32 begin, i32 end, i32 grain, const TaskFunction& function);
 
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
@@ -87,6 +116,8 @@ public:
     /// Return number of worker threads.
     i32 GetNumThreads() const { return threads_.Size(); }
 
+    /// Return index of the calling thread: 0 for the main thread, from 1 for the worker threads and -1 for other threads.
+    static i32 GetThreadIndex();
     /// Return whether all work with at least the specified priority is finished.
     bool IsCompleted(i32 priority) const;
     /// Return whether the queue is currently completing work in the main thread.
@@ -95,12 +126,37 @@ public:
     /// Return the pool tolerance.
     int GetTolerance() const { return tolerance_; }
 
+    /// Return scheduling statistics of a thread (0 = main thread).
+    WorkQueueStats GetStats(i32 threadIndex) const;
+    /// Return scheduling statistics summed over all threads.
+    WorkQueueStats GetTotalStats() const;
+    /// Reset scheduling statistics. Should not be called while work is being completed.
+    void ResetStats();
+
     /// Return how many milliseconds maximum to spend on non-threaded low-priority work.
     int GetNonThreadedWorkMs() const { return maxNonThreadedWorkMs_; }
 
 private:
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(i32 threadIndex);
+    /// Take a queued work item which has at least the specified priority. Own queue of the thread is tried first, then work is stolen from the other threads. Return null if no work.
+    WorkItem* TakeItem(i32 threadIndex, i32 minPriority);
+    /// Execute a taken work item.
+    void ExecuteItem(WorkItem* item, i32 threadIndex);
+    /// Take and execute one work item which has at least the specified priority in the main thread. Return false if no work.
+    bool ExecuteOne(i32 minPriority);
+    /// Register a work item as submitted without making it available to the threads yet. Called only by the main thread.
+    void RegisterItem(const SharedPtr<WorkItem>& item);
+    /// Make a registered work item available to the threads. Can be called from any thread.
+    void EnqueueItem(WorkItem* item, i32 threadIndex);
+    /// Return whether there are submitted items which are not completed yet in any lane.
+    bool HasPendingWork() const;
+    /// Return the priority lane, create if not exists. Called only by the main thread.
+    WorkQueueLane* GetLane(i32 priority);
+    /// Return whether there are no queued items in any lane.
+    bool IsQueueEmpty() const;
+    /// Return removed items to the pool when no thread can access them anymore.
+    void PurgeRemoved();
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(i32 priority);
     /// Purge the pool to reduce allocation where its unneeded.
@@ -112,13 +168,21 @@ private:
 
     /// Worker threads.
     Vector<SharedPtr<WorkerThread>> threads_;
-    /// Work item pool for reuse to cut down on allocation. The bool is a flag for item pooling and whether it is available or not.
-    List<SharedPtr<WorkItem>> poolItems_;
+    /// Work item pool for reuse to cut down on allocation. Used as a stack by the main thread only.
+    Vector<SharedPtr<WorkItem>> poolItems_;
     /// Work item collection. Accessed only by the main thread.
-    List<SharedPtr<WorkItem>> workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems).
-    List<WorkItem*> queue_;
-    /// Worker queue mutex.
+    Vector<SharedPtr<WorkItem>> workItems_;
+    /// Removed items which may still be referenced by stale queue slots. Accessed only by the main thread.
+    Vector<SharedPtr<WorkItem>> removedItems_;
+    /// Priority lanes sorted by descending priority. Each lane has a lock-free queue per thread. Lanes are only added by the main thread and never removed until destruction.
+    std::atomic<WorkQueueLane*> lanes_;
+    /// Per-thread scheduling state and statistics (0 = main thread).
+    std::unique_ptr<WorkerState[]> workerStates_;
+    /// Number of per-thread states.
+    i32 numWorkerStates_;
+    /// Ticket of the last submitted item.
+    u32 lastTicket_;
+    /// Mutex which keeps the idle worker threads waiting while the queue is paused. Is not used to access the queues.
     std::mutex queueMutex_;
     /// Shutting down flag.
     std::atomic<bool> shutDown_;
@@ -134,6 +198,8 @@ private:
     i32 lastSize_;
     /// Maximum milliseconds per frame to spend on low-priority work, when there are no worker threads.
     int maxNonThreadedWorkMs_;
+    /// Task graph reused by ParallelFor().
+    SharedPtr<TaskGraph> parallelForGraph_;
 };
 
 }
@@ -513,6 +513,9 @@ void Engine::RunFrame()
 
     time->BeginFrame(timeStep_);
 
+    // Deliver events posted from worker threads since the previous frame
+    DV_CONTEXT.SendPostedEvents();
+
     // If pause when minimized -mode is in use, stop updates and audio as necessary
     if (pauseMinimized_ && input->IsMinimized())
     {
@@ -706,20 +709,20 @@ void Engine::Update()
     DV_PROFILE(Update);
 
     // Logic update event
-    using namespace Update;
-
-    VariantMap& eventData = GetEventDataMap();
-    eventData[P_TIMESTEP] = timeStep_;
-    SendEvent(E_UPDATE, eventData);
+    UpdateEvent updateEvent{timeStep_};
+    SendTypedEvent(updateEvent);
 
     // Logic post-update event
-    SendEvent(E_POSTUPDATE, eventData);
+    PostUpdateEvent postUpdateEvent{timeStep_};
+    SendTypedEvent(postUpdateEvent);
 
     // Rendering update event
-    SendEvent(E_RENDERUPDATE, eventData);
+    RenderUpdateEvent renderUpdateEvent{timeStep_};
+    SendTypedEvent(renderUpdateEvent);
 
     // Post-render update event
-    SendEvent(E_POSTRENDERUPDATE, eventData);
+    PostRenderUpdateEvent postRenderUpdateEvent{timeStep_};
+    SendTypedEvent(postRenderUpdateEvent);
 }
 
 void Engine::Render()
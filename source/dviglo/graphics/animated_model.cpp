@@ -59,6 +59,8 @@ AnimatedModel::AnimatedModel() :
     morphsDirty_(false),
     skinningDirty_(true),
     boneBoundingBoxDirty_(true),
+    boneTransformsDirty_(false),
+    flatSkeleton_(false),
     isMaster_(true),
     loading_(false),
     assignBonesPending_(false),
@@ -69,6 +71,17 @@ AnimatedModel::AnimatedModel() :
 AnimatedModel::~AnimatedModel()
 {
     // When being destroyed, remove the bone hierarchy if appropriate (last AnimatedModel in the node)
+    if (HasFlatBones())
+    {
+        for (Bone& bone : skeleton_.GetModifiableBones())
+        {
+            Node* parent = bone.node_ ? bone.node_->GetParent() : nullptr;
+            if (parent && !parent->GetComponent<AnimatedModel>())
+                bone.node_->Remove();
+        }
+        return;
+    }
+
     Bone* rootBone = skeleton_.GetRootBone();
     if (rootBone && rootBone->node_)
     {
@@ -83,6 +96,8 @@ void AnimatedModel::RegisterObject()
     DV_CONTEXT.RegisterFactory<AnimatedModel>(GEOMETRY_CATEGORY);
 
     DV_ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, true, AM_DEFAULT);
+    // Must be set before the model, which creates the skeleton
+    DV_ACCESSOR_ATTRIBUTE("Flat Skeleton", IsFlatSkeleton, SetFlatSkeleton, false, AM_DEFAULT);
     DV_ACCESSOR_ATTRIBUTE("Model", GetModelAttr, SetModelAttr, ResourceRef(Model::GetTypeStatic()), AM_DEFAULT);
     DV_ACCESSOR_ATTRIBUTE("Material", GetMaterialsAttr, SetMaterialsAttr, ResourceRefList(Material::GetTypeStatic()),
         AM_DEFAULT);
@@ -139,9 +154,16 @@ void AnimatedModel::ApplyAttributes()
 
 void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQueryResult>& results)
 {
-    // If no bones or no bone-level testing, use the StaticModel test
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    bool hasHitboxes = false;
+    for (const Bone& bone : bones)
+        hasHitboxes |= (bone.collisionMask_ & (BONECOLLISION_BOX | BONECOLLISION_SPHERE)) != 0;
+
+    // If no bone hitboxes or no bone-level testing, use the StaticModel test. At the triangle levels it tests
+    // the triangles of the bind pose transformed by the world transform. Texture coordinates exist only for triangles,
+    // so they are always queried from the bind pose
     RayQueryLevel level = query.level_;
-    if (level < RAY_TRIANGLE || !skeleton_.GetNumBones())
+    if (level < RAY_TRIANGLE || level == RAY_TRIANGLE_UV || !hasHitboxes)
     {
         StaticModel::ProcessRayQuery(query, results);
         return;
@@ -151,15 +173,17 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQuery
     if (query.ray_.HitDistance(GetWorldBoundingBox()) >= query.maxDistance_)
         return;
 
-    const Vector<Bone>& bones = skeleton_.GetBones();
+    const bool flatBones = HasFlatBones();
     Sphere boneSphere;
 
     for (i32 i = 0; i < bones.Size(); ++i)
     {
         const Bone& bone = bones[i];
-        if (!bone.node_)
+        if (!flatBones && !bone.node_)
             continue;
 
+        const Matrix3x4 transform = flatBones ? node_->GetWorldTransform() * boneTransforms_[i] :
+            bone.node_->GetWorldTransform();
         float distance;
 
         // Use hitbox if available
@@ -167,7 +191,6 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQuery
         {
             // Do an initial crude test using the bone's AABB
             const BoundingBox& box = bone.boundingBox_;
-            const Matrix3x4& transform = bone.node_->GetWorldTransform();
             distance = query.ray_.HitDistance(box.Transformed(transform));
             if (distance >= query.maxDistance_)
                 continue;
@@ -183,7 +206,7 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQuery
         }
         else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
         {
-            boneSphere.center_ = bone.node_->GetWorldPosition();
+            boneSphere.center_ = transform.Translation();
             boneSphere.radius_ = bone.radius_;
             distance = query.ray_.HitDistance(boneSphere);
             if (distance >= query.maxDistance_)
@@ -204,6 +227,17 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQuery
     }
 }
 
+void AnimatedModel::PrepareRayQuery()
+{
+    StaticModel::PrepareRayQuery();
+
+    for (const Bone& bone : skeleton_.GetBones())
+    {
+        if (bone.node_)
+            bone.node_->GetWorldTransform();
+    }
+}
+
 void AnimatedModel::Update(const FrameInfo& frame)
 {
     // If node was invisible last frame, need to decide animation LOD distance here
@@ -306,7 +340,34 @@ void AnimatedModel::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     if (debug && IsEnabledEffective())
     {
         debug->AddBoundingBox(GetWorldBoundingBox(), Color::GREEN, depthTest);
-        debug->AddSkeleton(skeleton_, Color(0.75f, 0.75f, 0.75f), depthTest);
+
+        if (!HasFlatBones())
+        {
+            debug->AddSkeleton(skeleton_, Color(0.75f, 0.75f, 0.75f), depthTest);
+            return;
+        }
+
+        // Same as DebugRenderer::AddSkeleton() but from the flat bone transforms
+        const Vector<Bone>& bones = skeleton_.GetBones();
+        const Matrix3x4& worldTransform = node_->GetWorldTransform();
+        color32 color = Color(0.75f, 0.75f, 0.75f).ToU32();
+
+        for (i32 i = 0; i < bones.Size(); ++i)
+        {
+            const Bone& bone = bones[i];
+            if (bone.radius_ < M_EPSILON && bone.boundingBox_.Size().LengthSquared() < M_EPSILON)
+                continue;
+
+            Vector3 start = worldTransform * boneTransforms_[i].Translation();
+            Vector3 end = start;
+
+            i32 j = bone.parentIndex_;
+            if (j != i && j >= 0 && j < bones.Size() &&
+                (bones[j].radius_ >= M_EPSILON || bones[j].boundingBox_.Size().LengthSquared() >= M_EPSILON))
+                end = worldTransform * boneTransforms_[j].Translation();
+
+            debug->AddLine(start, end, color, depthTest);
+        }
     }
 }
 
@@ -531,6 +592,33 @@ void AnimatedModel::SetUpdateInvisible(bool enable)
     MarkNetworkUpdate();
 }
 
+void AnimatedModel::SetPoseCache(AnimationPoseCache* cache)
+{
+    poseCache_ = cache;
+    MarkAnimationDirty();
+}
+
+void AnimatedModel::SetFlatSkeleton(bool enable)
+{
+    if (enable == flatSkeleton_)
+        return;
+
+    // Remove the bone nodes of the current mode and recreate the skeleton
+    bool recreate = model_ && node_ && isMaster_;
+    if (recreate)
+    {
+        RemoveRootBone();
+        skeleton_.ClearBones();
+    }
+
+    flatSkeleton_ = enable;
+
+    if (recreate)
+    {
+        SetSkeleton(model_->GetSkeleton(), !loading_);
+        MarkAnimationDirty();
+    }
+}
 
 void AnimatedModel::SetMorphWeight(i32 index, float weight)
 {
@@ -678,6 +766,33 @@ AnimationState* AnimatedModel::GetAnimationState(i32 index) const
     return index < animationStates_.Size() ? animationStates_[index].Get() : nullptr;
 }
 
+Node* AnimatedModel::GetOrCreateBoneNode(const String& name)
+{
+    Bone* bone = skeleton_.GetBone(name);
+    if (!bone)
+        return nullptr;
+
+    if (!bone->node_ && HasFlatBones())
+    {
+        if (boneTransformsDirty_)
+            UpdateFlatBoneTransforms();
+
+        Vector3 position;
+        Quaternion rotation;
+        Vector3 scale;
+        boneTransforms_[bone - skeleton_.GetBones().Buffer()].Decompose(position, rotation, scale);
+
+        // The node is a direct child of the model's node, so its transform is the bone transform relative to the model
+        Node* boneNode = node_->CreateChild(bone->name_, LOCAL);
+        boneNode->SetTransform(position, rotation, scale);
+        boneNode->SetTemporary(IsTemporary());
+        boneNode->AddListener(this);
+        bone->node_ = boneNode;
+    }
+
+    return bone->node_;
+}
+
 void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
 {
     if (!node_ && createBones)
@@ -697,8 +812,8 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
 
             for (unsigned i = 0; i < destBones.Size(); ++i)
             {
-                if (destBones[i].node_ && destBones[i].name_ == srcBones[i].name_ && destBones[i].parentIndex_ ==
-                                                                                     srcBones[i].parentIndex_)
+                if ((destBones[i].node_ || HasFlatBones()) && destBones[i].name_ == srcBones[i].name_ &&
+                    destBones[i].parentIndex_ == srcBones[i].parentIndex_)
                 {
                     // If compatible, just copy the values and retain the old node and animated status
                     Node* boneNode = destBones[i].node_;
@@ -714,7 +829,11 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
                 }
             }
             if (compatible)
+            {
+                if (HasFlatBones())
+                    InitFlatBones();
                 return;
+            }
         }
 
         RemoveAllAnimationStates();
@@ -729,8 +848,18 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
         FinalizeBoneBoundingBoxes();
 
         Vector<Bone>& bones = skeleton_.GetModifiableBones();
+        // In flat skeleton mode the bones are not scene nodes
+        if (flatSkeleton_)
+            InitFlatBones();
+        else
+        {
+            bonePose_ = AnimationPose();
+            boneTransforms_.Clear();
+            boneOrder_.Clear();
+        }
+
         // Create scene nodes for the bones
-        if (createBones)
+        if (createBones && !flatSkeleton_)
         {
             for (Vector<Bone>::Iterator i = bones.Begin(); i != bones.End(); ++i)
             {
@@ -899,6 +1028,32 @@ void AnimatedModel::UpdateBoneBoundingBox()
         Matrix3x4 inverseNodeTransform = node_->GetWorldTransform().Inverse();
 
         const Vector<Bone>& bones = skeleton_.GetBones();
+
+        // Flat bone transforms are already relative to the model's node
+        if (HasFlatBones())
+        {
+            if (boneTransformsDirty_)
+            {
+                UpdateFlatBoneTransforms();
+                // Moving the bone nodes marks the bone transforms dirty again, but they are already up to date
+                UpdateFlatBoneNodes();
+                boneTransformsDirty_ = false;
+            }
+
+            for (i32 i = 0; i < bones.Size(); ++i)
+            {
+                const Bone& bone = bones[i];
+                if (bone.collisionMask_ & BONECOLLISION_BOX)
+                    boneBoundingBox_.Merge(bone.boundingBox_.Transformed(boneTransforms_[i]));
+                else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
+                    boneBoundingBox_.Merge(Sphere(boneTransforms_[i].Translation(), bone.radius_ * 0.5f));
+            }
+
+            boneBoundingBoxDirty_ = false;
+            worldBoundingBoxDirty_ = true;
+            return;
+        }
+
         for (Vector<Bone>::ConstIterator i = bones.Begin(); i != bones.End(); ++i)
         {
             Node* boneNode = i->node_;
@@ -939,7 +1094,11 @@ void AnimatedModel::OnMarkedDirty(Node* node)
         skinningDirty_ = true;
         // Bone bounding box doesn't need to be marked dirty when only the base scene node moves
         if (node != node_)
+        {
             boneBoundingBoxDirty_ = true;
+            // A bone node created on demand may control a bone in flat skeleton mode
+            boneTransformsDirty_ = HasFlatBones();
+        }
     }
 }
 
@@ -970,12 +1129,14 @@ void AnimatedModel::AssignBoneNodes()
     if (!node_)
         return;
 
-    // Find the bone nodes from the node hierarchy and add listeners
+    // Find the bone nodes from the node hierarchy and add listeners. In flat skeleton mode only the nodes created on
+    // demand exist, as direct children of the model's node
     Vector<Bone>& bones = skeleton_.GetModifiableBones();
+    bool flatBones = HasFlatBones();
     bool boneFound = false;
     for (Vector<Bone>::Iterator i = bones.Begin(); i != bones.End(); ++i)
     {
-        Node* boneNode = node_->GetChild(i->name_, true);
+        Node* boneNode = node_->GetChild(i->name_, !flatBones);
         if (boneNode)
         {
             boneFound = true;
@@ -986,7 +1147,7 @@ void AnimatedModel::AssignBoneNodes()
 
     // If no bones found, this may be a prefab where the bone information was left out.
     // In that case reassign the skeleton now if possible
-    if (!boneFound && model_)
+    if (!boneFound && !flatBones && model_)
         SetSkeleton(model_->GetSkeleton(), true);
 
     // Re-assign the same start bone to animations to get the proper bone node this time
@@ -1061,6 +1222,16 @@ void AnimatedModel::FinalizeBoneBoundingBoxes()
 
 void AnimatedModel::RemoveRootBone()
 {
+    if (HasFlatBones())
+    {
+        for (Bone& bone : skeleton_.GetModifiableBones())
+        {
+            if (bone.node_)
+                bone.node_->Remove();
+        }
+        return;
+    }
+
     Bone* rootBone = skeleton_.GetRootBone();
     if (rootBone && rootBone->node_)
         rootBone->node_->Remove();
@@ -1243,6 +1414,8 @@ void AnimatedModel::SetGeometryBoneMappings()
 
 void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
 {
+    DV_PROFILE(UpdateAnimation);
+
     // If using animation LOD, accumulate time and see if it is time to update
     if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f)
     {
@@ -1259,10 +1432,13 @@ void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
             animationLodTimer_ = 0.0f;
     }
 
-    ApplyAnimation();
+    if (poseCache_)
+        ApplyCachedAnimation(frame.frameNumber_);
+    else
+        ApplyAnimation();
 }
 
-void AnimatedModel::ApplyAnimation()
+void AnimatedModel::SortAnimationStates()
 {
     // Make sure animations are in ascending priority order
     if (animationOrderDirty_)
@@ -1270,23 +1446,245 @@ void AnimatedModel::ApplyAnimation()
         std::sort(animationStates_.Begin(), animationStates_.End(), CompareAnimationOrder);
         animationOrderDirty_ = false;
     }
+}
+
+void AnimatedModel::ApplyCachedAnimation(i32 frameNumber)
+{
+    SortAnimationStates();
+
+    if (isMaster_)
+    {
+        Vector<Bone>& bones = skeleton_.GetModifiableBones();
+
+        // The pose depends on the model, the bones which are animated and the settings of the enabled animation states
+        poseKey_.Clear();
+        poseKey_.Push((u64)(uintptr_t)model_.Get());
+        for (i32 i = 0; i < bones.Size(); i += 64)
+        {
+            u64 animatedBones = 0;
+            for (i32 j = i; j < Min(i + 64, bones.Size()); ++j)
+                animatedBones |= bones[j].animated_ ? 1ull << (j - i) : 0;
+            poseKey_.Push(animatedBones);
+        }
+
+        for (const SharedPtr<AnimationState>& state : animationStates_)
+        {
+            if (state->GetAnimation() && state->IsEnabled())
+                state->AddPoseKey(poseKey_, poseCache_->QuantizeTime(state->GetTime()));
+        }
+
+        const bool flatBones = HasFlatBones();
+
+        if (const AnimationPose* pose = poseCache_->FindPose(poseKey_, frameNumber))
+        {
+            for (i32 i = 0; i < bones.Size(); ++i)
+            {
+                Bone& bone = bones[i];
+                if (!bone.animated_)
+                    continue;
+
+                if (flatBones)
+                {
+                    bonePose_.positions_[i] = pose->positions_[i];
+                    bonePose_.rotations_[i] = pose->rotations_[i];
+                    bonePose_.scales_[i] = pose->scales_[i];
+                }
+                else if (bone.node_)
+                    bone.node_->SetTransformSilent(pose->positions_[i], pose->rotations_[i], pose->scales_[i]);
+            }
+        }
+        else if (flatBones)
+        {
+            ResetFlatBones();
+            for (const SharedPtr<AnimationState>& state : animationStates_)
+                state->Apply(poseCache_->QuantizeTime(state->GetTime()));
+
+            poseCache_->StorePose(poseKey_, frameNumber, bonePose_);
+        }
+        else
+        {
+            skeleton_.ResetSilent();
+            for (const SharedPtr<AnimationState>& state : animationStates_)
+                state->Apply(poseCache_->QuantizeTime(state->GetTime()));
+
+            AnimationPose newPose;
+            newPose.positions_.Resize(bones.Size());
+            newPose.rotations_.Resize(bones.Size());
+            newPose.scales_.Resize(bones.Size());
+
+            for (i32 i = 0; i < bones.Size(); ++i)
+            {
+                Node* boneNode = bones[i].node_;
+                newPose.positions_[i] = boneNode ? boneNode->GetPosition() : bones[i].initialPosition_;
+                newPose.rotations_[i] = boneNode ? boneNode->GetRotation() : bones[i].initialRotation_;
+                newPose.scales_[i] = boneNode ? boneNode->GetScale() : bones[i].initialScale_;
+            }
+
+            poseCache_->StorePose(poseKey_, frameNumber, newPose);
+        }
+
+        FinishAnimation();
+    }
+
+    animationDirty_ = false;
+}
+
+void AnimatedModel::ApplyAnimation()
+{
+    SortAnimationStates();
 
     // Reset skeleton, apply all animations, calculate bones' bounding box. Make sure this is only done for the master model
     // (first AnimatedModel in a node)
     if (isMaster_)
     {
-        skeleton_.ResetSilent();
+        if (HasFlatBones())
+            ResetFlatBones();
+        else
+            skeleton_.ResetSilent();
+
         for (Vector<SharedPtr<AnimationState>>::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
             (*i)->Apply();
 
+        FinishAnimation();
+    }
+
+    animationDirty_ = false;
+}
+
+void AnimatedModel::FinishAnimation()
+{
+    if (HasFlatBones())
+    {
+        // The bone transforms are recalculated in one pass together with the bone bounding box, instead of marking the
+        // bone nodes dirty and updating their world transforms lazily
+        boneTransformsDirty_ = true;
+        skinningDirty_ = true;
+        worldBoundingBoxDirty_ = true;
+        if (!updateQueued_ && octant_)
+            octant_->GetRoot()->QueueUpdate(this);
+    }
+    else
+    {
         // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
         node_->MarkDirty();
+    }
 
-        // Calculate new bone bounding box
-        UpdateBoneBoundingBox();
+    // Calculate new bone bounding box
+    UpdateBoneBoundingBox();
+}
+
+void AnimatedModel::InitFlatBones()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    const i32 numBones = bones.Size();
+
+    bonePose_.positions_.Resize(numBones);
+    bonePose_.rotations_.Resize(numBones);
+    bonePose_.scales_.Resize(numBones);
+    boneTransforms_.Resize(numBones);
+
+    for (i32 i = 0; i < numBones; ++i)
+    {
+        bonePose_.positions_[i] = bones[i].initialPosition_;
+        bonePose_.rotations_[i] = bones[i].initialRotation_;
+        bonePose_.scales_[i] = bones[i].initialScale_;
     }
 
-    animationDirty_ = false;
+    // Parents before children. Usually the bones are already in this order
+    boneOrder_.Clear();
+    Vector<bool> added(numBones, false);
+    Vector<i32> chain;
+
+    for (i32 i = 0; i < numBones; ++i)
+    {
+        chain.Clear();
+        for (i32 j = i; j >= 0 && j < numBones && !added[j] && chain.Size() < numBones; j = bones[j].parentIndex_)
+        {
+            chain.Push(j);
+            if (bones[j].parentIndex_ == j)
+                break;
+        }
+
+        for (i32 j = chain.Size() - 1; j >= 0; --j)
+        {
+            if (!added[chain[j]])
+            {
+                added[chain[j]] = true;
+                boneOrder_.Push(chain[j]);
+            }
+        }
+    }
+
+    UpdateFlatBoneTransforms();
+}
+
+void AnimatedModel::ResetFlatBones()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+
+    for (i32 i = 0; i < bones.Size(); ++i)
+    {
+        const Bone& bone = bones[i];
+        if (bone.animated_)
+        {
+            bonePose_.positions_[i] = bone.initialPosition_;
+            bonePose_.rotations_[i] = bone.initialRotation_;
+            bonePose_.scales_[i] = bone.initialScale_;
+        }
+    }
+}
+
+void AnimatedModel::UpdateFlatBoneTransforms()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    Matrix3x4 inverseNodeTransform;
+    bool hasInverseNodeTransform = false;
+
+    for (i32 i : boneOrder_)
+    {
+        const Bone& bone = bones[i];
+
+        // A bone which is not animated follows its node, for example a ragdoll body. Use the world transform, so that
+        // the node is no longer dirty and notifies again when it moves
+        if (!bone.animated_ && bone.node_)
+        {
+            if (!hasInverseNodeTransform)
+            {
+                inverseNodeTransform = node_->GetWorldTransform().Inverse();
+                hasInverseNodeTransform = true;
+            }
+
+            boneTransforms_[i] = inverseNodeTransform * bone.node_->GetWorldTransform();
+            continue;
+        }
+
+        Matrix3x4 transform(bonePose_.positions_[i], bonePose_.rotations_[i], bonePose_.scales_[i]);
+        i32 parentIndex = bone.parentIndex_;
+        if (parentIndex != i && parentIndex >= 0 && parentIndex < bones.Size())
+            boneTransforms_[i] = boneTransforms_[parentIndex] * transform;
+        else
+            boneTransforms_[i] = transform;
+    }
+
+    boneTransformsDirty_ = false;
+}
+
+void AnimatedModel::UpdateFlatBoneNodes()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+
+    for (i32 i = 0; i < bones.Size(); ++i)
+    {
+        const Bone& bone = bones[i];
+        if (!bone.animated_ || !bone.node_)
+            continue;
+
+        Vector3 position;
+        Quaternion rotation;
+        Vector3 scale;
+        boneTransforms_[i].Decompose(position, rotation, scale);
+        bone.node_->SetTransform(position, rotation, scale);
+    }
 }
 
 void AnimatedModel::UpdateSkinning()
@@ -1296,8 +1694,25 @@ void AnimatedModel::UpdateSkinning()
     // Use model's world transform in case a bone is missing
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
 
+    // Flat bone transforms are relative to the model's node
+    if (HasFlatBones())
+    {
+        if (boneTransformsDirty_)
+            UpdateFlatBoneTransforms();
+
+        for (i32 i = 0; i < bones.Size(); ++i)
+        {
+            skinMatrices_[i] = worldTransform * boneTransforms_[i] * bones[i].offsetMatrix_;
+
+            if (geometrySkinMatrices_.Size())
+            {
+                for (Matrix3x4* geometrySkinMatrix : geometrySkinMatrixPtrs_[i])
+                    *geometrySkinMatrix = skinMatrices_[i];
+            }
+        }
+    }
     // Skinning with global matrices only
-    if (!geometrySkinMatrices_.Size())
+    else if (!geometrySkinMatrices_.Size())
     {
         for (unsigned i = 0; i < bones.Size(); ++i)
         {
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "animation_pose_cache.h"
 #include "model.h"
 #include "skeleton.h"
 #include "static_model.h"
@@ -37,10 +38,15 @@ public:
     bool LoadJSON(const JSONValue& source) override;
     /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
     void ApplyAttributes() override;
-    /// Process octree raycast. May be called from a worker thread.
+    /// Process octree raycast. May be called from a worker thread. RAY_TRIANGLE tests the bone hitboxes if there are any,
+    /// otherwise the triangles of the bind pose. RAY_TRIANGLE_UV always tests the triangles of the bind pose.
     void ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQueryResult>& results) override;
+    /// Calculate the world transforms of the bone nodes in addition to the model's own.
+    void PrepareRayQuery() override;
     /// Update before octree reinsertion. Is called from a worker thread.
     void Update(const FrameInfo& frame) override;
+    /// Return whether Update() is expensive. True when the animation needs to be updated.
+    bool IsUpdateExpensive() const override { return animationDirty_ || animationOrderDirty_; }
     /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
     void UpdateBatches(const FrameInfo& frame) override;
     /// Prepare geometry for rendering. Called from a worker thread if possible (no GPU update).
@@ -70,6 +76,13 @@ public:
     void SetAnimationLodBias(float bias);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
+    /// Set animation pose cache to share evaluated poses with other models, or null to evaluate the animations of this
+    /// model alone (default).
+    void SetPoseCache(AnimationPoseCache* cache);
+    /// Set whether to keep the bones in flat arrays instead of scene nodes. Bone nodes are then created only on demand
+    /// by GetOrCreateBoneNode(). Changing the mode recreates the skeleton and removes the animation states, so set it
+    /// before the model. Only affects the master model.
+    void SetFlatSkeleton(bool enable);
     /// Set vertex morph weight by index.
     void SetMorphWeight(i32 index, float weight);
     /// Set vertex morph weight by name.
@@ -105,6 +118,20 @@ public:
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
 
+    /// Return animation pose cache.
+    AnimationPoseCache* GetPoseCache() const { return poseCache_; }
+
+    /// Return whether the bones are kept in flat arrays instead of scene nodes.
+    bool IsFlatSkeleton() const { return flatSkeleton_; }
+
+    /// Return bone transforms relative to the model's node in flat skeleton mode, in the skeleton's bone order.
+    const Vector<Matrix3x4>& GetBoneTransforms() const { return boneTransforms_; }
+
+    /// Return the scene node of a bone. In flat skeleton mode the node is created on demand as a child of the model's
+    /// node. The node follows the animated bone, so that other nodes can be attached to it. If the bone's animation is
+    /// disabled, the bone follows the node instead, for example a ragdoll body.
+    Node* GetOrCreateBoneNode(const String& name);
+
     /// Return all vertex morphs.
     const Vector<ModelMorph>& GetMorphs() const { return morphs_; }
 
@@ -163,7 +190,7 @@ private:
     void AssignBoneNodes();
     /// Finalize master model bone bounding boxes by merging from matching non-master bones.. Performed whenever any of the AnimatedModels in the same node changes its model.
     void FinalizeBoneBoundingBoxes();
-    /// Remove (old) skeleton root bone.
+    /// Remove (old) skeleton root bone, or the bone nodes created on demand in flat skeleton mode.
     void RemoveRootBone();
     /// Mark animation and skinning to require an update.
     void MarkAnimationDirty();
@@ -181,6 +208,22 @@ private:
     void CopyMorphVertices(void* destVertexData, void* srcVertexData, i32 vertexCount, VertexBuffer* destBuffer, VertexBuffer* srcBuffer);
     /// Recalculate animations. Called from Update().
     void UpdateAnimation(const FrameInfo& frame);
+    /// Sort animation states in ascending priority order if needed.
+    void SortAnimationStates();
+    /// Apply all animation states to nodes or copy the pose from the animation pose cache.
+    void ApplyCachedAnimation(i32 frameNumber);
+    /// Mark bones dirty after applying the animations and recalculate the bone bounding box.
+    void FinishAnimation();
+    /// Return whether the bones of this model are kept in flat arrays.
+    bool HasFlatBones() const { return !boneTransforms_.Empty(); }
+    /// Set up the flat bone arrays and the update order.
+    void InitFlatBones();
+    /// Reset the flat bone transforms of the animated bones to the initial pose.
+    void ResetFlatBones();
+    /// Recalculate the flat bone transforms relative to the model's node in one pass over the bones.
+    void UpdateFlatBoneTransforms();
+    /// Copy the flat bone transforms to the bone nodes created on demand.
+    void UpdateFlatBoneNodes();
     /// Recalculate skinning.
     void UpdateSkinning();
     /// Reapply all vertex morphs.
@@ -199,6 +242,16 @@ private:
     Vector<ModelMorph> morphs_;
     /// Animation states.
     Vector<SharedPtr<AnimationState>> animationStates_;
+    /// Animation pose cache.
+    SharedPtr<AnimationPoseCache> poseCache_;
+    /// Animation pose cache key.
+    Vector<u64> poseKey_;
+    /// Local bone transforms in flat skeleton mode.
+    AnimationPose bonePose_;
+    /// Bone transforms relative to the model's node in flat skeleton mode.
+    Vector<Matrix3x4> boneTransforms_;
+    /// Bone indices in flat skeleton mode, ordered so that parents come before children.
+    Vector<i32> boneOrder_;
     /// Skinning matrices.
     Vector<Matrix3x4> skinMatrices_;
     /// Mapping of subgeometry bone indices, used if more bones than skinning shader can manage.
@@ -233,6 +286,10 @@ private:
     bool skinningDirty_;
     /// Bone bounding box dirty flag.
     bool boneBoundingBoxDirty_;
+    /// Flat bone transforms dirty flag, set when a bone node created on demand moves.
+    bool boneTransformsDirty_;
+    /// Flat skeleton mode flag.
+    bool flatSkeleton_;
     /// Master model flag.
     bool isMaster_;
     /// Loading flag. During loading bone nodes are not created, as they will be serialized as child nodes.
@@ -14,6 +14,7 @@ namespace dviglo
 class AnimatedModel;
 class Animation;
 struct Bone;
+struct ScenePostUpdateEvent;
 
 /// Control data for an animation.
 struct DV_API AnimationControl
@@ -182,7 +183,7 @@ private:
     /// Find the internal index and animation state of an animation.
     void FindAnimation(const String& name, i32& index, AnimationState*& state) const;
     /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleScenePostUpdate(ScenePostUpdateEvent& event);
 
     /// Animation control structures.
     Vector<AnimationControl> animations_;
@@ -0,0 +1,96 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "animation_pose_cache.h"
+
+#include "../common/debug_new.h"
+
+namespace dviglo
+{
+
+static u64 HashPoseKey(const Vector<u64>& key)
+{
+    u64 hash = key.Size();
+    for (u64 word : key)
+    {
+        hash ^= word;
+        hash *= 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+AnimationPoseCache::AnimationPoseCache() :
+    numEntries_(0),
+    numSharedPoses_(0),
+    frameNumber_(NINDEX),
+    timeStep_(0.0f)
+{
+}
+
+AnimationPoseCache::~AnimationPoseCache() = default;
+
+void AnimationPoseCache::SetTimeStep(float step)
+{
+    std::scoped_lock lock(mutex_);
+    timeStep_ = Max(step, 0.0f);
+    entryIndices_.Clear();
+    numEntries_ = 0;
+}
+
+void AnimationPoseCache::Clear()
+{
+    std::scoped_lock lock(mutex_);
+    entries_.Clear();
+    entryIndices_.Clear();
+    numEntries_ = 0;
+    numSharedPoses_ = 0;
+    frameNumber_ = NINDEX;
+}
+
+const AnimationPose* AnimationPoseCache::FindPose(const Vector<u64>& key, i32 frameNumber)
+{
+    std::scoped_lock lock(mutex_);
+    SetFrame(frameNumber);
+
+    i32 index;
+    if (!entryIndices_.TryGetValue(HashPoseKey(key), index) || entries_[index]->key_ != key)
+        return nullptr;
+
+    ++numSharedPoses_;
+    return &entries_[index]->pose_;
+}
+
+void AnimationPoseCache::StorePose(const Vector<u64>& key, i32 frameNumber, const AnimationPose& pose)
+{
+    std::scoped_lock lock(mutex_);
+    SetFrame(frameNumber);
+
+    // Another model may have evaluated the same pose meanwhile. In case of a hash collision the pose is not shared
+    u64 hash = HashPoseKey(key);
+    if (entryIndices_.Find(hash) != entryIndices_.End())
+        return;
+
+    if (numEntries_ == entries_.Size())
+        entries_.Push(SharedPtr<Entry>(new Entry()));
+
+    Entry& entry = *entries_[numEntries_];
+    entry.key_ = key;
+    entry.pose_.positions_ = pose.positions_;
+    entry.pose_.rotations_ = pose.rotations_;
+    entry.pose_.scales_ = pose.scales_;
+    entryIndices_[hash] = numEntries_++;
+}
+
+void AnimationPoseCache::SetFrame(i32 frameNumber)
+{
+    if (frameNumber == frameNumber_)
+        return;
+
+    entryIndices_.Clear();
+    numEntries_ = 0;
+    numSharedPoses_ = 0;
+    frameNumber_ = frameNumber;
+}
+
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+/// \file
+
+#pragma once
+
+#include "../containers/flat_hash_map.h"
+#include "../containers/ptr.h"
+#include "../math/quaternion.h"
+
+#include <mutex>
+
+namespace dviglo
+{
+
+/// Local transforms of the bones of a skeleton.
+struct AnimationPose
+{
+    /// Bone positions.
+    Vector<Vector3> positions_;
+    /// Bone rotations.
+    Vector<Quaternion> rotations_;
+    /// Bone scales.
+    Vector<Vector3> scales_;
+};
+
+/// Animation poses shared by animated models, which have the same model and play the same animations with the same
+/// settings at the same quantized time. During a frame the first model which needs a pose evaluates it and the other
+/// models copy it, so that crowds scale with the number of distinct poses instead of the number of models.
+class DV_API AnimationPoseCache : public RefCounted
+{
+public:
+    /// Construct.
+    AnimationPoseCache();
+    /// Destruct.
+    ~AnimationPoseCache() override;
+
+    /// Set time quantization step in seconds. Animations are evaluated at time positions rounded down to a multiple of
+    /// it. Zero (default) shares only poses with exactly the same time positions.
+    void SetTimeStep(float step);
+    /// Remove all poses.
+    void Clear();
+
+    /// Return time quantization step.
+    float GetTimeStep() const { return timeStep_; }
+
+    /// Return time position at which animations are evaluated.
+    float QuantizeTime(float time) const { return timeStep_ > 0.0f ? floorf(time / timeStep_) * timeStep_ : time; }
+
+    /// Return number of poses evaluated on the last frame.
+    i32 GetNumPoses() const { return numEntries_; }
+
+    /// Return number of times a pose was copied instead of evaluated on the last frame.
+    i32 GetNumSharedPoses() const { return numSharedPoses_; }
+
+    /// Return pose with the same key evaluated on the frame, or null if not found. The pose remains valid until poses
+    /// of another frame are requested. Thread-safe.
+    const AnimationPose* FindPose(const Vector<u64>& key, i32 frameNumber);
+    /// Store pose evaluated on the frame. If a pose with the same key is already stored, it is kept. Thread-safe.
+    void StorePose(const Vector<u64>& key, i32 frameNumber, const AnimationPose& pose);
+
+private:
+    /// Pose with its key.
+    struct Entry : public RefCounted
+    {
+        /// Key.
+        Vector<u64> key_;
+        /// Pose.
+        AnimationPose pose_;
+    };
+
+    /// Remove the poses of the previous frame if the frame has changed. Called with the mutex locked.
+    void SetFrame(i32 frameNumber);
+
+    /// Poses, reused between frames. Entries are not moved in memory while they are in use.
+    Vector<SharedPtr<Entry>> entries_;
+    /// Entry indices by key hash.
+    FlatHashMap<u64, i32> entryIndices_;
+    /// Number of entries in use.
+    i32 numEntries_;
+    /// Number of copied poses.
+    i32 numSharedPoses_;
+    /// Frame number of the poses.
+    i32 frameNumber_;
+    /// Time quantization step.
+    float timeStep_;
+    /// Mutex for access from worker threads.
+    std::mutex mutex_;
+};
+
+}
@@ -23,6 +23,22 @@ AnimationStateTrack::AnimationStateTrack() :
 
 AnimationStateTrack::~AnimationStateTrack() = default;
 
+// Check if a bone is an ancestor of another bone by following the parent indices
+static bool IsBoneAncestor(const Vector<Bone>& bones, i32 ancestorIndex, i32 index)
+{
+    for (i32 i = 0; i < bones.Size() && index >= 0 && index < bones.Size(); ++i)
+    {
+        i32 parentIndex = bones[index].parentIndex_;
+        if (parentIndex == index)
+            return false;
+        if (parentIndex == ancestorIndex)
+            return true;
+        index = parentIndex;
+    }
+
+    return false;
+}
+
 AnimationState::AnimationState(AnimatedModel* model, Animation* animation) :
     model_(model),
     animation_(animation),
@@ -105,7 +121,11 @@ void AnimationState::SetStartBone(Bone* startBone)
     const HashMap<StringHash, AnimationTrack>& tracks = animation_->GetTracks();
     stateTracks_.Clear();
 
-    if (!startBone->node_)
+    // In flat skeleton mode the tracks are applied to the model's bone arrays instead of the bone nodes
+    const bool flatBones = model_->HasFlatBones();
+    const Vector<Bone>& bones = skeleton.GetBones();
+
+    if (!startBone->node_ && !flatBones)
         return;
 
     for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks.Begin(); i != tracks.End(); ++i)
@@ -119,6 +139,12 @@ void AnimationState::SetStartBone(Bone* startBone)
 
         if (nameHash == startBone->nameHash_)
             trackBone = startBone;
+        else if (flatBones)
+        {
+            Bone* bone = skeleton.GetBone(nameHash);
+            if (bone && IsBoneAncestor(bones, (i32)(startBone - bones.Buffer()), (i32)(bone - bones.Buffer())))
+                trackBone = bone;
+        }
         else
         {
             Node* trackBoneNode = startBone->node_->GetChild(nameHash, true);
@@ -126,7 +152,12 @@ void AnimationState::SetStartBone(Bone* startBone)
                 trackBone = skeleton.GetBone(nameHash);
         }
 
-        if (trackBone && trackBone->node_)
+        if (trackBone && flatBones)
+        {
+            stateTrack.bone_ = trackBone;
+            stateTracks_.Push(stateTrack);
+        }
+        else if (trackBone && trackBone->node_)
         {
             stateTrack.bone_ = trackBone;
             stateTrack.node_ = trackBone->node_;
@@ -201,7 +232,19 @@ void AnimationState::SetBoneWeight(i32 index, float weight, bool recursive)
     if (recursive)
     {
         Node* boneNode = stateTracks_[index].node_;
-        if (boneNode)
+        if (!boneNode && stateTracks_[index].bone_)
+        {
+            // Flat skeleton mode, find the child bones by the parent indices
+            const Bone* bones = model_->GetSkeleton().GetBones().Buffer();
+            const i32 boneIndex = (i32)(stateTracks_[index].bone_ - bones);
+            for (i32 i = 0; i < stateTracks_.Size(); ++i)
+            {
+                const Bone* bone = stateTracks_[i].bone_;
+                if (i != index && bone->parentIndex_ == boneIndex)
+                    SetBoneWeight(i, weight, true);
+            }
+        }
+        else if (boneNode)
         {
             const Vector<SharedPtr<Node>>& children = boneNode->GetChildren();
             for (i32 i = 0; i < children.Size(); ++i)
@@ -389,7 +432,8 @@ i32 AnimationState::GetTrackIndex(const String& name) const
     for (i32 i = 0; i < stateTracks_.Size(); ++i)
     {
         Node* node = stateTracks_[i].node_;
-        if (node && node->GetName() == name)
+        const Bone* bone = stateTracks_[i].bone_;
+        if (node ? node->GetName() == name : bone && bone->name_ == name)
             return i;
     }
 
@@ -412,7 +456,8 @@ i32 AnimationState::GetTrackIndex(StringHash nameHash) const
     for (i32 i = 0; i < stateTracks_.Size(); ++i)
     {
         Node* node = stateTracks_[i].node_;
-        if (node && node->GetNameHash() == nameHash)
+        const Bone* bone = stateTracks_[i].bone_;
+        if (node ? node->GetNameHash() == nameHash : bone && bone->nameHash_ == nameHash)
             return i;
     }
 
@@ -425,17 +470,41 @@ float AnimationState::GetLength() const
 }
 
 void AnimationState::Apply()
+{
+    Apply(time_);
+}
+
+void AnimationState::Apply(float time)
 {
     if (!animation_ || !IsEnabled())
         return;
 
     if (model_)
-        ApplyToModel();
+        ApplyToModel(time);
     else
-        ApplyToNodes();
+        ApplyToNodes(time);
+}
+
+void AnimationState::AddPoseKey(Vector<u64>& key, float time) const
+{
+    AnimatedModel* model = model_;
+    const Bone* bones = model ? model->GetSkeleton().GetBones().Buffer() : nullptr;
+
+    key.Push((u64)(uintptr_t)animation_.Get());
+    key.Push((u64)FloatToRawIntBits(time) << 32 | FloatToRawIntBits(weight_));
+    key.Push((u64)(startBone_ && bones ? startBone_ - bones : NINDEX) << 32 | (u64)blendingMode_ << 1 | (looped_ ? 1 : 0));
+
+    // Per-track weights, two in each word
+    for (i32 i = 0; i < stateTracks_.Size(); i += 2)
+    {
+        u64 weights = FloatToRawIntBits(stateTracks_[i].weight_);
+        if (i + 1 < stateTracks_.Size())
+            weights |= (u64)FloatToRawIntBits(stateTracks_[i + 1].weight_) << 32;
+        key.Push(weights);
+    }
 }
 
-void AnimationState::ApplyToModel()
+void AnimationState::ApplyToModel(float time)
 {
     for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
     {
@@ -446,27 +515,70 @@ void AnimationState::ApplyToModel()
         if (Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_)
             continue;
 
-        ApplyTrack(stateTrack, finalWeight, true);
+        ApplyTrack(stateTrack, finalWeight, true, time);
     }
 }
 
-void AnimationState::ApplyToNodes()
+void AnimationState::ApplyToNodes(float time)
 {
     // When applying to a node hierarchy, can only use full weight (nothing to blend to)
     for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
-        ApplyTrack(*i, 1.0f, false);
+        ApplyTrack(*i, 1.0f, false, time);
 }
 
-void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent)
+void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent, float time)
 {
     const AnimationTrack* track = stateTrack.track_;
     Node* node = stateTrack.node_;
 
-    if (track->keyFrames_.Empty() || !node)
+    if (track->keyFrames_.Empty())
         return;
 
+    // Flat skeleton mode
+    if (!node)
+    {
+        if (stateTrack.bone_ && model_ && model_->HasFlatBones())
+        {
+            i32 index = (i32)(stateTrack.bone_ - model_->GetSkeleton().GetBones().Buffer());
+            AnimationPose& pose = model_->bonePose_;
+            BlendTrack(stateTrack, weight, time, pose.positions_[index], pose.rotations_[index], pose.scales_[index]);
+        }
+        return;
+    }
+
+    const AnimationChannels channelMask = track->channelMask_;
+    Vector3 newPosition = node->GetPosition();
+    Quaternion newRotation = node->GetRotation();
+    Vector3 newScale = node->GetScale();
+    BlendTrack(stateTrack, weight, time, newPosition, newRotation, newScale);
+
+    if (silent)
+    {
+        if (!!(channelMask & AnimationChannels::Position))
+            node->SetPositionSilent(newPosition);
+        if (!!(channelMask & AnimationChannels::Rotation))
+            node->SetRotationSilent(newRotation);
+        if (!!(channelMask & AnimationChannels::Scale))
+            node->SetScaleSilent(newScale);
+    }
+    else
+    {
+        if (!!(channelMask & AnimationChannels::Position))
+            node->SetPosition(newPosition);
+        if (!!(channelMask & AnimationChannels::Rotation))
+            node->SetRotation(newRotation);
+        if (!!(channelMask & AnimationChannels::Scale))
+            node->SetScale(newScale);
+    }
+}
+
+void AnimationState::BlendTrack(AnimationStateTrack& stateTrack, float weight, float time, Vector3& position,
+    Quaternion& rotation, Vector3& scale)
+{
+    const AnimationTrack* track = stateTrack.track_;
+
     i32& frame = stateTrack.keyFrame_;
-    track->GetKeyFrameIndex(time_, frame);
+    track->GetKeyFrameIndex(time, frame);
 
     // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
     i32 nextFrame = frame + 1;
@@ -495,7 +607,7 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
         if (timeInterval < 0.0f)
             timeInterval += animation_->GetLength();
-        float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
+        float t = timeInterval > 0.0f ? (time - keyFrame->time_) / timeInterval : 1.0f;
 
         if (!!(channelMask & AnimationChannels::Position))
             newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
@@ -519,19 +631,19 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         if (!!(channelMask & AnimationChannels::Position))
         {
             Vector3 delta = newPosition - stateTrack.bone_->initialPosition_;
-            newPosition = node->GetPosition() + delta * weight;
+            newPosition = position + delta * weight;
         }
         if (!!(channelMask & AnimationChannels::Rotation))
         {
             Quaternion delta = newRotation * stateTrack.bone_->initialRotation_.Inverse();
-            newRotation = (delta * node->GetRotation()).Normalized();
+            newRotation = (delta * rotation).Normalized();
             if (!Equals(weight, 1.0f))
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                newRotation = rotation.Slerp(newRotation, weight);
         }
         if (!!(channelMask & AnimationChannels::Scale))
         {
             Vector3 delta = newScale - stateTrack.bone_->initialScale_;
-            newScale = node->GetScale() + delta * weight;
+            newScale = scale + delta * weight;
         }
     }
     else
@@ -539,32 +651,20 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         if (!Equals(weight, 1.0f)) // not full weight
         {
             if (!!(channelMask & AnimationChannels::Position))
-                newPosition = node->GetPosition().Lerp(newPosition, weight);
+                newPosition = position.Lerp(newPosition, weight);
             if (!!(channelMask & AnimationChannels::Rotation))
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                newRotation = rotation.Slerp(newRotation, weight);
             if (!!(channelMask & AnimationChannels::Scale))
-                newScale = node->GetScale().Lerp(newScale, weight);
+                newScale = scale.Lerp(newScale, weight);
         }
     }
 
-    if (silent)
-    {
-        if (!!(channelMask & AnimationChannels::Position))
-            node->SetPositionSilent(newPosition);
-        if (!!(channelMask & AnimationChannels::Rotation))
-            node->SetRotationSilent(newRotation);
-        if (!!(channelMask & AnimationChannels::Scale))
-            node->SetScaleSilent(newScale);
-    }
-    else
-    {
-        if (!!(channelMask & AnimationChannels::Position))
-            node->SetPosition(newPosition);
-        if (!!(channelMask & AnimationChannels::Rotation))
-            node->SetRotation(newRotation);
-        if (!!(channelMask & AnimationChannels::Scale))
-            node->SetScale(newScale);
-    }
+    if (!!(channelMask & AnimationChannels::Position))
+        position = newPosition;
+    if (!!(channelMask & AnimationChannels::Rotation))
+        rotation = newRotation;
+    if (!!(channelMask & AnimationChannels::Scale))
+        scale = newScale;
 }
 
 }
@@ -16,9 +16,11 @@ class Animation;
 class AnimatedModel;
 class Deserializer;
 class Node;
+class Quaternion;
 class Serializer;
 class Skeleton;
 class StringHash;
+class Vector3;
 struct AnimationTrack;
 struct Bone;
 
@@ -130,14 +132,22 @@ public:
 
     /// Apply the animation at the current time position.
     void Apply();
+    /// Apply the animation at a time position. Does not change the current time position or fire animation triggers.
+    void Apply(float time);
+    /// Append the settings which affect the applied bone transforms to an animation pose cache key. The time position
+    /// is given by the caller, which may have quantized it.
+    void AddPoseKey(Vector<u64>& key, float time) const;
 
 private:
     /// Apply animation to a skeleton. Transform changes are applied silently, so the model needs to dirty its root model afterward.
-    void ApplyToModel();
+    void ApplyToModel(float time);
     /// Apply animation to a scene node hierarchy.
-    void ApplyToNodes();
+    void ApplyToNodes(float time);
     /// Apply track.
-    void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent);
+    void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent, float time);
+    /// Sample track and blend it to a bone transform. Only the channels of the track are changed.
+    void BlendTrack(AnimationStateTrack& stateTrack, float weight, float time, Vector3& position, Quaternion& rotation,
+        Vector3& scale);
 
     /// Animated model (model mode).
     WeakPtr<AnimatedModel> model_;
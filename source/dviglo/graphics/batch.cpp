@@ -16,6 +16,8 @@
 #include "../graphics_api/vertex_buffer.h"
 #include "../scene/scene.h"
 
+#include <cstring>
+
 #include "../common/debug_new.h"
 
 namespace dviglo
@@ -31,34 +33,118 @@ inline bool CompareBatchesState(Batch* lhs, Batch* rhs)
         return lhs->distance_ < rhs->distance_;
 }
 
-inline bool CompareBatchesFrontToBack(Batch* lhs, Batch* rhs)
+inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ < rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    return lhs.distance_ < rhs.distance_;
 }
 
-inline bool CompareBatchesBackToFront(Batch* lhs, Batch* rhs)
+// Render order in the order of unsigned integers
+inline u64 RenderOrderKey(i8 renderOrder)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ > rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    return (u8)renderOrder ^ 0x80u;
 }
 
-inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
+// Distance in the order of unsigned integers
+inline u64 DistanceKey(float distance)
 {
-    return lhs.distance_ < rhs.distance_;
+    u32 bits;
+    memcpy(&bits, &distance, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
 }
 
-inline bool CompareBatchGroupOrder(BatchGroup* lhs, BatchGroup* rhs)
+// Number of bits needed for the values [0, count)
+static i32 NumBits(i32 count)
 {
-    return lhs->renderOrder_ < rhs->renderOrder_;
+    i32 bits = 0;
+    while (bits < 31 && (1 << bits) < count)
+        ++bits;
+    return bits;
+}
+
+// Stable LSD radix sort by the keys, one byte at a time. Bytes which are the same in all the keys are skipped
+static void RadixSort(Vector<BatchSortItem>& items, Vector<BatchSortItem>& temp)
+{
+    i32 count = items.Size();
+    if (count < 2)
+        return;
+
+    i32 histograms[8][256]{};
+    for (const BatchSortItem& item : items)
+    {
+        for (i32 i = 0; i < 8; ++i)
+            ++histograms[i][(item.key_ >> (i * 8)) & 0xffu];
+    }
+
+    temp.Resize(count);
+    BatchSortItem* src = items.Buffer();
+    BatchSortItem* dest = temp.Buffer();
+
+    for (i32 i = 0; i < 8; ++i)
+    {
+        i32 shift = i * 8;
+        i32* offsets = histograms[i];
+        if (offsets[(src[0].key_ >> shift) & 0xffu] == count)
+            continue;
+
+        i32 sum = 0;
+        for (i32 j = 0; j < 256; ++j)
+        {
+            i32 bucketSize = offsets[j];
+            offsets[j] = sum;
+            sum += bucketSize;
+        }
+
+        for (i32 j = 0; j < count; ++j)
+            dest[offsets[(src[j].key_ >> shift) & 0xffu]++] = src[j];
+
+        std::swap(src, dest);
+    }
+
+    if (src != items.Buffer())
+        items.Swap(temp);
+}
+
+// Replace the IDs in the sort keys of the batches with dense IDs, which are assigned in the order in which the IDs
+// first appear. Return the number of distinct IDs
+static i32 AssignDenseIds(const Vector<Batch*>& batches, i32 shift, u64 mask, i32* ids, i32 stride,
+    Vector<BatchSortItem>& items, Vector<BatchSortItem>& temp, Vector<i32>& groupIds)
+{
+    i32 count = batches.Size();
+    items.Resize(count);
+    for (i32 i = 0; i < count; ++i)
+        items[i] = BatchSortItem{(batches[i]->sortKey_ >> shift) & mask, i};
+
+    // The same IDs become adjacent and stay in the order of the batches, so the first one of each run is the first
+    // appearance
+    RadixSort(items, temp);
+
+    for (i32 i = 0; i < count; ++i)
+        ids[i * stride] = NINDEX;
+
+    i32 numGroups = 0;
+    for (i32 i = 0; i < count; ++i)
+    {
+        if (i == 0 || items[i].key_ != items[i - 1].key_)
+            ids[items[i].index_ * stride] = numGroups++;
+    }
+
+    groupIds.Resize(numGroups);
+    i32 nextId = 0;
+    for (i32 i = 0; i < count; ++i)
+    {
+        if (ids[i * stride] != NINDEX)
+            groupIds[ids[i * stride]] = nextId++;
+    }
+
+    i32 group = NINDEX;
+    for (i32 i = 0; i < count; ++i)
+    {
+        if (i == 0 || items[i].key_ != items[i - 1].key_)
+            ++group;
+        ids[items[i].index_ * stride] = groupIds[group];
+    }
+
+    return numGroups;
 }
 
 void CalculateShadowMatrix(Matrix4& dest, LightBatchQueue* queue, i32 split, Renderer* renderer)
@@ -719,20 +805,33 @@ void BatchQueue::Clear(int maxSortedInstances)
 
 void BatchQueue::SortBackToFront()
 {
-    sortedBatches_.Resize(batches_.Size());
-
+    // Stable radix sort by render order and descending distance
+    sortItems_.Resize(batches_.Size());
     for (i32 i = 0; i < batches_.Size(); ++i)
-        sortedBatches_[i] = &batches_[i];
+        sortItems_[i] = BatchSortItem{RenderOrderKey(batches_[i].renderOrder_) << 32u | (~DistanceKey(batches_[i].distance_) & 0xffffffffu), i};
 
-    std::sort(sortedBatches_.Begin(), sortedBatches_.End(), CompareBatchesBackToFront);
+    RadixSort(sortItems_, sortTemp_);
 
-    sortedBatchGroups_.Resize(batchGroups_.Size());
+    sortedBatches_.Resize(batches_.Size());
+    for (i32 i = 0; i < sortItems_.Size(); ++i)
+        sortedBatches_[i] = &batches_[sortItems_[i].index_];
 
-    unsigned index = 0;
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
-        sortedBatchGroups_[index++] = &i->second_;
+    sortBatches_.Resize(batchGroups_.Size());
+    sortItems_.Resize(batchGroups_.Size());
+
+    i32 index = 0;
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    {
+        sortBatches_[index] = &i->second_;
+        sortItems_[index] = BatchSortItem{RenderOrderKey(i->second_.renderOrder_), index};
+        ++index;
+    }
+
+    RadixSort(sortItems_, sortTemp_);
 
-    std::sort(sortedBatchGroups_.Begin(), sortedBatchGroups_.End(), CompareBatchGroupOrder);
+    sortedBatchGroups_.Resize(batchGroups_.Size());
+    for (i32 i = 0; i < sortItems_.Size(); ++i)
+        sortedBatchGroups_[i] = static_cast<BatchGroup*>(sortBatches_[sortItems_[i].index_]);
 }
 
 void BatchQueue::SortFrontToBack()
@@ -745,7 +844,7 @@ void BatchQueue::SortFrontToBack()
     SortFrontToBack2Pass(sortedBatches_);
 
     // Sort each group front to back
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
     {
         if (i->second_.instances_.Size() <= maxSortedInstances_)
         {
@@ -756,7 +855,7 @@ void BatchQueue::SortFrontToBack()
         else
         {
             float minDistance = M_INFINITY;
-            for (Vector<InstanceData>::ConstIterator j = i->second_.instances_.Begin(); j != i->second_.instances_.End(); ++j)
+            for (ArenaVector<InstanceData>::ConstIterator j = i->second_.instances_.Begin(); j != i->second_.instances_.End(); ++j)
                 minDistance = Min(minDistance, j->distance_);
             i->second_.distance_ = minDistance;
         }
@@ -765,7 +864,7 @@ void BatchQueue::SortFrontToBack()
     sortedBatchGroups_.Resize(batchGroups_.Size());
 
     unsigned index = 0;
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
         sortedBatchGroups_[index++] = &i->second_;
 
     SortFrontToBack2Pass(reinterpret_cast<Vector<Batch*>& >(sortedBatchGroups_));
@@ -778,63 +877,82 @@ void BatchQueue::SortFrontToBack2Pass(Vector<Batch*>& batches)
 #ifdef MOBILE_GRAPHICS
     std::sort(batches.Begin(), batches.End(), CompareBatchesState);
 #else
-    // For desktop, first sort by distance and remap shader/material/geometry IDs in the sort key
-    std::sort(batches.Begin(), batches.End(), CompareBatchesFrontToBack);
-
-    hash32 freeShaderID = 0;
-    hash16 freeMaterialID = 0;
-    hash16 freeGeometryID = 0;
-
-    for (Vector<Batch*>::Iterator i = batches.Begin(); i != batches.End(); ++i)
+    // For desktop, first sort by distance. Radix sort is stable, so the batches at the same distance keep their order
+    i32 count = batches.Size();
+    sortItems_.Resize(count);
+    for (i32 i = 0; i < count; ++i)
+        sortItems_[i] = BatchSortItem{RenderOrderKey(batches[i]->renderOrder_) << 32u | DistanceKey(batches[i]->distance_), i};
+
+    RadixSort(sortItems_, sortTemp_);
+
+    sortBatches_.Resize(count);
+    for (i32 i = 0; i < count; ++i)
+        sortBatches_[i] = batches[sortItems_[i].index_];
+
+    // Replace shader/material/geometry IDs of the sort key with dense IDs in the order of distance. The shader ID
+    // includes the light queue and the non-base flag
+    sortIds_.Resize(count * 3);
+    i32* ids = sortIds_.Buffer();
+    i32 numShaders = AssignDenseIds(sortBatches_, 32, 0xffffffffu, ids, 3, sortTemp_, sortItems_, sortGroupIds_);
+    i32 numMaterials = AssignDenseIds(sortBatches_, 16, 0xffffu, ids + 1, 3, sortTemp_, sortItems_, sortGroupIds_);
+    i32 numGeometries = AssignDenseIds(sortBatches_, 0, 0xffffu, ids + 2, 3, sortTemp_, sortItems_, sortGroupIds_);
+
+    i32 shaderBits = NumBits(numShaders);
+    i32 materialBits = NumBits(numMaterials);
+    i32 geometryBits = NumBits(numGeometries);
+
+    // Finally sort again by render order, non-base flag and the dense IDs. The batches with the same state stay in the
+    // order of distance
+    if (shaderBits + materialBits + geometryBits <= 55)
     {
-        Batch* batch = *i;
-
-        hash32 shaderID = (hash32)(batch->sortKey_ >> 32u);
-        HashMap<hash32, hash32>::ConstIterator j = shaderRemapping_.Find(shaderID);
-        if (j != shaderRemapping_.End())
-            shaderID = j->second_;
-        else
+        sortItems_.Resize(count);
+        for (i32 i = 0; i < count; ++i)
         {
-            shaderID = shaderRemapping_[shaderID] = freeShaderID | (shaderID & 0x80000000);
-            ++freeShaderID;
+            const i32* batchIds = ids + i * 3;
+            sortItems_[i] = BatchSortItem{RenderOrderKey(sortBatches_[i]->renderOrder_) << 56u |
+                (sortBatches_[i]->sortKey_ >> 63u) << 55u | (u64)batchIds[0] << (materialBits + geometryBits) |
+                (u64)batchIds[1] << geometryBits | (u64)batchIds[2], i};
         }
 
-        hash16 materialID = (hash16)((batch->sortKey_ & 0xffff0000) >> 16u);
-        HashMap<hash16, hash16>::ConstIterator k = materialRemapping_.Find(materialID);
-        if (k != materialRemapping_.End())
-            materialID = k->second_;
-        else
-        {
-            materialID = materialRemapping_[materialID] = freeMaterialID;
-            ++freeMaterialID;
-        }
+        RadixSort(sortItems_, sortTemp_);
+    }
+    else
+    {
+        // Too many distinct IDs for one key
+        sortItems_.Resize(count);
+        for (i32 i = 0; i < count; ++i)
+            sortItems_[i] = BatchSortItem{0, i};
 
-        hash16 geometryID = (hash16)(batch->sortKey_ & 0xffffu);
-        HashMap<hash16, hash16>::ConstIterator l = geometryRemapping_.Find(geometryID);
-        if (l != geometryRemapping_.End())
-            geometryID = l->second_;
-        else
+        std::stable_sort(sortItems_.Begin(), sortItems_.End(), [this, ids](const BatchSortItem& lhs, const BatchSortItem& rhs)
         {
-            geometryID = geometryRemapping_[geometryID] = freeGeometryID;
-            ++freeGeometryID;
-        }
+            const Batch* lhsBatch = sortBatches_[lhs.index_];
+            const Batch* rhsBatch = sortBatches_[rhs.index_];
+            if (lhsBatch->renderOrder_ != rhsBatch->renderOrder_)
+                return lhsBatch->renderOrder_ < rhsBatch->renderOrder_;
+            if ((lhsBatch->sortKey_ >> 63u) != (rhsBatch->sortKey_ >> 63u))
+                return (lhsBatch->sortKey_ >> 63u) < (rhsBatch->sortKey_ >> 63u);
+
+            const i32* lhsIds = ids + lhs.index_ * 3;
+            const i32* rhsIds = ids + rhs.index_ * 3;
+            for (i32 i = 0; i < 3; ++i)
+            {
+                if (lhsIds[i] != rhsIds[i])
+                    return lhsIds[i] < rhsIds[i];
+            }
 
-        batch->sortKey_ = (((hash64)shaderID) << 32u) | (((hash64)materialID) << 16u) | geometryID;
+            return false;
+        });
     }
 
-    shaderRemapping_.Clear();
-    materialRemapping_.Clear();
-    geometryRemapping_.Clear();
-
-    // Finally sort again with the rewritten ID's
-    std::sort(batches.Begin(), batches.End(), CompareBatchesState);
+    for (i32 i = 0; i < count; ++i)
+        batches[i] = sortBatches_[sortItems_[i].index_];
 #endif
 }
 
 void BatchQueue::SetInstancingData(void* lockedData, i32 stride, i32& freeIndex)
 {
     assert(stride >= 0);
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
         i->second_.SetInstancingData(lockedData, stride, freeIndex);
 }
 
@@ -885,7 +1003,7 @@ i32 BatchQueue::GetNumInstances() const
 {
     i32 total = 0;
 
-    for (HashMap<BatchGroupKey, BatchGroup>::ConstIterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::ConstIterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
     {
         if (i->second_.geometryType_ == GEOM_INSTANCED)
             total += i->second_.instances_.Size();
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "../containers/arena_vector.h"
+#include "../containers/flat_hash_map.h"
 #include "../containers/ptr.h"
 #include "drawable.h"
 #include "material.h"
@@ -121,9 +123,10 @@ struct BatchGroup : public Batch
     {
     }
 
-    /// Construct from a batch.
-    explicit BatchGroup(const Batch& batch) :
+    /// Construct from a batch. Instance data is allocated from the allocator.
+    BatchGroup(const Batch& batch, ArenaAllocator* allocator) :
         Batch(batch),
+        instances_(allocator),
         startIndex_(NINDEX)
     {
     }
@@ -150,8 +153,8 @@ struct BatchGroup : public Batch
     /// Prepare and draw.
     void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
 
-    /// Instance data.
-    Vector<InstanceData> instances_;
+    /// Instance data. Valid until the end of the frame.
+    ArenaVector<InstanceData> instances_;
     /// Instance stream start index, or NINDEX if transforms not pre-set.
     i32 startIndex_;
 };
@@ -204,6 +207,15 @@ struct BatchGroupKey
     hash32 ToHash() const;
 };
 
+/// Radix sort key and index of a batch.
+struct BatchSortItem
+{
+    /// Sort key.
+    u64 key_;
+    /// Index of the batch.
+    i32 index_;
+};
+
 /// Queue that contains both instanced and non-instanced draw calls.
 struct BatchQueue
 {
@@ -227,13 +239,17 @@ public:
     bool IsEmpty() const { return batches_.Empty() && batchGroups_.Empty(); }
 
     /// Instanced draw calls.
-    HashMap<BatchGroupKey, BatchGroup> batchGroups_;
-    /// Shader remapping table for 2-pass state and distance sort.
-    HashMap<hash32, hash32> shaderRemapping_;
-    /// Material remapping table for 2-pass state and distance sort.
-    HashMap<hash16, hash16> materialRemapping_;
-    /// Geometry remapping table for 2-pass state and distance sort.
-    HashMap<hash16, hash16> geometryRemapping_;
+    FlatHashMap<BatchGroupKey, BatchGroup> batchGroups_;
+    /// Sort keys of the batches being sorted.
+    Vector<BatchSortItem> sortItems_;
+    /// Temporary buffer for radix sort.
+    Vector<BatchSortItem> sortTemp_;
+    /// Batches in distance order for 2-pass state and distance sort.
+    Vector<Batch*> sortBatches_;
+    /// Dense shader, material and geometry IDs of the batches for 2-pass state and distance sort.
+    Vector<i32> sortIds_;
+    /// Dense IDs of the distinct shaders, materials or geometries while assigning them.
+    Vector<i32> sortGroupIds_;
 
     /// Unsorted non-instanced draw calls.
     Vector<Batch> batches_;
@@ -4,9 +4,11 @@
 
 #include "../core/context.h"
 #include "../core/profiler.h"
+#include "../core/work_queue.h"
 #include "batch.h"
 #include "billboard_set.h"
 #include "camera.h"
+#include "distance_sort.h"
 #include "geometry.h"
 #include "graphics.h"
 #include "octree_query.h"
@@ -25,6 +27,7 @@ namespace dviglo
 extern const char* GEOMETRY_CATEGORY;
 
 static const float INV_SQRT_TWO = 1.0f / sqrtf(2.0f);
+static const i32 BILLBOARD_UPDATE_GRAIN = 1024;
 
 const char* faceCameraModeNames[] =
 {
@@ -50,9 +53,15 @@ static const StringVector billboardsStructureElementNames =
     "   Is Enabled"
 };
 
-inline bool CompareBillboards(Billboard* lhs, Billboard* rhs)
+// Process range [0, count) in worker threads if available. The main thread takes part and waits for the result
+template <typename Func>
+static void ParallelForBillboards(i32 count, Func func)
 {
-    return lhs->sortDistance_ > rhs->sortDistance_;
+    auto* queue = DV_CONTEXT.GetSubsystem<WorkQueue>();
+    if (queue)
+        queue->ParallelFor(0, count, BILLBOARD_UPDATE_GRAIN, [&func](i32 begin, i32 end, i32 /*threadIndex*/) { func(begin, end); });
+    else
+        func(0, count);
 }
 
 BillboardSet::BillboardSet() :
@@ -600,15 +609,11 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
     sortedBillboards_.Resize(enabledBillboards);
     i32 index = 0;
 
-    // Then set initial sort order and distances
+    // Then set initial sort order
     for (Billboard& billboard : billboards_)
     {
         if (billboard.enabled_)
-        {
             sortedBillboards_[index++] = &billboard;
-            if (sorted_)
-                billboard.sortDistance_ = frame.camera_->GetDistanceSquared(billboardTransform * billboard.position_);
-        }
     }
 
     batches_[0].geometry_->SetDrawRange(TRIANGLE_LIST, 0, enabledBillboards * 6, false);
@@ -620,137 +625,168 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
 
     if (sorted_)
     {
-        std::sort(sortedBillboards_.Begin(), sortedBillboards_.End(), CompareBillboards);
+        DV_PROFILE(SortBillboards);
+
+        // Distances in worker threads, then a radix sort from the farthest to the nearest
+        Billboard* billboards = billboards_.Buffer();
+        sortKeys_.Resize(enabledBillboards);
+
+        // Update the view matrix of the camera now, worker threads only read it
+        frame.camera_->GetView();
+
+        ParallelForBillboards(enabledBillboards, [&](i32 begin, i32 end)
+        {
+            for (i32 i = begin; i < end; ++i)
+            {
+                Billboard& billboard = *sortedBillboards_[i];
+                billboard.sortDistance_ = frame.camera_->GetDistanceSquared(billboardTransform * billboard.position_);
+                sortKeys_[i] = BackToFrontSortKey(billboard.sortDistance_, (i32)(&billboard - billboards));
+            }
+        });
+
+        SortBackToFront(sortKeys_, sortTemp_);
+        for (i32 i = 0; i < enabledBillboards; ++i)
+            sortedBillboards_[i] = billboards + (u32)sortKeys_[i];
+
         Vector3 worldPos = node_->GetWorldPosition();
         // Store the "last sorted position" now
         previousOffset_ = (worldPos - frame.camera_->GetNode()->GetWorldPosition());
     }
 
-    auto* dest = (float*)vertexBuffer_->Lock(0, enabledBillboards * 4, true);
-    if (!dest)
+    auto* vertices = (float*)vertexBuffer_->Lock(0, enabledBillboards * 4, true);
+    if (!vertices)
         return;
 
+    // Vertices of the billboards in worker threads. Each billboard has its own place in the locked buffer
     if (faceCameraMode_ != FC_DIRECTION)
     {
-        for (i32 i = 0; i < enabledBillboards; ++i)
+        ParallelForBillboards(enabledBillboards, [&](i32 begin, i32 end)
         {
-            Billboard& billboard = *sortedBillboards_[i];
-
-            Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
-            color32 color = billboard.color_.ToU32();
-            if (fixedScreenSize_)
-                size *= billboard.screenScaleFactor_;
-
-            float rotationMatrix[2][2];
-            SinCos(billboard.rotation_, rotationMatrix[0][1], rotationMatrix[0][0]);
-            rotationMatrix[1][0] = -rotationMatrix[0][1];
-            rotationMatrix[1][1] = rotationMatrix[0][0];
-
-            dest[0] = billboard.position_.x_;
-            dest[1] = billboard.position_.y_;
-            dest[2] = billboard.position_.z_;
-            ((color32&)dest[3]) = color;
-            dest[4] = billboard.uv_.min_.x_;
-            dest[5] = billboard.uv_.min_.y_;
-            dest[6] = -size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
-            dest[7] = -size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
-
-            dest[8] = billboard.position_.x_;
-            dest[9] = billboard.position_.y_;
-            dest[10] = billboard.position_.z_;
-            ((color32&)dest[11]) = color;
-            dest[12] = billboard.uv_.max_.x_;
-            dest[13] = billboard.uv_.min_.y_;
-            dest[14] = size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
-            dest[15] = size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
-
-            dest[16] = billboard.position_.x_;
-            dest[17] = billboard.position_.y_;
-            dest[18] = billboard.position_.z_;
-            ((color32&)dest[19]) = color;
-            dest[20] = billboard.uv_.max_.x_;
-            dest[21] = billboard.uv_.max_.y_;
-            dest[22] = size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
-            dest[23] = size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
-
-            dest[24] = billboard.position_.x_;
-            dest[25] = billboard.position_.y_;
-            dest[26] = billboard.position_.z_;
-            ((color32&)dest[27]) = color;
-            dest[28] = billboard.uv_.min_.x_;
-            dest[29] = billboard.uv_.max_.y_;
-            dest[30] = -size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
-            dest[31] = -size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
-
-            dest += 32;
-        }
+            float* dest = vertices + begin * 32;
+            for (i32 i = begin; i < end; ++i)
+            {
+                Billboard& billboard = *sortedBillboards_[i];
+
+                Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
+                color32 color = billboard.color_.ToU32();
+                if (fixedScreenSize_)
+                    size *= billboard.screenScaleFactor_;
+
+                float rotationMatrix[2][2];
+                SinCos(billboard.rotation_, rotationMatrix[0][1], rotationMatrix[0][0]);
+                rotationMatrix[1][0] = -rotationMatrix[0][1];
+                rotationMatrix[1][1] = rotationMatrix[0][0];
+
+                dest[0] = billboard.position_.x_;
+                dest[1] = billboard.position_.y_;
+                dest[2] = billboard.position_.z_;
+                ((color32&)dest[3]) = color;
+                dest[4] = billboard.uv_.min_.x_;
+                dest[5] = billboard.uv_.min_.y_;
+                dest[6] = -size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
+                dest[7] = -size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
+
+                dest[8] = billboard.position_.x_;
+                dest[9] = billboard.position_.y_;
+                dest[10] = billboard.position_.z_;
+                ((color32&)dest[11]) = color;
+                dest[12] = billboard.uv_.max_.x_;
+                dest[13] = billboard.uv_.min_.y_;
+                dest[14] = size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
+                dest[15] = size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
+
+                dest[16] = billboard.position_.x_;
+                dest[17] = billboard.position_.y_;
+                dest[18] = billboard.position_.z_;
+                ((color32&)dest[19]) = color;
+                dest[20] = billboard.uv_.max_.x_;
+                dest[21] = billboard.uv_.max_.y_;
+                dest[22] = size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
+                dest[23] = size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
+
+                dest[24] = billboard.position_.x_;
+                dest[25] = billboard.position_.y_;
+                dest[26] = billboard.position_.z_;
+                ((color32&)dest[27]) = color;
+                dest[28] = billboard.uv_.min_.x_;
+                dest[29] = billboard.uv_.max_.y_;
+                dest[30] = -size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
+                dest[31] = -size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
+
+                dest += 32;
+            }
+        });
     }
     else
     {
-        for (i32 i = 0; i < enabledBillboards; ++i)
+        ParallelForBillboards(enabledBillboards, [&](i32 begin, i32 end)
         {
-            Billboard& billboard = *sortedBillboards_[i];
-
-            Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
-            color32 color = billboard.color_.ToU32();
-            if (fixedScreenSize_)
-                size *= billboard.screenScaleFactor_;
-
-            float rot2D[2][2];
-            SinCos(billboard.rotation_, rot2D[0][1], rot2D[0][0]);
-            rot2D[1][0] = -rot2D[0][1];
-            rot2D[1][1] = rot2D[0][0];
-
-            dest[0] = billboard.position_.x_;
-            dest[1] = billboard.position_.y_;
-            dest[2] = billboard.position_.z_;
-            dest[3] = billboard.direction_.x_;
-            dest[4] = billboard.direction_.y_;
-            dest[5] = billboard.direction_.z_;
-            ((color32&)dest[6]) = color;
-            dest[7] = billboard.uv_.min_.x_;
-            dest[8] = billboard.uv_.min_.y_;
-            dest[9] = -size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
-            dest[10] = -size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
-
-            dest[11] = billboard.position_.x_;
-            dest[12] = billboard.position_.y_;
-            dest[13] = billboard.position_.z_;
-            dest[14] = billboard.direction_.x_;
-            dest[15] = billboard.direction_.y_;
-            dest[16] = billboard.direction_.z_;
-            ((color32&)dest[17]) = color;
-            dest[18] = billboard.uv_.max_.x_;
-            dest[19] = billboard.uv_.min_.y_;
-            dest[20] = size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
-            dest[21] = size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
-
-            dest[22] = billboard.position_.x_;
-            dest[23] = billboard.position_.y_;
-            dest[24] = billboard.position_.z_;
-            dest[25] = billboard.direction_.x_;
-            dest[26] = billboard.direction_.y_;
-            dest[27] = billboard.direction_.z_;
-            ((color32&)dest[28]) = color;
-            dest[29] = billboard.uv_.max_.x_;
-            dest[30] = billboard.uv_.max_.y_;
-            dest[31] = size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
-            dest[32] = size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
-
-            dest[33] = billboard.position_.x_;
-            dest[34] = billboard.position_.y_;
-            dest[35] = billboard.position_.z_;
-            dest[36] = billboard.direction_.x_;
-            dest[37] = billboard.direction_.y_;
-            dest[38] = billboard.direction_.z_;
-            ((color32&)dest[39]) = color;
-            dest[40] = billboard.uv_.min_.x_;
-            dest[41] = billboard.uv_.max_.y_;
-            dest[42] = -size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
-            dest[43] = -size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
-
-            dest += 44;
-        }
+            float* dest = vertices + begin * 44;
+            for (i32 i = begin; i < end; ++i)
+            {
+                Billboard& billboard = *sortedBillboards_[i];
+
+                Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
+                color32 color = billboard.color_.ToU32();
+                if (fixedScreenSize_)
+                    size *= billboard.screenScaleFactor_;
+
+                float rot2D[2][2];
+                SinCos(billboard.rotation_, rot2D[0][1], rot2D[0][0]);
+                rot2D[1][0] = -rot2D[0][1];
+                rot2D[1][1] = rot2D[0][0];
+
+                dest[0] = billboard.position_.x_;
+                dest[1] = billboard.position_.y_;
+                dest[2] = billboard.position_.z_;
+                dest[3] = billboard.direction_.x_;
+                dest[4] = billboard.direction_.y_;
+                dest[5] = billboard.direction_.z_;
+                ((color32&)dest[6]) = color;
+                dest[7] = billboard.uv_.min_.x_;
+                dest[8] = billboard.uv_.min_.y_;
+                dest[9] = -size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
+                dest[10] = -size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
+
+                dest[11] = billboard.position_.x_;
+                dest[12] = billboard.position_.y_;
+                dest[13] = billboard.position_.z_;
+                dest[14] = billboard.direction_.x_;
+                dest[15] = billboard.direction_.y_;
+                dest[16] = billboard.direction_.z_;
+                ((color32&)dest[17]) = color;
+                dest[18] = billboard.uv_.max_.x_;
+                dest[19] = billboard.uv_.min_.y_;
+                dest[20] = size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
+                dest[21] = size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
+
+                dest[22] = billboard.position_.x_;
+                dest[23] = billboard.position_.y_;
+                dest[24] = billboard.position_.z_;
+                dest[25] = billboard.direction_.x_;
+                dest[26] = billboard.direction_.y_;
+                dest[27] = billboard.direction_.z_;
+                ((color32&)dest[28]) = color;
+                dest[29] = billboard.uv_.max_.x_;
+                dest[30] = billboard.uv_.max_.y_;
+                dest[31] = size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
+                dest[32] = size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
+
+                dest[33] = billboard.position_.x_;
+                dest[34] = billboard.position_.y_;
+                dest[35] = billboard.position_.z_;
+                dest[36] = billboard.direction_.x_;
+                dest[37] = billboard.direction_.y_;
+                dest[38] = billboard.direction_.z_;
+                ((color32&)dest[39]) = color;
+                dest[40] = billboard.uv_.min_.x_;
+                dest[41] = billboard.uv_.max_.y_;
+                dest[42] = -size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
+                dest[43] = -size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
+
+                dest += 44;
+            }
+        });
     }
 
     vertexBuffer_->Unlock();
@@ -187,6 +187,10 @@ private:
     Vector3 previousOffset_;
     /// Billboard pointers for sorting.
     Vector<Billboard*> sortedBillboards_;
+    /// Distance sort keys of the enabled billboards.
+    Vector<u64> sortKeys_;
+    /// Temporary buffer for distance sort.
+    Vector<u64> sortTemp_;
     /// Attribute buffer for network replication.
     mutable VectorBuffer attrBuffer_;
 };
@@ -0,0 +1,59 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "distance_sort.h"
+
+#include <utility>
+
+#include "../common/debug_new.h"
+
+namespace dviglo
+{
+
+void SortBackToFront(Vector<u64>& keys, Vector<u64>& temp)
+{
+    i32 count = keys.Size();
+    if (count < 2)
+        return;
+
+    // The distance is in the upper 32 bits, which are sorted 11 bits at a time
+    i32 histograms[3][2048]{};
+    for (u64 key : keys)
+    {
+        ++histograms[0][(key >> 32) & 2047];
+        ++histograms[1][(key >> 43) & 2047];
+        ++histograms[2][(key >> 54) & 2047];
+    }
+
+    temp.Resize(count);
+    u64* src = keys.Buffer();
+    u64* dest = temp.Buffer();
+
+    for (i32 i = 0; i < 3; ++i)
+    {
+        i32 shift = 32 + i * 11;
+        i32* offsets = histograms[i];
+
+        // Skip the pass if all keys are in the same bucket
+        if (offsets[(src[0] >> shift) & 2047] == count)
+            continue;
+
+        i32 sum = 0;
+        for (i32 j = 0; j < 2048; ++j)
+        {
+            i32 bucketSize = offsets[j];
+            offsets[j] = sum;
+            sum += bucketSize;
+        }
+
+        for (i32 j = 0; j < count; ++j)
+            dest[offsets[(src[j] >> shift) & 2047]++] = src[j];
+
+        std::swap(src, dest);
+    }
+
+    if (src != keys.Buffer())
+        keys.Swap(temp);
+}
+
+}
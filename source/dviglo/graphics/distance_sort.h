@@ -0,0 +1,27 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+/// \file
+
+#pragma once
+
+#include "../containers/vector.h"
+#include "../math/math_defs.h"
+
+namespace dviglo
+{
+
+/// Return key for sorting from the farthest to the nearest with SortBackToFront(). The index is stored in the lower 32 bits.
+inline u64 BackToFrontSortKey(float distance, i32 index)
+{
+    // Flip the bits of the float so that the keys of larger distances are smaller unsigned integers
+    u32 bits = FloatToRawIntBits(distance);
+    bits = (bits & 0x80000000u) ? bits : ~bits & 0x7fffffffu;
+    return (u64)bits << 32 | (u32)index;
+}
+
+/// Sort keys from BackToFrontSortKey() with a stable radix sort. Keys with equal distances remain in their order.
+/// The temporary buffer is resized as needed.
+DV_API void SortBackToFront(Vector<u64>& keys, Vector<u64>& temp);
+
+}
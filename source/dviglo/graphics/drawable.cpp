@@ -41,6 +41,7 @@ Drawable::Drawable(DrawableTypes drawableType) :
     updateQueued_(false),
     zoneDirty_(false),
     octant_(nullptr),
+    octantIndex_(NINDEX),
     zone_(nullptr),
     viewMask_(DEFAULT_VIEWMASK),
     lightMask_(DEFAULT_LIGHTMASK),
@@ -73,7 +74,7 @@ Drawable::~Drawable()
 void Drawable::RegisterObject()
 {
     DV_ATTRIBUTE("Max Lights", maxLights_, 0, AM_DEFAULT);
-    DV_ATTRIBUTE("View Mask", viewMask_, DEFAULT_VIEWMASK, AM_DEFAULT);
+    DV_ACCESSOR_ATTRIBUTE("View Mask", GetViewMask, SetViewMask, DEFAULT_VIEWMASK, AM_DEFAULT);
     DV_ATTRIBUTE("Light Mask", lightMask_, DEFAULT_LIGHTMASK, AM_DEFAULT);
     DV_ATTRIBUTE("Shadow Mask", shadowMask_, DEFAULT_SHADOWMASK, AM_DEFAULT);
     DV_ACCESSOR_ATTRIBUTE("Zone Mask", GetZoneMask, SetZoneMask, DEFAULT_ZONEMASK, AM_DEFAULT);
@@ -105,6 +106,13 @@ void Drawable::ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQueryResul
     }
 }
 
+void Drawable::PrepareRayQuery()
+{
+    if (node_)
+        node_->GetWorldTransform();
+    GetWorldBoundingBox();
+}
+
 void Drawable::UpdateBatches(const FrameInfo& frame)
 {
     const BoundingBox& worldBoundingBox = GetWorldBoundingBox();
@@ -168,6 +176,8 @@ void Drawable::SetLodBias(float bias)
 void Drawable::SetViewMask(mask32 mask)
 {
     viewMask_ = mask;
+    if (octant_)
+        octant_->UpdateDrawableCullData(this);
     MarkNetworkUpdate();
 }
 
@@ -114,8 +114,13 @@ public:
     void OnSetEnabled() override;
     /// Process octree raycast. May be called from a worker thread.
     virtual void ProcessRayQuery(const RayOctreeQuery& query, Vector<RayQueryResult>& results);
+    /// Calculate the world transforms and the bounding box which ProcessRayQuery() reads, before ray queries in worker
+    /// threads. Is called from the main thread for moved drawables.
+    virtual void PrepareRayQuery();
     /// Update before octree reinsertion. Is called from a worker thread.
     virtual void Update(const FrameInfo& frame) { }
+    /// Return whether Update() is expensive, for example animation. Such drawable objects are updated one per work item.
+    virtual bool IsUpdateExpensive() const { return false; }
     /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
     virtual void UpdateBatches(const FrameInfo& frame);
     /// Prepare geometry for rendering.
@@ -342,6 +347,8 @@ protected:
     bool zoneDirty_;
     /// Octree octant.
     Octant* octant_;
+    /// Index in the octant's drawable list.
+    i32 octantIndex_;
     /// Current zone.
     Zone* zone_;
     /// View mask.
@@ -0,0 +1,361 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../core/context.h"
+#include "../core/profiler.h"
+#include "../core/work_queue.h"
+#include "drawable_bvh.h"
+
+#include <utility>
+
+#include "../common/debug_new.h"
+
+namespace dviglo
+{
+
+static const i32 BVH_GRAIN = 1024;
+static const i32 LEAF_FLAG = (i32)0x80000000;
+
+// Process range [begin, end) in worker threads if available
+template <typename Func>
+static void ParallelForIfAvailable(i32 begin, i32 end, Func func)
+{
+    auto* queue = DV_CONTEXT.GetSubsystem<WorkQueue>();
+    if (queue && end - begin > BVH_GRAIN)
+        queue->ParallelFor(begin, end, BVH_GRAIN, [&func](i32 begin, i32 end, i32 /*threadIndex*/) { func(begin, end); });
+    else
+        func(begin, end);
+}
+
+// Insert two zero bits after each of the lower 10 bits
+static u32 ExpandBits(u32 value)
+{
+    value = (value * 0x00010001u) & 0xFF0000FFu;
+    value = (value * 0x00000101u) & 0x0F00F00Fu;
+    value = (value * 0x00000011u) & 0xC30C30C3u;
+    value = (value * 0x00000005u) & 0x49249249u;
+    return value;
+}
+
+static i32 CountLeadingZeros(u64 value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - (i32)index;
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+// Length of the common prefix of two sort keys, or -1 if j is out of range. Keys are unique
+static i32 CommonPrefix(const u64* keys, i32 count, i32 i, i32 j)
+{
+    if (j < 0 || j >= count)
+        return -1;
+    return CountLeadingZeros(keys[i] ^ keys[j]);
+}
+
+void DrawableBvh::Build(const Vector<Drawable*>& drawables)
+{
+    DV_PROFILE(BuildBvh);
+
+    i32 count = drawables.Size();
+    if (!count)
+    {
+        Clear();
+        return;
+    }
+
+    // Bounding box centers and their bounds
+    centers_.Resize(count);
+    ParallelForIfAvailable(0, count, [&](i32 begin, i32 end)
+    {
+        for (i32 i = begin; i < end; ++i)
+            centers_[i] = drawables[i]->GetWorldBoundingBox().Center();
+    });
+
+    BoundingBox bounds(centers_[0], centers_[0]);
+    for (const Vector3& center : centers_)
+        bounds.Merge(center);
+
+    // Morton codes of the centers quantized to 10 bits per axis
+    Vector3 scale = bounds.Size();
+    scale.x_ = scale.x_ > 0.f ? 1023.f / scale.x_ : 0.f;
+    scale.y_ = scale.y_ > 0.f ? 1023.f / scale.y_ : 0.f;
+    scale.z_ = scale.z_ > 0.f ? 1023.f / scale.z_ : 0.f;
+
+    keys_.Resize(count);
+    ParallelForIfAvailable(0, count, [&](i32 begin, i32 end)
+    {
+        for (i32 i = begin; i < end; ++i)
+        {
+            Vector3 position = (centers_[i] - bounds.min_) * scale;
+            u32 x = Min((u32)position.x_, 1023u);
+            u32 y = Min((u32)position.y_, 1023u);
+            u32 z = Min((u32)position.z_, 1023u);
+            u32 code = ExpandBits(x) << 2 | ExpandBits(y) << 1 | ExpandBits(z);
+            keys_[i] = (u64)code << 32 | (u32)i;
+        }
+    });
+
+    // Stable radix sort by the Morton codes, which keeps the keys with equal codes sorted by index
+    sortBuffer_.Resize(count);
+    u64* src = keys_.Buffer();
+    u64* dest = sortBuffer_.Buffer();
+
+    for (i32 shift = 32; shift < 62; shift += 10)
+    {
+        i32 offsets[1024]{};
+        for (i32 i = 0; i < count; ++i)
+            ++offsets[(src[i] >> shift) & 1023];
+
+        i32 sum = 0;
+        for (i32& offset : offsets)
+        {
+            i32 bucketSize = offset;
+            offset = sum;
+            sum += bucketSize;
+        }
+
+        for (i32 i = 0; i < count; ++i)
+            dest[offsets[(src[i] >> shift) & 1023]++] = src[i];
+
+        std::swap(src, dest);
+    }
+
+    // Odd number of passes leaves the result in the temporary buffer
+    if (src != keys_.Buffer())
+        keys_.Swap(sortBuffer_);
+
+    drawables_.Resize(count);
+    for (i32 i = 0; i < count; ++i)
+        drawables_[i] = drawables[(i32)(keys_[i] & 0xFFFFFFFFu)];
+
+    // Internal nodes of a binary radix tree, each of them independently (T. Karras, Maximizing Parallelism
+    // in the Construction of BVHs, Octrees, and k-d Trees, 2012)
+    const u64* keys = keys_.Buffer();
+    buildNodes_.Resize(Max(count - 1, 0) * 4);
+
+    ParallelForIfAvailable(0, count - 1, [&](i32 begin, i32 end)
+    {
+        for (i32 i = begin; i < end; ++i)
+        {
+            // Direction of the range
+            i32 d = CommonPrefix(keys, count, i, i + 1) > CommonPrefix(keys, count, i, i - 1) ? 1 : -1;
+
+            // Upper bound for the length of the range
+            i32 minPrefix = CommonPrefix(keys, count, i, i - d);
+            i32 maxLength = 2;
+            while (CommonPrefix(keys, count, i, i + maxLength * d) > minPrefix)
+                maxLength *= 2;
+
+            // Other end of the range with binary search
+            i32 length = 0;
+            for (i32 t = maxLength / 2; t >= 1; t /= 2)
+            {
+                if (CommonPrefix(keys, count, i, i + (length + t) * d) > minPrefix)
+                    length += t;
+            }
+            i32 j = i + length * d;
+
+            // Split position with binary search
+            i32 nodePrefix = CommonPrefix(keys, count, i, j);
+            i32 split = 0;
+            i32 t = length;
+            do
+            {
+                t = (t + 1) / 2;
+                if (CommonPrefix(keys, count, i, i + (split + t) * d) > nodePrefix)
+                    split += t;
+            }
+            while (t > 1);
+            i32 gamma = i + split * d + Min(d, 0);
+
+            i32 first = Min(i, j);
+            i32 last = Max(i, j);
+            i32* node = &buildNodes_[i * 4];
+            node[0] = first == gamma ? (gamma | LEAF_FLAG) : gamma;
+            node[1] = last == gamma + 1 ? ((gamma + 1) | LEAF_FLAG) : gamma + 1;
+            node[2] = first;
+            node[3] = last;
+        }
+    });
+
+    // Store nodes in depth-first order. The root is internal node 0, or the only leaf
+    nodes_.Resize(count * 2 - 1);
+    i32 stack[MAX_DEPTH * 2];
+    i32 parentStack[MAX_DEPTH * 2];
+    i32 stackSize = 0;
+    stack[stackSize] = count > 1 ? 0 : LEAF_FLAG;
+    parentStack[stackSize++] = NINDEX;
+    i32 numNodes = 0;
+
+    while (stackSize)
+    {
+        --stackSize;
+        i32 buildIndex = stack[stackSize];
+        i32 parent = parentStack[stackSize];
+        i32 index = numNodes++;
+        BvhNode& node = nodes_[index];
+
+        // Second child is not stored right after the parent
+        if (parent != NINDEX)
+            nodes_[parent].secondChild_ = index;
+
+        if (buildIndex & LEAF_FLAG)
+        {
+            node.secondChild_ = NINDEX;
+            node.first_ = buildIndex & ~LEAF_FLAG;
+            node.count_ = 1;
+        }
+        else
+        {
+            const i32* buildNode = &buildNodes_[buildIndex * 4];
+            node.first_ = buildNode[2];
+            node.count_ = buildNode[3] - buildNode[2] + 1;
+
+            stack[stackSize] = buildNode[1];
+            parentStack[stackSize++] = index;
+            stack[stackSize] = buildNode[0];
+            parentStack[stackSize++] = NINDEX;
+        }
+    }
+
+    assert(numNodes == nodes_.Size());
+    Refit();
+}
+
+void DrawableBvh::Refit()
+{
+    DV_PROFILE(RefitBvh);
+
+    // Fetch the leaf bounding boxes in worker threads, then merge the boxes of the internal nodes from the last node
+    // to the first, so that the children are ready before their parent
+    ParallelForIfAvailable(0, nodes_.Size(), [this](i32 begin, i32 end)
+    {
+        for (i32 i = begin; i < end; ++i)
+        {
+            BvhNode& node = nodes_[i];
+            if (node.secondChild_ == NINDEX)
+                node.box_ = drawables_[node.first_]->GetWorldBoundingBox();
+        }
+    });
+
+    for (i32 i = nodes_.Size() - 1; i >= 0; --i)
+    {
+        BvhNode& node = nodes_[i];
+        if (node.secondChild_ != NINDEX)
+        {
+            node.box_ = nodes_[i + 1].box_;
+            node.box_.Merge(nodes_[node.secondChild_].box_);
+        }
+    }
+}
+
+void DrawableBvh::Clear()
+{
+    drawables_.Clear();
+    nodes_.Clear();
+}
+
+void DrawableBvh::GetDrawables(OctreeQuery& query) const
+{
+    if (nodes_.Empty())
+        return;
+
+    i32 stack[MAX_DEPTH];
+    bool insideStack[MAX_DEPTH];
+    i32 stackSize = 0;
+    stack[stackSize] = 0;
+    insideStack[stackSize++] = false;
+    auto** drawables = const_cast<Drawable**>(drawables_.Buffer());
+
+    while (stackSize)
+    {
+        --stackSize;
+        i32 index = stack[stackSize];
+        const BvhNode& node = nodes_[index];
+        bool inside = insideStack[stackSize];
+
+        // Like octants, nodes are tested also when inside, because the query may do additional tests such as occlusion
+        Intersection res = query.TestOctant(node.box_, inside);
+        if (res == OUTSIDE)
+            continue;
+        if (res == INSIDE)
+            inside = true;
+
+        if (node.count_ <= MAX_LEAF_DRAWABLES)
+        {
+            query.TestDrawables(drawables + node.first_, drawables + node.first_ + node.count_, inside);
+            continue;
+        }
+
+        stack[stackSize] = node.secondChild_;
+        insideStack[stackSize++] = inside;
+        stack[stackSize] = index + 1;
+        insideStack[stackSize++] = inside;
+    }
+}
+
+void DrawableBvh::Raycast(RayOctreeQuery& query) const
+{
+    if (nodes_.Empty())
+        return;
+
+    i32 stack[MAX_DEPTH];
+    i32 stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize)
+    {
+        i32 index = stack[--stackSize];
+        const BvhNode& node = nodes_[index];
+
+        if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+            continue;
+
+        if (node.secondChild_ == NINDEX)
+        {
+            Drawable* drawable = drawables_[node.first_];
+            if (!!(drawable->GetDrawableType() & query.drawableTypes_) && (drawable->GetViewMask() & query.viewMask_))
+                drawable->ProcessRayQuery(query, query.result_);
+            continue;
+        }
+
+        stack[stackSize++] = node.secondChild_;
+        stack[stackSize++] = index + 1;
+    }
+}
+
+void DrawableBvh::GetRayDrawables(RayOctreeQuery& query, Vector<Drawable*>& drawables) const
+{
+    if (nodes_.Empty())
+        return;
+
+    i32 stack[MAX_DEPTH];
+    i32 stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize)
+    {
+        i32 index = stack[--stackSize];
+        const BvhNode& node = nodes_[index];
+
+        if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+            continue;
+
+        if (node.secondChild_ == NINDEX)
+        {
+            Drawable* drawable = drawables_[node.first_];
+            if (!!(drawable->GetDrawableType() & query.drawableTypes_) && (drawable->GetViewMask() & query.viewMask_))
+                drawables.Push(drawable);
+            continue;
+        }
+
+        stack[stackSize++] = node.secondChild_;
+        stack[stackSize++] = index + 1;
+    }
+}
+
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+/// \file
+
+#pragma once
+
+#include "octree_query.h"
+
+namespace dviglo
+{
+
+/// Node of a drawable bounding volume hierarchy.
+struct BvhNode
+{
+    /// Bounding box of the drawables in the node.
+    BoundingBox box_;
+    /// Index of the second child node or NINDEX for a leaf. The first child node always follows its parent.
+    i32 secondChild_;
+    /// Index of the first drawable.
+    i32 first_;
+    /// Number of drawables.
+    i32 count_;
+};
+
+/// Linear bounding volume hierarchy of drawables. Built in parallel from Morton codes of the bounding box centers, so that
+/// it adapts to the distribution of the drawables instead of having fixed bounds and subdivision levels. When the drawables
+/// move, the node bounding boxes can be refit without changing the hierarchy.
+class DV_API DrawableBvh
+{
+public:
+    /// Build from drawables. Uses worker threads if available. The current world bounding boxes of the drawables are used.
+    void Build(const Vector<Drawable*>& drawables);
+    /// Update node bounding boxes from the current world bounding boxes of the drawables.
+    void Refit();
+    /// Remove all drawables.
+    void Clear();
+
+    /// Return drawable objects by a query.
+    void GetDrawables(OctreeQuery& query) const;
+    /// Return drawable objects by a ray query.
+    void Raycast(RayOctreeQuery& query) const;
+    /// Return drawable objects whose bounding box is hit by a ray query, without testing the drawables themselves.
+    void GetRayDrawables(RayOctreeQuery& query, Vector<Drawable*>& drawables) const;
+
+    /// Call sink(drawable) for the drawable objects accepted by a visitor query, see Octree::VisitDrawables().
+    template <typename Query, typename Sink>
+    void VisitDrawables(const Query& query, Sink& sink) const
+    {
+        if (nodes_.Empty())
+            return;
+
+        // Node index and whether the node is known to be inside
+        i32 stack[MAX_DEPTH];
+        bool insideStack[MAX_DEPTH];
+        i32 stackSize = 0;
+        stack[stackSize] = 0;
+        insideStack[stackSize++] = false;
+
+        while (stackSize)
+        {
+            --stackSize;
+            const BvhNode& node = nodes_[stack[stackSize]];
+            bool inside = insideStack[stackSize];
+
+            Intersection res = query.TestOctant(node.box_, inside);
+            if (res == OUTSIDE)
+                continue;
+            if (res == INSIDE)
+                inside = true;
+
+            // Test the drawables directly if they are all inside or if there are only a few of them
+            if (inside || node.count_ <= MAX_LEAF_DRAWABLES)
+            {
+                for (i32 i = node.first_; i < node.first_ + node.count_; ++i)
+                {
+                    Drawable* drawable = drawables_[i];
+                    if (!!(drawable->GetDrawableType() & query.drawableTypes_) && (drawable->GetViewMask() & query.viewMask_) &&
+                        query.TestDrawable(drawable, inside))
+                        sink(drawable);
+                }
+                continue;
+            }
+
+            i32 index = (i32)(&node - nodes_.Buffer());
+            stack[stackSize] = node.secondChild_;
+            insideStack[stackSize++] = inside;
+            stack[stackSize] = index + 1;
+            insideStack[stackSize++] = inside;
+        }
+    }
+
+    /// Return number of drawables.
+    i32 GetNumDrawables() const { return drawables_.Size(); }
+    /// Return drawables in the order of the leaves.
+    const Vector<Drawable*>& GetDrawables() const { return drawables_; }
+    /// Return nodes. The first node is the root.
+    const Vector<BvhNode>& GetNodes() const { return nodes_; }
+
+    /// Size of the traversal stack. Depth of the hierarchy is limited by the 64 bits of the sort keys.
+    static constexpr i32 MAX_DEPTH = 66;
+    /// Maximum number of drawables which are tested without descending to the leaves.
+    static constexpr i32 MAX_LEAF_DRAWABLES = 4;
+
+private:
+    /// Drawables sorted by Morton code.
+    Vector<Drawable*> drawables_;
+    /// Nodes in depth-first order, so that children always follow their parent.
+    Vector<BvhNode> nodes_;
+    /// Bounding box centers of the drawables during the build.
+    Vector<Vector3> centers_;
+    /// Sort keys during the build: Morton code in the high bits and drawable index in the low bits.
+    Vector<u64> keys_;
+    /// Temporary buffer for sorting the keys.
+    Vector<u64> sortBuffer_;
+    /// Children and drawable ranges of the internal nodes during the build, 4 values per node. Leaves are marked with the highest bit.
+    Vector<i32> buildNodes_;
+};
+
+}
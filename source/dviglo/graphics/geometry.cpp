@@ -41,6 +41,7 @@ bool Geometry::SetNumVertexBuffers(i32 num)
 
     i32 oldSize = vertexBuffers_.Size(); // TODO: unused
     vertexBuffers_.Resize(num);
+    ++dataRevision_;
 
     return true;
 }
@@ -56,12 +57,14 @@ bool Geometry::SetVertexBuffer(i32 index, VertexBuffer* buffer)
     }
 
     vertexBuffers_[index] = buffer;
+    ++dataRevision_;
     return true;
 }
 
 void Geometry::SetIndexBuffer(IndexBuffer* buffer)
 {
     indexBuffer_ = buffer;
+    ++dataRevision_;
 }
 
 bool Geometry::SetDrawRange(PrimitiveType type, i32 indexStart, i32 indexCount, bool getUsedVertexRange/* = true*/)
@@ -84,6 +87,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, i32 indexStart, i32 indexCount,
     primitiveType_ = type;
     indexStart_ = indexStart;
     indexCount_ = indexCount;
+    ++dataRevision_;
 
     // Get min.vertex index and num of vertices from index buffer. If it fails, use full range as fallback
     if (indexCount)
@@ -132,6 +136,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, i32 indexStart, i32 indexCount,
     indexCount_ = indexCount;
     vertexStart_ = vertexStart;
     vertexCount_ = vertexCount;
+    ++dataRevision_;
 
     return true;
 }
@@ -149,6 +154,7 @@ void Geometry::SetRawVertexData(const SharedArrayPtr<byte>& data, const Vector<V
     rawVertexData_ = data;
     rawVertexSize_ = VertexBuffer::GetVertexSize(elements);
     rawElements_ = elements;
+    ++dataRevision_;
 }
 
 void Geometry::SetRawVertexData(const SharedArrayPtr<byte>& data, VertexElements elementMask)
@@ -156,6 +162,8 @@ void Geometry::SetRawVertexData(const SharedArrayPtr<byte>& data, VertexElements
     rawVertexData_ = data;
     rawVertexSize_ = VertexBuffer::GetVertexSize(elementMask);
     rawElements_ = VertexBuffer::GetElements(elementMask);
+    VertexBuffer::UpdateOffsets(rawElements_);
+    ++dataRevision_;
 }
 
 void Geometry::SetRawIndexData(const SharedArrayPtr<byte>& data, i32 indexSize)
@@ -163,6 +171,7 @@ void Geometry::SetRawIndexData(const SharedArrayPtr<byte>& data, i32 indexSize)
     assert(indexSize >= 0);
     rawIndexData_ = data;
     rawIndexSize_ = indexSize;
+    ++dataRevision_;
 }
 
 void Geometry::Draw(Graphics* graphics)
@@ -315,10 +324,93 @@ float Geometry::GetHitDistance(const Ray& ray, Vector3* outNormal, Vector2* outU
         outUV = nullptr;
     }
 
+    i32 numTriangles = (indexData ? indexCount_ : vertexCount_) / 3;
+    if (primitiveType_ == TRIANGLE_LIST && numTriangles >= MIN_TRIANGLE_BVH_TRIANGLES)
+    {
+        const TriangleBvh& bvh = GetTriangleBvh(vertexData, vertexSize, indexData, indexSize);
+        Vector3 barycentric;
+        i32 triangle;
+        float distance = bvh.HitDistance(ray, outNormal, outUV ? &barycentric : nullptr, &triangle);
+
+        if (outUV)
+        {
+            if (triangle == NINDEX)
+                *outUV = Vector2::ZERO;
+            else
+            {
+                // Interpolate the UV coordinate using barycentric coordinate
+                i32 vertices[3];
+                for (i32 i = 0; i < 3; ++i)
+                {
+                    i32 index = triangle * 3 + i;
+                    if (!indexData)
+                        vertices[i] = vertexStart_ + index;
+                    else if (indexSize == sizeof(u16))
+                        vertices[i] = ((const u16*)indexData)[indexStart_ + index];
+                    else
+                        vertices[i] = (i32)((const u32*)indexData)[indexStart_ + index];
+                }
+
+                const Vector2& uv0 = *((const Vector2*)(&vertexData[uvOffset + (size_t)vertices[0] * vertexSize]));
+                const Vector2& uv1 = *((const Vector2*)(&vertexData[uvOffset + (size_t)vertices[1] * vertexSize]));
+                const Vector2& uv2 = *((const Vector2*)(&vertexData[uvOffset + (size_t)vertices[2] * vertexSize]));
+                *outUV = Vector2(uv0.x_ * barycentric.x_ + uv1.x_ * barycentric.y_ + uv2.x_ * barycentric.z_,
+                    uv0.y_ * barycentric.x_ + uv1.y_ * barycentric.y_ + uv2.y_ * barycentric.z_);
+            }
+        }
+
+        return distance;
+    }
+
     return indexData ? ray.HitDistance(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_, outNormal, outUV,
         uvOffset) : ray.HitDistance(vertexData, vertexSize, vertexStart_, vertexCount_, outNormal, outUV, uvOffset);
 }
 
+const TriangleBvh& Geometry::GetTriangleBvh(const byte* vertexData, i32 vertexSize, const byte* indexData, i32 indexSize) const
+{
+    // Raw data overrides are tracked by the revision of the geometry
+    VertexBuffer* vertexBuffer = !rawVertexData_ && vertexBuffers_.Size() ? vertexBuffers_[0].Get() : nullptr;
+    IndexBuffer* indexBuffer = !rawIndexData_ ? indexBuffer_.Get() : nullptr;
+    u32 revisions[3] = {
+        dataRevision_,
+        vertexBuffer ? vertexBuffer->GetDataRevision() : 0,
+        indexBuffer ? indexBuffer->GetDataRevision() : 0
+    };
+
+    auto isCurrent = [&revisions](const BuiltTriangleBvh* built)
+    {
+        return built && built->revisions_[0] == revisions[0] && built->revisions_[1] == revisions[1] &&
+            built->revisions_[2] == revisions[2];
+    };
+
+    BuiltTriangleBvh* built = triangleBvh_.load(std::memory_order_acquire);
+    if (isCurrent(built))
+        return built->bvh_;
+
+    std::scoped_lock lock(triangleBvhMutex_);
+
+    // Another thread may have built it while this one was waiting
+    built = triangleBvh_.load(std::memory_order_relaxed);
+    if (isCurrent(built))
+        return built->bvh_;
+
+    // The previous hierarchy is kept, as queries which started before the data changed may still traverse it
+    std::unique_ptr<BuiltTriangleBvh> newBuilt(new BuiltTriangleBvh());
+    if (indexData)
+        newBuilt->bvh_.Build(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_);
+    else
+        newBuilt->bvh_.Build(vertexData, vertexSize, vertexStart_, vertexCount_);
+
+    for (i32 i = 0; i < 3; ++i)
+        newBuilt->revisions_[i] = revisions[i];
+
+    built = newBuilt.get();
+    triangleBvhs_[1] = std::move(triangleBvhs_[0]);
+    triangleBvhs_[0] = std::move(newBuilt);
+    triangleBvh_.store(built, std::memory_order_release);
+    return built->bvh_;
+}
+
 bool Geometry::IsInside(const Ray& ray) const
 {
     const byte* vertexData;
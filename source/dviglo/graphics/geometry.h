@@ -7,6 +7,11 @@
 #include "../containers/array_ptr.h"
 #include "../core/object.h"
 #include "../graphics_api/graphics_defs.h"
+#include "triangle_bvh.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 namespace dviglo
 {
@@ -87,6 +92,8 @@ public:
     void GetRawDataShared(SharedArrayPtr<byte>& vertexData, i32& vertexSize, SharedArrayPtr<byte>& indexData,
         i32& indexSize, const Vector<VertexElement>*& elements) const;
     /// Return ray hit distance or infinity if no hit. Requires raw data to be set. Optionally return hit normal and hit uv coordinates at intersect point.
+    /// Triangle lists with enough triangles are tested with a triangle hierarchy, which is built on the first call and
+    /// rebuilt after the data or the draw range changes.
     float GetHitDistance(const Ray& ray, Vector3* outNormal = nullptr, Vector2* outUV = nullptr) const;
     /// Return whether or not the ray is inside geometry.
     bool IsInside(const Ray& ray) const;
@@ -94,7 +101,22 @@ public:
     /// Return whether has empty draw range.
     bool IsEmpty() const { return indexCount_ == 0 && vertexCount_ == 0; }
 
+    /// Minimum number of triangles for using a triangle hierarchy in ray queries.
+    static constexpr i32 MIN_TRIANGLE_BVH_TRIANGLES = 64;
+
 private:
+    /// Triangle hierarchy with the data revisions of the geometry, first vertex buffer and index buffer it was built from.
+    struct BuiltTriangleBvh
+    {
+        /// Triangle hierarchy.
+        TriangleBvh bvh_;
+        /// Data revisions.
+        u32 revisions_[3];
+    };
+
+    /// Return the triangle hierarchy for the current raw data, building it if necessary.
+    const TriangleBvh& GetTriangleBvh(const byte* vertexData, i32 vertexSize, const byte* indexData, i32 indexSize) const;
+
     /// Vertex buffers.
     Vector<SharedPtr<VertexBuffer>> vertexBuffers_;
     /// Index buffer.
@@ -121,6 +143,16 @@ private:
     i32 rawVertexSize_;
     /// Raw index data override size.
     i32 rawIndexSize_;
+    /// Revision of the buffers, raw data overrides and draw range.
+    u32 dataRevision_{};
+    /// Current triangle hierarchy for ray queries. The lookup does not lock, as a hierarchy is not modified after
+    /// it is published.
+    mutable std::atomic<BuiltTriangleBvh*> triangleBvh_{};
+    /// Current and previous triangle hierarchies. The previous one may still be traversed by a query which started
+    /// before the rebuild.
+    mutable std::unique_ptr<BuiltTriangleBvh> triangleBvhs_[2];
+    /// Mutex for building the triangle hierarchy in concurrent ray queries.
+    mutable std::mutex triangleBvhMutex_;
 };
 
 }
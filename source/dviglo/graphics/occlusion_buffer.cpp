@@ -2,28 +2,58 @@
 // Copyright (c) 2022-2023 the Dviglo project
 // License: MIT
 
-#include "../core/work_queue.h"
 #include "../core/profiler.h"
+#include "../core/task_graph.h"
 #include "camera.h"
+#include "drawable.h"
 #include "occlusion_buffer.h"
 #include "../io/log.h"
 
+#include <emmintrin.h>
+
 #include "../common/debug_new.h"
 
 namespace dviglo
 {
 
+// Positive and negative planes are in separate groups of bits to match the order of the SIMD lanes
 enum ClipMask : unsigned
 {
     CLIPMASK_X_POS = 0x1,
-    CLIPMASK_X_NEG = 0x2,
-    CLIPMASK_Y_POS = 0x4,
-    CLIPMASK_Y_NEG = 0x8,
-    CLIPMASK_Z_POS = 0x10,
+    CLIPMASK_Y_POS = 0x2,
+    CLIPMASK_Z_POS = 0x4,
+    CLIPMASK_X_NEG = 0x8,
+    CLIPMASK_Y_NEG = 0x10,
     CLIPMASK_Z_NEG = 0x20,
 };
 DV_FLAGSET(ClipMask, ClipMaskFlags);
 
+// Triangles crossing the screen edges are cut by the rasterizer, so X and Y clip planes are moved outwards
+// to keep the coordinates small. Only triangles extending beyond this guard band are clipped
+static constexpr float OCCLUSION_GUARD_BAND = 8.0f;
+
+/// Return clip planes, which a vertex in clip space is behind.
+static inline ClipMaskFlags GetClipMask(const Vector4& vertex)
+{
+    ClipMaskFlags clipMask{};
+    float guardW = vertex.w_ * OCCLUSION_GUARD_BAND;
+
+    if (vertex.x_ > guardW)
+        clipMask |= CLIPMASK_X_POS;
+    if (vertex.x_ < -guardW)
+        clipMask |= CLIPMASK_X_NEG;
+    if (vertex.y_ > guardW)
+        clipMask |= CLIPMASK_Y_POS;
+    if (vertex.y_ < -guardW)
+        clipMask |= CLIPMASK_Y_NEG;
+    if (vertex.z_ > vertex.w_)
+        clipMask |= CLIPMASK_Z_POS;
+    if (vertex.z_ < 0.0f)
+        clipMask |= CLIPMASK_Z_NEG;
+
+    return clipMask;
+}
+
 static constexpr int OCCLUSION_MIN_SIZE = 8;
 static constexpr int OCCLUSION_DEFAULT_MAX_TRIANGLES = 5000;
 static constexpr float OCCLUSION_RELATIVE_BIAS = 0.00001f;
@@ -31,11 +61,24 @@ static constexpr int OCCLUSION_FIXED_BIAS = 16;
 static constexpr float OCCLUSION_X_SCALE = 65536.0f;
 static constexpr float OCCLUSION_Z_SCALE = 16777216.0f;
 
-void DrawOcclusionBatchWork(const WorkItem* item, i32 threadIndex)
+// Tiles are rasterized independently, so worker threads write directly to the buffer.
+// Tile width is a multiple of the number of pixels processed at once
+static constexpr int OCCLUSION_TILE_WIDTH = 32;
+static constexpr int OCCLUSION_TILE_HEIGHT = 16;
+static constexpr int OCCLUSION_SIMD_WIDTH = 8;
+
+/// Return the smallest integer not less than a positive value. Unlike CeilToInt() does not call the library function.
+static inline int CeilToIntPositive(float x)
+{
+    int i = (int)x;
+    return (float)i < x ? i + 1 : i;
+}
+
+/// Return the larger of signed integers in each lane. SSE2 has no instruction for this.
+static inline __m128i MaxInt(__m128i a, __m128i b)
 {
-    auto* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
-    OcclusionBatch& batch = *reinterpret_cast<OcclusionBatch*>(item->start_);
-    buffer->DrawBatch(batch, threadIndex);
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
 }
 
 OcclusionBuffer::OcclusionBuffer()
@@ -65,17 +108,25 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
 
     width_ = width;
     height_ = height;
-
-    // Build work buffers for threading
-    unsigned numThreadBuffers = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
-    buffers_.Resize(numThreadBuffers);
-    for (unsigned i = 0; i < numThreadBuffers; ++i)
+    numTilesX_ = (width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+    numTilesY_ = (height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+
+    buffer_ = new int[width * height];
+    ResetHistory();
+
+    // Each thread bins triangles separately, the bins of a tile are merged during rasterization.
+    // Without threads the triangles are rasterized right away
+    i32 numThreads = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
+    threaded_ = numThreads > 1;
+    threadData_.Resize(numThreads);
+    for (OcclusionBufferData& data : threadData_)
     {
-        // Reserve extra memory in case 3D clipping is not exact
-        OcclusionBufferData& buffer = buffers_[i];
-        buffer.dataWithSafety_ = new int[width * (height + 2) + 2];
-        buffer.data_ = buffer.dataWithSafety_.Get() + width + 1;
-        buffer.used_ = false;
+        // Theoretical max. amount of vertices if each of the 6 clipping planes doubles the triangle count
+        data.clippedVertices_.Resize(64 * 3);
+        data.triangles_.Clear();
+        data.tileTriangles_.Clear();
+        if (threaded_)
+            data.tileTriangles_.Resize(numTilesX_ * numTilesY_);
     }
 
     mipBuffers_.Clear();
@@ -93,7 +144,7 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
     }
 
     DV_LOGDEBUG("Set occlusion buffer size " + String(width_) + "x" + String(height_) + " with " +
-             String(mipBuffers_.Size()) + " mip levels and " + String(numThreadBuffers) + " thread buffers");
+             String(mipBuffers_.Size()) + " mip levels and " + String(numTilesX_ * numTilesY_) + " tiles");
 
     CalculateViewport();
     return true;
@@ -140,12 +191,15 @@ void OcclusionBuffer::Clear()
 {
     Reset();
 
-    // Only clear the main thread buffer. Rest are cleared on-demand when drawing the first batch
-    ClearBuffer(0);
-    for (OcclusionBufferData& buffer : buffers_)
-        buffer.used_ = false;
+    int* dest = buffer_.Get();
+    int count = width_ * height_;
+    auto fillValue = (int)OCCLUSION_Z_SCALE;
+
+    while (count--)
+        *dest++ = fillValue;
 
     depthHierarchyDirty_ = true;
+    historyAge_ = 0;
 }
 
 bool OcclusionBuffer::AddTriangles(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart,
@@ -186,41 +240,78 @@ bool OcclusionBuffer::AddTriangles(const Matrix3x4& model, const void* vertexDat
 
 void OcclusionBuffer::DrawTriangles()
 {
-    if (buffers_.Size() == 1)
+    if (!buffer_ || batches_.Empty())
     {
-        // Not threaded
-        for (Vector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
-            DrawBatch(*i, 0);
+        batches_.Clear();
+        return;
+    }
 
-        depthHierarchyDirty_ = true;
+    if (!threaded_)
+    {
+        for (const OcclusionBatch& batch : batches_)
+            DrawBatch(batch, 0);
     }
-    else if (buffers_.Size() > 1)
+    else
     {
-        // Threaded
         auto* queue = GetSubsystem<WorkQueue>();
+        i32 numTiles = numTilesX_ * numTilesY_;
 
-        for (Vector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
+        queue->ParallelFor(0, batches_.Size(), 1, [this](i32 begin, i32 end, i32 threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = WI_MAX_PRIORITY;
-            item->workFunction_ = DrawOcclusionBatchWork;
-            item->aux_ = this;
-            item->start_ = &(*i);
-            queue->AddWorkItem(item);
-        }
+            for (i32 i = begin; i < end; ++i)
+                DrawBatch(batches_[i], threadIndex);
+        });
 
-        queue->Complete(WI_MAX_PRIORITY);
+        queue->ParallelFor(0, numTiles, 1, [this](i32 begin, i32 end, i32 threadIndex)
+        {
+            for (i32 i = begin; i < end; ++i)
+                RasterizeTile(i);
+        });
 
-        MergeBuffers();
-        depthHierarchyDirty_ = true;
+        for (OcclusionBufferData& data : threadData_)
+            data.triangles_.Clear();
     }
 
+    depthHierarchyDirty_ = true;
     batches_.Clear();
 }
 
+i32 OcclusionBuffer::AddDrawTasks(TaskGraph* graph)
+{
+    assert(threaded_);
+
+    // Same as DrawTriangles(), but the tiles are rasterized as soon as all batches are binned, and the mip levels are
+    // built right after
+    i32 binTask = graph->AddParallelFor(0, batches_.Size(), 1, [this](i32 begin, i32 end, i32 threadIndex)
+    {
+        for (i32 i = begin; i < end; ++i)
+            DrawBatch(batches_[i], threadIndex);
+    });
+
+    i32 rasterizeTask = graph->AddParallelFor(0, numTilesX_ * numTilesY_, 1, [this](i32 begin, i32 end, i32 threadIndex)
+    {
+        for (i32 i = begin; i < end; ++i)
+            RasterizeTile(i);
+    });
+
+    i32 hierarchyTask = graph->AddTask([this](i32, i32, i32)
+    {
+        for (OcclusionBufferData& data : threadData_)
+            data.triangles_.Clear();
+
+        batches_.Clear();
+        depthHierarchyDirty_ = true;
+        BuildDepthHierarchy();
+    });
+
+    graph->AddDependency(rasterizeTask, binTask);
+    graph->AddDependency(hierarchyTask, rasterizeTask);
+    return hierarchyTask;
+}
+
 void OcclusionBuffer::BuildDepthHierarchy()
 {
-    if (buffers_.Empty() || !depthHierarchyDirty_)
+    if (!buffer_ || !depthHierarchyDirty_)
         return;
 
     DV_PROFILE(BuildDepthHierarchy);
@@ -232,7 +323,7 @@ void OcclusionBuffer::BuildDepthHierarchy()
     {
         for (int y = 0; y < height; ++y)
         {
-            int* src = buffers_[0].data_ + (y * 2) * width_;
+            int* src = buffer_.Get() + (y * 2) * width_;
             DepthValue* dest = mipBuffers_[0].Get() + y * width;
             DepthValue* end = dest + width;
 
@@ -315,6 +406,289 @@ void OcclusionBuffer::BuildDepthHierarchy()
     depthHierarchyDirty_ = false;
 }
 
+void OcclusionBuffer::StoreHistory(Camera* camera, Vector<OccluderHistory>& occluders)
+{
+    historyCamera_ = camera;
+    historyViewProj_ = viewProj_;
+    historyOccluders_.Swap(occluders);
+}
+
+void OcclusionBuffer::InvalidateHistory(const BoundingBox& worldSpaceBox)
+{
+    if (!buffer_ || !historyCamera_)
+        return;
+
+    IntRect rect = GetHistoryRect(worldSpaceBox);
+    invalidHistoryRects_.Push(rect);
+
+    auto fillValue = (int)OCCLUSION_Z_SCALE;
+
+    for (int y = rect.top_; y <= rect.bottom_; ++y)
+    {
+        int* row = buffer_.Get() + y * width_;
+        for (int x = rect.left_; x <= rect.right_; ++x)
+            row[x] = fillValue;
+    }
+}
+
+bool OcclusionBuffer::IsHistoryValid(const BoundingBox& worldSpaceBox) const
+{
+    if (!historyCamera_)
+        return false;
+
+    if (invalidHistoryRects_.Empty())
+        return true;
+
+    IntRect rect = GetHistoryRect(worldSpaceBox);
+
+    for (const IntRect& invalidRect : invalidHistoryRects_)
+    {
+        if (rect.left_ <= invalidRect.right_ && rect.right_ >= invalidRect.left_ && rect.top_ <= invalidRect.bottom_ &&
+            rect.bottom_ >= invalidRect.top_)
+            return false;
+    }
+
+    return true;
+}
+
+bool OcclusionBuffer::ReprojectOccluders(Vector<OccluderHistory>& occluders)
+{
+    if (!buffer_ || !historyCamera_)
+        return false;
+
+    // Erase the old depth of occluders which have moved or disappeared. They are drawn again if still present
+    for (const OccluderHistory& history : historyOccluders_)
+    {
+        Drawable* drawable = history.drawable_;
+        if (!drawable || !drawable->IsEnabledEffective() || !drawable->IsOccluder() ||
+            drawable->GetWorldBoundingBox() != history.worldBoundingBox_)
+            InvalidateHistory(history.worldBoundingBox_);
+    }
+
+    // The depth of the other occluders is kept, even if they are not in the current occluder list. They must stay
+    // in the history, so that their depth is erased when they move
+    i32 oldSize = occluders.Size();
+    for (const OccluderHistory& history : historyOccluders_)
+    {
+        Drawable* drawable = history.drawable_;
+        if (drawable && drawable->IsEnabledEffective() && drawable->IsOccluder() &&
+            drawable->GetWorldBoundingBox() == history.worldBoundingBox_ && IsHistoryValid(history.worldBoundingBox_))
+            occluders.Push(history);
+    }
+
+    if (!Reproject())
+    {
+        occluders.Resize(oldSize);
+        return false;
+    }
+
+    return true;
+}
+
+bool OcclusionBuffer::Reproject()
+{
+    if (!buffer_ || !historyCamera_)
+        return false;
+
+    DV_PROFILE(ReprojectOcclusion);
+
+    Reset();
+
+    // Reprojection scatters the pixels of the previous frame to a separate buffer. It has a border of one pixel
+    // on the left and on the top, so that the scattering needs no bounds checks
+    int paddedWidth = width_ + 1;
+    int paddedHeight = height_ + 1;
+    if (!reprojectionBuffer_)
+        reprojectionBuffer_ = new int[paddedWidth * paddedHeight];
+
+    invalidHistoryRects_.Clear();
+
+    auto emptyValue = (int)OCCLUSION_Z_SCALE;
+    int* dest = reprojectionBuffer_.Get();
+    int count = paddedWidth * paddedHeight;
+
+    // Pixels which receive no history are marked with a negative value
+    while (count--)
+        *dest++ = -1;
+
+    // Transform from the pixel coordinates and integer depth of the previous frame to the homogeneous pixel coordinates
+    // and depth of the current frame
+    Matrix4 fromPixels(
+        1.0f / scaleX_, 0.0f, 0.0f, (1.0f - offsetX_) / scaleX_,
+        0.0f, 1.0f / scaleY_, 0.0f, (1.0f - offsetY_) / scaleY_,
+        0.0f, 0.0f, 1.0f / OCCLUSION_Z_SCALE, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f);
+    Matrix4 toPixels(
+        scaleX_, 0.0f, 0.0f, offsetX_,
+        0.0f, scaleY_, 0.0f, offsetY_,
+        0.0f, 0.0f, OCCLUSION_Z_SCALE, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f);
+    Matrix4 reprojection = toPixels * viewProj_ * historyViewProj_.Inverse() * fromPixels;
+
+    const int* src = buffer_.Get();
+    dest = reprojectionBuffer_.Get() + paddedWidth + 1;
+
+    // Store the depth of a point to the pixel on its upper left. The 2x2 pixels around the point receive it below,
+    // so that the pixels between neighbouring points are not left empty when the view moves by fractions of a pixel.
+    // When several points land on a pixel, keep the farthest
+    auto splat = [dest, paddedWidth](float left, float top, float depth)
+    {
+        // Rounds down also for negative values
+        int pixelX = (int)(left + 1.0f) - 1;
+        int pixelY = (int)(top + 1.0f) - 1;
+
+        int& pixel = dest[pixelY * paddedWidth + pixelX];
+        pixel = Max(pixel, CeilToIntPositive(depth));
+    };
+
+    const __m128i empty = _mm_set1_epi32(emptyValue);
+    const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 minCoord = _mm_set1_ps(-1.0f);
+    const __m128 maxX = _mm_set1_ps((float)width_);
+    const __m128 maxY = _mm_set1_ps((float)height_);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zScale = _mm_set1_ps(OCCLUSION_Z_SCALE);
+
+    for (int y = 0; y < height_; ++y)
+    {
+        const int* row = src + y * width_;
+        const int* upperRow = y > 0 ? row - width_ : row;
+        const int* lowerRow = y < height_ - 1 ? row + width_ : row;
+        Vector4 rowStart(
+            reprojection.m03_ + reprojection.m01_ * (float)y,
+            reprojection.m13_ + reprojection.m11_ * (float)y,
+            reprojection.m23_ + reprojection.m21_ * (float)y,
+            reprojection.m33_ + reprojection.m31_ * (float)y);
+
+        int x = 0;
+
+        for (; x + 4 <= width_; x += 4)
+        {
+            __m128i depth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            if (!_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(depth, empty))))
+                continue;
+
+            // Take the farthest depth of the pixel and its neighbours. This shrinks occluders by a pixel
+            // to compensate the growth caused by splatting
+            __m128i leftDepth = x > 0 ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1)) :
+                _mm_setr_epi32(row[0], row[0], row[1], row[2]);
+            __m128i rightDepth = x + 4 < width_ ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1)) :
+                _mm_setr_epi32(row[x + 1], row[x + 2], row[x + 3], row[x + 3]);
+            depth = MaxInt(depth, MaxInt(leftDepth, rightDepth));
+            depth = MaxInt(depth, MaxInt(_mm_loadu_si128(reinterpret_cast<const __m128i*>(upperRow + x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(lowerRow + x))));
+            __m128 valid = _mm_castsi128_ps(_mm_cmplt_epi32(depth, empty));
+            if (!_mm_movemask_ps(valid))
+                continue;
+
+            __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+            __m128 pixelZ = _mm_cvtepi32_ps(depth);
+            __m128 vertexX = _mm_add_ps(_mm_add_ps(_mm_set1_ps(rowStart.x_), _mm_mul_ps(_mm_set1_ps(reprojection.m00_), pixelX)),
+                _mm_mul_ps(_mm_set1_ps(reprojection.m02_), pixelZ));
+            __m128 vertexY = _mm_add_ps(_mm_add_ps(_mm_set1_ps(rowStart.y_), _mm_mul_ps(_mm_set1_ps(reprojection.m10_), pixelX)),
+                _mm_mul_ps(_mm_set1_ps(reprojection.m12_), pixelZ));
+            __m128 vertexZ = _mm_add_ps(_mm_add_ps(_mm_set1_ps(rowStart.z_), _mm_mul_ps(_mm_set1_ps(reprojection.m20_), pixelX)),
+                _mm_mul_ps(_mm_set1_ps(reprojection.m22_), pixelZ));
+            __m128 vertexW = _mm_add_ps(_mm_add_ps(_mm_set1_ps(rowStart.w_), _mm_mul_ps(_mm_set1_ps(reprojection.m30_), pixelX)),
+                _mm_mul_ps(_mm_set1_ps(reprojection.m32_), pixelZ));
+
+            // Skip points which are now behind the near plane or beyond the far plane
+            valid = _mm_and_ps(valid, _mm_cmpgt_ps(vertexW, _mm_setzero_ps()));
+            valid = _mm_and_ps(valid, _mm_cmpge_ps(vertexZ, _mm_setzero_ps()));
+            valid = _mm_and_ps(valid, _mm_cmple_ps(vertexZ, _mm_mul_ps(vertexW, zScale)));
+
+            __m128 invW = _mm_div_ps(one, vertexW);
+            __m128 left = _mm_sub_ps(_mm_mul_ps(vertexX, invW), one);
+            __m128 top = _mm_sub_ps(_mm_mul_ps(vertexY, invW), one);
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(left, minCoord), _mm_cmplt_ps(left, maxX)));
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(top, minCoord), _mm_cmplt_ps(top, maxY)));
+
+            unsigned mask = (unsigned)_mm_movemask_ps(valid);
+            if (!mask)
+                continue;
+
+            alignas(16) float lefts[4];
+            alignas(16) float tops[4];
+            alignas(16) float depths[4];
+            _mm_store_ps(lefts, left);
+            _mm_store_ps(tops, top);
+            _mm_store_ps(depths, _mm_mul_ps(vertexZ, invW));
+
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                if (mask & (1u << i))
+                    splat(lefts[i], tops[i], depths[i]);
+            }
+        }
+
+        // Buffers narrower than the SIMD width
+        for (; x < width_; ++x)
+        {
+            int depth = Max(row[x], Max(upperRow[x], lowerRow[x]));
+            if (x > 0)
+                depth = Max(depth, row[x - 1]);
+            if (x < width_ - 1)
+                depth = Max(depth, row[x + 1]);
+            if (depth >= emptyValue)
+                continue;
+
+            Vector4 vertex(
+                rowStart.x_ + reprojection.m00_ * (float)x + reprojection.m02_ * (float)depth,
+                rowStart.y_ + reprojection.m10_ * (float)x + reprojection.m12_ * (float)depth,
+                rowStart.z_ + reprojection.m20_ * (float)x + reprojection.m22_ * (float)depth,
+                rowStart.w_ + reprojection.m30_ * (float)x + reprojection.m32_ * (float)depth);
+            if (vertex.w_ <= 0.0f || vertex.z_ < 0.0f || vertex.z_ > vertex.w_ * OCCLUSION_Z_SCALE)
+                continue;
+
+            float invW = 1.0f / vertex.w_;
+            float left = vertex.x_ * invW - 1.0f;
+            float top = vertex.y_ * invW - 1.0f;
+            if (left >= -1.0f && top >= -1.0f && left < (float)width_ && top < (float)height_)
+                splat(left, top, vertex.z_ * invW);
+        }
+    }
+
+    // Each pixel receives the farthest depth of the points on its upper left, on its left, above and itself
+    for (int y = 0; y < height_; ++y)
+    {
+        const int* srcRow = dest + y * paddedWidth;
+        const int* upperRow = srcRow - paddedWidth;
+        int* destRow = buffer_.Get() + y * width_;
+        int x = 0;
+
+        for (; x + 4 <= width_; x += 4)
+        {
+            __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow + x));
+            __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow + x - 1));
+            __m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upperRow + x));
+            __m128i upperLeft = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upperRow + x - 1));
+            __m128i depth = MaxInt(MaxInt(current, left), MaxInt(upper, upperLeft));
+            __m128i none = _mm_cmplt_epi32(depth, _mm_setzero_si128());
+            depth = _mm_or_si128(_mm_and_si128(none, empty), _mm_andnot_si128(none, depth));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destRow + x), depth);
+        }
+
+        for (; x < width_; ++x)
+        {
+            int depth = Max(Max(srcRow[x], srcRow[x - 1]), Max(upperRow[x], upperRow[x - 1]));
+            destRow[x] = depth >= 0 ? depth : emptyValue;
+        }
+    }
+
+    depthHierarchyDirty_ = true;
+    ++historyAge_;
+    return true;
+}
+
+void OcclusionBuffer::ResetHistory()
+{
+    reprojectionBuffer_.Reset();
+    historyOccluders_.Clear();
+    invalidHistoryRects_.Clear();
+    historyCamera_.Reset();
+    historyAge_ = 0;
+}
+
 void OcclusionBuffer::ResetUseTimer()
 {
     useTimer_.Reset();
@@ -322,7 +696,7 @@ void OcclusionBuffer::ResetUseTimer()
 
 bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
 {
-    if (buffers_.Empty())
+    if (!buffer_)
         return true;
 
     // Transform corners to projection space
@@ -424,8 +798,8 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
     }
 
     // If no conclusive result, finally check the pixel-level data
-    int* row = buffers_[0].data_ + rect.top_ * width_;
-    int* endRow = buffers_[0].data_ + rect.bottom_ * width_;
+    int* row = buffer_.Get() + rect.top_ * width_;
+    int* endRow = buffer_.Get() + rect.bottom_ * width_;
     while (row <= endRow)
     {
         int* src = row + rect.left_;
@@ -447,22 +821,15 @@ unsigned OcclusionBuffer::GetUseTimer()
     return useTimer_.GetMSec(false);
 }
 
-
 void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, i32 threadIndex)
 {
-    assert(threadIndex >= 0);
+    DV_PROFILE(DrawOcclusionBatch);
 
-    // If buffer not yet used, clear it
-    if (threadIndex > 0 && !buffers_[threadIndex].used_)
-    {
-        ClearBuffer(threadIndex);
-        buffers_[threadIndex].used_ = true;
-    }
+    assert(threadIndex >= 0);
 
     Matrix4 modelViewProj = viewProj_ * batch.model_;
-
-    // Theoretical max. amount of vertices if each of the 6 clipping planes doubles the triangle count
-    Vector4 vertices[64 * 3];
+    OcclusionBufferData& data = threadData_[threadIndex];
+    Vector4* vertices = data.clippedVertices_.Buffer();
 
     if (!batch.indexData_)
     {
@@ -485,47 +852,96 @@ void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, i32 threadIndex)
     }
     else
     {
-        const auto* srcData = (const unsigned char*)batch.vertexData_;
-
-        // 16-bit indices
-        if (batch.indexSize_ == sizeof(unsigned short))
+        // Vertices are shared by triangles, so transform each used vertex once
+        auto drawIndexed = [&](const auto* indices)
         {
-            const unsigned short* indices = ((const unsigned short*)batch.indexData_) + batch.drawStart_;
-            const unsigned short* indicesEnd = indices + batch.drawCount_;
+            const auto* indicesEnd = indices + batch.drawCount_;
 
-            while (indices < indicesEnd)
+            unsigned minIndex = M_MAX_UNSIGNED;
+            unsigned maxIndex = 0;
+            for (const auto* i = indices; i < indicesEnd; ++i)
             {
-                const Vector3& v0 = *((const Vector3*)(&srcData[indices[0] * batch.vertexSize_]));
-                const Vector3& v1 = *((const Vector3*)(&srcData[indices[1] * batch.vertexSize_]));
-                const Vector3& v2 = *((const Vector3*)(&srcData[indices[2] * batch.vertexSize_]));
+                minIndex = Min(minIndex, (unsigned)*i);
+                maxIndex = Max(maxIndex, (unsigned)*i);
+            }
 
-                vertices[0] = ModelTransform(modelViewProj, v0);
-                vertices[1] = ModelTransform(modelViewProj, v1);
-                vertices[2] = ModelTransform(modelViewProj, v2);
-                DrawTriangle(vertices, threadIndex);
+            if (minIndex > maxIndex)
+                return;
 
-                indices += 3;
+            i32 numVertices = (i32)(maxIndex - minIndex + 1);
+            if (data.clipVertices_.Size() < numVertices)
+            {
+                data.clipVertices_.Resize(numVertices);
+                data.screenVertices_.Resize(numVertices);
+                data.clipMasks_.Resize(numVertices);
             }
-        }
-        else
-        {
-            const unsigned* indices = ((const unsigned*)batch.indexData_) + batch.drawStart_;
-            const unsigned* indicesEnd = indices + batch.drawCount_;
 
-            while (indices < indicesEnd)
+            // Transform, clip plane test and viewport transform of 4 components at once
+            __m128 column0 = _mm_setr_ps(modelViewProj.m00_, modelViewProj.m10_, modelViewProj.m20_, modelViewProj.m30_);
+            __m128 column1 = _mm_setr_ps(modelViewProj.m01_, modelViewProj.m11_, modelViewProj.m21_, modelViewProj.m31_);
+            __m128 column2 = _mm_setr_ps(modelViewProj.m02_, modelViewProj.m12_, modelViewProj.m22_, modelViewProj.m32_);
+            __m128 column3 = _mm_setr_ps(modelViewProj.m03_, modelViewProj.m13_, modelViewProj.m23_, modelViewProj.m33_);
+            __m128 posPlanes = _mm_setr_ps(OCCLUSION_GUARD_BAND, OCCLUSION_GUARD_BAND, 1.0f, 0.0f);
+            __m128 negPlanes = _mm_setr_ps(-OCCLUSION_GUARD_BAND, -OCCLUSION_GUARD_BAND, 0.0f, 0.0f);
+            __m128 viewportScale = _mm_setr_ps(scaleX_, scaleY_, OCCLUSION_Z_SCALE, 0.0f);
+            __m128 viewportOffset = _mm_setr_ps(offsetX_, offsetY_, 0.0f, 0.0f);
+
+            const unsigned char* srcData = ((const unsigned char*)batch.vertexData_) + minIndex * batch.vertexSize_;
+            for (i32 i = 0; i < numVertices; ++i)
             {
-                const Vector3& v0 = *((const Vector3*)(&srcData[indices[0] * batch.vertexSize_]));
-                const Vector3& v1 = *((const Vector3*)(&srcData[indices[1] * batch.vertexSize_]));
-                const Vector3& v2 = *((const Vector3*)(&srcData[indices[2] * batch.vertexSize_]));
+                const Vector3& position = *((const Vector3*)(&srcData[i * batch.vertexSize_]));
+                __m128 vertex = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(position.x_)), _mm_mul_ps(column1, _mm_set1_ps(position.y_))),
+                    _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(position.z_)), column3));
+                __m128 w = _mm_shuffle_ps(vertex, vertex, _MM_SHUFFLE(3, 3, 3, 3));
+
+                unsigned clipMask = (_mm_movemask_ps(_mm_cmpgt_ps(vertex, _mm_mul_ps(w, posPlanes))) & 0x7u) |
+                    ((_mm_movemask_ps(_mm_cmplt_ps(vertex, _mm_mul_ps(w, negPlanes))) & 0x7u) << 3u);
 
-                vertices[0] = ModelTransform(modelViewProj, v0);
-                vertices[1] = ModelTransform(modelViewProj, v1);
-                vertices[2] = ModelTransform(modelViewProj, v2);
-                DrawTriangle(vertices, threadIndex);
+                _mm_storeu_ps(&data.clipVertices_[i].x_, vertex);
+                data.clipMasks_[i] = (u8)clipMask;
 
+                if (!clipMask)
+                {
+                    __m128 projected = _mm_add_ps(_mm_mul_ps(_mm_div_ps(vertex, w), viewportScale), viewportOffset);
+                    Vector3& dest = data.screenVertices_[i];
+                    _mm_storel_pi(reinterpret_cast<__m64*>(&dest.x_), projected);
+                    _mm_store_ss(&dest.z_, _mm_movehl_ps(projected, projected));
+                }
+            }
+
+            while (indices < indicesEnd)
+            {
+                unsigned i0 = indices[0] - minIndex;
+                unsigned i1 = indices[1] - minIndex;
+                unsigned i2 = indices[2] - minIndex;
                 indices += 3;
+
+                // If triangle is fully behind any clip plane, can reject quickly
+                if (data.clipMasks_[i0] & data.clipMasks_[i1] & data.clipMasks_[i2])
+                    continue;
+
+                if (data.clipMasks_[i0] | data.clipMasks_[i1] | data.clipMasks_[i2])
+                {
+                    vertices[0] = data.clipVertices_[i0];
+                    vertices[1] = data.clipVertices_[i1];
+                    vertices[2] = data.clipVertices_[i2];
+                    DrawTriangle(vertices, threadIndex);
+                    continue;
+                }
+
+                Vector3 projected[3] = {data.screenVertices_[i0], data.screenVertices_[i1], data.screenVertices_[i2]};
+                if (!IsCulled(projected) && DrawTriangle2D(projected, threadIndex))
+                    ++numTriangles_;
             }
-        }
+        };
+
+        const unsigned char* indexData = ((const unsigned char*)batch.indexData_) + batch.drawStart_ * batch.indexSize_;
+
+        if (batch.indexSize_ == sizeof(unsigned short))
+            drawIndexed((const unsigned short*)indexData);
+        else
+            drawIndexed((const unsigned*)indexData);
     }
 }
 
@@ -564,6 +980,15 @@ inline float OcclusionBuffer::SignedArea(const Vector3& v0, const Vector3& v1, c
     return aX * bY - aY * bX;
 }
 
+inline bool OcclusionBuffer::IsCulled(const Vector3* projected) const
+{
+    if (cullMode_ == CULL_NONE)
+        return false;
+
+    bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
+    return cullMode_ == CULL_CCW ? !clockwise : clockwise;
+}
+
 void OcclusionBuffer::CalculateViewport()
 {
     // Add half pixel offset due to 3D frustum culling
@@ -575,6 +1000,33 @@ void OcclusionBuffer::CalculateViewport()
     projOffsetScaleY_ = projection_.m11_ * scaleY_;
 }
 
+IntRect OcclusionBuffer::GetHistoryRect(const BoundingBox& worldSpaceBox) const
+{
+    IntRect fullRect(0, 0, width_ - 1, height_ - 1);
+    float minX = M_INFINITY, maxX = -M_INFINITY, minY = M_INFINITY, maxY = -M_INFINITY;
+
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        Vector3 corner(i & 1u ? worldSpaceBox.max_.x_ : worldSpaceBox.min_.x_, i & 2u ? worldSpaceBox.max_.y_ : worldSpaceBox.min_.y_,
+            i & 4u ? worldSpaceBox.max_.z_ : worldSpaceBox.min_.z_);
+        Vector4 vertex = ModelTransform(historyViewProj_, corner);
+
+        // If the box crosses the near plane, its projection is unbounded
+        if (vertex.w_ <= 0.0f)
+            return fullRect;
+
+        Vector3 projected = ViewportTransform(vertex);
+        minX = Min(minX, projected.x_);
+        maxX = Max(maxX, projected.x_);
+        minY = Min(minY, projected.y_);
+        maxY = Max(maxY, projected.y_);
+    }
+
+    // Expand by a pixel in each direction like IsVisible() does
+    return IntRect((int)Clamp(minX - 1.5f, 0.0f, (float)fullRect.right_), (int)Clamp(minY - 1.5f, 0.0f, (float)fullRect.bottom_),
+        (int)Clamp(maxX + 0.5f, 0.0f, (float)fullRect.right_), (int)Clamp(maxY + 0.5f, 0.0f, (float)fullRect.bottom_));
+}
+
 void OcclusionBuffer::DrawTriangle(Vector4* vertices, i32 threadIndex)
 {
     assert(threadIndex >= 0);
@@ -587,21 +1039,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, i32 threadIndex)
     // Build the clip plane mask for the triangle
     for (unsigned i = 0; i < 3; ++i)
     {
-        ClipMaskFlags vertexClipMask{};
-
-        if (vertices[i].x_ > vertices[i].w_)
-            vertexClipMask |= CLIPMASK_X_POS;
-        if (vertices[i].x_ < -vertices[i].w_)
-            vertexClipMask |= CLIPMASK_X_NEG;
-        if (vertices[i].y_ > vertices[i].w_)
-            vertexClipMask |= CLIPMASK_Y_POS;
-        if (vertices[i].y_ < -vertices[i].w_)
-            vertexClipMask |= CLIPMASK_Y_NEG;
-        if (vertices[i].z_ > vertices[i].w_)
-            vertexClipMask |= CLIPMASK_Z_POS;
-        if (vertices[i].z_ < 0.0f)
-            vertexClipMask |= CLIPMASK_Z_NEG;
-
+        ClipMaskFlags vertexClipMask = GetClipMask(vertices[i]);
         clipMask |= vertexClipMask;
 
         if (!i)
@@ -621,12 +1059,8 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, i32 threadIndex)
         projected[1] = ViewportTransform(vertices[1]);
         projected[2] = ViewportTransform(vertices[2]);
 
-        bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
-        if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
-        {
-            DrawTriangle2D(projected, clockwise, threadIndex);
-            drawOk = true;
-        }
+        if (!IsCulled(projected))
+            drawOk = DrawTriangle2D(projected, threadIndex);
     }
     else
     {
@@ -637,13 +1071,13 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, i32 threadIndex)
         unsigned numTriangles = 1;
 
         if (clipMask & CLIPMASK_X_POS)
-            ClipVertices(Vector4(-1.0f, 0.0f, 0.0f, 1.0f), vertices, triangles, numTriangles);
+            ClipVertices(Vector4(-1.0f, 0.0f, 0.0f, OCCLUSION_GUARD_BAND), vertices, triangles, numTriangles);
         if (clipMask & CLIPMASK_X_NEG)
-            ClipVertices(Vector4(1.0f, 0.0f, 0.0f, 1.0f), vertices, triangles, numTriangles);
+            ClipVertices(Vector4(1.0f, 0.0f, 0.0f, OCCLUSION_GUARD_BAND), vertices, triangles, numTriangles);
         if (clipMask & CLIPMASK_Y_POS)
-            ClipVertices(Vector4(0.0f, -1.0f, 0.0f, 1.0f), vertices, triangles, numTriangles);
+            ClipVertices(Vector4(0.0f, -1.0f, 0.0f, OCCLUSION_GUARD_BAND), vertices, triangles, numTriangles);
         if (clipMask & CLIPMASK_Y_NEG)
-            ClipVertices(Vector4(0.0f, 1.0f, 0.0f, 1.0f), vertices, triangles, numTriangles);
+            ClipVertices(Vector4(0.0f, 1.0f, 0.0f, OCCLUSION_GUARD_BAND), vertices, triangles, numTriangles);
         if (clipMask & CLIPMASK_Z_POS)
             ClipVertices(Vector4(0.0f, 0.0f, -1.0f, 1.0f), vertices, triangles, numTriangles);
         if (clipMask & CLIPMASK_Z_NEG)
@@ -659,12 +1093,8 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, i32 threadIndex)
                 projected[1] = ViewportTransform(vertices[index + 1]);
                 projected[2] = ViewportTransform(vertices[index + 2]);
 
-                bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
-                if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
-                {
-                    DrawTriangle2D(projected, clockwise, threadIndex);
+                if (!IsCulled(projected) && DrawTriangle2D(projected, threadIndex))
                     drawOk = true;
-                }
             }
         }
     }
@@ -743,294 +1173,234 @@ void OcclusionBuffer::ClipVertices(const Vector4& plane, Vector4* vertices, bool
     }
 }
 
-// Code based on Chris Hecker's Perspective Texture Mapping series in the Game Developer magazine
-// Also available online at http://chrishecker.com/Miscellaneous_Technical_Articles
+bool OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, i32 threadIndex)
+{
+    assert(threadIndex >= 0);
+
+    OcclusionTriangle triangle;
+    if (!SetupTriangle(vertices, triangle))
+        return false;
+
+    if (threaded_)
+        BinTriangle(triangle, threadIndex);
+    else
+        RasterizeTriangle(triangle, triangle.rect_);
+
+    return true;
+}
 
-/// %Gradients of a software rasterized triangle.
-struct Gradients
+bool OcclusionBuffer::SetupTriangle(const Vector3* vertices, OcclusionTriangle& triangle) const
 {
-    /// Construct from vertices.
-    explicit Gradients(const Vector3* vertices)
-    {
-        float invdX = 1.0f / (((vertices[1].x_ - vertices[2].x_) *
-                               (vertices[0].y_ - vertices[2].y_)) -
-                              ((vertices[0].x_ - vertices[2].x_) *
-                               (vertices[1].y_ - vertices[2].y_)));
+    const Vector3& v0 = vertices[0];
+    const Vector3& v1 = vertices[1];
+    const Vector3& v2 = vertices[2];
 
-        float invdY = -invdX;
+    float minX = Min(Min(v0.x_, v1.x_), v2.x_);
+    float minY = Min(Min(v0.y_, v1.y_), v2.y_);
+    float maxX = Max(Max(v0.x_, v1.x_), v2.x_);
+    float maxY = Max(Max(v0.y_, v1.y_), v2.y_);
 
-        dInvZdX_ = invdX * (((vertices[1].z_ - vertices[2].z_) * (vertices[0].y_ - vertices[2].y_)) -
-                            ((vertices[0].z_ - vertices[2].z_) * (vertices[1].y_ - vertices[2].y_)));
+    if (maxX < 1.0f || maxY < 1.0f || minX > (float)width_ || minY > (float)height_)
+        return false;
 
-        dInvZdY_ = invdY * (((vertices[1].z_ - vertices[2].z_) * (vertices[0].x_ - vertices[2].x_)) -
-                            ((vertices[0].z_ - vertices[2].z_) * (vertices[1].x_ - vertices[2].x_)));
+    // Pixel (x, y) is sampled at (x + 1, y + 1), which is its center because of the half pixel offset of the viewport.
+    // Small triangles often cover no samples, so reject them before the rest of the setup
+    IntRect rect(
+        CeilToIntPositive(Max(minX, 1.0f)) - 1,
+        CeilToIntPositive(Max(minY, 1.0f)) - 1,
+        (int)Min(maxX, (float)width_) - 1,
+        (int)Min(maxY, (float)height_) - 1
+    );
 
-        dInvZdXInt_ = (int)dInvZdX_;
-    }
+    if (rect.left_ > rect.right_ || rect.top_ > rect.bottom_)
+        return false;
 
-    /// Integer horizontal gradient.
-    int dInvZdXInt_;
-    /// Horizontal gradient.
-    float dInvZdX_;
-    /// Vertical gradient.
-    float dInvZdY_;
-};
+    // Twice the signed area
+    float area = (v1.x_ - v0.x_) * (v2.y_ - v0.y_) - (v2.x_ - v0.x_) * (v1.y_ - v0.y_);
+    if (area == 0.0f)
+        return false;
 
-/// %Edge of a software rasterized triangle.
-struct Edge
-{
-    /// Construct from gradients and top & bottom vertices.
-    Edge(const Gradients& gradients, const Vector3& top, const Vector3& bottom, int topY)
+    triangle.rect_ = rect;
+
+    // Horizontal edges do not need bounds, because the bounding rectangle already cuts the rows
+    i32 numLeft = 0;
+    i32 numRight = 0;
+    for (i32 i = 0; i < 3; ++i)
     {
-        float height = (bottom.y_ - top.y_);
-        float slope = (height != 0.0f) ? (bottom.x_ - top.x_) / height : 0.0f;
-        float yPreStep = (float)(topY + 1) - top.y_;
-        float xPreStep = slope * yPreStep;
-
-        x_ = RoundToInt((xPreStep + top.x_) * OCCLUSION_X_SCALE);
-        xStep_ = RoundToInt(slope * OCCLUSION_X_SCALE);
-        invZ_ = RoundToInt(top.z_ + xPreStep * gradients.dInvZdX_ + yPreStep * gradients.dInvZdY_);
-        invZStep_ = RoundToInt(slope * gradients.dInvZdX_ + gradients.dInvZdY_);
+        const Vector3& start = vertices[i];
+        const Vector3& end = vertices[i < 2 ? i + 1 : 0];
+        float dy = end.y_ - start.y_;
+        if (dy == 0.0f)
+            continue;
+
+        // Inside of the edge is on the left or on the right depending on the winding
+        OcclusionEdge& edge = (dy > 0.0f) == (area > 0.0f) ? triangle.rightEdges_[numRight++] : triangle.leftEdges_[numLeft++];
+        edge.x_ = start.x_ - 1.0f;
+        edge.y_ = start.y_ - 1.0f;
+        edge.slope_ = (end.x_ - start.x_) / dy;
     }
 
-    /// X coordinate.
-    int x_;
-    /// X coordinate step.
-    int xStep_;
-    /// Inverse Z.
-    int invZ_;
-    /// Inverse Z step.
-    int invZStep_;
-};
+    for (; numLeft < 2; ++numLeft)
+        triangle.leftEdges_[numLeft] = {-M_LARGE_VALUE, 0.0f, 0.0f};
+    for (; numRight < 2; ++numRight)
+        triangle.rightEdges_[numRight] = {M_LARGE_VALUE, 0.0f, 0.0f};
+
+    // Depth is linear in screen space
+    float invArea = 1.0f / area;
+    triangle.depthX_ = v0.x_ - 1.0f;
+    triangle.depthY_ = v0.y_ - 1.0f;
+    triangle.depth_ = v0.z_;
+    triangle.depthGradientX_ = ((v1.z_ - v0.z_) * (v2.y_ - v0.y_) - (v2.z_ - v0.z_) * (v1.y_ - v0.y_)) * invArea;
+    triangle.depthGradientY_ = ((v1.x_ - v0.x_) * (v2.z_ - v0.z_) - (v2.x_ - v0.x_) * (v1.z_ - v0.z_)) * invArea;
 
-void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, i32 threadIndex)
+    return true;
+}
+
+void OcclusionBuffer::BinTriangle(const OcclusionTriangle& triangle, i32 threadIndex)
 {
-    assert(threadIndex >= 0);
+    OcclusionBufferData& data = threadData_[threadIndex];
+    data.triangles_.Push(triangle);
 
-    int top, middle, bottom;
-    bool middleIsRight;
+    const IntRect& rect = triangle.rect_;
+    i32 index = data.triangles_.Size() - 1;
+    int firstTileX = rect.left_ / OCCLUSION_TILE_WIDTH;
+    int lastTileX = rect.right_ / OCCLUSION_TILE_WIDTH;
+    int firstTileY = rect.top_ / OCCLUSION_TILE_HEIGHT;
+    int lastTileY = rect.bottom_ / OCCLUSION_TILE_HEIGHT;
 
-    // Sort vertices in Y-direction
-    if (vertices[0].y_ < vertices[1].y_)
+    if (firstTileX == lastTileX && firstTileY == lastTileY)
     {
-        if (vertices[2].y_ < vertices[0].y_)
-        {
-            top = 2;
-            middle = 0;
-            bottom = 1;
-            middleIsRight = true;
-        }
-        else
-        {
-            top = 0;
-            if (vertices[1].y_ < vertices[2].y_)
-            {
-                middle = 1;
-                bottom = 2;
-                middleIsRight = true;
-            }
-            else
-            {
-                middle = 2;
-                bottom = 1;
-                middleIsRight = false;
-            }
-        }
+        data.tileTriangles_[firstTileY * numTilesX_ + firstTileX].Push(index);
+        return;
     }
-    else
+
+    for (int tileY = firstTileY; tileY <= lastTileY; ++tileY)
     {
-        if (vertices[2].y_ < vertices[1].y_)
-        {
-            top = 2;
-            middle = 1;
-            bottom = 0;
-            middleIsRight = false;
-        }
-        else
+        float top = (float)(tileY * OCCLUSION_TILE_HEIGHT);
+        float bottom = top + (float)(OCCLUSION_TILE_HEIGHT - 1);
+
+        for (int tileX = firstTileX; tileX <= lastTileX; ++tileX)
         {
-            top = 1;
-            if (vertices[0].y_ < vertices[2].y_)
+            float left = (float)(tileX * OCCLUSION_TILE_WIDTH);
+            float right = left + (float)(OCCLUSION_TILE_WIDTH - 1);
+
+            // Skip the tile if all of its rows are outside of any edge
+            bool outside = false;
+            for (const OcclusionEdge& edge : triangle.leftEdges_)
             {
-                middle = 0;
-                bottom = 2;
-                middleIsRight = false;
+                if (edge.GetX(edge.slope_ > 0.0f ? top : bottom) > right)
+                    outside = true;
             }
-            else
+            for (const OcclusionEdge& edge : triangle.rightEdges_)
             {
-                middle = 2;
-                bottom = 0;
-                middleIsRight = true;
+                if (edge.GetX(edge.slope_ > 0.0f ? bottom : top) < left)
+                    outside = true;
             }
+
+            if (!outside)
+                data.tileTriangles_[tileY * numTilesX_ + tileX].Push(index);
         }
     }
+}
 
-    auto topY = (int)vertices[top].y_;
-    auto middleY = (int)vertices[middle].y_;
-    auto bottomY = (int)vertices[bottom].y_;
-
-    // Check for degenerate triangle
-    if (topY == bottomY)
-        return;
+/// Write depth to 4 pixels of a row, if they are inside the span and closer.
+static inline void WritePixels(int* dest, __m128i x, __m128i spanFirst, __m128i spanLast, __m128 depth)
+{
+    __m128i inside = _mm_and_si128(_mm_cmpgt_epi32(x, spanFirst), _mm_cmplt_epi32(x, spanLast));
+    __m128i intDepth = _mm_cvtps_epi32(depth);
+    __m128i old = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest));
+    __m128i write = _mm_and_si128(inside, _mm_cmplt_epi32(intDepth, old));
+    __m128i result = _mm_or_si128(_mm_and_si128(write, intDepth), _mm_andnot_si128(write, old));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), result);
+}
 
-    // Reverse middleIsRight test if triangle is counterclockwise
-    if (!clockwise)
-        middleIsRight = !middleIsRight;
+// Coverage is found from the row spans instead of evaluating the three edge functions for each block. The span bounds
+// are the edge functions solved for x once per row, so a block needs two integer comparisons per 4 pixels instead of
+// three additions and three comparisons, and the blocks outside the triangle are never visited. Edge function masks
+// were measured 20-30% slower with the OcclusionBuffer benchmark
+void OcclusionBuffer::RasterizeTriangle(const OcclusionTriangle& triangle, const IntRect& clipRect)
+{
+    const OcclusionEdge* leftEdges = triangle.leftEdges_;
+    const OcclusionEdge* rightEdges = triangle.rightEdges_;
+    float left = (float)Max(triangle.rect_.left_, clipRect.left_);
+    float right = (float)Min(triangle.rect_.right_, clipRect.right_);
+    int top = Max(triangle.rect_.top_, clipRect.top_);
+    int bottom = Min(triangle.rect_.bottom_, clipRect.bottom_);
+
+    // Width is a power of two, so rows of wide enough buffers consist of whole blocks
+    bool useSimd = width_ >= OCCLUSION_SIMD_WIDTH;
+    const __m128i laneOffsets = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i four = _mm_set1_epi32(4);
+
+    // Depth of the pixels in a block relative to the first pixel
+    float gradientX = triangle.depthGradientX_;
+    __m128 laneDepths = _mm_setr_ps(0.0f, gradientX, 2.0f * gradientX, 3.0f * gradientX);
+    __m128 laneDepths4 = _mm_add_ps(laneDepths, _mm_set1_ps(4.0f * gradientX));
+    __m128 blockDepthStep = _mm_set1_ps(8.0f * gradientX);
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        float fy = (float)y;
+        float spanLeft = Max(Max(left, leftEdges[0].GetX(fy)), leftEdges[1].GetX(fy));
+        float spanRight = Min(Min(right, rightEdges[0].GetX(fy)), rightEdges[1].GetX(fy));
 
-    const bool topDegenerate = topY == middleY;
-    const bool bottomDegenerate = middleY == bottomY;
+        if (spanLeft > spanRight)
+            continue;
 
-    Gradients gradients(vertices);
-    Edge topToBottom(gradients, vertices[top], vertices[bottom], topY);
+        // Pixels with x in [first, last]. The span is not negative, so the conversion truncates to floor
+        int first = CeilToIntPositive(spanLeft);
+        int last = (int)spanRight;
+        if (first > last)
+            continue;
 
-    int* bufferData = buffers_[threadIndex].data_;
+        int* row = buffer_.Get() + y * width_;
+        float depthRow = triangle.depth_ + triangle.depthGradientY_ * (fy - triangle.depthY_);
 
-    if (middleIsRight)
-    {
-        // Top half
-        if (!topDegenerate)
+        if (useSimd)
         {
-            Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-            int* row = bufferData + topY * width_;
-            int* endRow = bufferData + middleY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToBottom.invZ_;
-                int* dest = row + (topToBottom.x_ >> 16u);
-                int* end = row + (topToMiddle.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
+            __m128i spanFirst = _mm_set1_epi32(first - 1);
+            __m128i spanLast = _mm_set1_epi32(last + 1);
 
-                topToBottom.x_ += topToBottom.xStep_;
-                topToBottom.invZ_ += topToBottom.invZStep_;
-                topToMiddle.x_ += topToMiddle.xStep_;
-                row += width_;
-            }
-        }
-
-        // Bottom half
-        if (!bottomDegenerate)
-        {
-            Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-            int* row = bufferData + middleY * width_;
-            int* endRow = bufferData + bottomY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToBottom.invZ_;
-                int* dest = row + (topToBottom.x_ >> 16u);
-                int* end = row + (middleToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
+            // Blocks are aligned, so they do not cross the border of a tile or a row
+            int x = first & ~(OCCLUSION_SIMD_WIDTH - 1);
+            __m128 blockDepth = _mm_set1_ps(depthRow + gradientX * ((float)x - triangle.depthX_));
 
-                topToBottom.x_ += topToBottom.xStep_;
-                topToBottom.invZ_ += topToBottom.invZStep_;
-                middleToBottom.x_ += middleToBottom.xStep_;
-                row += width_;
-            }
-        }
-    }
-    else
-    {
-        // Top half
-        if (!topDegenerate)
-        {
-            Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-            int* row = bufferData + topY * width_;
-            int* endRow = bufferData + middleY * width_;
-            while (row < endRow)
+            for (; x <= last; x += OCCLUSION_SIMD_WIDTH)
             {
-                int invZ = topToMiddle.invZ_;
-                int* dest = row + (topToMiddle.x_ >> 16u);
-                int* end = row + (topToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                topToMiddle.x_ += topToMiddle.xStep_;
-                topToMiddle.invZ_ += topToMiddle.invZStep_;
-                topToBottom.x_ += topToBottom.xStep_;
-                row += width_;
+                __m128i xVec = _mm_add_epi32(_mm_set1_epi32(x), laneOffsets);
+                WritePixels(row + x, xVec, spanFirst, spanLast, _mm_add_ps(blockDepth, laneDepths));
+                WritePixels(row + x + 4, _mm_add_epi32(xVec, four), spanFirst, spanLast, _mm_add_ps(blockDepth, laneDepths4));
+                blockDepth = _mm_add_ps(blockDepth, blockDepthStep);
             }
         }
-
-        // Bottom half
-        if (!bottomDegenerate)
+        else
         {
-            Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-            int* row = bufferData + middleY * width_;
-            int* endRow = bufferData + bottomY * width_;
-            while (row < endRow)
+            for (int x = first; x <= last; ++x)
             {
-                int invZ = middleToBottom.invZ_;
-                int* dest = row + (middleToBottom.x_ >> 16u);
-                int* end = row + (topToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                middleToBottom.x_ += middleToBottom.xStep_;
-                middleToBottom.invZ_ += middleToBottom.invZStep_;
-                topToBottom.x_ += topToBottom.xStep_;
-                row += width_;
+                int depth = RoundToInt(gradientX * ((float)x - triangle.depthX_) + depthRow);
+                if (depth < row[x])
+                    row[x] = depth;
             }
         }
     }
 }
 
-void OcclusionBuffer::MergeBuffers()
+void OcclusionBuffer::RasterizeTile(i32 tileIndex)
 {
-    DV_PROFILE(MergeBuffers);
+    int tileLeft = (tileIndex % numTilesX_) * OCCLUSION_TILE_WIDTH;
+    int tileTop = (tileIndex / numTilesX_) * OCCLUSION_TILE_HEIGHT;
+    IntRect tileRect(tileLeft, tileTop, Min(tileLeft + OCCLUSION_TILE_WIDTH, width_) - 1,
+        Min(tileTop + OCCLUSION_TILE_HEIGHT, height_) - 1);
 
-    for (i32 i = 1; i < buffers_.Size(); ++i)
+    for (OcclusionBufferData& data : threadData_)
     {
-        if (!buffers_[i].used_)
-            continue;
+        Vector<i32>& tileTriangles = data.tileTriangles_[tileIndex];
 
-        int* src = buffers_[i].data_;
-        int* dest = buffers_[0].data_;
-        int count = width_ * height_;
+        for (i32 index : tileTriangles)
+            RasterizeTriangle(data.triangles_[index], tileRect);
 
-        while (count--)
-        {
-            // If thread buffer's depth value is closer, overwrite the original
-            if (*src < *dest)
-                *dest = *src;
-            ++src;
-            ++dest;
-        }
+        tileTriangles.Clear();
     }
 }
 
-void OcclusionBuffer::ClearBuffer(i32 threadIndex)
-{
-    assert(threadIndex >= 0);
-
-    if (threadIndex >= buffers_.Size())
-        return;
-
-    int* dest = buffers_[threadIndex].data_;
-    int count = width_ * height_;
-    auto fillValue = (int)OCCLUSION_Z_SCALE;
-
-    while (count--)
-        *dest++ = fillValue;
-}
-
 }
@@ -10,18 +10,18 @@
 #include "../core/timer.h"
 #include "../containers/array_ptr.h"
 #include "../graphics_api/graphics_defs.h"
+#include "../math/bounding_box.h"
 #include "../math/frustum.h"
+#include "../math/rect.h"
 
 namespace dviglo
 {
 
-class BoundingBox;
 class Camera;
+class Drawable;
 class IndexBuffer;
-class IntRect;
+class TaskGraph;
 class VertexBuffer;
-struct Edge;
-struct Gradients;
 
 /// Occlusion hierarchy depth value.
 struct DepthValue
@@ -32,15 +32,56 @@ struct DepthValue
     int max_;
 };
 
+/// Edge of a triangle prepared for rasterization. Bounds the pixels of a row from the left or from the right.
+struct OcclusionEdge
+{
+    /// Return the bound on a row.
+    float GetX(float y) const { return x_ + slope_ * (y - y_); }
+
+    /// Bound on the starting row.
+    float x_;
+    /// Starting row.
+    float y_;
+    /// Change of the bound per row.
+    float slope_;
+};
+
+/// Triangle prepared for rasterization. Coordinates are in pixels.
+struct OcclusionTriangle
+{
+    /// Left bounds. Unused edges are far to the left.
+    OcclusionEdge leftEdges_[2];
+    /// Right bounds. Unused edges are far to the right.
+    OcclusionEdge rightEdges_[2];
+    /// Pixel x of the depth origin.
+    float depthX_;
+    /// Pixel y of the depth origin.
+    float depthY_;
+    /// Depth at the origin.
+    float depth_;
+    /// Change of depth per pixel in x direction.
+    float depthGradientX_;
+    /// Change of depth per pixel in y direction.
+    float depthGradientY_;
+    /// Bounding rectangle in pixels, inclusive.
+    IntRect rect_;
+};
+
 /// Per-thread occlusion buffer data.
 struct OcclusionBufferData
 {
-    /// Full buffer data with safety padding.
-    SharedArrayPtr<int> dataWithSafety_;
-    /// Buffer data.
-    int* data_;
-    /// Use flag.
-    bool used_;
+    /// Vertices of the current batch in clip space.
+    Vector<Vector4> clipVertices_;
+    /// Vertices of the current batch in screen space. Valid only for vertices inside the view frustum.
+    Vector<Vector3> screenVertices_;
+    /// Clip plane masks of the vertices of the current batch.
+    Vector<u8> clipMasks_;
+    /// Vertices of the triangle being clipped. Allocated once, because clipping may need many of them.
+    Vector<Vector4> clippedVertices_;
+    /// Triangles set up by the thread.
+    Vector<OcclusionTriangle> triangles_;
+    /// Indices of the triangles which overlap each tile.
+    Vector<Vector<i32>> tileTriangles_;
 };
 
 /// Stored occlusion render job.
@@ -62,6 +103,15 @@ struct OcclusionBatch
     unsigned drawCount_;
 };
 
+/// Occluder whose depth is kept in the occlusion buffer history.
+struct OccluderHistory
+{
+    /// Occluder.
+    WeakPtr<Drawable> drawable_;
+    /// World space bounding box at the time of drawing.
+    BoundingBox worldBoundingBox_;
+};
+
 /// Software renderer for occlusion.
 class DV_API OcclusionBuffer : public Object
 {
@@ -73,7 +123,7 @@ public:
     /// Destruct.
     ~OcclusionBuffer() override;
 
-    /// Set occlusion buffer size and whether to reserve multiple buffers for threading optimization.
+    /// Set occlusion buffer size and whether to use worker threads.
     bool SetSize(int width, int height, bool threaded);
     /// Set camera view to render from.
     void SetView(Camera* camera);
@@ -90,15 +140,33 @@ public:
     /// Submit a triangle mesh to the buffer using indexed geometry. Return true if did not overflow the allowed triangle count.
     bool AddTriangles(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize,
         unsigned indexStart, unsigned indexCount);
-    /// Draw submitted batches. Uses worker threads if enabled during SetSize().
+    /// Draw submitted batches. Triangles are binned to screen tiles, then the tiles are rasterized.
+    /// Uses worker threads if enabled during SetSize().
     void DrawTriangles();
+    /// Add tasks which draw the submitted triangles and build the mip levels to a task graph. Threaded mode only. Return the last task.
+    i32 AddDrawTasks(TaskGraph* graph);
     /// Build reduced size mip levels.
     void BuildDepthHierarchy();
+    /// Remember the depth, the view and the drawn occluders of the current frame, so that the next frame can reproject them.
+    void StoreHistory(Camera* camera, Vector<OccluderHistory>& occluders);
+    /// Erase the history depth inside the projection of a world space box, e.g. of an occluder that has moved.
+    /// Must be called before Reproject().
+    void InvalidateHistory(const BoundingBox& worldSpaceBox);
+    /// Return whether the history depth inside the projection of a world space box has not been erased by InvalidateHistory().
+    bool IsHistoryValid(const BoundingBox& worldSpaceBox) const;
+    /// Replace the buffer contents with the history depth reprojected to the current view. Return false if there is no history.
+    /// The result is conservative: depth is never moved closer and pixels without history are left empty.
+    bool Reproject();
+    /// Erase the history depth of occluders which have moved or disappeared, then reproject the history to the current view.
+    /// Append the occluders whose depth is still in the buffer to the list. Return false if there is no history.
+    bool ReprojectOccluders(Vector<OccluderHistory>& occluders);
+    /// Forget the history.
+    void ResetHistory();
     /// Reset last used timer.
     void ResetUseTimer();
 
     /// Return highest level depth values.
-    int* GetBuffer() const { return buffers_.Size() ? buffers_[0].data_ : nullptr; }
+    int* GetBuffer() const { return buffer_.Get(); }
 
     /// Return view transform matrix.
     const Matrix3x4& GetView() const { return view_; }
@@ -121,15 +189,27 @@ public:
     /// Return culling mode.
     CullMode GetCullMode() const { return cullMode_; }
 
+    /// Return whether has history depth rendered from a camera.
+    bool HasHistory(Camera* camera) const { return camera && historyCamera_.Get() == camera; }
+
+    /// Return camera of the history depth.
+    Camera* GetHistoryCamera() const { return historyCamera_.Get(); }
+
+    /// Return occluders drawn into the history depth.
+    const Vector<OccluderHistory>& GetHistoryOccluders() const { return historyOccluders_; }
+
+    /// Return number of successive reprojections since the buffer was last cleared.
+    i32 GetHistoryAge() const { return historyAge_; }
+
     /// Return whether is using threads to speed up rendering.
-    bool IsThreaded() const { return buffers_.Size() > 1; }
+    bool IsThreaded() const { return threaded_; }
 
     /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
     /// Return time since last use in milliseconds.
     unsigned GetUseTimer();
 
-    /// Draw a batch. Called internally.
+    /// Set up the triangles of a batch and bin them to tiles. Called internally.
     void DrawBatch(const OcclusionBatch& batch, i32 threadIndex);
 
 private:
@@ -141,21 +221,43 @@ private:
     inline Vector4 ClipEdge(const Vector4& v0, const Vector4& v1, float d0, float d1) const;
     /// Return signed area of a triangle. If negative, is clockwise.
     inline float SignedArea(const Vector3& v0, const Vector3& v1, const Vector3& v2) const;
+    /// Return whether a projected triangle is removed by the culling mode.
+    inline bool IsCulled(const Vector3* projected) const;
     /// Calculate viewport transform.
     void CalculateViewport();
-    /// Draw a triangle.
+    /// Return the pixels covered by a world space box in the history depth.
+    IntRect GetHistoryRect(const BoundingBox& worldSpaceBox) const;
+    /// Clip a triangle and draw the result.
     void DrawTriangle(Vector4* vertices, i32 threadIndex);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
-    void DrawTriangle2D(const Vector3* vertices, bool clockwise, i32 threadIndex);
-    /// Clear a thread work buffer.
-    void ClearBuffer(i32 threadIndex);
-    /// Merge thread work buffers into the first buffer.
-    void MergeBuffers();
-
-    /// Highest-level buffer data per thread.
-    Vector<OcclusionBufferData> buffers_;
+    /// Draw a clipped triangle, or bin it when using worker threads. Return true if it covers any pixels.
+    bool DrawTriangle2D(const Vector3* vertices, i32 threadIndex);
+    /// Prepare a clipped triangle for rasterization. Return false if it covers no pixels.
+    bool SetupTriangle(const Vector3* vertices, OcclusionTriangle& triangle) const;
+    /// Add a triangle to the bins of the overlapped tiles.
+    void BinTriangle(const OcclusionTriangle& triangle, i32 threadIndex);
+    /// Rasterize the part of a triangle inside a rectangle.
+    void RasterizeTriangle(const OcclusionTriangle& triangle, const IntRect& clipRect);
+    /// Rasterize the binned triangles of a tile and clear its bins.
+    void RasterizeTile(i32 tileIndex);
+
+    /// Highest-level buffer data.
+    SharedArrayPtr<int> buffer_;
+    /// Reprojected depth with a border of one pixel.
+    SharedArrayPtr<int> reprojectionBuffer_;
+    /// Occluders drawn into the history depth.
+    Vector<OccluderHistory> historyOccluders_;
+    /// Rectangles of the history depth erased by InvalidateHistory().
+    Vector<IntRect> invalidHistoryRects_;
+    /// Camera of the history depth.
+    WeakPtr<Camera> historyCamera_;
+    /// Combined view and projection matrix of the history depth.
+    Matrix4 historyViewProj_;
+    /// Number of successive reprojections.
+    i32 historyAge_{};
+    /// Binned triangles per thread.
+    Vector<OcclusionBufferData> threadData_;
     /// Reduced size depth buffers.
     Vector<SharedArrayPtr<DepthValue>> mipBuffers_;
     /// Submitted render jobs.
@@ -164,12 +266,18 @@ private:
     int width_{};
     /// Buffer height.
     int height_{};
+    /// Number of tiles in X direction.
+    int numTilesX_{};
+    /// Number of tiles in Y direction.
+    int numTilesY_{};
     /// Number of rendered triangles.
     unsigned numTriangles_{};
     /// Maximum number of triangles.
     unsigned maxTriangles_;
     /// Culling mode.
     CullMode cullMode_{CULL_CCW};
+    /// Use worker threads flag.
+    bool threaded_{};
     /// Depth hierarchy needs update flag.
     bool depthHierarchyDirty_{true};
     /// Culling reverse flag.
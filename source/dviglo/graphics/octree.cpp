@@ -5,6 +5,7 @@
 #include "../core/context.h"
 #include "../core/core_events.h"
 #include "../core/profiler.h"
+#include "../core/task_graph.h"
 #include "../core/thread.h"
 #include "../core/work_queue.h"
 #include "debug_renderer.h"
@@ -16,6 +17,8 @@
 
 #include "../common/debug_new.h"
 
+#include <algorithm>
+
 #ifdef _MSC_VER
 #pragma warning(disable:4355)
 #endif
@@ -25,14 +28,14 @@ namespace dviglo
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+static const int DRAWABLE_UPDATE_GRAIN = 16;
+static const int RAYCAST_BATCH_GRAIN = 8;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, i32 threadIndex)
+static void UpdateDrawablesWork(Drawable** start, Drawable** end, const FrameInfo& frame)
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
+    DV_PROFILE(UpdateDrawablesWork);
 
     while (start != end)
     {
@@ -66,8 +69,7 @@ Octant::~Octant()
         // Remove the drawables (if any) from this octant to the root octant
         for (Vector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
         {
-            (*i)->SetOctant(root_);
-            root_->drawables_.Push(*i);
+            root_->PushDrawable(*i);
             root_->QueueUpdate(*i);
         }
         drawables_.Clear();
@@ -117,35 +119,47 @@ void Octant::DeleteChild(i32 index)
 
 void Octant::InsertDrawable(Drawable* drawable)
 {
-    const BoundingBox& box = drawable->GetWorldBoundingBox();
-
-    // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
-    // Also if drawable is outside the root octant bounds, insert to root
-    bool insertHere;
-    if (this == root_)
-        insertHere = !drawable->IsOccludee() || cullingBox_.IsInside(box) != INSIDE || CheckDrawableFit(box);
-    else
-        insertHere = CheckDrawableFit(box);
+    Octant* octant = GetInsertionOctant(drawable->GetWorldBoundingBox(), drawable->IsOccludee(), true);
+    Octant* oldOctant = drawable->octant_;
 
-    if (insertHere)
+    if (octant != oldOctant)
     {
-        Octant* oldOctant = drawable->octant_;
-        if (oldOctant != this)
-        {
-            // Add first, then remove, because drawable count going to zero deletes the octree branch in question
-            AddDrawable(drawable);
-            if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
-        }
+        // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+        i32 oldIndex = drawable->octantIndex_;
+        octant->AddDrawable(drawable);
+        if (oldOctant)
+            oldOctant->RemoveDrawableAt(oldIndex);
     }
-    else
+}
+
+Octant* Octant::GetInsertionOctant(const BoundingBox& box, bool occludee, bool create)
+{
+    Octant* octant = this;
+
+    for (;;)
     {
-        Vector3 boxCenter = box.Center();
-        i32 x = boxCenter.x_ < center_.x_ ? 0 : 1;
-        i32 y = boxCenter.y_ < center_.y_ ? 0 : 2;
-        i32 z = boxCenter.z_ < center_.z_ ? 0 : 4;
+        // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
+        // Also if drawable is outside the root octant bounds, insert to root
+        bool insertHere;
+        if (octant == root_)
+            insertHere = !occludee || octant->cullingBox_.IsInside(box) != INSIDE || octant->CheckDrawableFit(box);
+        else
+            insertHere = octant->CheckDrawableFit(box);
+
+        if (insertHere)
+            return octant;
 
-        GetOrCreateChild(x + y + z)->InsertDrawable(drawable);
+        Vector3 boxCenter = box.Center();
+        i32 x = boxCenter.x_ < octant->center_.x_ ? 0 : 1;
+        i32 y = boxCenter.y_ < octant->center_.y_ ? 0 : 2;
+        i32 z = boxCenter.z_ < octant->center_.z_ ? 0 : 4;
+
+        if (create)
+            octant = octant->GetOrCreateChild(x + y + z);
+        else if (octant->children_[x + y + z])
+            octant = octant->children_[x + y + z];
+        else
+            return octant;
     }
 }
 
@@ -153,8 +167,9 @@ bool Octant::CheckDrawableFit(const BoundingBox& box) const
 {
     Vector3 boxSize = box.Size();
 
-    // If max split level, size always OK, otherwise check that box is at least half size of octant
-    if (level_ >= root_->GetNumLevels() || boxSize.x_ >= halfSize_.x_ || boxSize.y_ >= halfSize_.y_ ||
+    // If max split level or indexing with a bounding volume hierarchy, size always OK, otherwise check that box is at least
+    // half size of octant
+    if (level_ >= root_->GetNumLevels() || root_->IsBvhEnabled() || boxSize.x_ >= halfSize_.x_ || boxSize.y_ >= halfSize_.y_ ||
         boxSize.z_ >= halfSize_.z_)
         return true;
     // Also check if the box can not fit a child octant's culling box, in that case size OK (must insert here)
@@ -173,6 +188,19 @@ bool Octant::CheckDrawableFit(const BoundingBox& box) const
     return false;
 }
 
+void Octant::UpdateDrawableCullData(Drawable* drawable)
+{
+    assert(drawable->octant_ == this);
+
+    i32 index = drawable->octantIndex_;
+    cullData_.viewMasks_[index] = drawable->GetViewMask();
+
+    if (drawable->updateQueued_)
+        cullData_.SetStale(index);
+    else
+        cullData_.SetBounds(index, drawable->GetWorldBoundingBox());
+}
+
 void Octant::ResetRoot()
 {
     root_ = nullptr;
@@ -210,6 +238,98 @@ void Octant::Initialize(const BoundingBox& box)
     cullingBox_ = BoundingBox(worldBoundingBox_.min_ - halfSize_, worldBoundingBox_.max_ + halfSize_);
 }
 
+void Octant::PushDrawable(Drawable* drawable)
+{
+    drawable->SetOctant(this);
+    drawable->octantIndex_ = drawables_.Size();
+    drawables_.Push(drawable);
+
+    cullData_.centerX_.Push(0.0f);
+    cullData_.centerY_.Push(0.0f);
+    cullData_.centerZ_.Push(0.0f);
+    cullData_.edgeX_.Push(0.0f);
+    cullData_.edgeY_.Push(0.0f);
+    cullData_.edgeZ_.Push(0.0f);
+    cullData_.viewMasks_.Push(0);
+    cullData_.flags_.Push((u8)drawable->GetDrawableType());
+    UpdateDrawableCullData(drawable);
+
+    if (!parent_ && root_)
+        root_->bvhDirty_ = true;
+}
+
+void Octant::RemoveDrawableAt(i32 index)
+{
+    assert(index >= 0 && index < drawables_.Size());
+
+    drawables_.EraseSwap(index);
+    cullData_.centerX_.EraseSwap(index);
+    cullData_.centerY_.EraseSwap(index);
+    cullData_.centerZ_.EraseSwap(index);
+    cullData_.edgeX_.EraseSwap(index);
+    cullData_.edgeY_.EraseSwap(index);
+    cullData_.edgeZ_.EraseSwap(index);
+    cullData_.viewMasks_.EraseSwap(index);
+    cullData_.flags_.EraseSwap(index);
+
+    // The last drawable was moved to the erased position
+    if (index < drawables_.Size())
+        drawables_[index]->octantIndex_ = index;
+
+    if (!parent_ && root_)
+        root_->bvhDirty_ = true;
+
+    DecDrawableCount();
+}
+
+void Octant::RemoveMovedDrawables()
+{
+    i32 numKept = 0;
+
+    for (i32 i = 0; i < drawables_.Size(); ++i)
+    {
+        Drawable* drawable = drawables_[i];
+        if (drawable->octant_ != this)
+            continue;
+
+        if (i != numKept)
+        {
+            drawables_[numKept] = drawable;
+            cullData_.centerX_[numKept] = cullData_.centerX_[i];
+            cullData_.centerY_[numKept] = cullData_.centerY_[i];
+            cullData_.centerZ_[numKept] = cullData_.centerZ_[i];
+            cullData_.edgeX_[numKept] = cullData_.edgeX_[i];
+            cullData_.edgeY_[numKept] = cullData_.edgeY_[i];
+            cullData_.edgeZ_[numKept] = cullData_.edgeZ_[i];
+            cullData_.viewMasks_[numKept] = cullData_.viewMasks_[i];
+            cullData_.flags_[numKept] = cullData_.flags_[i];
+            drawable->octantIndex_ = numKept;
+        }
+
+        ++numKept;
+    }
+
+    i32 numRemoved = drawables_.Size() - numKept;
+    if (!numRemoved)
+        return;
+
+    drawables_.Resize(numKept);
+    cullData_.centerX_.Resize(numKept);
+    cullData_.centerY_.Resize(numKept);
+    cullData_.centerZ_.Resize(numKept);
+    cullData_.edgeX_.Resize(numKept);
+    cullData_.edgeY_.Resize(numKept);
+    cullData_.edgeZ_.Resize(numKept);
+    cullData_.viewMasks_.Resize(numKept);
+    cullData_.flags_.Resize(numKept);
+
+    if (!parent_ && root_)
+        root_->bvhDirty_ = true;
+
+    // May delete this octant
+    DecDrawableCount(numRemoved);
+}
+
 void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
 {
     if (this != root_)
@@ -228,7 +348,7 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     {
         auto** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        query.TestDrawablesBatched(start, end, cullData_, inside);
     }
 
     for (auto child : children_)
@@ -299,7 +419,7 @@ Octree::Octree() :
     // If the engine is running headless, subscribe to RenderUpdate events for manually updating the octree
     // to allow raycasts and animation update
     if (!GetSubsystem<Graphics>())
-        SubscribeToEvent(E_RENDERUPDATE, DV_HANDLER(Octree, HandleRenderUpdate));
+        SubscribeToTypedEvent(&Octree::HandleRenderUpdate);
 }
 
 Octree::~Octree()
@@ -319,6 +439,7 @@ void Octree::RegisterObject()
     DV_ATTRIBUTE_EX("Bounding Box Min", worldBoundingBox_.min_, UpdateOctreeSize, defaultBoundsMin, AM_DEFAULT);
     DV_ATTRIBUTE_EX("Bounding Box Max", worldBoundingBox_.max_, UpdateOctreeSize, defaultBoundsMax, AM_DEFAULT);
     DV_ATTRIBUTE_EX("Number of Levels", numLevels_, UpdateOctreeSize, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    DV_ACCESSOR_ATTRIBUTE("BVH Enabled", IsBvhEnabled, SetBvhEnabled, false, AM_DEFAULT);
 }
 
 void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
@@ -346,51 +467,99 @@ void Octree::SetSize(const BoundingBox& box, i32 numLevels)
     numLevels_ = Max(numLevels, 1);
 }
 
-void Octree::Update(const FrameInfo& frame)
+void Octree::SetBvhEnabled(bool enable)
 {
-    if (!Thread::IsMainThread())
-    {
-        DV_LOGERROR("Octree::Update() can not be called from worker threads");
+    if (enable == bvhEnabled_)
         return;
+
+    // When enabled, child octants are deleted and their drawables are moved to the root. When disabled, the drawables
+    // are reinserted to the octants in the next update
+    bvhEnabled_ = enable;
+    bvhDirty_ = true;
+    bvh_.Clear();
+    SetSize(worldBoundingBox_, numLevels_);
+
+    if (!enable)
+    {
+        for (Drawable* drawable : drawables_)
+        {
+            if (!drawable->updateQueued_)
+                QueueUpdate(drawable);
+        }
     }
+}
 
-    // Let drawables update themselves before reinsertion. This can be used for animation
-    if (!drawableUpdates_.Empty())
+void Octree::AddUpdateTasks(WorkQueue* queue, const FrameInfo& frame, i32 finishTask)
+{
+    if (drawableUpdates_.Empty())
+        return;
+
+    if (!queue->GetNumThreads())
     {
-        DV_PROFILE(UpdateDrawables);
+        i32 task = updateGraph_->AddTask([this, &frame](i32, i32, i32)
+        {
+            UpdateDrawablesWork(drawableUpdates_.Buffer(), drawableUpdates_.Buffer() + drawableUpdates_.Size(), frame);
+        });
+        updateGraph_->AddDependency(finishTask, task);
+        return;
+    }
 
-        // Perform updates in worker threads. Notify the scene that a threaded update is going on and components
-        // (for example physics objects) should not perform non-threadsafe work when marked dirty
-        Scene* scene = GetScene();
-        auto* queue = GetSubsystem<WorkQueue>();
-        scene->BeginThreadedUpdate();
+    // Expensive updates (skeletal animation) go first. The order of the updates does not matter
+    Drawable** start = drawableUpdates_.Buffer();
+    Drawable** expensiveEnd = std::partition(start, start + drawableUpdates_.Size(),
+        [](Drawable* drawable) { return drawable->IsUpdateExpensive(); });
+    i32 numExpensive = (i32)(expensiveEnd - start);
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
+    // Drawables share ancestor nodes, so their world transforms are calculated before the updates, which read them
+    // from different threads
+    i32 transformTask = updateGraph_->AddTask([this](i32, i32, i32)
+    {
+        DV_PROFILE(UpdateDrawableTransforms);
 
-        Vector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        for (Drawable* drawable : drawableUpdates_)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = WI_MAX_PRIORITY;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
+            if (Node* node = drawable->GetNode())
+                node->GetWorldTransform();
+        }
+    });
 
-            Vector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
+    // A few expensive updates in the same chunk would keep one thread busy while the others are idle. Instead each
+    // thread takes the next drawable when done with the previous one
+    if (numExpensive)
+    {
+        nextExpensiveUpdate_.store(0, std::memory_order_relaxed);
+        i32 expensiveTask = updateGraph_->AddParallelFor(0, Min(numExpensive, queue->GetNumThreads() + 1), 1,
+            [this, &frame, numExpensive](i32, i32, i32)
+        {
+            DV_PROFILE(UpdateExpensiveDrawablesWork);
 
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
+            for (i32 i = nextExpensiveUpdate_.fetch_add(1, std::memory_order_relaxed); i < numExpensive;
+                i = nextExpensiveUpdate_.fetch_add(1, std::memory_order_relaxed))
+            {
+                drawableUpdates_[i]->Update(frame);
+            }
+        });
+        updateGraph_->AddDependency(expensiveTask, transformTask);
+        updateGraph_->AddDependency(finishTask, expensiveTask);
+    }
 
-            start = end;
-        }
+    if (numExpensive < drawableUpdates_.Size())
+    {
+        i32 task = updateGraph_->AddParallelFor(numExpensive, drawableUpdates_.Size(), DRAWABLE_UPDATE_GRAIN,
+            [this, &frame](i32 begin, i32 end, i32 threadIndex)
+        {
+            UpdateDrawablesWork(drawableUpdates_.Buffer() + begin, drawableUpdates_.Buffer() + end, frame);
+        });
+        updateGraph_->AddDependency(task, transformTask);
+        updateGraph_->AddDependency(finishTask, task);
+    }
+}
 
-        queue->Complete(WI_MAX_PRIORITY);
+void Octree::FinishDrawableUpdates(const FrameInfo& frame)
+{
+    Scene* scene = GetScene();
+    if (scene && !drawableUpdates_.Empty())
         scene->EndThreadedUpdate();
-    }
 
     // If any drawables were inserted during threaded update, update them now from the main thread
     if (!threadedDrawableUpdates_.Empty())
@@ -411,7 +580,6 @@ void Octree::Update(const FrameInfo& frame)
     }
 
     // Notify drawable update being finished. Custom animation (eg. IK) can be done at this point
-    Scene* scene = GetScene();
     if (scene)
     {
         using namespace SceneDrawableUpdateFinished;
@@ -422,16 +590,51 @@ void Octree::Update(const FrameInfo& frame)
         scene->SendEvent(E_SCENEDRAWABLEUPDATEFINISHED, eventData);
     }
 
-    // Reinsert drawables that have been moved or resized, or that have been newly added to the octree and do not sit inside
-    // the proper octant yet
-    if (!drawableUpdates_.Empty())
+    // Drawables which are marked dirty while the new octants are searched are queued for the next update
+    if (scene && !drawableUpdates_.Empty())
+        scene->BeginThreadedUpdate();
+}
+
+void Octree::Update(const FrameInfo& frame)
+{
+    if (!Thread::IsMainThread())
     {
-        DV_PROFILE(ReinsertToOctree);
+        DV_LOGERROR("Octree::Update() can not be called from worker threads");
+        return;
+    }
+
+    DV_PROFILE(UpdateDrawables);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    Scene* scene = GetScene();
+
+    if (!updateGraph_)
+        updateGraph_ = new TaskGraph(queue);
 
-        for (Vector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+    updateGraph_->Clear();
+
+    // Let drawables update themselves before reinsertion. This can be used for animation. Notify the scene that
+    // a threaded update is going on and components (for example physics objects) should not perform non-threadsafe
+    // work when marked dirty
+    if (scene && !drawableUpdates_.Empty())
+        scene->BeginThreadedUpdate();
+
+    // The update finished event is sent from the main thread between the updates and the search for the new octants,
+    // which both run in worker threads. It also queues the drawables updated by the main thread for reinsertion
+    i32 finishTask = updateGraph_->AddMainThreadTask([this, &frame](i32, i32, i32) { FinishDrawableUpdates(frame); });
+    AddUpdateTasks(queue, frame, finishTask);
+
+    // Reinsert drawables that have been moved or resized, or that have been newly added to the octree and do not sit
+    // inside the proper octant yet. Octants are not created or deleted while the new octants are searched
+    i32 findTask = updateGraph_->AddParallelFor(DRAWABLE_UPDATE_GRAIN, [this](i32 begin, i32 end, i32 threadIndex)
+    {
+        DV_PROFILE(FindReinsertOctants);
+
+        for (i32 i = begin; i < end; ++i)
         {
-            Drawable* drawable = *i;
+            Drawable* drawable = drawableUpdates_[i];
             drawable->updateQueued_ = false;
+            reinsertOctants_[i] = nullptr;
             Octant* octant = drawable->GetOctant();
             const BoundingBox& box = drawable->GetWorldBoundingBox();
 
@@ -440,13 +643,69 @@ void Octree::Update(const FrameInfo& frame)
                 continue;
             // Skip if still fits the current octant
             if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            {
+                octant->UpdateDrawableCullData(drawable);
+                continue;
+            }
+
+            reinsertOctants_[i] = GetInsertionOctant(box, drawable->IsOccludee(), false);
+        }
+    });
+
+    // The bounding boxes read the world transforms of shared ancestor nodes. Drawables queued from the threaded
+    // update or moved by the event handlers were not handled by the transform pass of the update
+    i32 reinsertTransformTask = updateGraph_->AddTask([this, queue, findTask](i32, i32, i32)
+    {
+        reinsertOctants_.Resize(drawableUpdates_.Size());
+        updateGraph_->SetRange(findTask, 0, drawableUpdates_.Size());
+
+        if (queue->GetNumThreads())
+        {
+            DV_PROFILE(UpdateReinsertTransforms);
+
+            for (Drawable* drawable : drawableUpdates_)
+            {
+                if (Node* node = drawable->GetNode())
+                    node->GetWorldTransform();
+            }
+        }
+    });
+    updateGraph_->AddDependency(reinsertTransformTask, finishTask);
+    updateGraph_->AddDependency(findTask, reinsertTransformTask);
+
+    updateGraph_->Run();
+    updateGraph_->Wait();
+
+    if (!drawableUpdates_.Empty())
+    {
+        DV_PROFILE(ReinsertToOctree);
+
+        if (scene)
+            scene->EndThreadedUpdate();
+
+        // Add the drawables to the new octants. Missing child octants are created here. Removal from the old octants is
+        // postponed, so that no octant is deleted while the found octants are being used
+        for (i32 i = 0; i < drawableUpdates_.Size(); ++i)
+        {
+            Octant* octant = reinsertOctants_[i];
+            if (!octant)
                 continue;
 
-            InsertDrawable(drawable);
+            Drawable* drawable = drawableUpdates_[i];
+            const BoundingBox& box = drawable->GetWorldBoundingBox();
+            octant = octant->GetInsertionOctant(box, drawable->IsOccludee(), true);
+            Octant* oldOctant = drawable->GetOctant();
+
+            if (octant == oldOctant)
+                octant->UpdateDrawableCullData(drawable);
+            else
+            {
+                movedFromOctants_.Push(oldOctant);
+                octant->AddDrawable(drawable);
+            }
 
 #ifdef _DEBUG
             // Verify that the drawable will be culled correctly
-            octant = drawable->GetOctant();
             if (octant != this && octant->GetCullingBox().IsInside(box) != INSIDE)
             {
                 DV_LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() +
@@ -454,8 +713,20 @@ void Octree::Update(const FrameInfo& frame)
             }
 #endif
         }
+
+        // Remove the moved drawables from each old octant once. An octant becomes empty and is deleted only after
+        // the removals from itself and its child octants are all counted, so the remaining pointers stay valid
+        std::sort(movedFromOctants_.Begin(), movedFromOctants_.End());
+        Vector<Octant*>::Iterator movedFromEnd = std::unique(movedFromOctants_.Begin(), movedFromOctants_.End());
+        for (Vector<Octant*>::Iterator i = movedFromOctants_.Begin(); i != movedFromEnd; ++i)
+            (*i)->RemoveMovedDrawables();
+
+        movedFromOctants_.Clear();
     }
 
+    if (bvhEnabled_)
+        UpdateBvh(drawableUpdates_.Size());
+
     drawableUpdates_.Clear();
 }
 
@@ -480,7 +751,11 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.Clear();
-    GetDrawablesInternal(query, false);
+
+    if (IsBvhReady())
+        bvh_.GetDrawables(query);
+    else
+        GetDrawablesInternal(query, false);
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -488,7 +763,12 @@ void Octree::Raycast(RayOctreeQuery& query) const
     DV_PROFILE(Raycast);
 
     query.result_.Clear();
-    GetDrawablesInternal(query);
+
+    if (IsBvhReady())
+        bvh_.Raycast(query);
+    else
+        GetDrawablesInternal(query);
+
     std::sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
 }
 
@@ -496,28 +776,80 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 {
     DV_PROFILE(Raycast);
 
-    query.result_.Clear();
-    rayQueryDrawables_.Clear();
-    GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+    RaycastSingleInternal(query, rayQueryScratch_);
+}
 
-    // Sort by increasing hit distance to AABB
-    for (Vector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
+void Octree::RaycastSingle(const Vector<Ray>& rays, Vector<RayQueryResult>& results, RayQueryLevel level, float maxDistance,
+    DrawableTypes drawableTypes, mask32 viewMask) const
+{
+    DV_PROFILE(RaycastBatch);
+
+    if (!Thread::IsMainThread())
     {
-        Drawable* drawable = *i;
-        drawable->SetSortValue(query.ray_.HitDistance(drawable->GetWorldBoundingBox()));
+        DV_LOGERROR("Octree::RaycastSingle() with multiple rays can not be called from worker threads");
+        return;
     }
 
-    std::sort(rayQueryDrawables_.Begin(), rayQueryDrawables_.End(), CompareDrawables);
+    results.Resize(rays.Size());
+
+    // Each thread has its own temporary data. Thread index 0 is the main thread
+    auto* queue = GetSubsystem<WorkQueue>();
+    batchRayQueryScratch_.Resize(queue->GetNumThreads() + 1);
+
+    // World transforms and bounding boxes are calculated on demand, and the nodes are shared by the drawables and
+    // the rays. Drawables which moved since the last update are queued for it, so only they need to be resolved here
+    if (queue->GetNumThreads())
+    {
+        for (Drawable* drawable : drawableUpdates_)
+            drawable->PrepareRayQuery();
+    }
+
+    queue->ParallelFor(0, rays.Size(), RAYCAST_BATCH_GRAIN, [&](i32 begin, i32 end, i32 threadIndex)
+    {
+        RaycastSingleScratch& scratch = batchRayQueryScratch_[threadIndex];
+
+        for (i32 i = begin; i < end; ++i)
+        {
+            RayOctreeQuery query(scratch.results_, rays[i], level, maxDistance, drawableTypes, viewMask);
+            RaycastSingleInternal(query, scratch);
+
+            if (scratch.results_.Size())
+                results[i] = scratch.results_[0];
+            else
+            {
+                results[i] = RayQueryResult();
+                results[i].distance_ = M_INFINITY;
+            }
+        }
+    });
+}
+
+void Octree::RaycastSingleInternal(RayOctreeQuery& query, RaycastSingleScratch& scratch) const
+{
+    query.result_.Clear();
+    scratch.drawables_.Clear();
+
+    if (IsBvhReady())
+        bvh_.GetRayDrawables(query, scratch.drawables_);
+    else
+        GetDrawablesOnlyInternal(query, scratch.drawables_);
+
+    // Sort by increasing hit distance to AABB
+    scratch.sortedDrawables_.Clear();
+    for (Drawable* drawable : scratch.drawables_)
+        scratch.sortedDrawables_.Push(MakePair(query.ray_.HitDistance(drawable->GetWorldBoundingBox()), drawable));
+
+    std::sort(scratch.sortedDrawables_.Begin(), scratch.sortedDrawables_.End(),
+        [](const Pair<float, Drawable*>& lhs, const Pair<float, Drawable*>& rhs) { return lhs.first_ < rhs.first_; });
 
     // Then do the actual test according to the query, and early-out as possible
     float closestHit = M_INFINITY;
-    for (Vector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
+    for (const Pair<float, Drawable*>& sortedDrawable : scratch.sortedDrawables_)
     {
-        Drawable* drawable = *i;
-        if (drawable->GetSortValue() < Min(closestHit, query.maxDistance_))
+        if (sortedDrawable.first_ < Min(closestHit, query.maxDistance_))
         {
             i32 oldSize = query.result_.Size();
-            drawable->ProcessRayQuery(query, query.result_);
+            sortedDrawable.second_->ProcessRayQuery(query, query.result_);
             if (query.result_.Size() > oldSize)
                 closestHit = Min(closestHit, query.result_.Back().distance_);
         }
@@ -544,6 +876,11 @@ void Octree::QueueUpdate(Drawable* drawable)
         drawableUpdates_.Push(drawable);
 
     drawable->updateQueued_ = true;
+
+    // Bounds are going to change, so the drawable must be tested individually until reinsertion
+    Octant* octant = drawable->GetOctant();
+    if (octant)
+        octant->UpdateDrawableCullData(drawable);
 }
 
 void Octree::CancelUpdate(Drawable* drawable)
@@ -560,18 +897,32 @@ void Octree::DrawDebugGeometry(bool depthTest)
     DrawDebugGeometry(debug, depthTest);
 }
 
-void Octree::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
+void Octree::UpdateBvh(i32 numUpdated)
+{
+    // Refitting keeps the hierarchy, which becomes loose when the drawables move far from their original neighbours.
+    // Rebuild when the number of updates since the last build reaches the number of drawables
+    bvhNumUpdated_ += numUpdated;
+
+    if (bvhDirty_ || bvhNumUpdated_ >= drawables_.Size())
+    {
+        bvh_.Build(drawables_);
+        bvhNumUpdated_ = 0;
+        bvhDirty_ = false;
+    }
+    else if (numUpdated)
+        bvh_.Refit();
+}
+
+void Octree::HandleRenderUpdate(RenderUpdateEvent& event)
 {
     // When running in headless mode, update the Octree manually during the RenderUpdate event
     Scene* scene = GetScene();
     if (!scene || !scene->IsUpdateEnabled())
         return;
 
-    using namespace RenderUpdate;
-
     FrameInfo frame;
     frame.frameNumber_ = GetSubsystem<Time>()->GetFrameNumber();
-    frame.timeStep_ = eventData[P_TIMESTEP].GetFloat();
+    frame.timeStep_ = event.timeStep_;
     frame.camera_ = nullptr;
 
     Update(frame);
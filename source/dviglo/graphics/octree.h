@@ -5,14 +5,19 @@
 #pragma once
 
 #include "drawable.h"
+#include "drawable_bvh.h"
 #include "octree_query.h"
 
+#include <atomic>
 #include <mutex>
 
 namespace dviglo
 {
 
 class Octree;
+class TaskGraph;
+class WorkQueue;
+struct RenderUpdateEvent;
 
 static const int NUM_OCTANTS = 8;
 static const i32 ROOT_INDEX = NINDEX;
@@ -32,28 +37,35 @@ public:
     void DeleteChild(i32 index);
     /// Insert a drawable object by checking for fit recursively.
     void InsertDrawable(Drawable* drawable);
+    /// Return the octant where a drawable object with the given bounding box should be inserted, starting from this octant.
+    /// If create is false and a child octant on the way does not exist, return the deepest existing octant instead.
+    Octant* GetInsertionOctant(const BoundingBox& box, bool occludee, bool create);
     /// Check if a drawable object fits.
     bool CheckDrawableFit(const BoundingBox& box) const;
 
     /// Add a drawable object to this octant.
     void AddDrawable(Drawable* drawable)
     {
-        drawable->SetOctant(this);
-        drawables_.Push(drawable);
+        PushDrawable(drawable);
         IncDrawableCount();
     }
 
     /// Remove a drawable object from this octant.
     void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
     {
-        if (drawables_.Remove(drawable))
-        {
-            if (resetOctant)
-                drawable->SetOctant(nullptr);
-            DecDrawableCount();
-        }
+        if (drawable->octant_ != this)
+            return;
+
+        if (resetOctant)
+            drawable->SetOctant(nullptr);
+        RemoveDrawableAt(drawable->octantIndex_);
     }
 
+    /// Update culling data of a drawable object in this octant from its current world bounding box and view mask.
+    void UpdateDrawableCullData(Drawable* drawable);
+    /// Remove drawable objects which have already been added to other octants.
+    void RemoveMovedDrawables();
+
     /// Return world-space bounding box.
     const BoundingBox& GetWorldBoundingBox() const { return worldBoundingBox_; }
 
@@ -90,6 +102,44 @@ protected:
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, Vector<Drawable*>& drawables) const;
 
+    /// Pass drawable objects accepted by a visitor query to the sink, called internally.
+    template <typename Query, typename Sink>
+    void VisitDrawablesInternal(const Query& query, Sink& sink, bool inside) const
+    {
+        // Root octant has no parent
+        if (parent_)
+        {
+            Intersection res = query.TestOctant(cullingBox_, inside);
+            if (res == INSIDE)
+                inside = true;
+            else if (res == OUTSIDE)
+                return;
+        }
+
+        // Drawable types and view masks are checked from the culling data without accessing the drawables
+        u8 drawableTypes = (u8)query.drawableTypes_ & ~DrawableCullData::STALE;
+        mask32 viewMask = query.viewMask_;
+        const u8* flags = cullData_.flags_.Buffer();
+        const mask32* viewMasks = cullData_.viewMasks_.Buffer();
+
+        for (i32 i = 0; i < drawables_.Size(); ++i)
+        {
+            if ((flags[i] & drawableTypes) && (viewMasks[i] & viewMask) && query.TestDrawable(drawables_[i], inside))
+                sink(drawables_[i]);
+        }
+
+        for (Octant* child : children_)
+        {
+            if (child)
+                child->VisitDrawablesInternal(query, sink, inside);
+        }
+    }
+
+    /// Add a drawable object and its culling data to the drawable list without changing the drawable count.
+    void PushDrawable(Drawable* drawable);
+    /// Remove a drawable object and its culling data by index.
+    void RemoveDrawableAt(i32 index);
+
     /// Increase drawable object count recursively.
     void IncDrawableCount()
     {
@@ -99,11 +149,11 @@ protected:
     }
 
     /// Decrease drawable object count recursively and remove octant if it becomes empty.
-    void DecDrawableCount()
+    void DecDrawableCount(i32 count = 1)
     {
         Octant* parent = parent_;
 
-        --numDrawables_;
+        numDrawables_ -= count;
         if (!numDrawables_)
         {
             if (parent)
@@ -111,7 +161,7 @@ protected:
         }
 
         if (parent)
-            parent->DecDrawableCount();
+            parent->DecDrawableCount(count);
     }
 
     /// World bounding box.
@@ -120,6 +170,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     Vector<Drawable*> drawables_;
+    /// Culling data of the drawable objects.
+    DrawableCullData cullData_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS]{};
     /// World bounding box center.
@@ -142,6 +194,7 @@ protected:
 class DV_API Octree : public Component, public Octant
 {
     DV_OBJECT(Octree, Component);
+    friend class Octant;
 
 public:
     /// Construct.
@@ -156,6 +209,10 @@ public:
 
     /// Set size and maximum subdivision levels. If octree is not empty, drawable objects will be temporarily moved to the root.
     void SetSize(const BoundingBox& box, i32 numLevels);
+    /// Set whether to index drawable objects with a bounding volume hierarchy instead of the octants. The hierarchy does not
+    /// depend on the octree size and levels, so it suits large worlds. It is rebuilt in Update() when drawable objects
+    /// are added or removed or have moved a lot, and refit otherwise.
+    void SetBvhEnabled(bool enable);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
     /// Add a drawable manually.
@@ -165,13 +222,32 @@ public:
 
     /// Return drawable objects by a query.
     void GetDrawables(OctreeQuery& query) const;
+    /// Call sink(drawable) for the drawable objects accepted by a visitor query such as VolumeVisitQuery. The tests and
+    /// the sink are inlined and no result vector is needed. The sink must not add or remove drawables.
+    template <typename Query, typename Sink>
+    void VisitDrawables(const Query& query, Sink&& sink) const
+    {
+        if (IsBvhReady())
+            bvh_.VisitDrawables(query, sink);
+        else
+            VisitDrawablesInternal(query, sink, false);
+    }
     /// Return drawable objects by a ray query.
     void Raycast(RayOctreeQuery& query) const;
     /// Return the closest drawable object by a ray query.
     void RaycastSingle(RayOctreeQuery& query) const;
+    /// Return the closest drawable object for each ray, with the same results as RaycastSingle(). The rays are processed
+    /// in worker threads. Results receive one entry per ray, with a null drawable and infinite distance if nothing was hit.
+    /// The drawable objects and their scene nodes should be up to date, as after Update(), and must not change during the call.
+    void RaycastSingle(const Vector<Ray>& rays, Vector<RayQueryResult>& results, RayQueryLevel level = RAY_TRIANGLE,
+        float maxDistance = M_INFINITY, DrawableTypes drawableTypes = DrawableTypes::Any, mask32 viewMask = DEFAULT_VIEWMASK) const;
 
     /// Return subdivision levels.
     i32 GetNumLevels() const { return numLevels_; }
+    /// Return whether drawable objects are indexed with a bounding volume hierarchy.
+    bool IsBvhEnabled() const { return bvhEnabled_; }
+    /// Return the bounding volume hierarchy.
+    const DrawableBvh& GetBvh() const { return bvh_; }
 
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
@@ -181,21 +257,61 @@ public:
     void DrawDebugGeometry(bool depthTest);
 
 private:
+    /// Temporary data of a single-result ray query.
+    struct RaycastSingleScratch
+    {
+        /// Drawable objects whose bounding box is hit.
+        Vector<Drawable*> drawables_;
+        /// Hit distances to the bounding boxes and the drawable objects.
+        Vector<Pair<float, Drawable*>> sortedDrawables_;
+        /// Query results.
+        Vector<RayQueryResult> results_;
+    };
+
+    /// Return the closest drawable object by a ray query using the given temporary data.
+    void RaycastSingleInternal(RayOctreeQuery& query, RaycastSingleScratch& scratch) const;
     /// Handle render update in case of headless execution.
-    void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleRenderUpdate(RenderUpdateEvent& event);
+    /// Add the tasks which update the queued drawable objects to the update graph. The finishing task depends on them.
+    void AddUpdateTasks(WorkQueue* queue, const FrameInfo& frame, i32 finishTask);
+    /// Update the drawable objects queued during the threaded update and send the update finished event. Called from the main thread.
+    void FinishDrawableUpdates(const FrameInfo& frame);
     /// Update octree size.
     void UpdateOctreeSize() { SetSize(worldBoundingBox_, numLevels_); }
+    /// Rebuild or refit the bounding volume hierarchy after reinsertion.
+    void UpdateBvh(i32 numUpdated);
+    /// Return whether queries can use the bounding volume hierarchy. Until it is rebuilt after drawable objects were added
+    /// or removed, queries test the drawables in the root octant.
+    bool IsBvhReady() const { return bvhEnabled_ && !bvhDirty_; }
 
     /// Drawable objects that require update.
     Vector<Drawable*> drawableUpdates_;
+    /// Task graph of the drawable object updates and the search for their new octants.
+    SharedPtr<TaskGraph> updateGraph_;
+    /// Next expensive drawable object to update.
+    std::atomic<i32> nextExpensiveUpdate_{};
     /// Drawable objects that were inserted during threaded update phase.
     Vector<Drawable*> threadedDrawableUpdates_;
+    /// Octants where the updated drawable objects should be reinserted, or null if the octant does not change.
+    Vector<Octant*> reinsertOctants_;
+    /// Octants from which drawable objects were moved during reinsertion.
+    Vector<Octant*> movedFromOctants_;
     /// Mutex for octree reinsertions.
     std::mutex octreeMutex_;
-    /// Ray query temporary list of drawables.
-    mutable Vector<Drawable*> rayQueryDrawables_;
+    /// Temporary data of single-result ray queries.
+    mutable RaycastSingleScratch rayQueryScratch_;
+    /// Temporary data of batched single-result ray queries for each thread.
+    mutable Vector<RaycastSingleScratch> batchRayQueryScratch_;
     /// Subdivision level.
     i32 numLevels_;
+    /// Bounding volume hierarchy of the drawable objects.
+    DrawableBvh bvh_;
+    /// Number of drawable object updates since the bounding volume hierarchy was built.
+    i32 bvhNumUpdated_{};
+    /// Bounding volume hierarchy enabled flag. All drawable objects are kept in the root octant when enabled.
+    bool bvhEnabled_{};
+    /// Drawable objects were added or removed after the bounding volume hierarchy was built.
+    bool bvhDirty_{};
 };
 
 }
@@ -4,6 +4,8 @@
 
 #include "octree_query.h"
 
+#include <emmintrin.h>
+
 #include "../common/debug_new.h"
 
 namespace dviglo
@@ -97,6 +99,123 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestDrawablesBatched(Drawable** start, Drawable** end, const DrawableCullData& cullData, bool inside)
+{
+    if (inside)
+    {
+        TestDrawables(start, end, true);
+        return;
+    }
+
+    // Drawables inside the frustum are collected to small batches
+    static constexpr i32 MAX_PASSED = 64;
+    Drawable* passed[MAX_PASSED];
+    i32 numPassed = 0;
+
+    i32 count = (i32)(end - start);
+    const float* centerX = cullData.centerX_.Buffer();
+    const float* centerY = cullData.centerY_.Buffer();
+    const float* centerZ = cullData.centerZ_.Buffer();
+    const float* edgeX = cullData.edgeX_.Buffer();
+    const float* edgeY = cullData.edgeY_.Buffer();
+    const float* edgeZ = cullData.edgeZ_.Buffer();
+    const mask32* viewMasks = cullData.viewMasks_.Buffer();
+    const u8* flags = cullData.flags_.Buffer();
+    u8 drawableTypes = (u8)drawableTypes_ & ~DrawableCullData::STALE;
+
+    auto addDrawable = [&](i32 index)
+    {
+        if (!(flags[index] & drawableTypes) || !(viewMasks[index] & viewMask_))
+            return;
+
+        if (flags[index] & DrawableCullData::STALE)
+        {
+            // Bounds are not known, test the drawable itself
+            TestDrawables(start + index, start + index + 1, false);
+            return;
+        }
+
+        passed[numPassed++] = start[index];
+        if (numPassed == MAX_PASSED)
+        {
+            TestDrawables(passed, passed + numPassed, true);
+            numPassed = 0;
+        }
+    };
+
+    i32 i = 0;
+
+    if (count >= 4)
+    {
+        __m128 normalX[NUM_FRUSTUM_PLANES], normalY[NUM_FRUSTUM_PLANES], normalZ[NUM_FRUSTUM_PLANES], d[NUM_FRUSTUM_PLANES];
+        __m128 absNormalX[NUM_FRUSTUM_PLANES], absNormalY[NUM_FRUSTUM_PLANES], absNormalZ[NUM_FRUSTUM_PLANES];
+
+        for (i32 j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            const Plane& plane = frustum_.planes_[j];
+            normalX[j] = _mm_set1_ps(plane.normal_.x_);
+            normalY[j] = _mm_set1_ps(plane.normal_.y_);
+            normalZ[j] = _mm_set1_ps(plane.normal_.z_);
+            d[j] = _mm_set1_ps(plane.d_);
+            absNormalX[j] = _mm_set1_ps(plane.absNormal_.x_);
+            absNormalY[j] = _mm_set1_ps(plane.absNormal_.y_);
+            absNormalZ[j] = _mm_set1_ps(plane.absNormal_.z_);
+        }
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(centerX + i);
+            __m128 y = _mm_loadu_ps(centerY + i);
+            __m128 z = _mm_loadu_ps(centerZ + i);
+            __m128 ex = _mm_loadu_ps(edgeX + i);
+            __m128 ey = _mm_loadu_ps(edgeY + i);
+            __m128 ez = _mm_loadu_ps(edgeZ + i);
+            __m128 outside = _mm_setzero_ps();
+
+            // Same operations as in Frustum::IsInsideFast()
+            for (i32 j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+            {
+                __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[j], x), _mm_mul_ps(normalY[j], y)),
+                    _mm_mul_ps(normalZ[j], z)), d[j]);
+                __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[j], ex), _mm_mul_ps(absNormalY[j], ey)),
+                    _mm_mul_ps(absNormalZ[j], ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), absDist)));
+            }
+
+            i32 outsideMask = _mm_movemask_ps(outside);
+            if (outsideMask == 0xF)
+                continue;
+
+            for (i32 lane = 0; lane < 4; ++lane)
+            {
+                if (!(outsideMask & (1 << lane)))
+                    addDrawable(i + lane);
+            }
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        Vector3 center(centerX[i], centerY[i], centerZ[i]);
+        Vector3 edge(edgeX[i], edgeY[i], edgeZ[i]);
+        bool outside = false;
+
+        for (const Plane& plane : frustum_.planes_)
+        {
+            if (plane.normal_.DotProduct(center) + plane.d_ < -plane.absNormal_.DotProduct(edge))
+            {
+                outside = true;
+                break;
+            }
+        }
+
+        if (!outside)
+            addDrawable(i);
+    }
+
+    if (numPassed)
+        TestDrawables(passed, passed + numPassed, true);
+}
 
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
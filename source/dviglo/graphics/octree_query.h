@@ -18,6 +18,53 @@ namespace dviglo
 class Drawable;
 class Node;
 
+/// Culling data of the drawables in an octant in structure of arrays layout, so that several drawables
+/// can be tested at once without accessing them. Indices match the octant's drawable list.
+struct DV_API DrawableCullData
+{
+    /// Set bounds of a drawable.
+    void SetBounds(i32 index, const BoundingBox& box)
+    {
+        Vector3 center = box.Center();
+        Vector3 edge = center - box.min_;
+        centerX_[index] = center.x_;
+        centerY_[index] = center.y_;
+        centerZ_[index] = center.z_;
+        edgeX_[index] = edge.x_;
+        edgeY_[index] = edge.y_;
+        edgeZ_[index] = edge.z_;
+        flags_[index] &= ~STALE;
+    }
+
+    /// Mark bounds of a drawable out of date. The drawable is then always tested individually.
+    void SetStale(i32 index)
+    {
+        centerX_[index] = centerY_[index] = centerZ_[index] = 0.0f;
+        edgeX_[index] = edgeY_[index] = edgeZ_[index] = M_INFINITY;
+        flags_[index] |= STALE;
+    }
+
+    /// Flag for out of date bounds. Does not overlap with drawable types.
+    static constexpr u8 STALE = 0x80;
+
+    /// Bounding box center X coordinates.
+    Vector<float> centerX_;
+    /// Bounding box center Y coordinates.
+    Vector<float> centerY_;
+    /// Bounding box center Z coordinates.
+    Vector<float> centerZ_;
+    /// Bounding box half sizes in X direction.
+    Vector<float> edgeX_;
+    /// Bounding box half sizes in Y direction.
+    Vector<float> edgeY_;
+    /// Bounding box half sizes in Z direction.
+    Vector<float> edgeZ_;
+    /// View masks.
+    Vector<mask32> viewMasks_;
+    /// Drawable types combined with the STALE flag.
+    Vector<u8> flags_;
+};
+
 /// Base class for octree queries.
 class DV_API OctreeQuery
 {
@@ -42,6 +89,11 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables which may use the culling data of the octant. By default calls TestDrawables().
+    virtual void TestDrawablesBatched(Drawable** start, Drawable** end, const DrawableCullData& cullData, bool inside)
+    {
+        TestDrawables(start, end, inside);
+    }
 
     /// Result vector reference.
     Vector<Drawable*>& result_;
@@ -130,6 +182,9 @@ public:
     Intersection TestOctant(const BoundingBox& box, bool inside) override;
     /// Intersection test for drawables.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override;
+    /// Intersection test for drawables using the culling data of the octant. Tests 4 drawables at once with SIMD.
+    /// The drawables inside the frustum are then passed to TestDrawables() as if inside, so subclasses can filter them further.
+    void TestDrawablesBatched(Drawable** start, Drawable** end, const DrawableCullData& cullData, bool inside) override;
 
     /// Frustum.
     Frustum frustum_;
@@ -251,4 +306,93 @@ public:
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override;
 };
 
+/// Filter of visitor octree queries which accepts all drawables.
+struct AcceptAllDrawables
+{
+    /// Return whether to accept the drawable.
+    bool operator ()(Drawable*) const { return true; }
+};
+
+/// Visitor octree query for Octree::VisitDrawables() with a volume which can be tested against bounding boxes:
+/// Sphere, BoundingBox or Frustum. The filter is called for the drawables of matching types and view mask
+/// before the volume test. Unlike OctreeQuery, everything is resolved at compile time.
+template <typename Volume, typename Filter = AcceptAllDrawables>
+class VolumeVisitQuery
+{
+public:
+    /// Construct with volume, query parameters and filter.
+    explicit VolumeVisitQuery(const Volume& volume, DrawableTypes drawableTypes = DrawableTypes::Any,
+        mask32 viewMask = DEFAULT_VIEWMASK, const Filter& filter = Filter()) :
+        volume_(volume),
+        filter_(filter),
+        drawableTypes_(drawableTypes),
+        viewMask_(viewMask)
+    {
+    }
+
+    /// Intersection test for an octant.
+    Intersection TestOctant(const BoundingBox& box, bool inside) const
+    {
+        if (inside)
+            return INSIDE;
+        else
+            return volume_.IsInside(box);
+    }
+
+    /// Intersection test for a drawable which matches the drawable types and view mask.
+    bool TestDrawable(Drawable* drawable, bool inside) const
+    {
+        return filter_(drawable) && (inside || volume_.IsInsideFast(drawable->GetWorldBoundingBox()));
+    }
+
+    /// Volume.
+    Volume volume_;
+    /// Filter.
+    Filter filter_;
+    /// Drawable types to include.
+    DrawableTypes drawableTypes_;
+    /// Drawable layers to include.
+    mask32 viewMask_;
+};
+
+/// Point visitor octree query for Octree::VisitDrawables().
+template <typename Filter = AcceptAllDrawables>
+class PointVisitQuery
+{
+public:
+    /// Construct with point, query parameters and filter.
+    explicit PointVisitQuery(const Vector3& point, DrawableTypes drawableTypes = DrawableTypes::Any,
+        mask32 viewMask = DEFAULT_VIEWMASK, const Filter& filter = Filter()) :
+        point_(point),
+        filter_(filter),
+        drawableTypes_(drawableTypes),
+        viewMask_(viewMask)
+    {
+    }
+
+    /// Intersection test for an octant.
+    Intersection TestOctant(const BoundingBox& box, bool inside) const
+    {
+        if (inside)
+            return INSIDE;
+        else
+            return box.IsInside(point_);
+    }
+
+    /// Intersection test for a drawable which matches the drawable types and view mask.
+    bool TestDrawable(Drawable* drawable, bool inside) const
+    {
+        return filter_(drawable) && (inside || drawable->GetWorldBoundingBox().IsInside(point_));
+    }
+
+    /// Point.
+    Vector3 point_;
+    /// Filter.
+    Filter filter_;
+    /// Drawable types to include.
+    DrawableTypes drawableTypes_;
+    /// Drawable layers to include.
+    mask32 viewMask_;
+};
+
 }
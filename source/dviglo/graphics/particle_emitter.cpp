@@ -12,6 +12,8 @@
 #include "../scene/scene.h"
 #include "../scene/scene_events.h"
 
+#include <emmintrin.h>
+
 #include "../common/debug_new.h"
 
 namespace dviglo
@@ -23,6 +25,23 @@ static const i32 MAX_PARTICLES_IN_FRAME = 100;
 
 extern const char* autoRemoveModeNames[];
 
+void ParticleArrays::Resize(i32 num)
+{
+    assert(num >= 0);
+
+    size_ = num;
+    i32 paddedSize = (num + 3) & ~3;
+
+    for (Vector<float>* array : {&velocityX_, &velocityY_, &velocityZ_, &sizeX_, &sizeY_, &timer_, &timeToLive_, &scale_,
+        &rotationSpeed_})
+    {
+        array->Resize(paddedSize, 0.0f);
+    }
+
+    colorIndex_.Resize(paddedSize, 0);
+    texIndex_.Resize(paddedSize, 0);
+}
+
 ParticleEmitter::ParticleEmitter() :
     periodTimer_(0.0f),
     emissionTimer_(0.0f),
@@ -71,7 +90,7 @@ void ParticleEmitter::OnSetEnabled()
     if (scene)
     {
         if (IsEnabledEffective())
-            SubscribeToEvent(scene, E_SCENEPOSTUPDATE, DV_HANDLER(ParticleEmitter, HandleScenePostUpdate));
+            SubscribeToTypedEvent(scene, &ParticleEmitter::HandleScenePostUpdate);
         else
             UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
     }
@@ -145,98 +164,244 @@ void ParticleEmitter::Update(const FrameInfo& frame)
     }
 
     // Update existing particles
-    Vector3 relativeConstantForce = node_->GetWorldRotation().Inverse() * effect_->GetConstantForce();
+    if (UpdateParticles())
+        needCommit = true;
+
+    if (needCommit)
+        Commit();
+
+    needUpdate_ = false;
+}
+
+bool ParticleEmitter::UpdateParticles()
+{
+    DV_PROFILE(UpdateParticles);
+
+    bool anyEnabled = false;
+    const float timeStep = lastTimeStep_;
+
+    // Effect parameters are checked once. The calculations are done in the same order as for a single Vector3, so that
+    // the result does not depend on the position of the particle in the group of four
+    const Vector3& constantForce = effect_->GetConstantForce();
+    Vector3 force = relative_ ? node_->GetWorldRotation().Inverse() * constantForce : constantForce;
+    bool applyForce = constantForce != Vector3::ZERO;
+    float dampingForce = effect_->GetDampingForce();
+    float sizeAdd = effect_->GetSizeAdd();
+    float sizeMul = effect_->GetSizeMul();
+    bool applyScaling = sizeAdd != 0.0f || sizeMul != 1.0f;
+    const Vector<ColorFrame>& colorFrames = effect_->GetColorFrames();
+    const Vector<TextureFrame>& textureFrames = effect_->GetTextureFrames();
+
     // If billboards are not relative, apply scaling to the position update
     Vector3 scaleVector = Vector3::ONE;
     if (scaled_ && !relative_)
         scaleVector = node_->GetWorldScale();
 
-    for (i32 i = 0; i < particles_.Size(); ++i)
+    const __m128 dt = _mm_set1_ps(timeStep);
+    const __m128 forceX = _mm_set1_ps(force.x_);
+    const __m128 forceY = _mm_set1_ps(force.y_);
+    const __m128 forceZ = _mm_set1_ps(force.z_);
+    const __m128 negDamping = _mm_set1_ps(-dampingForce);
+    const __m128 scaleX = _mm_set1_ps(scaleVector.x_);
+    const __m128 scaleY = _mm_set1_ps(scaleVector.y_);
+    const __m128 scaleZ = _mm_set1_ps(scaleVector.z_);
+    const __m128 scaleAdd = _mm_mul_ps(dt, _mm_set1_ps(sizeAdd));
+    const __m128 scaleMul = _mm_add_ps(_mm_mul_ps(dt, _mm_set1_ps(sizeMul - 1.0f)), _mm_set1_ps(1.0f));
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(std::numeric_limits<float>::epsilon());
+
+    const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+
+    alignas(16) float position[3][4];
+    alignas(16) float rotation[4];
+    alignas(16) float direction[3][4];
+    alignas(16) float size[2][4];
+    alignas(16) float color[4][4];
+
+    Billboard* billboards = billboards_.Buffer();
+    i32 numParticles = particles_.Size();
+
+    for (i32 i = 0; i < numParticles; i += 4)
     {
-        Particle& particle = particles_[i];
-        Billboard& billboard = billboards_[i];
+        i32 count = Min(numParticles - i, 4);
+        i32 enabledMask = 0;
 
-        if (billboard.enabled_)
-        {
-            needCommit = true;
+        for (i32 j = 0; j < count; ++j)
+            enabledMask |= billboards[i + j].enabled_ ? 1 << j : 0;
 
-            // Time to live
-            if (particle.timer_ >= particle.timeToLive_)
-            {
-                billboard.enabled_ = false;
-                continue;
-            }
-            particle.timer_ += lastTimeStep_;
+        if (!enabledMask)
+            continue;
 
-            // Velocity & position
-            const Vector3& constantForce = effect_->GetConstantForce();
-            if (constantForce != Vector3::ZERO)
-            {
-                if (relative_)
-                    particle.velocity_ += lastTimeStep_ * relativeConstantForce;
-                else
-                    particle.velocity_ += lastTimeStep_ * constantForce;
-            }
+        anyEnabled = true;
 
-            float dampingForce = effect_->GetDampingForce();
-            if (dampingForce != 0.0f)
+        // Particles which have lived their time are disabled and not updated
+        __m128 timer = _mm_loadu_ps(&particles_.timer_[i]);
+        i32 aliveMask = enabledMask & ~_mm_movemask_ps(_mm_cmpge_ps(timer, _mm_loadu_ps(&particles_.timeToLive_[i])));
+
+        if (aliveMask != enabledMask)
+        {
+            for (i32 j = 0; j < count; ++j)
             {
-                Vector3 force = -dampingForce * particle.velocity_;
-                particle.velocity_ += lastTimeStep_ * force;
+                if ((enabledMask & ~aliveMask) & (1 << j))
+                    billboards[i + j].enabled_ = false;
             }
-            billboard.position_ += lastTimeStep_ * particle.velocity_ * scaleVector;
-            billboard.direction_ = particle.velocity_.Normalized();
 
-            // Rotation
-            billboard.rotation_ += lastTimeStep_ * particle.rotationSpeed_;
+            if (!aliveMask)
+                continue;
+        }
+
+        __m128i maskBits = _mm_and_si128(_mm_set1_epi32(aliveMask), laneBits);
+        __m128 alive = _mm_castsi128_ps(_mm_cmpeq_epi32(maskBits, laneBits));
+
+        timer = _mm_add_ps(timer, dt);
+
+        // Velocity & position
+        __m128 velocityX = _mm_loadu_ps(&particles_.velocityX_[i]);
+        __m128 velocityY = _mm_loadu_ps(&particles_.velocityY_[i]);
+        __m128 velocityZ = _mm_loadu_ps(&particles_.velocityZ_[i]);
 
-            // Scaling
-            float sizeAdd = effect_->GetSizeAdd();
-            float sizeMul = effect_->GetSizeMul();
-            if (sizeAdd != 0.0f || sizeMul != 1.0f)
+        if (applyForce)
+        {
+            velocityX = _mm_add_ps(velocityX, _mm_mul_ps(forceX, dt));
+            velocityY = _mm_add_ps(velocityY, _mm_mul_ps(forceY, dt));
+            velocityZ = _mm_add_ps(velocityZ, _mm_mul_ps(forceZ, dt));
+        }
+
+        if (dampingForce != 0.0f)
+        {
+            velocityX = _mm_add_ps(velocityX, _mm_mul_ps(_mm_mul_ps(velocityX, negDamping), dt));
+            velocityY = _mm_add_ps(velocityY, _mm_mul_ps(_mm_mul_ps(velocityY, negDamping), dt));
+            velocityZ = _mm_add_ps(velocityZ, _mm_mul_ps(_mm_mul_ps(velocityZ, negDamping), dt));
+        }
+
+        for (i32 j = 0; j < 4; ++j)
+        {
+            const Billboard& billboard = billboards[i + (j < count ? j : 0)];
+            position[0][j] = billboard.position_.x_;
+            position[1][j] = billboard.position_.y_;
+            position[2][j] = billboard.position_.z_;
+            rotation[j] = billboard.rotation_;
+        }
+
+        __m128 positionX = _mm_add_ps(_mm_load_ps(position[0]), _mm_mul_ps(_mm_mul_ps(velocityX, dt), scaleX));
+        __m128 positionY = _mm_add_ps(_mm_load_ps(position[1]), _mm_mul_ps(_mm_mul_ps(velocityY, dt), scaleY));
+        __m128 positionZ = _mm_add_ps(_mm_load_ps(position[2]), _mm_mul_ps(_mm_mul_ps(velocityZ, dt), scaleZ));
+        _mm_store_ps(position[0], positionX);
+        _mm_store_ps(position[1], positionY);
+        _mm_store_ps(position[2], positionZ);
+
+        // Direction is the normalized velocity like Vector3::Normalized()
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY)),
+            _mm_mul_ps(velocityZ, velocityZ));
+        __m128 unitLength = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(lengthSquared, epsilon), one),
+            _mm_cmple_ps(_mm_sub_ps(lengthSquared, epsilon), one));
+        __m128 normalize = _mm_andnot_ps(unitLength, _mm_cmpgt_ps(lengthSquared, zero));
+        __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+        __m128 directionScale = _mm_or_ps(_mm_and_ps(normalize, invLength), _mm_andnot_ps(normalize, one));
+        _mm_store_ps(direction[0], _mm_mul_ps(velocityX, directionScale));
+        _mm_store_ps(direction[1], _mm_mul_ps(velocityY, directionScale));
+        _mm_store_ps(direction[2], _mm_mul_ps(velocityZ, directionScale));
+
+        // Rotation
+        _mm_store_ps(rotation, _mm_add_ps(_mm_load_ps(rotation), _mm_mul_ps(dt, _mm_loadu_ps(&particles_.rotationSpeed_[i]))));
+
+        // Scaling
+        __m128 scale = _mm_loadu_ps(&particles_.scale_[i]);
+        if (applyScaling)
+        {
+            scale = _mm_max_ps(_mm_add_ps(scale, scaleAdd), zero);
+            if (sizeMul != 1.0f)
+                scale = _mm_mul_ps(scale, scaleMul);
+            _mm_store_ps(size[0], _mm_mul_ps(_mm_loadu_ps(&particles_.sizeX_[i]), scale));
+            _mm_store_ps(size[1], _mm_mul_ps(_mm_loadu_ps(&particles_.sizeY_[i]), scale));
+        }
+
+        // Store the state of the alive particles only
+        auto select = [alive](__m128 newValue, __m128 oldValue)
+        {
+            return _mm_or_ps(_mm_and_ps(alive, newValue), _mm_andnot_ps(alive, oldValue));
+        };
+        _mm_storeu_ps(&particles_.timer_[i], select(timer, _mm_loadu_ps(&particles_.timer_[i])));
+        _mm_storeu_ps(&particles_.velocityX_[i], select(velocityX, _mm_loadu_ps(&particles_.velocityX_[i])));
+        _mm_storeu_ps(&particles_.velocityY_[i], select(velocityY, _mm_loadu_ps(&particles_.velocityY_[i])));
+        _mm_storeu_ps(&particles_.velocityZ_[i], select(velocityZ, _mm_loadu_ps(&particles_.velocityZ_[i])));
+        _mm_storeu_ps(&particles_.scale_[i], select(scale, _mm_loadu_ps(&particles_.scale_[i])));
+
+        // Advance the color frames. The color is interpolated for four particles at a time if they are in the same frame
+        i32 colorIndex = NINDEX;
+        bool sameColorFrame = true;
+
+        for (i32 j = 0; j < count; ++j)
+        {
+            if (!(aliveMask & (1 << j)))
+                continue;
+
+            i32& index = particles_.colorIndex_[i + j];
+            if (index < colorFrames.Size() - 1 && particles_.timer_[i + j] >= colorFrames[index + 1].time_)
+                ++index;
+
+            if (colorIndex == NINDEX)
+                colorIndex = index;
+            else if (index != colorIndex)
+                sameColorFrame = false;
+        }
+
+        bool interpolateColors = sameColorFrame && colorIndex < colorFrames.Size() - 1 &&
+            colorFrames[colorIndex + 1].time_ - colorFrames[colorIndex].time_ > 0.0f;
+
+        if (interpolateColors)
+        {
+            // Same calculations as ColorFrame::Interpolate()
+            const ColorFrame& frame = colorFrames[colorIndex];
+            const ColorFrame& nextFrame = colorFrames[colorIndex + 1];
+            __m128 t = _mm_div_ps(_mm_sub_ps(timer, _mm_set1_ps(frame.time_)), _mm_set1_ps(nextFrame.time_ - frame.time_));
+            __m128 invT = _mm_sub_ps(one, t);
+
+            for (i32 k = 0; k < 4; ++k)
             {
-                particle.scale_ += lastTimeStep_ * sizeAdd;
-                if (particle.scale_ < 0.0f)
-                    particle.scale_ = 0.0f;
-                if (sizeMul != 1.0f)
-                    particle.scale_ *= (lastTimeStep_ * (sizeMul - 1.0f)) + 1.0f;
-                billboard.size_ = particle.size_ * particle.scale_;
+                _mm_store_ps(color[k], _mm_add_ps(_mm_mul_ps(_mm_set1_ps(frame.color_.Data()[k]), invT),
+                    _mm_mul_ps(_mm_set1_ps(nextFrame.color_.Data()[k]), t)));
             }
+        }
+
+        for (i32 j = 0; j < count; ++j)
+        {
+            if (!(aliveMask & (1 << j)))
+                continue;
+
+            Billboard& billboard = billboards[i + j];
+            billboard.position_ = Vector3(position[0][j], position[1][j], position[2][j]);
+            billboard.direction_ = Vector3(direction[0][j], direction[1][j], direction[2][j]);
+            billboard.rotation_ = rotation[j];
+            if (applyScaling)
+                billboard.size_ = Vector2(size[0][j], size[1][j]);
+
+            float particleTimer = particles_.timer_[i + j];
 
             // Color interpolation
-            i32& index = particle.colorIndex_;
-            const Vector<ColorFrame>& colorFrames_ = effect_->GetColorFrames();
-            if (index < colorFrames_.Size())
-            {
-                if (index < colorFrames_.Size() - 1)
-                {
-                    if (particle.timer_ >= colorFrames_[index + 1].time_)
-                        ++index;
-                }
-                if (index < colorFrames_.Size() - 1)
-                    billboard.color_ = colorFrames_[index].Interpolate(colorFrames_[index + 1], particle.timer_);
-                else
-                    billboard.color_ = colorFrames_[index].color_;
-            }
+            i32 index = particles_.colorIndex_[i + j];
+            if (interpolateColors)
+                billboard.color_ = Color(color[0][j], color[1][j], color[2][j], color[3][j]);
+            else if (index < colorFrames.Size() - 1)
+                billboard.color_ = colorFrames[index].Interpolate(colorFrames[index + 1], particleTimer);
+            else if (index < colorFrames.Size())
+                billboard.color_ = colorFrames[index].color_;
 
             // Texture animation
-            i32& texIndex = particle.texIndex_;
-            const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
-            if (textureFrames_.Size() && texIndex < textureFrames_.Size() - 1)
+            i32& texIndex = particles_.texIndex_[i + j];
+            if (textureFrames.Size() && texIndex < textureFrames.Size() - 1)
             {
-                if (particle.timer_ >= textureFrames_[texIndex + 1].time_)
+                if (particleTimer >= textureFrames[texIndex + 1].time_)
                 {
-                    billboard.uv_ = textureFrames_[texIndex + 1].uv_;
+                    billboard.uv_ = textureFrames[texIndex + 1].uv_;
                     ++texIndex;
                 }
             }
         }
     }
 
-    if (needCommit)
-        Commit();
-
-    needUpdate_ = false;
+    return anyEnabled;
 }
 
 void ParticleEmitter::SetEffect(ParticleEffect* effect)
@@ -350,16 +515,21 @@ void ParticleEmitter::SetParticlesAttr(const VariantVector& value)
     i32 index = 0;
     SetNumParticles(index < value.Size() ? value[index++].GetU32() : 0);
 
-    for (Vector<Particle>::Iterator i = particles_.Begin(); i != particles_.End() && index < value.Size(); ++i)
+    for (i32 i = 0; i < particles_.Size() && index < value.Size(); ++i)
     {
-        i->velocity_ = value[index++].GetVector3();
-        i->size_ = value[index++].GetVector2();
-        i->timer_ = value[index++].GetFloat();
-        i->timeToLive_ = value[index++].GetFloat();
-        i->scale_ = value[index++].GetFloat();
-        i->rotationSpeed_ = value[index++].GetFloat();
-        i->colorIndex_ = value[index++].GetI32();
-        i->texIndex_ = value[index++].GetI32();
+        Vector3 velocity = value[index++].GetVector3();
+        particles_.velocityX_[i] = velocity.x_;
+        particles_.velocityY_[i] = velocity.y_;
+        particles_.velocityZ_[i] = velocity.z_;
+        Vector2 size = value[index++].GetVector2();
+        particles_.sizeX_[i] = size.x_;
+        particles_.sizeY_[i] = size.y_;
+        particles_.timer_[i] = value[index++].GetFloat();
+        particles_.timeToLive_[i] = value[index++].GetFloat();
+        particles_.scale_[i] = value[index++].GetFloat();
+        particles_.rotationSpeed_[i] = value[index++].GetFloat();
+        particles_.colorIndex_[i] = value[index++].GetI32();
+        particles_.texIndex_[i] = value[index++].GetI32();
     }
 }
 
@@ -374,16 +544,16 @@ VariantVector ParticleEmitter::GetParticlesAttr() const
 
     ret.Reserve(particles_.Size() * 8 + 1);
     ret.Push(particles_.Size());
-    for (Vector<Particle>::ConstIterator i = particles_.Begin(); i != particles_.End(); ++i)
+    for (i32 i = 0; i < particles_.Size(); ++i)
     {
-        ret.Push(i->velocity_);
-        ret.Push(i->size_);
-        ret.Push(i->timer_);
-        ret.Push(i->timeToLive_);
-        ret.Push(i->scale_);
-        ret.Push(i->rotationSpeed_);
-        ret.Push(i->colorIndex_);
-        ret.Push(i->texIndex_);
+        ret.Push(Vector3(particles_.velocityX_[i], particles_.velocityY_[i], particles_.velocityZ_[i]));
+        ret.Push(Vector2(particles_.sizeX_[i], particles_.sizeY_[i]));
+        ret.Push(particles_.timer_[i]);
+        ret.Push(particles_.timeToLive_[i]);
+        ret.Push(particles_.scale_[i]);
+        ret.Push(particles_.rotationSpeed_[i]);
+        ret.Push(particles_.colorIndex_[i]);
+        ret.Push(particles_.texIndex_[i]);
     }
     return ret;
 }
@@ -419,7 +589,7 @@ void ParticleEmitter::OnSceneSet(Scene* scene)
     BillboardSet::OnSceneSet(scene);
 
     if (scene && IsEnabledEffective())
-        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, DV_HANDLER(ParticleEmitter, HandleScenePostUpdate));
+        SubscribeToTypedEvent(scene, &ParticleEmitter::HandleScenePostUpdate);
     else if (!scene)
          UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
 }
@@ -430,7 +600,6 @@ bool ParticleEmitter::EmitNewParticle()
     if (index == NINDEX)
         return false;
     assert(index < particles_.Size());
-    Particle& particle = particles_[index];
     Billboard& billboard = billboards_[index];
 
     Vector3 startDir;
@@ -492,17 +661,19 @@ bool ParticleEmitter::EmitNewParticle()
         break;
     }
 
-    particle.size_ = effect_->GetRandomSize();
-    particle.timer_ = 0.0f;
-    particle.timeToLive_ = effect_->GetRandomTimeToLive();
-    particle.scale_ = 1.0f;
-    particle.rotationSpeed_ = effect_->GetRandomRotationSpeed();
-    particle.colorIndex_ = 0;
-    particle.texIndex_ = 0;
+    Vector2 size = effect_->GetRandomSize();
+    particles_.sizeX_[index] = size.x_;
+    particles_.sizeY_[index] = size.y_;
+    particles_.timer_[index] = 0.0f;
+    particles_.timeToLive_[index] = effect_->GetRandomTimeToLive();
+    particles_.scale_[index] = 1.0f;
+    particles_.rotationSpeed_[index] = effect_->GetRandomRotationSpeed();
+    particles_.colorIndex_[index] = 0;
+    particles_.texIndex_[index] = 0;
 
     if (faceCameraMode_ == FC_DIRECTION)
     {
-        startPos += startDir * particle.size_.y_;
+        startPos += startDir * size.y_;
     }
 
     if (!relative_)
@@ -511,10 +682,13 @@ bool ParticleEmitter::EmitNewParticle()
         startDir = node_->GetWorldRotation() * startDir;
     };
 
-    particle.velocity_ = effect_->GetRandomVelocity() * startDir;
+    Vector3 velocity = effect_->GetRandomVelocity() * startDir;
+    particles_.velocityX_[index] = velocity.x_;
+    particles_.velocityY_[index] = velocity.y_;
+    particles_.velocityZ_[index] = velocity.z_;
 
     billboard.position_ = startPos;
-    billboard.size_ = particles_[index].size_;
+    billboard.size_ = size;
     const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
     billboard.uv_ = textureFrames_.Size() ? textureFrames_[0].uv_ : Rect::POSITIVE;
     billboard.rotation_ = effect_->GetRandomRotation();
@@ -551,12 +725,10 @@ bool ParticleEmitter::CheckActiveParticles() const
     return false;
 }
 
-void ParticleEmitter::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+void ParticleEmitter::HandleScenePostUpdate(ScenePostUpdateEvent& event)
 {
     // Store scene's timestep and use it instead of global timestep, as time scale may be other than 1
-    using namespace ScenePostUpdate;
-
-    lastTimeStep_ = eventData[P_TIMESTEP].GetFloat();
+    lastTimeStep_ = event.timeStep_;
 
     // If no invisible update, check that the billboardset is in view (framenumber has changed)
     if ((effect_ && effect_->GetUpdateInvisible()) || viewFrameNumber_ != lastUpdateFrameNumber_)
@@ -10,26 +10,43 @@ namespace dviglo
 {
 
 class ParticleEffect;
+struct ScenePostUpdateEvent;
 
-/// One particle in the particle system.
-struct Particle
+/// Simulation state of the particles in the particle system in structure of arrays layout, so that the particles can be
+/// updated four at a time. The arrays are padded to a multiple of four. Position, rotation and enabled state are stored
+/// in the billboards.
+struct DV_API ParticleArrays
 {
-    /// Velocity.
-    Vector3 velocity_;
-    /// Original billboard size.
-    Vector2 size_;
+    /// Set number of particles. The state of new particles is zeroed.
+    void Resize(i32 num);
+
+    /// Return number of particles.
+    i32 Size() const { return size_; }
+
+    /// Number of particles.
+    i32 size_ = 0;
+    /// Velocity X.
+    Vector<float> velocityX_;
+    /// Velocity Y.
+    Vector<float> velocityY_;
+    /// Velocity Z.
+    Vector<float> velocityZ_;
+    /// Original billboard width.
+    Vector<float> sizeX_;
+    /// Original billboard height.
+    Vector<float> sizeY_;
     /// Time elapsed from creation.
-    float timer_;
+    Vector<float> timer_;
     /// Lifetime.
-    float timeToLive_;
+    Vector<float> timeToLive_;
     /// Size scaling value.
-    float scale_;
+    Vector<float> scale_;
     /// Rotation speed.
-    float rotationSpeed_;
+    Vector<float> rotationSpeed_;
     /// Current color animation index.
-    i32 colorIndex_;
+    Vector<i32> colorIndex_;
     /// Current texture animation index.
-    i32 texIndex_;
+    Vector<i32> texIndex_;
 };
 
 /// %Particle emitter component.
@@ -74,6 +91,8 @@ public:
 
     /// Return maximum number of particles.
     i32 GetNumParticles() const { return particles_.Size(); }
+    /// Return simulation state of the particles.
+    const ParticleArrays& GetParticles() const { return particles_; }
 
     /// Return whether is currently emitting.
     bool IsEmitting() const { return emitting_; }
@@ -108,14 +127,16 @@ protected:
 
 private:
     /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleScenePostUpdate(ScenePostUpdateEvent& event);
     /// Handle live reload of the particle effect.
     void HandleEffectReloadFinished(StringHash eventType, VariantMap& eventData);
+    /// Update existing particles four at a time. Return true if any particle was enabled.
+    bool UpdateParticles();
 
     /// Particle effect.
     SharedPtr<ParticleEffect> effect_;
     /// Particles.
-    Vector<Particle> particles_;
+    ParticleArrays particles_;
     /// Active/inactive period timer.
     float periodTimer_;
     /// New particle emission timer.
@@ -501,6 +501,20 @@ void Renderer::SetThreadedOcclusion(bool enable)
     }
 }
 
+void Renderer::SetTemporalOcclusion(bool enable)
+{
+    if (enable != temporalOcclusion_)
+    {
+        temporalOcclusion_ = enable;
+        occlusionBuffers_.Clear();
+    }
+}
+
+void Renderer::SetMaxOcclusionHistoryAge(int frames)
+{
+    maxOcclusionHistoryAge_ = Max(frames, 1);
+}
+
 void Renderer::ReloadShaders()
 {
     shadersDirty_ = true;
@@ -1098,6 +1112,18 @@ OcclusionBuffer* Renderer::GetOcclusionBuffer(Camera* camera)
         SharedPtr<OcclusionBuffer> newBuffer(new OcclusionBuffer());
         occlusionBuffers_.Push(newBuffer);
     }
+    else if (temporalOcclusion_)
+    {
+        // Prefer the buffer which holds the previous frame as seen from the same camera
+        for (i32 i = numOcclusionBuffers_ + 1; i < occlusionBuffers_.Size(); ++i)
+        {
+            if (occlusionBuffers_[i]->HasHistory(camera))
+            {
+                occlusionBuffers_[i].Swap(occlusionBuffers_[numOcclusionBuffers_]);
+                break;
+            }
+        }
+    }
 
     int width = occlusionBufferSize_;
     auto height = RoundToInt(occlusionBufferSize_ / camera->GetAspectRatio());
@@ -1602,7 +1628,8 @@ void Renderer::Initialize()
 
     initialized_ = true;
 
-    SubscribeToEvent(E_RENDERUPDATE, DV_HANDLER(Renderer, HandleRenderUpdate));
+    SubscribeToTypedEvent(&Renderer::HandleRenderUpdate);
+    SubscribeToEvent(E_ENDFRAME, DV_HANDLER(Renderer, HandleEndFrame));
 
     DV_LOGINFO("Initialized renderer");
 }
@@ -1956,11 +1983,14 @@ void Renderer::HandleScreenMode(StringHash eventType, VariantMap& eventData)
         resetViews_ = true;
 }
 
-void Renderer::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
+void Renderer::HandleRenderUpdate(RenderUpdateEvent& event)
 {
-    using namespace RenderUpdate;
+    Update(event.timeStep_);
+}
 
-    Update(eventData[P_TIMESTEP].GetFloat());
+void Renderer::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    frameAllocator_.Reset();
 }
 
 
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "../containers/arena_allocator.h"
 #include "../containers/hash_set.h"
 #include "batch.h"
 #include "drawable.h"
@@ -38,6 +39,7 @@ class TextureCube;
 class View;
 class Zone;
 struct BatchQueue;
+struct RenderUpdateEvent;
 
 static const int SHADOW_MIN_PIXELS = 64;
 static const int INSTANCING_BUFFER_DEFAULT_SIZE = 1024;
@@ -223,6 +225,10 @@ public:
     void SetOccluderSizeThreshold(float screenSize);
     /// Set whether to thread occluder rendering. Default false.
     void SetThreadedOcclusion(bool enable);
+    /// Set whether to reproject the occlusion depth of the previous frame and draw only new or moved occluders on top. Default false.
+    void SetTemporalOcclusion(bool enable);
+    /// Set number of frames after which the reprojected occlusion depth is rebuilt from scratch. Default 8.
+    void SetMaxOcclusionHistoryAge(int frames);
     /// Set shadow depth bias multiplier for mobile platforms to counteract possible worse shadow map precision. Default 1.0 (no effect).
     void SetMobileShadowBiasMul(float mul);
     /// Set shadow depth bias addition for mobile platforms to counteract possible worse shadow map precision. Default 0.0 (no effect).
@@ -313,6 +319,12 @@ public:
     /// Return whether occlusion rendering is threaded.
     bool GetThreadedOcclusion() const { return threadedOcclusion_; }
 
+    /// Return whether occlusion depth is reprojected from the previous frame.
+    bool GetTemporalOcclusion() const { return temporalOcclusion_; }
+
+    /// Return number of frames after which the reprojected occlusion depth is rebuilt from scratch.
+    int GetMaxOcclusionHistoryAge() const { return maxOcclusionHistoryAge_; }
+
     /// Return shadow depth bias multiplier for mobile platforms.
     float GetMobileShadowBiasMul() const { return mobileShadowBiasMul_; }
 
@@ -364,6 +376,13 @@ public:
     /// Return the frame update parameters.
     const FrameInfo& GetFrameInfo() const { return frame_; }
 
+    /// Return allocator for temporary data, which is released at the end of the frame. Must be used only from the main thread.
+    ArenaAllocator* GetFrameAllocator() { return &frameAllocator_; }
+
+    /// Return number of heap allocations made by the frame allocator. Does not change when the amount of temporary data
+    /// does not grow.
+    i32 GetNumFrameHeapAllocations() const { return frameAllocator_.GetNumHeapAllocations(); }
+
     /// Update for rendering. Called by HandleRenderUpdate().
     void Update(float timeStep);
     /// Render. Called by Engine.
@@ -449,7 +468,9 @@ private:
     /// Handle screen mode event.
     void HandleScreenMode(StringHash eventType, VariantMap& eventData);
     /// Handle render update event.
-    void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleRenderUpdate(RenderUpdateEvent& event);
+    /// Handle end frame event. Release the temporary data of the frame.
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
     /// Blur the shadow map.
     void BlurShadowMap(View* view, Texture2D* shadowMap, float blurScale);
 
@@ -513,6 +534,8 @@ private:
     HashSet<Technique*> shaderErrorDisplayed_;
     /// Mutex for shadow camera allocation.
     std::mutex rendererMutex_;
+    /// Allocator for temporary data of the frame.
+    ArenaAllocator frameAllocator_;
     /// Current variation names for deferred light volume shaders.
     Vector<String> deferredLightPSVariations_;
     /// Frame info for rendering.
@@ -547,6 +570,8 @@ private:
     int occlusionBufferSize_{256};
     /// Occluder screen size threshold.
     float occluderSizeThreshold_{0.025f};
+    /// Number of frames after which the reprojected occlusion depth is rebuilt.
+    int maxOcclusionHistoryAge_{8};
     /// Mobile platform shadow depth bias multiplier.
     float mobileShadowBiasMul_{1.0f};
     /// Mobile platform shadow depth bias addition.
@@ -579,6 +604,8 @@ private:
     int numExtraInstancingBufferElements_{};
     /// Threaded occlusion rendering flag.
     bool threadedOcclusion_{};
+    /// Temporal occlusion flag.
+    bool temporalOcclusion_{};
     /// Shaders need reloading flag.
     bool shadersDirty_{true};
     /// Initialized flag.
@@ -4,6 +4,7 @@
 
 #include "../core/context.h"
 #include "camera.h"
+#include "distance_sort.h"
 #include "geometry.h"
 #include "material.h"
 #include "octree_query.h"
@@ -28,11 +29,6 @@ const char* trailTypeNames[] =
     nullptr
 };
 
-inline bool CompareTails(TrailPoint* lhs, TrailPoint* rhs)
-{
-    return lhs->sortDistance_ > rhs->sortDistance_;
-}
-
 TrailPoint::TrailPoint(const Vector3& position, const Vector3& forward) :
     position_{position},
     forward_{forward}
@@ -528,17 +524,27 @@ void RibbonTrail::UpdateVertexBuffer(const FrameInfo& frame)
 
     // Fill sorted points vector
     sortedPoints_.Resize(numPoints_);
+    if (sorted_)
+        sortKeys_.Resize(numPoints_);
+
     for (unsigned i = 0; i < numPoints_; ++i)
     {
         TrailPoint& point = points_[i];
         sortedPoints_[i] = &point;
         if (sorted_)
+        {
             point.sortDistance_ = frame.camera_->GetDistanceSquared(point.position_);
+            sortKeys_[i] = BackToFrontSortKey(point.sortDistance_, i);
+        }
     }
 
     // Sort points
     if (sorted_)
-        std::sort(sortedPoints_.Begin(), sortedPoints_.End(), CompareTails);
+    {
+        SortBackToFront(sortKeys_, sortTemp_);
+        for (unsigned i = 0; i < numPoints_; ++i)
+            sortedPoints_[i] = &points_[(u32)sortKeys_[i]];
+    }
 
     // Update individual trail elapsed length
     float trailLength = 0.0f;
@@ -223,6 +223,10 @@ private:
     Vector3 previousOffset_;
     /// Trail pointers for sorting.
     Vector<TrailPoint*> sortedPoints_;
+    /// Distance sort keys of the points.
+    Vector<u64> sortKeys_;
+    /// Temporary buffer for distance sort.
+    Vector<u64> sortTemp_;
     /// Force update flag (ignore animation LOD momentarily).
     bool forceUpdate_;
     /// Currently emitting flag.
@@ -0,0 +1,213 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../math/ray.h"
+#include "triangle_bvh.h"
+
+#include <algorithm>
+
+#include "../common/debug_new.h"
+
+namespace dviglo
+{
+
+// Enough for the depth of a hierarchy which is split at the median
+static const i32 MAX_STACK_SIZE = 64;
+
+void TriangleBvh::Build(const void* vertexData, i32 vertexSize, const void* indexData, i32 indexSize, i32 indexStart, i32 indexCount)
+{
+    assert(vertexSize > 0 && indexStart >= 0 && indexCount >= 0);
+
+    const byte* vertices = (const byte*)vertexData;
+    vertices_.Resize(indexCount / 3 * 3);
+
+    if (indexSize == sizeof(u16))
+    {
+        const u16* indices = (const u16*)indexData + indexStart;
+        for (i32 i = 0; i < vertices_.Size(); ++i)
+            vertices_[i] = *(const Vector3*)(vertices + indices[i] * vertexSize);
+    }
+    else
+    {
+        const u32* indices = (const u32*)indexData + indexStart;
+        for (i32 i = 0; i < vertices_.Size(); ++i)
+            vertices_[i] = *(const Vector3*)(vertices + (size_t)indices[i] * vertexSize);
+    }
+
+    Build();
+}
+
+void TriangleBvh::Build(const void* vertexData, i32 vertexSize, i32 vertexStart, i32 vertexCount)
+{
+    assert(vertexSize > 0 && vertexStart >= 0 && vertexCount >= 0);
+
+    const byte* vertices = (const byte*)vertexData + (size_t)vertexStart * vertexSize;
+    vertices_.Resize(vertexCount / 3 * 3);
+
+    for (i32 i = 0; i < vertices_.Size(); ++i)
+        vertices_[i] = *(const Vector3*)(vertices + (size_t)i * vertexSize);
+
+    Build();
+}
+
+void TriangleBvh::Clear()
+{
+    nodes_.Clear();
+    vertices_.Clear();
+    triangles_.Clear();
+}
+
+void TriangleBvh::Build()
+{
+    i32 numTriangles = vertices_.Size() / 3;
+    nodes_.Clear();
+    triangles_.Resize(numTriangles);
+    centers_.Resize(numTriangles);
+
+    for (i32 i = 0; i < numTriangles; ++i)
+    {
+        const Vector3* v = &vertices_[i * 3];
+        triangles_[i] = i;
+        centers_[i] = (VectorMin(VectorMin(v[0], v[1]), v[2]) + VectorMax(VectorMax(v[0], v[1]), v[2])) * 0.5f;
+    }
+
+    if (numTriangles)
+    {
+        nodes_.Reserve(numTriangles / MAX_LEAF_TRIANGLES * 2 + 1);
+        BuildNode(0, numTriangles);
+    }
+
+    // Store the vertices in the order of the leaves, so that a leaf reads them sequentially
+    Vector<Vector3> sourceVertices;
+    sourceVertices.Swap(vertices_);
+    vertices_.Resize(sourceVertices.Size());
+
+    for (i32 i = 0; i < numTriangles; ++i)
+    {
+        const Vector3* v = &sourceVertices[triangles_[i] * 3];
+        vertices_[i * 3] = v[0];
+        vertices_[i * 3 + 1] = v[1];
+        vertices_[i * 3 + 2] = v[2];
+    }
+
+    centers_.Clear();
+}
+
+i32 TriangleBvh::BuildNode(i32 first, i32 count)
+{
+    BoundingBox box;
+    BoundingBox centerBox;
+
+    for (i32 i = first; i < first + count; ++i)
+    {
+        const Vector3* v = &vertices_[triangles_[i] * 3];
+        box.Merge(v[0]);
+        box.Merge(v[1]);
+        box.Merge(v[2]);
+        centerBox.Merge(centers_[triangles_[i]]);
+    }
+
+    i32 index = nodes_.Size();
+    nodes_.Push(Node{box, NINDEX, first, count});
+
+    if (count <= MAX_LEAF_TRIANGLES)
+        return index;
+
+    // Split at the median along the longest axis of the centers, which keeps the hierarchy balanced
+    Vector3 size = centerBox.Size();
+    i32 axis = size.x_ >= size.y_ && size.x_ >= size.z_ ? 0 : (size.y_ >= size.z_ ? 1 : 2);
+    i32 half = count / 2;
+
+    std::nth_element(triangles_.Begin() + first, triangles_.Begin() + first + half, triangles_.Begin() + first + count,
+        [this, axis](i32 lhs, i32 rhs) { return centers_[lhs].Data()[axis] < centers_[rhs].Data()[axis]; });
+
+    BuildNode(first, half);
+    i32 secondChild = BuildNode(first + half, count - half);
+    nodes_[index].secondChild_ = secondChild;
+
+    return index;
+}
+
+float TriangleBvh::HitDistance(const Ray& ray, Vector3* outNormal, Vector3* outBary, i32* outTriangle) const
+{
+    float nearest = M_INFINITY;
+    i32 nearestTriangle = NINDEX;
+
+    if (nodes_.Empty() || ray.HitDistance(nodes_[0].box_) == M_INFINITY)
+    {
+        if (outTriangle)
+            *outTriangle = NINDEX;
+        return nearest;
+    }
+
+    Vector3 normal;
+    Vector3* normalPtr = outNormal ? &normal : nullptr;
+    Vector3 bary;
+    Vector3* baryPtr = outBary ? &bary : nullptr;
+
+    // Node index and the hit distance to its bounding box
+    i32 stack[MAX_STACK_SIZE];
+    float distanceStack[MAX_STACK_SIZE];
+    i32 stackSize = 0;
+    stack[stackSize] = 0;
+    distanceStack[stackSize++] = 0.0f;
+
+    while (stackSize)
+    {
+        --stackSize;
+        if (distanceStack[stackSize] >= nearest)
+            continue;
+
+        const Node& node = nodes_[stack[stackSize]];
+
+        if (node.secondChild_ == NINDEX)
+        {
+            for (i32 i = node.first_; i < node.first_ + node.count_; ++i)
+            {
+                const Vector3* v = &vertices_[i * 3];
+                float distance = ray.HitDistance(v[0], v[1], v[2], normalPtr, baryPtr);
+                if (distance < nearest)
+                {
+                    nearest = distance;
+                    nearestTriangle = i;
+
+                    if (outNormal)
+                        *outNormal = normal;
+                    if (outBary)
+                        *outBary = bary;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so that the farther one can be skipped after a closer hit
+        i32 nearChild = (i32)(&node - nodes_.Buffer()) + 1;
+        i32 farChild = node.secondChild_;
+        float nearDistance = ray.HitDistance(nodes_[nearChild].box_);
+        float farDistance = ray.HitDistance(nodes_[farChild].box_);
+
+        if (farDistance < nearDistance)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+
+        if (farDistance < nearest)
+        {
+            stack[stackSize] = farChild;
+            distanceStack[stackSize++] = farDistance;
+        }
+        if (nearDistance < nearest)
+        {
+            stack[stackSize] = nearChild;
+            distanceStack[stackSize++] = nearDistance;
+        }
+    }
+
+    if (outTriangle)
+        *outTriangle = nearestTriangle != NINDEX ? triangles_[nearestTriangle] : NINDEX;
+
+    return nearest;
+}
+
+}
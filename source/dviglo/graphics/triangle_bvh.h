@@ -0,0 +1,69 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+/// \file
+
+#pragma once
+
+#include "../containers/vector.h"
+#include "../math/bounding_box.h"
+
+namespace dviglo
+{
+
+class Ray;
+
+/// Bounding volume hierarchy of the triangles of a triangle list, for ray queries. Vertex positions are copied, so the
+/// source data is not needed after the build.
+class DV_API TriangleBvh
+{
+public:
+    /// Build from indexed vertex data. Position must be the first vertex element.
+    void Build(const void* vertexData, i32 vertexSize, const void* indexData, i32 indexSize, i32 indexStart, i32 indexCount);
+    /// Build from non-indexed vertex data. Position must be the first vertex element.
+    void Build(const void* vertexData, i32 vertexSize, i32 vertexStart, i32 vertexCount);
+    /// Remove all triangles.
+    void Clear();
+
+    /// Return hit distance to the closest triangle, or infinity if no hit. Optionally return hit normal, hit barycentric
+    /// coordinate and the index of the hit triangle in the source data relative to the start of the range.
+    float HitDistance(const Ray& ray, Vector3* outNormal = nullptr, Vector3* outBary = nullptr, i32* outTriangle = nullptr) const;
+
+    /// Return number of triangles.
+    i32 GetNumTriangles() const { return triangles_.Size(); }
+    /// Return bounding box of all triangles.
+    BoundingBox GetBoundingBox() const { return nodes_.Size() ? nodes_[0].box_ : BoundingBox(); }
+
+    /// Maximum number of triangles in a leaf node.
+    static constexpr i32 MAX_LEAF_TRIANGLES = 4;
+
+private:
+    /// Hierarchy node.
+    struct Node
+    {
+        /// Bounding box of the triangles in the node.
+        BoundingBox box_;
+        /// Index of the second child node or NINDEX for a leaf. The first child node always follows its parent.
+        i32 secondChild_;
+        /// Index of the first triangle.
+        i32 first_;
+        /// Number of triangles.
+        i32 count_;
+    };
+
+    /// Build from the vertex positions of the triangles.
+    void Build();
+    /// Build a node and its children from a range of triangles. Return the node index.
+    i32 BuildNode(i32 first, i32 count);
+
+    /// Nodes in depth-first order.
+    Vector<Node> nodes_;
+    /// Vertex positions of the triangles in the order of the leaves, 3 per triangle.
+    Vector<Vector3> vertices_;
+    /// Indices of the triangles in the source data in the order of the leaves.
+    Vector<i32> triangles_;
+    /// Bounding box centers of the triangles during the build.
+    Vector<Vector3> centers_;
+};
+
+}
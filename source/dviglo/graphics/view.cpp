@@ -3,7 +3,7 @@
 // License: MIT
 
 #include "../core/profiler.h"
-#include "../core/work_queue.h"
+#include "../core/task_graph.h"
 #include "camera.h"
 #include "debug_renderer.h"
 #include "geometry.h"
@@ -36,34 +36,6 @@
 namespace dviglo
 {
 
-/// %Frustum octree query for shadowcasters.
-class ShadowCasterOctreeQuery : public FrustumOctreeQuery
-{
-public:
-    /// Construct with frustum and query parameters.
-    ShadowCasterOctreeQuery(Vector<Drawable*>& result, const Frustum& frustum, DrawableTypes drawableTypes = DrawableTypes::Any,
-        unsigned viewMask = DEFAULT_VIEWMASK) :
-        FrustumOctreeQuery(result, frustum, drawableTypes, viewMask)
-    {
-    }
-
-    /// Intersection test for drawables.
-    void TestDrawables(Drawable** start, Drawable** end, bool inside) override
-    {
-        while (start != end)
-        {
-            Drawable* drawable = *start++;
-
-            if (drawable->GetCastShadows() && !!(drawable->GetDrawableType() & drawableTypes_) &&
-                (drawable->GetViewMask() & viewMask_))
-            {
-                if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                    result_.Push(drawable);
-            }
-        }
-    }
-};
-
 /// %Frustum octree query for zones and occluders.
 class ZoneOccluderOctreeQuery : public FrustumOctreeQuery
 {
@@ -138,11 +110,10 @@ public:
     OcclusionBuffer* buffer_;
 };
 
-void CheckVisibilityWork(const WorkItem* item, i32 threadIndex)
+void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, i32 threadIndex)
 {
-    auto* view = reinterpret_cast<View*>(item->aux_);
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
+    DV_PROFILE(CheckVisibilityWork);
+
     OcclusionBuffer* buffer = view->occlusionBuffer_;
     const Matrix3x4& viewMatrix = view->cullCamera_->GetView();
     Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
@@ -207,19 +178,9 @@ void CheckVisibilityWork(const WorkItem* item, i32 threadIndex)
     }
 }
 
-void ProcessLightWork(const WorkItem* item, i32 threadIndex)
+static void UpdateDrawableGeometriesWork(Drawable** start, Drawable** end, const FrameInfo& frame)
 {
-    auto* view = reinterpret_cast<View*>(item->aux_);
-    auto* query = reinterpret_cast<LightQueryResult*>(item->start_);
-
-    view->ProcessLight(*query, threadIndex);
-}
-
-void UpdateDrawableGeometriesWork(const WorkItem* item, i32 threadIndex)
-{
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
+    DV_PROFILE(UpdateDrawableGeometriesWork);
 
     while (start != end)
     {
@@ -230,36 +191,14 @@ void UpdateDrawableGeometriesWork(const WorkItem* item, i32 threadIndex)
     }
 }
 
-void SortBatchQueueFrontToBackWork(const WorkItem* item, i32 threadIndex)
-{
-    auto* queue = reinterpret_cast<BatchQueue*>(item->start_);
-
-    queue->SortFrontToBack();
-}
-
-void SortBatchQueueBackToFrontWork(const WorkItem* item, i32 threadIndex)
-{
-    auto* queue = reinterpret_cast<BatchQueue*>(item->start_);
-
-    queue->SortBackToFront();
-}
-
-void SortLightQueueWork(const WorkItem* item, i32 threadIndex)
-{
-    auto* start = reinterpret_cast<LightBatchQueue*>(item->start_);
-    start->litBaseBatches_.SortFrontToBack();
-    start->litBatches_.SortFrontToBack();
-}
-
-void SortShadowQueueWork(const WorkItem* item, i32 threadIndex)
-{
-    LightBatchQueue* start = reinterpret_cast<LightBatchQueue*>(item->start_);
-    for (ShadowBatchQueue& shadowSplit : start->shadowSplits_)
-        shadowSplit.shadowBatches_.SortFrontToBack();
-}
 
 StringHash ParseTextureTypeXml(ResourceCache* cache, const String& filename);
 
+/// Minimum number of drawables checked for visibility by one work item.
+static constexpr i32 VISIBILITY_CHECK_GRAIN = 64;
+/// Minimum number of drawables updated by one work item.
+static constexpr i32 GEOMETRY_UPDATE_GRAIN = 16;
+
 View::View() :
     graphics_(GetSubsystem<Graphics>()),
     renderer_(GetSubsystem<Renderer>())
@@ -268,8 +207,11 @@ View::View() :
     i32 numThreads = GetSubsystem<WorkQueue>()->GetNumThreads() + 1; // Worker threads + main thread
     tempDrawables_.Resize(numThreads);
     sceneResults_.Resize(numThreads);
+    tempFrustumVolumes_.Resize(numThreads);
 }
 
+View::~View() = default;
+
 bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
 {
     sourceView_ = nullptr;
@@ -504,6 +446,13 @@ void View::Update(const FrameInfo& frame)
 
     using namespace BeginViewUpdate;
 
+    if (!frameGraph_)
+        frameGraph_ = new TaskGraph(GetSubsystem<WorkQueue>());
+
+    // Event handlers may add tasks to the graph
+    frameGraph_->Clear();
+    combineTask_ = -1;
+    lightsTask_ = -1;
     SendViewEvent(E_BEGINVIEWUPDATE);
 
     int maxSortedInstances = renderer_->GetMaxSortedInstances();
@@ -521,6 +470,8 @@ void View::Update(const FrameInfo& frame)
 
     if (hasScenePasses_ && (!cullCamera_ || !octree_))
     {
+        frameGraph_->Run();
+        frameGraph_->Wait();
         SendViewEvent(E_ENDVIEWUPDATE);
         return;
     }
@@ -529,8 +480,13 @@ void View::Update(const FrameInfo& frame)
     if (cullCamera_ && cullCamera_->GetAutoAspectRatio())
         cullCamera_->SetAspectRatioInternal((float)frame_.viewSize_.x_ / (float)frame_.viewSize_.y_);
 
+    // Occlusion, visibility checks and light processing follow each other in the worker threads, while the main thread
+    // builds the batches of the processed lights
     GetDrawables();
+    ProcessLights();
+    frameGraph_->Run();
     GetBatches();
+    frameGraph_->Wait();
     renderer_->StorePreparedView(this, cullCamera_);
 
     SendViewEvent(E_ENDVIEWUPDATE);
@@ -780,8 +736,9 @@ void View::GetDrawables()
 
     DV_PROFILE(GetDrawables);
 
-    auto* queue = GetSubsystem<WorkQueue>();
     Vector<Drawable*>& tempDrawables = tempDrawables_[0];
+    // Tasks added by the E_BEGINVIEWUPDATE handlers
+    i32 numBeginTasks = frameGraph_->GetNumTasks();
 
     // Get zones and occluders first
     {
@@ -839,6 +796,7 @@ void View::GetDrawables()
 
     // If occlusion in use, get & render the occluders
     occlusionBuffer_ = nullptr;
+    i32 occlusionTask = -1;
     if (maxOccluderTriangles_ > 0)
     {
         UpdateOccluders(occluders_, cullCamera_);
@@ -847,27 +805,39 @@ void View::GetDrawables()
             DV_PROFILE(DrawOcclusion);
 
             occlusionBuffer_ = renderer_->GetOcclusionBuffer(cullCamera_);
-            DrawOccluders(occlusionBuffer_, occluders_);
+            occlusionTask = DrawOccluders(occlusionBuffer_, occluders_);
         }
     }
     else
         occluders_.Clear();
 
-    // Get lights and geometries. Coarse occlusion for octants is used at this point
-    if (occlusionBuffer_)
-    {
-        OccludedFrustumOctreeQuery query
-            (tempDrawables, cullCamera_->GetFrustum(), occlusionBuffer_, DrawableTypes::Geometry | DrawableTypes::Light, cullCamera_->GetViewMask());
-        octree_->GetDrawables(query);
-    }
-    else
+    // Check drawable occlusion, find zones for moved drawables and collect geometries & lights in worker threads.
+    // The range is set when the drawables are known
+    i32 visibilityTask = frameGraph_->AddParallelFor(VISIBILITY_CHECK_GRAIN, [this](i32 begin, i32 end, i32 threadIndex)
     {
-        FrustumOctreeQuery query(tempDrawables, cullCamera_->GetFrustum(), DrawableTypes::Geometry | DrawableTypes::Light, cullCamera_->GetViewMask());
-        octree_->GetDrawables(query);
-    }
+        Vector<Drawable*>& drawables = tempDrawables_[0];
+        CheckVisibilityWork(this, drawables.Buffer() + begin, drawables.Buffer() + end, threadIndex);
+    });
 
-    // Check drawable occlusion, find zones for moved drawables and collect geometries & lights in worker threads
+    // Get lights and geometries. Coarse occlusion for octants is used at this point
+    i32 queryTask = frameGraph_->AddTask([this, visibilityTask](i32, i32, i32)
     {
+        DV_PROFILE(QueryDrawables);
+
+        Vector<Drawable*>& drawables = tempDrawables_[0];
+
+        if (occlusionBuffer_)
+        {
+            OccludedFrustumOctreeQuery query
+                (drawables, cullCamera_->GetFrustum(), occlusionBuffer_, DrawableTypes::Geometry | DrawableTypes::Light, cullCamera_->GetViewMask());
+            octree_->GetDrawables(query);
+        }
+        else
+        {
+            FrustumOctreeQuery query(drawables, cullCamera_->GetFrustum(), DrawableTypes::Geometry | DrawableTypes::Light, cullCamera_->GetViewMask());
+            octree_->GetDrawables(query);
+        }
+
         for (PerThreadSceneResult& result : sceneResults_)
         {
             result.geometries_.Clear();
@@ -876,32 +846,27 @@ void View::GetDrawables()
             result.maxZ_ = 0.0f;
         }
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.Size() / numWorkItems;
+        frameGraph_->SetRange(visibilityTask, 0, drawables.Size());
+    });
 
-        Vector<Drawable*>::Iterator start = tempDrawables.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = WI_MAX_PRIORITY;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            Vector<Drawable*>::Iterator end = tempDrawables.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
+    combineTask_ = frameGraph_->AddTask([this](i32, i32, i32)
+    {
+        DV_PROFILE(CombineSceneResults);
+        CombineSceneResults();
+    });
 
-            start = end;
-        }
+    if (occlusionTask >= 0)
+        frameGraph_->AddDependency(queryTask, occlusionTask);
+    frameGraph_->AddDependency(visibilityTask, queryTask);
+    frameGraph_->AddDependency(combineTask_, visibilityTask);
 
-        queue->Complete(WI_MAX_PRIORITY);
-    }
+    // Drawables may use the results of the event handler tasks when their batches are updated
+    for (i32 i = 0; i < numBeginTasks; ++i)
+        frameGraph_->AddDependency(visibilityTask, i);
+}
 
+void View::CombineSceneResults()
+{
     // Combine lights, geometries & scene Z range from the threads
     geometries_.Clear();
     lights_.Clear();
@@ -939,6 +904,13 @@ void View::GetDrawables()
     }
 
     std::sort(lights_.Begin(), lights_.End(), CompareLights);
+
+    lightQueryResults_.Resize(lights_.Size());
+    for (i32 i = 0; i < lightQueryResults_.Size(); ++i)
+        lightQueryResults_[i].light_ = lights_[i];
+
+    if (lightsTask_ >= 0)
+        frameGraph_->SetRange(lightsTask_, 0, lightQueryResults_.Size());
 }
 
 void View::GetBatches()
@@ -949,35 +921,25 @@ void View::GetBatches()
     nonThreadedGeometries_.Clear();
     threadedGeometries_.Clear();
 
-    ProcessLights();
+    // Wait for the visible geometries and lights
+    frameGraph_->Wait(combineTask_);
     GetLightBatches();
     GetBaseBatches();
 }
 
 void View::ProcessLights()
 {
-    // Process lit geometries and shadow casters for each light
-    DV_PROFILE(ProcessLights);
-
-    auto* queue = GetSubsystem<WorkQueue>();
-    lightQueryResults_.Resize(lights_.Size());
+    if (combineTask_ < 0)
+        return;
 
-    for (i32 i = 0; i < lightQueryResults_.Size(); ++i)
+    // Process lit geometries and shadow casters for each light. The range is set when the lights are known
+    lightsTask_ = frameGraph_->AddParallelFor(1, [this](i32 begin, i32 end, i32 threadIndex)
     {
-        SharedPtr<WorkItem> item = queue->GetFreeItem();
-        item->priority_ = WI_MAX_PRIORITY;
-        item->workFunction_ = ProcessLightWork;
-        item->aux_ = this;
+        for (i32 i = begin; i < end; ++i)
+            ProcessLight(lightQueryResults_[i], threadIndex);
+    });
 
-        LightQueryResult& query = lightQueryResults_[i];
-        query.light_ = lights_[i];
-
-        item->start_ = &query;
-        queue->AddWorkItem(item);
-    }
-
-    // Ensure all lights have been processed before proceeding
-    queue->Complete(WI_MAX_PRIORITY);
+    frameGraph_->AddDependency(lightsTask_, combineTask_);
 }
 
 void View::GetLightBatches()
@@ -988,22 +950,19 @@ void View::GetLightBatches()
     {
         DV_PROFILE(GetLightBatches);
 
-        // Preallocate light queues: per-pixel lights which have lit geometries
-        i32 numLightQueues = 0;
+        // Preallocate light queues. The lights are not processed yet, so reserve a queue for each light. Only per-pixel
+        // lights which have lit geometries use them, the rest is removed at the end without moving the used queues
         i32 usedLightQueues = 0;
-        for (Vector<LightQueryResult>::ConstIterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
-        {
-            if (!i->light_->GetPerVertex() && i->litGeometries_.Size())
-                ++numLightQueues;
-        }
-
-        lightQueues_.Resize(numLightQueues);
+        lightQueues_.Resize(lightQueryResults_.Size());
         maxLightsDrawables_.Clear();
         i32 maxSortedInstances = renderer_->GetMaxSortedInstances();
 
-        for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+        for (i32 lightIndex = 0; lightIndex < lightQueryResults_.Size(); ++lightIndex)
         {
-            LightQueryResult& query = *i;
+            // The worker threads continue with the next lights meanwhile. They do not modify the scene, only update
+            // the batches of the shadow casters outside the view, which the main thread may read at the same time
+            frameGraph_->Wait(lightsTask_, lightIndex);
+            LightQueryResult& query = lightQueryResults_[lightIndex];
 
             // If light has no affected geometries, no need to process further
             if (query.litGeometries_.Empty())
@@ -1142,6 +1101,8 @@ void View::GetLightBatches()
                 }
             }
         }
+
+        lightQueues_.Resize(usedLightQueues);
     }
 
     // Process drawables with limited per-pixel light count
@@ -1265,7 +1226,11 @@ void View::UpdateGeometries()
 
     DV_PROFILE(SortAndUpdateGeometry);
 
-    auto* queue = GetSubsystem<WorkQueue>();
+    if (!updateGraph_)
+        updateGraph_ = new TaskGraph(GetSubsystem<WorkQueue>());
+
+    // Sorting and geometry updates do not depend on each other, so they all run in parallel
+    updateGraph_->Clear();
 
     // Sort batches
     {
@@ -1276,30 +1241,32 @@ void View::UpdateGeometries()
 
             if (command.type_ == CMD_SCENEPASS)
             {
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = WI_MAX_PRIORITY;
-                item->workFunction_ =
-                    command.sortMode_ == SORT_FRONTTOBACK ? SortBatchQueueFrontToBackWork : SortBatchQueueBackToFrontWork;
-                item->start_ = &batchQueues_[command.passIndex_];
-                queue->AddWorkItem(item);
+                BatchQueue* batchQueue = &batchQueues_[command.passIndex_];
+
+                if (command.sortMode_ == SORT_FRONTTOBACK)
+                    updateGraph_->AddTask([batchQueue](i32, i32, i32) { batchQueue->SortFrontToBack(); });
+                else
+                    updateGraph_->AddTask([batchQueue](i32, i32, i32) { batchQueue->SortBackToFront(); });
             }
         }
 
-        for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+        for (LightBatchQueue& lightQueue : lightQueues_)
         {
-            SharedPtr<WorkItem> lightItem = queue->GetFreeItem();
-            lightItem->priority_ = WI_MAX_PRIORITY;
-            lightItem->workFunction_ = SortLightQueueWork;
-            lightItem->start_ = &(*i);
-            queue->AddWorkItem(lightItem);
+            LightBatchQueue* queuePtr = &lightQueue;
+
+            updateGraph_->AddTask([queuePtr](i32, i32, i32)
+            {
+                queuePtr->litBaseBatches_.SortFrontToBack();
+                queuePtr->litBatches_.SortFrontToBack();
+            });
 
-            if (i->shadowSplits_.Size())
+            if (lightQueue.shadowSplits_.Size())
             {
-                SharedPtr<WorkItem> shadowItem = queue->GetFreeItem();
-                shadowItem->priority_ = WI_MAX_PRIORITY;
-                shadowItem->workFunction_ = SortShadowQueueWork;
-                shadowItem->start_ = &(*i);
-                queue->AddWorkItem(shadowItem);
+                updateGraph_->AddTask([queuePtr](i32, i32, i32)
+                {
+                    for (ShadowBatchQueue& shadowSplit : queuePtr->shadowSplits_)
+                        shadowSplit.shadowBatches_.SortFrontToBack();
+                });
             }
         }
     }
@@ -1320,35 +1287,21 @@ void View::UpdateGeometries()
                 }
             }
 
-            int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-            int drawablesPerItem = threadedGeometries_.Size() / numWorkItems;
-
-            Vector<Drawable*>::Iterator start = threadedGeometries_.Begin();
-            for (int i = 0; i < numWorkItems; ++i)
+            updateGraph_->AddParallelFor(0, threadedGeometries_.Size(), GEOMETRY_UPDATE_GRAIN, [this](i32 begin, i32 end, i32 threadIndex)
             {
-                Vector<Drawable*>::Iterator end = threadedGeometries_.End();
-                if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                    end = start + drawablesPerItem;
-
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = WI_MAX_PRIORITY;
-                item->workFunction_ = UpdateDrawableGeometriesWork;
-                item->aux_ = const_cast<FrameInfo*>(&frame_);
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-
-                start = end;
-            }
+                UpdateDrawableGeometriesWork(threadedGeometries_.Buffer() + begin, threadedGeometries_.Buffer() + end, frame_);
+            });
         }
 
+        updateGraph_->Run();
+
         // While the work queue is processed, update non-threaded geometries
         for (Vector<Drawable*>::ConstIterator i = nonThreadedGeometries_.Begin(); i != nonThreadedGeometries_.End(); ++i)
             (*i)->UpdateGeometry(frame_);
     }
 
     // Finally ensure all threaded work has completed
-    queue->Complete(WI_MAX_PRIORITY);
+    updateGraph_->Wait();
     geometriesUpdated_ = true;
 }
 
@@ -2202,10 +2155,18 @@ void View::UpdateOccluders(Vector<Drawable*>& occluders, Camera* camera)
         std::sort(occluders.Begin(), occluders.End(), CompareDrawables);
 }
 
-void View::DrawOccluders(OcclusionBuffer* buffer, const Vector<Drawable*>& occluders)
+i32 View::DrawOccluders(OcclusionBuffer* buffer, const Vector<Drawable*>& occluders)
 {
     buffer->SetMaxTriangles(maxOccluderTriangles_);
-    buffer->Clear();
+
+    bool temporal = renderer_->GetTemporalOcclusion();
+    // Occluders whose depth is in the buffer after this frame. Starts with the reprojected ones
+    drawnOccluders_.Clear();
+    bool reprojected = temporal && ReprojectOccluders(buffer);
+    if (!reprojected)
+        buffer->Clear();
+
+    i32 drawTask = -1;
 
     if (!buffer->IsThreaded())
     {
@@ -2213,7 +2174,10 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const Vector<Drawable*>& occlu
         for (i32 i = 0; i < occluders.Size(); ++i)
         {
             Drawable* occluder = occluders[i];
-            if (i > 0)
+            if (reprojectedOccluders_.Contains(occluder))
+                continue;
+
+            if (i > 0 || reprojected)
             {
                 // For subsequent occluders, do a test against the pixel-level occlusion buffer to see if rendering is necessary
                 if (!buffer->IsVisible(occluder->GetWorldBoundingBox()))
@@ -2227,6 +2191,9 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const Vector<Drawable*>& occlu
             buffer->DrawTriangles();
             if (!success)
                 break;
+
+            if (temporal)
+                drawnOccluders_.Push(OccluderHistory{WeakPtr<Drawable>(occluder), occluder->GetWorldBoundingBox()});
         }
     }
     else
@@ -2234,22 +2201,55 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const Vector<Drawable*>& occlu
         // In threaded mode submit all triangles first, then render (cannot test in this case)
         for (Drawable* occluder : occluders)
         {
+            if (reprojectedOccluders_.Contains(occluder))
+                continue;
+
             // Check for running out of triangles
             ++activeOccluders_;
 
             if (!occluder->DrawOcclusion(buffer))
                 break;
+
+            if (temporal)
+                drawnOccluders_.Push(OccluderHistory{WeakPtr<Drawable>(occluder), occluder->GetWorldBoundingBox()});
         }
 
-        buffer->DrawTriangles();
+        // Rasterization and the depth mip levels are frame graph tasks, which the drawable query waits for
+        drawTask = buffer->AddDrawTasks(frameGraph_);
     }
 
     // Finally build the depth mip levels
-    buffer->BuildDepthHierarchy();
+    if (drawTask < 0)
+        buffer->BuildDepthHierarchy();
+
+    if (temporal)
+        buffer->StoreHistory(cullCamera_, drawnOccluders_);
+
+    return drawTask;
+}
+
+bool View::ReprojectOccluders(OcclusionBuffer* buffer)
+{
+    reprojectedOccluders_.Clear();
+
+    if (!buffer->HasHistory(cullCamera_) || buffer->GetHistoryAge() >= renderer_->GetMaxOcclusionHistoryAge())
+        return false;
+
+    // Unchanged occluders are not drawn, their depth comes from the previous frame. Occluders which overlap
+    // the erased areas are drawn again
+    if (!buffer->ReprojectOccluders(drawnOccluders_))
+        return false;
+
+    for (const OccluderHistory& history : drawnOccluders_)
+        reprojectedOccluders_.Insert(history.drawable_.Get());
+
+    return true;
 }
 
 void View::ProcessLight(LightQueryResult& query, i32 threadIndex)
 {
+    DV_PROFILE(ProcessLight);
+
     assert(threadIndex >= 0);
     Light* light = query.light_;
     LightType type = light->GetLightType();
@@ -2281,29 +2281,27 @@ void View::ProcessLight(LightQueryResult& query, i32 threadIndex)
         break;
 
     case LIGHT_SPOT:
+    case LIGHT_POINT:
         {
-            FrustumOctreeQuery octreeQuery(tempDrawables, light->GetFrustum(), DrawableTypes::Geometry,
-                cullCamera_->GetViewMask());
-            octree_->GetDrawables(octreeQuery);
+            // All geometries in the light volume are kept as potential shadow casters
+            auto collectLitGeometries = [&](Drawable* drawable)
+            {
+                tempDrawables.Push(drawable);
+                if (drawable->IsInView(frame_) && (GetLightMask(drawable) & lightMask))
+                    query.litGeometries_.Push(drawable);
+            };
 
-            for (Drawable* tempDrawable : tempDrawables)
+            tempDrawables.Clear();
+            if (type == LIGHT_SPOT)
             {
-                if (tempDrawable->IsInView(frame_) && (GetLightMask(tempDrawable) & lightMask))
-                    query.litGeometries_.Push(tempDrawable);
+                VolumeVisitQuery octreeQuery(light->GetFrustum(), DrawableTypes::Geometry, cullCamera_->GetViewMask());
+                octree_->VisitDrawables(octreeQuery, collectLitGeometries);
             }
-        }
-        break;
-
-    case LIGHT_POINT:
-        {
-            SphereOctreeQuery octreeQuery(tempDrawables, Sphere(light->GetNode()->GetWorldPosition(), light->GetRange()),
-                DrawableTypes::Geometry, cullCamera_->GetViewMask());
-            octree_->GetDrawables(octreeQuery);
-
-            for (Drawable* tempDrawable : tempDrawables)
+            else
             {
-                if (tempDrawable->IsInView(frame_) && (GetLightMask(tempDrawable) & lightMask))
-                    query.litGeometries_.Push(tempDrawable);
+                VolumeVisitQuery octreeQuery(Sphere(light->GetNode()->GetWorldPosition(), light->GetRange()),
+                    DrawableTypes::Geometry, cullCamera_->GetViewMask());
+                octree_->VisitDrawables(octreeQuery, collectLitGeometries);
             }
         }
         break;
@@ -2317,7 +2315,7 @@ void View::ProcessLight(LightQueryResult& query, i32 threadIndex)
     }
 
     // Determine number of shadow cameras and setup their initial positions
-    SetupShadowCameras(query);
+    SetupShadowCameras(query, threadIndex);
 
     // Process each split for shadow casters
     query.shadowCasters_.Clear();
@@ -2340,8 +2338,10 @@ void View::ProcessLight(LightQueryResult& query, i32 threadIndex)
                 continue;
 
             // Reuse lit geometry query for all except directional lights
-            ShadowCasterOctreeQuery query(tempDrawables, shadowCameraFrustum, DrawableTypes::Geometry, cullCamera_->GetViewMask());
-            octree_->GetDrawables(query);
+            VolumeVisitQuery shadowCasterQuery(shadowCameraFrustum, DrawableTypes::Geometry, cullCamera_->GetViewMask(),
+                [](Drawable* drawable) { return drawable->GetCastShadows(); });
+            tempDrawables.Clear();
+            octree_->VisitDrawables(shadowCasterQuery, [&tempDrawables](Drawable* drawable) { tempDrawables.Push(drawable); });
         }
 
         // Check which shadow casters actually contribute to the shadowing
@@ -2498,7 +2498,7 @@ IntRect View::GetShadowMapViewport(Light* light, int splitIndex, Texture2D* shad
     return {};
 }
 
-void View::SetupShadowCameras(LightQueryResult& query)
+void View::SetupShadowCameras(LightQueryResult& query, i32 threadIndex)
 {
     Light* light = query.light_;
 
@@ -2529,7 +2529,7 @@ void View::SetupShadowCameras(LightQueryResult& query)
                 query.shadowCameras_[splits] = shadowCamera;
                 query.shadowNearSplits_[splits] = nearSplit;
                 query.shadowFarSplits_[splits] = farSplit;
-                SetupDirLightShadowCamera(shadowCamera, light, nearSplit, farSplit);
+                SetupDirLightShadowCamera(shadowCamera, light, nearSplit, farSplit, threadIndex);
 
                 nearSplit = farSplit;
                 ++splits;
@@ -2589,7 +2589,7 @@ void View::SetupShadowCameras(LightQueryResult& query)
     query.numSplits_ = splits;
 }
 
-void View::SetupDirLightShadowCamera(Camera* shadowCamera, Light* light, float nearSplit, float farSplit)
+void View::SetupDirLightShadowCamera(Camera* shadowCamera, Light* light, float nearSplit, float farSplit, i32 threadIndex)
 {
     Node* shadowCameraNode = shadowCamera->GetNode();
     Node* lightNode = light->GetNode();
@@ -2610,7 +2610,7 @@ void View::SetupDirLightShadowCamera(Camera* shadowCamera, Light* light, float n
     }
 
     Frustum splitFrustum = cullCamera_->GetSplitFrustum(nearSplit, farSplit);
-    Polyhedron frustumVolume;
+    Polyhedron& frustumVolume = tempFrustumVolumes_[threadIndex];
     frustumVolume.Define(splitFrustum);
     // If focusing enabled, clip the frustum volume by the combined bounding box of the lit geometries within the frustum
     if (parameters.focus_)
@@ -2884,12 +2884,13 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     {
         BatchGroupKey key(batch);
 
-        HashMap<BatchGroupKey, BatchGroup>::Iterator i = queue.batchGroups_.Find(key);
+        FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = queue.batchGroups_.Find(key);
         if (i == queue.batchGroups_.End())
         {
             // Create a new group based on the batch
-            // In case the group remains below the instancing limit, do not enable instancing shaders yet
-            BatchGroup newGroup(batch);
+            // In case the group remains below the instancing limit, do not enable instancing shaders yet.
+            // Batches are queued by the main thread
+            BatchGroup newGroup(batch, renderer_->GetFrameAllocator());
             newGroup.geometryType_ = GEOM_STATIC;
             renderer_->SetBatchShaders(newGroup, tech, allowShadows, queue);
             newGroup.CalculateSortKey();
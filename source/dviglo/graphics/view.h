@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "../containers/flat_hash_set.h"
 #include "../containers/hash_set.h"
 #include "../core/object.h"
 #include "batch.h"
@@ -20,6 +21,7 @@ class Light;
 class Drawable;
 class Graphics;
 class OcclusionBuffer;
+struct OccluderHistory;
 class Octree;
 class Renderer;
 class RenderPath;
@@ -29,8 +31,8 @@ class Texture;
 class Texture2D;
 class Viewport;
 class Zone;
+class TaskGraph;
 struct RenderPathCommand;
-struct WorkItem;
 
 /// Intermediate light processing result.
 struct LightQueryResult
@@ -90,8 +92,7 @@ inline constexpr i32 MAX_VIEWPORT_TEXTURES = 2;
 /// Internal structure for 3D rendering work. Created for each backbuffer and texture viewport, but not for shadow cameras.
 class DV_API View : public Object
 {
-    friend void CheckVisibilityWork(const WorkItem* item, i32 threadIndex);
-    friend void ProcessLightWork(const WorkItem* item, i32 threadIndex);
+    friend void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, i32 threadIndex);
 
     DV_OBJECT(View, Object);
 
@@ -99,7 +100,7 @@ public:
     /// Construct.
     explicit View();
     /// Destruct.
-    ~View() override = default;
+    ~View() override;
 
     /// Define with rendertarget and viewport. Return true if successful.
     bool Define(RenderSurface* renderTarget, Viewport* viewport);
@@ -155,6 +156,9 @@ public:
     /// Return the last used software occlusion buffer.
     OcclusionBuffer* GetOcclusionBuffer() const { return occlusionBuffer_; }
 
+    /// Return the task graph of the view update. The tasks added by E_BEGINVIEWUPDATE handlers are finished before the visibility of the drawables is checked.
+    TaskGraph* GetFrameGraph() const { return frameGraph_; }
+
     /// Return number of occluders that were actually rendered. Occluders may be rejected if running out of triangles or if behind other occluders.
     i32 GetNumActiveOccluders() const { return activeOccluders_; }
 
@@ -177,13 +181,15 @@ public:
     Texture* FindNamedTexture(const String& name, bool isRenderTarget, bool isVolumeMap = false);
 
 private:
-    /// Query the octree for drawable objects.
+    /// Query the octree for drawable objects. Zones and occluders are found right away, the occlusion, the rest of the query and the visibility checks are added to the frame graph.
     void GetDrawables();
-    /// Construct batches from the drawable objects.
+    /// Construct batches from the drawable objects. Called while the frame graph is running.
     void GetBatches();
-    /// Get lit geometries and shadowcasters for visible lights.
+    /// Combine the visibility check results of the threads and sort the lights. Executed by the frame graph.
+    void CombineSceneResults();
+    /// Add the task which gets lit geometries and shadowcasters for visible lights to the frame graph.
     void ProcessLights();
-    /// Get batches from lit geometries and shadowcasters.
+    /// Get batches from lit geometries and shadowcasters. Batches of a light are built as soon as the light is processed.
     void GetLightBatches();
     /// Get unlit batches.
     void GetBaseBatches();
@@ -213,16 +219,18 @@ private:
     void BlitFramebuffer(Texture* source, RenderSurface* destination, bool depthWrite);
     /// Query for occluders as seen from a camera.
     void UpdateOccluders(Vector<Drawable*>& occluders, Camera* camera);
-    /// Draw occluders to occlusion buffer.
-    void DrawOccluders(OcclusionBuffer* buffer, const Vector<Drawable*>& occluders);
+    /// Draw occluders to occlusion buffer. Return the frame graph task which finishes the drawing, or -1 if drawn already.
+    i32 DrawOccluders(OcclusionBuffer* buffer, const Vector<Drawable*>& occluders);
+    /// Reproject the occlusion depth of the previous frame and collect the occluders which need not be drawn. Return false if not possible.
+    bool ReprojectOccluders(OcclusionBuffer* buffer);
     /// Query for lit geometries and shadow casters for a light.
     void ProcessLight(LightQueryResult& query, i32 threadIndex);
     /// Process shadow casters' visibilities and build their combined view- or projection-space bounding box.
     void ProcessShadowCasters(LightQueryResult& query, const Vector<Drawable*>& drawables, i32 splitIndex);
     /// Set up initial shadow camera view(s).
-    void SetupShadowCameras(LightQueryResult& query);
+    void SetupShadowCameras(LightQueryResult& query, i32 threadIndex);
     /// Set up a directional light shadow camera.
-    void SetupDirLightShadowCamera(Camera* shadowCamera, Light* light, float nearSplit, float farSplit);
+    void SetupDirLightShadowCamera(Camera* shadowCamera, Light* light, float nearSplit, float farSplit, i32 threadIndex);
     /// Finalize shadow camera view after shadow casters and the shadow map are known.
     void
         FinalizeShadowCamera(Camera* shadowCamera, Light* light, const IntRect& shadowViewport, const BoundingBox& shadowCasterBox);
@@ -367,6 +375,8 @@ private:
     Vector<Vector<Drawable*>> tempDrawables_;
     /// Per-thread geometries, lights and Z range collection results.
     Vector<PerThreadSceneResult> sceneResults_;
+    /// Per-thread frustum volumes for directional light shadow cameras. Reused to avoid allocations.
+    Vector<Polyhedron> tempFrustumVolumes_;
     /// Visible zones.
     Vector<Zone*> zones_;
     /// Visible geometry objects.
@@ -381,6 +391,10 @@ private:
     Vector<Light*> lights_;
     /// Number of active occluders.
     i32 activeOccluders_{};
+    /// Occluders whose depth was reprojected from the previous frame.
+    FlatHashSet<Drawable*> reprojectedOccluders_;
+    /// Occluders whose depth is in the occlusion buffer, reused between frames.
+    Vector<OccluderHistory> drawnOccluders_;
 
     /// Drawables that limit their maximum light count.
     HashSet<Drawable*> maxLightsDrawables_;
@@ -388,6 +402,14 @@ private:
     HashMap<StringHash, Texture*> renderTargets_;
     /// Intermediate light processing results.
     Vector<LightQueryResult> lightQueryResults_;
+    /// Batch sorting and geometry update tasks.
+    SharedPtr<TaskGraph> updateGraph_;
+    /// Occlusion, visibility check and light processing tasks of the view update.
+    SharedPtr<TaskGraph> frameGraph_;
+    /// Frame graph task which combines the visibility check results of the threads. -1 if not added.
+    i32 combineTask_{-1};
+    /// Frame graph task which processes the lights. -1 if not added.
+    i32 lightsTask_{-1};
     /// Info for scene render passes defined by the renderpath.
     Vector<ScenePassInfo> scenePasses_;
     /// Per-pixel light queues.
@@ -244,51 +244,35 @@ void Zone::UpdateAmbientGradient()
         Vector3 minZPosition = worldTransform * Vector3(center.x_, center.y_, boundingBox_.min_.z_);
         Vector3 maxZPosition = worldTransform * Vector3(center.x_, center.y_, boundingBox_.max_.z_);
 
-        Vector<Zone*> result;
+        // Gradient start and end positions: get the highest priority zone that is not this zone
+        auto getBestZone = [this](const Vector3& position)
         {
-            PointOctreeQuery query(reinterpret_cast<Vector<Drawable*>&>(result), minZPosition, DrawableTypes::Zone);
-            octant_->GetRoot()->GetDrawables(query);
-        }
+            i32 bestPriority = M_MIN_INT;
+            Zone* bestZone = nullptr;
 
-        // Gradient start position: get the highest priority zone that is not this zone
-        int bestPriority = M_MIN_INT;
-        Zone* bestZone = nullptr;
-        for (Vector<Zone*>::ConstIterator i = result.Begin(); i != result.End(); ++i)
-        {
-            Zone* zone = *i;
-            int priority = zone->GetPriority();
-            if (priority > bestPriority && zone != this && zone->IsInside(minZPosition))
+            PointVisitQuery query(position, DrawableTypes::Zone);
+            octant_->GetRoot()->VisitDrawables(query, [&](Drawable* drawable)
             {
-                bestZone = zone;
-                bestPriority = priority;
-            }
-        }
-
+                Zone* zone = static_cast<Zone*>(drawable);
+                i32 priority = zone->GetPriority();
+                if (priority > bestPriority && zone != this && zone->IsInside(position))
+                {
+                    bestZone = zone;
+                    bestPriority = priority;
+                }
+            });
+
+            return bestZone;
+        };
+
+        Zone* bestZone = getBestZone(minZPosition);
         if (bestZone)
         {
             ambientStartColor_ = bestZone->GetAmbientColor();
             lastAmbientStartZone_ = bestZone;
         }
 
-        // Do the same for gradient end position
-        {
-            PointOctreeQuery query(reinterpret_cast<Vector<Drawable*>&>(result), maxZPosition, DrawableTypes::Zone);
-            octant_->GetRoot()->GetDrawables(query);
-        }
-        bestPriority = M_MIN_INT;
-        bestZone = nullptr;
-
-        for (Vector<Zone*>::ConstIterator i = result.Begin(); i != result.End(); ++i)
-        {
-            Zone* zone = *i;
-            int priority = zone->GetPriority();
-            if (priority > bestPriority && zone != this && zone->IsInside(maxZPosition))
-            {
-                bestZone = zone;
-                bestPriority = priority;
-            }
-        }
-
+        bestZone = getBestZone(maxZPosition);
         if (bestZone)
         {
             ambientEndColor_ = bestZone->GetAmbientColor();
@@ -306,13 +290,9 @@ void Zone::ClearDrawablesZone()
 {
     if (octant_ && lastWorldBoundingBox_.Defined())
     {
-        Vector<Drawable*> result;
-        BoxOctreeQuery query(result, lastWorldBoundingBox_, DrawableTypes::Geometry | DrawableTypes::Zone);
-        octant_->GetRoot()->GetDrawables(query);
-
-        for (Vector<Drawable*>::Iterator i = result.Begin(); i != result.End(); ++i)
+        VolumeVisitQuery query(lastWorldBoundingBox_, DrawableTypes::Geometry | DrawableTypes::Zone);
+        octant_->GetRoot()->VisitDrawables(query, [](Drawable* drawable)
         {
-            Drawable* drawable = *i;
             DrawableTypes drawableType = drawable->GetDrawableType();
             if (drawableType == DrawableTypes::Geometry)
                 drawable->SetZone(nullptr);
@@ -322,7 +302,7 @@ void Zone::ClearDrawablesZone()
                 zone->lastAmbientStartZone_.Reset();
                 zone->lastAmbientEndZone_.Reset();
             }
-        }
+        });
     }
 
     lastWorldBoundingBox_ = GetWorldBoundingBox();
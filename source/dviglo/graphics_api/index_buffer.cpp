@@ -49,6 +49,7 @@ void IndexBuffer::SetShadowed(bool enable)
             shadowData_.Reset();
 
         shadowed_ = enable;
+        ++dataRevision_;
     }
 }
 
@@ -57,6 +58,7 @@ bool IndexBuffer::SetSize(i32 indexCount, bool largeIndices, bool dynamic)
     assert(indexCount >= 0);
     Unlock();
 
+    ++dataRevision_;
     indexCount_ = indexCount;
     indexSize_ = (i32)(largeIndices ? sizeof(u32) : sizeof(u16));
     dynamic_ = dynamic;
@@ -170,6 +172,7 @@ void IndexBuffer::Release()
 
 bool IndexBuffer::SetData(const void* data)
 {
+    ++dataRevision_;
     GAPI gapi = Graphics::GetGAPI();
 
 #ifdef DV_OPENGL
@@ -188,6 +191,7 @@ bool IndexBuffer::SetData(const void* data)
 bool IndexBuffer::SetDataRange(const void* data, i32 start, i32 count, bool discard)
 {
     assert(start >= 0 && count >= 0);
+    ++dataRevision_;
     GAPI gapi = Graphics::GetGAPI();
 
 #ifdef DV_OPENGL
@@ -223,6 +227,9 @@ void* IndexBuffer::Lock(i32 start, i32 count, bool discard)
 
 void IndexBuffer::Unlock()
 {
+    if (IsLocked())
+        ++dataRevision_;
+
     GAPI gapi = Graphics::GetGAPI();
 
 #ifdef DV_OPENGL
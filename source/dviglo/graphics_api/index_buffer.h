@@ -67,6 +67,9 @@ public:
     /// Return shared array pointer to the CPU memory shadow data.
     SharedArrayPtr<byte> GetShadowDataShared() const { return shadowData_; }
 
+    /// Return data revision, which changes whenever the size or the data of the buffer changes.
+    u32 GetDataRevision() const { return dataRevision_; }
+
 private:
     /// Create buffer.
     bool Create();
@@ -107,6 +110,8 @@ private:
 
     /// Shadow data.
     SharedArrayPtr<byte> shadowData_;
+    /// Data revision.
+    u32 dataRevision_{};
     /// Number of indices.
     i32 indexCount_;
     /// Index size.
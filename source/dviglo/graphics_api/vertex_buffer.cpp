@@ -42,6 +42,7 @@ void VertexBuffer::SetShadowed(bool enable)
             shadowData_.Reset();
 
         shadowed_ = enable;
+        ++dataRevision_;
     }
 }
 
@@ -56,6 +57,7 @@ bool VertexBuffer::SetSize(i32 vertexCount, const Vector<VertexElement>& element
     assert(vertexCount >= 0);
     Unlock();
 
+    ++dataRevision_;
     vertexCount_ = vertexCount;
     elements_ = elements;
     dynamic_ = dynamic;
@@ -240,6 +242,7 @@ void VertexBuffer::Release()
 
 bool VertexBuffer::SetData(const void* data)
 {
+    ++dataRevision_;
     GAPI gapi = Graphics::GetGAPI();
 
 #ifdef DV_OPENGL
@@ -258,6 +261,7 @@ bool VertexBuffer::SetData(const void* data)
 bool VertexBuffer::SetDataRange(const void* data, i32 start, i32 count, bool discard)
 {
     assert(start >= 0 && count >= 0);
+    ++dataRevision_;
     GAPI gapi = Graphics::GetGAPI();
 
 #ifdef DV_OPENGL
@@ -293,6 +297,9 @@ void* VertexBuffer::Lock(i32 start, i32 count, bool discard)
 
 void VertexBuffer::Unlock()
 {
+    if (IsLocked())
+        ++dataRevision_;
+
     GAPI gapi = Graphics::GetGAPI();
 
 #ifdef DV_OPENGL
@@ -108,6 +108,9 @@ public:
     /// Return shared array pointer to the CPU memory shadow data.
     SharedArrayPtr<byte> GetShadowDataShared() const { return shadowData_; }
 
+    /// Return data revision, which changes whenever the size or the data of the buffer changes.
+    u32 GetDataRevision() const { return dataRevision_; }
+
     /// Return buffer hash for building vertex declarations. Used internally.
     hash64 GetBufferHash(i32 streamIndex) { return elementHash_ << (streamIndex * 16); }
 
@@ -174,6 +177,8 @@ private:
 
     /// Shadow data.
     SharedArrayPtr<byte> shadowData_;
+    /// Data revision.
+    u32 dataRevision_{};
     /// Number of vertices.
     i32 vertexCount_{};
     /// Vertex size.
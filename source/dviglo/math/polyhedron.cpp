@@ -22,7 +22,7 @@ void Polyhedron::Define(const BoundingBox& box)
     vertices[6] = Vector3(box.min_.x_, box.max_.y_, box.max_.z_);
     vertices[7] = box.max_;
 
-    faces_.Resize(6);
+    SetNumFaces(6);
     SetFace(0, vertices[3], vertices[7], vertices[5], vertices[1]);
     SetFace(1, vertices[6], vertices[2], vertices[0], vertices[4]);
     SetFace(2, vertices[6], vertices[7], vertices[3], vertices[2]);
@@ -35,7 +35,7 @@ void Polyhedron::Define(const Frustum& frustum)
 {
     const Vector3* vertices = frustum.vertices_;
 
-    faces_.Resize(6);
+    SetNumFaces(6);
     SetFace(0, vertices[0], vertices[4], vertices[5], vertices[1]);
     SetFace(1, vertices[7], vertices[3], vertices[2], vertices[6]);
     SetFace(2, vertices[7], vertices[4], vertices[0], vertices[3]);
@@ -46,7 +46,7 @@ void Polyhedron::Define(const Frustum& frustum)
 
 void Polyhedron::AddFace(const Vector3& v0, const Vector3& v1, const Vector3& v2)
 {
-    faces_.Resize(faces_.Size() + 1);
+    SetNumFaces(faces_.Size() + 1);
     Vector<Vector3>& face = faces_[faces_.Size() - 1];
     face.Resize(3);
     face[0] = v0;
@@ -56,7 +56,7 @@ void Polyhedron::AddFace(const Vector3& v0, const Vector3& v1, const Vector3& v2
 
 void Polyhedron::AddFace(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Vector3& v3)
 {
-    faces_.Resize(faces_.Size() + 1);
+    SetNumFaces(faces_.Size() + 1);
     Vector<Vector3>& face = faces_[faces_.Size() - 1];
     face.Resize(4);
     face[0] = v0;
@@ -67,7 +67,8 @@ void Polyhedron::AddFace(const Vector3& v0, const Vector3& v1, const Vector3& v2
 
 void Polyhedron::AddFace(const Vector<Vector3>& face)
 {
-    faces_.Push(face);
+    SetNumFaces(faces_.Size() + 1);
+    faces_.Back() = face;
 }
 
 void Polyhedron::Clip(const Plane& plane)
@@ -125,15 +126,22 @@ void Polyhedron::Clip(const Plane& plane)
         if (outFace_.Size() < 3)
             outFace_.Clear();
 
-        face = outFace_;
+        // Swap instead of copying, the old buffer of the face is reused for the next face
+        face.Swap(outFace_);
     }
 
-    // Remove empty faces
-    for (i32 i = faces_.Size() - 1; i >= 0; --i)
+    // Remove empty faces. Move them to the end first, so that their buffers are kept
+    i32 numFaces = 0;
+    for (i32 i = 0; i < faces_.Size(); ++i)
     {
-        if (faces_[i].Empty())
-            faces_.Erase(i);
+        if (!faces_[i].Empty())
+        {
+            if (i != numFaces)
+                faces_[numFaces].Swap(faces_[i]);
+            ++numFaces;
+        }
     }
+    SetNumFaces(numFaces);
 
     // Create a new face from the clipped vertices. First remove duplicates
     for (i32 i = 0; i < clippedVertices_.Size(); ++i)
@@ -174,7 +182,8 @@ void Polyhedron::Clip(const Plane& plane)
             clippedVertices_.Erase(bestIndex);
         }
 
-        faces_.Push(outFace_);
+        SetNumFaces(faces_.Size() + 1);
+        faces_.Back().Swap(outFace_);
     }
 }
 
@@ -206,7 +215,7 @@ void Polyhedron::Clip(const BoundingBox& box)
 
 void Polyhedron::Clear()
 {
-    faces_.Clear();
+    SetNumFaces(0);
 }
 
 void Polyhedron::Transform(const Matrix3& transform)
@@ -263,6 +272,30 @@ Polyhedron Polyhedron::Transformed(const Matrix3x4& transform) const
     return ret;
 }
 
+void Polyhedron::SetNumFaces(i32 num)
+{
+    assert(num >= 0);
+
+    while (faces_.Size() > num)
+    {
+        spareFaces_.Resize(spareFaces_.Size() + 1);
+        spareFaces_.Back().Swap(faces_.Back());
+        faces_.Pop();
+    }
+
+    while (faces_.Size() < num)
+    {
+        faces_.Resize(faces_.Size() + 1);
+
+        if (!spareFaces_.Empty())
+        {
+            faces_.Back().Swap(spareFaces_.Back());
+            faces_.Back().Clear();
+            spareFaces_.Pop();
+        }
+    }
+}
+
 void Polyhedron::SetFace(i32 index, const Vector3& v0, const Vector3& v1, const Vector3& v2)
 {
     assert(index >= 0);
@@ -90,6 +90,8 @@ public:
     Vector<Vector<Vector3>> faces_;
 
 private:
+    /// Change number of faces. Buffers of the removed faces are kept for reuse.
+    void SetNumFaces(i32 num);
     /// Set a triangle face by index.
     void SetFace(i32 index, const Vector3& v0, const Vector3& v1, const Vector3& v2);
     /// Set a quadrilateral face by index.
@@ -98,6 +100,8 @@ private:
     Vector<Vector3> clippedVertices_;
     /// Internal vector for the new face being constructed.
     Vector<Vector3> outFace_;
+    /// Removed faces, whose buffers are reused for new faces.
+    Vector<Vector<Vector3>> spareFaces_;
 };
 
 }
@@ -9,6 +9,10 @@
 namespace dviglo
 {
 
+class Node;
+class PhysicsWorld;
+class RigidBody;
+
 /// Physics world is about to be stepped.
 DV_EVENT(E_PHYSICSPRESTEP, PhysicsPreStep)
 {
@@ -47,6 +51,32 @@ DV_EVENT(E_PHYSICSCOLLISION, PhysicsCollision)
     DV_PARAM(P_CONTACTS, Contacts);            // Buffer containing position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact
 }
 
+/// Typed version of E_PHYSICSCOLLISION.
+struct DV_API PhysicsCollisionEvent
+{
+    DV_TYPED_EVENT(E_PHYSICSCOLLISION)
+
+    /// Physics world.
+    PhysicsWorld* world_;
+    /// First node.
+    Node* nodeA_;
+    /// Second node.
+    Node* nodeB_;
+    /// First rigid body.
+    RigidBody* bodyA_;
+    /// Second rigid body.
+    RigidBody* bodyB_;
+    /// Whether either body is a trigger.
+    bool trigger_;
+    /// Position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact. Read with MemoryBuffer.
+    const Vector<byte>* contacts_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const;
+    /// Read parameters sent with SendEvent(). The contacts point to the VariantMap.
+    void FromVariantMap(VariantMap& eventData);
+};
+
 /// Physics collision ended. Global event sent by the PhysicsWorld.
 DV_EVENT(E_PHYSICSCOLLISIONEND, PhysicsCollisionEnd)
 {
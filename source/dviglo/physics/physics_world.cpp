@@ -763,19 +763,18 @@ void PhysicsWorld::OnSceneSet(Scene* scene)
     if (scene)
     {
         scene_ = GetScene();
-        SubscribeToEvent(scene_, E_SCENESUBSYSTEMUPDATE, DV_HANDLER(PhysicsWorld, HandleSceneSubsystemUpdate));
+        SubscribeToTypedEvent(scene_, &PhysicsWorld::HandleSceneSubsystemUpdate);
     }
     else
         UnsubscribeFromEvent(E_SCENESUBSYSTEMUPDATE);
 }
 
-void PhysicsWorld::HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData)
+void PhysicsWorld::HandleSceneSubsystemUpdate(SceneSubsystemUpdateEvent& event)
 {
     if (!updateEnabled_)
         return;
 
-    using namespace SceneSubsystemUpdate;
-    Update(eventData[P_TIMESTEP].GetFloat());
+    Update(event.timeStep_);
 }
 
 void PhysicsWorld::PreStep(float timeStep)
@@ -888,12 +887,6 @@ void PhysicsWorld::SendCollisionEvents()
             bool trigger = bodyA->IsTrigger() || bodyB->IsTrigger();
             bool newCollision = !previousCollisions_.Contains(i->first_);
 
-            physicsCollisionData_[PhysicsCollision::P_NODEA] = nodeA;
-            physicsCollisionData_[PhysicsCollision::P_NODEB] = nodeB;
-            physicsCollisionData_[PhysicsCollision::P_BODYA] = bodyA;
-            physicsCollisionData_[PhysicsCollision::P_BODYB] = bodyB;
-            physicsCollisionData_[PhysicsCollision::P_TRIGGER] = trigger;
-
             contacts_.Clear();
 
             // "Pointers not flipped"-manifold, send unmodified normals
@@ -923,11 +916,15 @@ void PhysicsWorld::SendCollisionEvents()
                 }
             }
 
-            physicsCollisionData_[PhysicsCollision::P_CONTACTS] = contacts_.GetBuffer();
-
             // Send separate collision start event if collision is new
             if (newCollision)
             {
+                physicsCollisionData_[PhysicsCollision::P_NODEA] = nodeA;
+                physicsCollisionData_[PhysicsCollision::P_NODEB] = nodeB;
+                physicsCollisionData_[PhysicsCollision::P_BODYA] = bodyA;
+                physicsCollisionData_[PhysicsCollision::P_BODYB] = bodyB;
+                physicsCollisionData_[PhysicsCollision::P_TRIGGER] = trigger;
+                physicsCollisionData_[PhysicsCollision::P_CONTACTS] = contacts_.GetBuffer();
                 SendEvent(E_PHYSICSCOLLISIONSTART, physicsCollisionData_);
                 // Skip rest of processing if either of the nodes or bodies is removed as a response to the event
                 if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
@@ -935,7 +932,8 @@ void PhysicsWorld::SendCollisionEvents()
             }
 
             // Then send the ongoing collision event
-            SendEvent(E_PHYSICSCOLLISION, physicsCollisionData_);
+            PhysicsCollisionEvent collisionEvent{this, nodeA, nodeB, bodyA, bodyB, trigger, &contacts_.GetBuffer()};
+            SendTypedEvent(collisionEvent);
             if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                 continue;
 
@@ -1061,6 +1059,32 @@ void PhysicsWorld::SendCollisionEvents()
     previousCollisions_ = currentCollisions_;
 }
 
+void PhysicsCollisionEvent::ToVariantMap(VariantMap& eventData) const
+{
+    using namespace PhysicsCollision;
+
+    eventData[P_WORLD] = world_;
+    eventData[P_NODEA] = nodeA_;
+    eventData[P_NODEB] = nodeB_;
+    eventData[P_BODYA] = bodyA_;
+    eventData[P_BODYB] = bodyB_;
+    eventData[P_TRIGGER] = trigger_;
+    eventData[P_CONTACTS] = *contacts_;
+}
+
+void PhysicsCollisionEvent::FromVariantMap(VariantMap& eventData)
+{
+    using namespace PhysicsCollision;
+
+    world_ = static_cast<PhysicsWorld*>(eventData[P_WORLD].GetPtr());
+    nodeA_ = static_cast<Node*>(eventData[P_NODEA].GetPtr());
+    nodeB_ = static_cast<Node*>(eventData[P_NODEB].GetPtr());
+    bodyA_ = static_cast<RigidBody*>(eventData[P_BODYA].GetPtr());
+    bodyB_ = static_cast<RigidBody*>(eventData[P_BODYB].GetPtr());
+    trigger_ = eventData[P_TRIGGER].GetBool();
+    contacts_ = &eventData[P_CONTACTS].GetBuffer();
+}
+
 void RegisterPhysicsLibrary()
 {
     CollisionShape::RegisterObject();
@@ -39,6 +39,7 @@ class Serializer;
 class XMLElement;
 
 struct CollisionGeometryData;
+struct SceneSubsystemUpdateEvent;
 
 /// Physics raycast hit.
 struct DV_API PhysicsRaycastResult
@@ -276,7 +277,7 @@ protected:
 
 private:
     /// Handle the scene subsystem update event, step simulation here.
-    void HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleSceneSubsystemUpdate(SceneSubsystemUpdateEvent& event);
     /// Trigger update before each physics simulation step.
     void PreStep(float timeStep);
     /// Trigger update after each physics simulation step.
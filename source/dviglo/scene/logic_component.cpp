@@ -93,7 +93,7 @@ void LogicComponent::UpdateEventSubscription()
     bool needUpdate = enabled && (!!(updateEventMask_ & LogicComponentEvents::Update) || !delayedStartCalled_);
     if (needUpdate && !(currentEventMask_ & LogicComponentEvents::Update))
     {
-        SubscribeToEvent(scene, E_SCENEUPDATE, DV_HANDLER(LogicComponent, HandleSceneUpdate));
+        SubscribeToTypedEvent(scene, &LogicComponent::HandleSceneUpdate);
         currentEventMask_ |= LogicComponentEvents::Update;
     }
     else if (!needUpdate && !!(currentEventMask_ & LogicComponentEvents::Update))
@@ -105,7 +105,7 @@ void LogicComponent::UpdateEventSubscription()
     bool needPostUpdate = enabled && !!(updateEventMask_ & LogicComponentEvents::PostUpdate);
     if (needPostUpdate && !(currentEventMask_ & LogicComponentEvents::PostUpdate))
     {
-        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, DV_HANDLER(LogicComponent, HandleScenePostUpdate));
+        SubscribeToTypedEvent(scene, &LogicComponent::HandleScenePostUpdate);
         currentEventMask_ |= LogicComponentEvents::PostUpdate;
     }
     else if (!needPostUpdate && !!(currentEventMask_ & LogicComponentEvents::PostUpdate))
@@ -145,10 +145,8 @@ void LogicComponent::UpdateEventSubscription()
 #endif
 }
 
-void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::HandleSceneUpdate(SceneUpdateEvent& event)
 {
-    using namespace SceneUpdate;
-
     // Execute user-defined delayed start function before first update
     if (!delayedStartCalled_)
     {
@@ -165,15 +163,13 @@ void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
     }
 
     // Then execute user-defined update function
-    Update(eventData[P_TIMESTEP].GetFloat());
+    Update(event.timeStep_);
 }
 
-void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::HandleScenePostUpdate(ScenePostUpdateEvent& event)
 {
-    using namespace ScenePostUpdate;
-
     // Execute user-defined post-update function
-    PostUpdate(eventData[P_TIMESTEP].GetFloat());
+    PostUpdate(event.timeStep_);
 }
 
 #if defined(DV_BULLET) || defined(DV_BOX2D)
@@ -12,6 +12,9 @@
 namespace dviglo
 {
 
+struct ScenePostUpdateEvent;
+struct SceneUpdateEvent;
+
 enum class LogicComponentEvents
 {
     /// Not use any events
@@ -85,9 +88,9 @@ private:
     /// Subscribe/unsubscribe to update events based on current enabled state and update event mask.
     void UpdateEventSubscription();
     /// Handle scene update event.
-    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleSceneUpdate(SceneUpdateEvent& event);
     /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleScenePostUpdate(ScenePostUpdateEvent& event);
 #if defined(DV_BULLET) || defined(DV_BOX2D)
     /// Handle physics pre-step event.
     void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
@@ -54,7 +54,7 @@ Scene::Scene() :
     SetID(GetFreeNodeID(REPLICATED));
     NodeAdded(this);
 
-    SubscribeToEvent(E_UPDATE, DV_HANDLER(Scene, HandleUpdate));
+    SubscribeToTypedEvent(&Scene::HandleUpdate);
     SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, DV_HANDLER(Scene, HandleResourceBackgroundLoaded));
 }
 
@@ -66,9 +66,9 @@ Scene::~Scene()
     RemoveAllChildren();
 
     // Remove scene reference and owner from all nodes that still exist
-    for (HashMap<NodeId, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<NodeId, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         i->second_->ResetScene();
-    for (HashMap<NodeId, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
+    for (FlatHashMap<NodeId, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
         i->second_->ResetScene();
 }
 
@@ -189,7 +189,7 @@ void Scene::AddReplicationState(NodeReplicationState* state)
     Node::AddReplicationState(state);
 
     // This is the first update for a new connection. Mark all replicated nodes dirty
-    for (HashMap<NodeId, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<NodeId, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         state->sceneState_->dirtyNodes_.Insert(i->first_);
 }
 
@@ -686,12 +686,12 @@ Node* Scene::GetNode(NodeId id) const
 {
     if (IsReplicatedID(id))
     {
-        HashMap<NodeId, Node*>::ConstIterator i = replicatedNodes_.Find(id);
+        FlatHashMap<NodeId, Node*>::ConstIterator i = replicatedNodes_.Find(id);
         return i != replicatedNodes_.End() ? i->second_ : nullptr;
     }
     else
     {
-        HashMap<NodeId, Node*>::ConstIterator i = localNodes_.Find(id);
+        FlatHashMap<NodeId, Node*>::ConstIterator i = localNodes_.Find(id);
         return i != localNodes_.End() ? i->second_ : nullptr;
     }
 }
@@ -713,12 +713,12 @@ Component* Scene::GetComponent(ComponentId id) const
 {
     if (IsReplicatedID(id))
     {
-        HashMap<ComponentId, Component*>::ConstIterator i = replicatedComponents_.Find(id);
+        FlatHashMap<ComponentId, Component*>::ConstIterator i = replicatedComponents_.Find(id);
         return i != replicatedComponents_.End() ? i->second_ : nullptr;
     }
     else
     {
-        HashMap<ComponentId, Component*>::ConstIterator i = localComponents_.Find(id);
+        FlatHashMap<ComponentId, Component*>::ConstIterator i = localComponents_.Find(id);
         return i != localComponents_.End() ? i->second_ : nullptr;
     }
 }
@@ -750,20 +750,23 @@ void Scene::Update(float timeStep)
 
     timeStep *= timeScale_;
 
-    using namespace SceneUpdate;
-
-    VariantMap& eventData = GetEventDataMap();
-    eventData[P_SCENE] = this;
-    eventData[P_TIMESTEP] = timeStep;
-
     // Update variable timestep logic
-    SendEvent(E_SCENEUPDATE, eventData);
+    SceneUpdateEvent sceneUpdateEvent{this, timeStep};
+    SendTypedEvent(sceneUpdateEvent);
 
     // Update scene attribute animation.
-    SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
+    {
+        using namespace AttributeAnimationUpdate;
+
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_SCENE] = this;
+        eventData[P_TIMESTEP] = timeStep;
+        SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
+    }
 
     // Update scene subsystems. If a physics world is present, it will be updated, triggering fixed timestep logic updates
-    SendEvent(E_SCENESUBSYSTEMUPDATE, eventData);
+    SceneSubsystemUpdateEvent subsystemUpdateEvent{this, timeStep};
+    SendTypedEvent(subsystemUpdateEvent);
 
     // Update transform smoothing
     {
@@ -780,7 +783,8 @@ void Scene::Update(float timeStep)
     }
 
     // Post-update variable timestep logic
-    SendEvent(E_SCENEPOSTUPDATE, eventData);
+    ScenePostUpdateEvent postUpdateEvent{this, timeStep};
+    SendTypedEvent(postUpdateEvent);
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -905,7 +909,7 @@ void Scene::NodeAdded(Node* node)
     // If node with same ID exists, remove the scene reference from it and overwrite with the new node
     if (IsReplicatedID(id))
     {
-        HashMap<NodeId, Node*>::Iterator i = replicatedNodes_.Find(id);
+        FlatHashMap<NodeId, Node*>::Iterator i = replicatedNodes_.Find(id);
         if (i != replicatedNodes_.End() && i->second_ != node)
         {
             DV_LOGWARNING("Overwriting node with ID " + String(id));
@@ -919,7 +923,7 @@ void Scene::NodeAdded(Node* node)
     }
     else
     {
-        HashMap<NodeId, Node*>::Iterator i = localNodes_.Find(id);
+        FlatHashMap<NodeId, Node*>::Iterator i = localNodes_.Find(id);
         if (i != localNodes_.End() && i->second_ != node)
         {
             DV_LOGWARNING("Overwriting node with ID " + String(id));
@@ -1004,7 +1008,7 @@ void Scene::ComponentAdded(Component* component)
 
     if (IsReplicatedID(id))
     {
-        HashMap<ComponentId, Component*>::Iterator i = replicatedComponents_.Find(id);
+        FlatHashMap<ComponentId, Component*>::Iterator i = replicatedComponents_.Find(id);
         if (i != replicatedComponents_.End() && i->second_ != component)
         {
             DV_LOGWARNING("Overwriting component with ID " + String(id));
@@ -1015,7 +1019,7 @@ void Scene::ComponentAdded(Component* component)
     }
     else
     {
-        HashMap<ComponentId, Component*>::Iterator i = localComponents_.Find(id);
+        FlatHashMap<ComponentId, Component*>::Iterator i = localComponents_.Find(id);
         if (i != localComponents_.End() && i->second_ != component)
         {
             DV_LOGWARNING("Overwriting component with ID " + String(id));
@@ -1091,10 +1095,10 @@ void Scene::CleanupConnection(Connection* connection)
 {
     Node::CleanupConnection(connection);
 
-    for (HashMap<NodeId, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<NodeId, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         i->second_->CleanupConnection(connection);
 
-    for (HashMap<ComponentId, Component*>::Iterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
+    for (FlatHashMap<ComponentId, Component*>::Iterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
         i->second_->CleanupConnection(connection);
 }
 
@@ -1140,13 +1144,12 @@ void Scene::MarkReplicationDirty(Node* node)
     }
 }
 
-void Scene::HandleUpdate(StringHash eventType, VariantMap& eventData)
+void Scene::HandleUpdate(UpdateEvent& event)
 {
     if (!updateEnabled_)
         return;
 
-    using namespace Update;
-    Update(eventData[P_TIMESTEP].GetFloat());
+    Update(event.timeStep_);
 }
 
 void Scene::HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData)
@@ -1517,4 +1520,40 @@ void RegisterSceneLibrary()
     SplinePath::RegisterObject();
 }
 
+void SceneUpdateEvent::ToVariantMap(VariantMap& eventData) const
+{
+    eventData[SceneUpdate::P_SCENE] = scene_;
+    eventData[SceneUpdate::P_TIMESTEP] = timeStep_;
+}
+
+void SceneUpdateEvent::FromVariantMap(VariantMap& eventData)
+{
+    scene_ = static_cast<Scene*>(eventData[SceneUpdate::P_SCENE].GetPtr());
+    timeStep_ = eventData[SceneUpdate::P_TIMESTEP].GetFloat();
+}
+
+void SceneSubsystemUpdateEvent::ToVariantMap(VariantMap& eventData) const
+{
+    eventData[SceneSubsystemUpdate::P_SCENE] = scene_;
+    eventData[SceneSubsystemUpdate::P_TIMESTEP] = timeStep_;
+}
+
+void SceneSubsystemUpdateEvent::FromVariantMap(VariantMap& eventData)
+{
+    scene_ = static_cast<Scene*>(eventData[SceneSubsystemUpdate::P_SCENE].GetPtr());
+    timeStep_ = eventData[SceneSubsystemUpdate::P_TIMESTEP].GetFloat();
+}
+
+void ScenePostUpdateEvent::ToVariantMap(VariantMap& eventData) const
+{
+    eventData[ScenePostUpdate::P_SCENE] = scene_;
+    eventData[ScenePostUpdate::P_TIMESTEP] = timeStep_;
+}
+
+void ScenePostUpdateEvent::FromVariantMap(VariantMap& eventData)
+{
+    scene_ = static_cast<Scene*>(eventData[ScenePostUpdate::P_SCENE].GetPtr());
+    timeStep_ = eventData[ScenePostUpdate::P_TIMESTEP].GetFloat();
+}
+
 }
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "../containers/flat_hash_map.h"
 #include "../containers/hash_set.h"
 #include "../resource/xml_element.h"
 #include "../resource/json_file.h"
@@ -19,6 +20,7 @@ namespace dviglo
 
 class File;
 class PackageFile;
+struct UpdateEvent;
 
 inline constexpr id32 FIRST_REPLICATED_ID = 0x1;
 inline constexpr id32 LAST_REPLICATED_ID = 0xffffff;
@@ -245,7 +247,7 @@ public:
 
 private:
     /// Handle the logic update event to update the scene, if active.
-    void HandleUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleUpdate(UpdateEvent& event);
     /// Handle a background loaded resource completing.
     void HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData);
     /// Update asynchronous loading.
@@ -264,13 +266,13 @@ private:
     void PreloadResourcesJSON(const JSONValue& value);
 
     /// Replicated scene nodes by ID.
-    HashMap<NodeId, Node*> replicatedNodes_;
+    FlatHashMap<NodeId, Node*> replicatedNodes_;
     /// Local scene nodes by ID.
-    HashMap<NodeId, Node*> localNodes_;
+    FlatHashMap<NodeId, Node*> localNodes_;
     /// Replicated components by ID.
-    HashMap<ComponentId, Component*> replicatedComponents_;
+    FlatHashMap<ComponentId, Component*> replicatedComponents_;
     /// Local components by ID.
-    HashMap<ComponentId, Component*> localComponents_;
+    FlatHashMap<ComponentId, Component*> localComponents_;
     /// Cached tagged nodes by tag.
     HashMap<StringHash, Vector<Node*>> taggedNodes_;
     /// Asynchronous loading progress.
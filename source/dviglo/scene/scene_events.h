@@ -9,6 +9,8 @@
 namespace dviglo
 {
 
+class Scene;
+
 /// Variable timestep scene update.
 DV_EVENT(E_SCENEUPDATE, SceneUpdate)
 {
@@ -16,6 +18,22 @@ DV_EVENT(E_SCENEUPDATE, SceneUpdate)
     DV_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed version of E_SCENEUPDATE.
+struct DV_API SceneUpdateEvent
+{
+    DV_TYPED_EVENT(E_SCENEUPDATE)
+
+    /// Scene.
+    Scene* scene_;
+    /// Timestep, scaled by the time scale of the scene.
+    float timeStep_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const;
+    /// Read parameters sent with SendEvent().
+    void FromVariantMap(VariantMap& eventData);
+};
+
 /// Scene subsystem update.
 DV_EVENT(E_SCENESUBSYSTEMUPDATE, SceneSubsystemUpdate)
 {
@@ -23,6 +41,22 @@ DV_EVENT(E_SCENESUBSYSTEMUPDATE, SceneSubsystemUpdate)
     DV_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed version of E_SCENESUBSYSTEMUPDATE.
+struct DV_API SceneSubsystemUpdateEvent
+{
+    DV_TYPED_EVENT(E_SCENESUBSYSTEMUPDATE)
+
+    /// Scene.
+    Scene* scene_;
+    /// Timestep, scaled by the time scale of the scene.
+    float timeStep_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const;
+    /// Read parameters sent with SendEvent().
+    void FromVariantMap(VariantMap& eventData);
+};
+
 /// Scene transform smoothing update.
 DV_EVENT(E_UPDATESMOOTHING, UpdateSmoothing)
 {
@@ -75,6 +109,22 @@ DV_EVENT(E_SCENEPOSTUPDATE, ScenePostUpdate)
     DV_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed version of E_SCENEPOSTUPDATE.
+struct DV_API ScenePostUpdateEvent
+{
+    DV_TYPED_EVENT(E_SCENEPOSTUPDATE)
+
+    /// Scene.
+    Scene* scene_;
+    /// Timestep, scaled by the time scale of the scene.
+    float timeStep_;
+
+    /// Fill parameters for VariantMap subscribers.
+    void ToVariantMap(VariantMap& eventData) const;
+    /// Read parameters sent with SendEvent().
+    void FromVariantMap(VariantMap& eventData);
+};
+
 /// Asynchronous scene loading progress.
 DV_EVENT(E_ASYNCLOADPROGRESS, AsyncLoadProgress)
 {
@@ -4,12 +4,12 @@
 
 #include "../core/context.h"
 #include "../core/profiler.h"
-#include "../core/work_queue.h"
+#include "../core/task_graph.h"
 #include "../graphics/camera.h"
 #include "../graphics/geometry.h"
 #include "../graphics/graphics_events.h"
 #include "../graphics/material.h"
-#include "../graphics/octree_query.h"
+#include "../graphics/octree.h"
 #include "../graphics/technique.h"
 #include "../graphics/view.h"
 #include "../graphics_api/index_buffer.h"
@@ -29,6 +29,7 @@ namespace dviglo
 extern const char* blendModeNames[];
 
 static const VertexElements MASK_VERTEX2D = VertexElements::Position | VertexElements::Color | VertexElements::TexCoord1;
+static const int VISIBILITY_CHECK_GRAIN = 64;
 
 ViewBatchInfo2D::ViewBatchInfo2D() :
     vertexBufferUpdateFrameNumber_(0),
@@ -283,11 +284,9 @@ SharedPtr<Material> Renderer2D::CreateMaterial(Texture2D* texture, BlendMode ble
     return newMaterial;
 }
 
-void CheckDrawableVisibilityWork(const WorkItem* item, i32 threadIndex)
+void CheckDrawableVisibilityWork(Renderer2D* renderer, Drawable2D** start, Drawable2D** end)
 {
-    auto* renderer = reinterpret_cast<Renderer2D*>(item->aux_);
-    auto** start = reinterpret_cast<Drawable2D**>(item->start_);
-    auto** end = reinterpret_cast<Drawable2D**>(item->end_);
+    DV_PROFILE(CheckDrawableVisibilityWork);
 
     while (start != end)
     {
@@ -305,63 +304,50 @@ void Renderer2D::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventDa
     if (GetScene() != eventData[P_SCENE].GetPtr())
         return;
 
-    frame_ = static_cast<View*>(eventData[P_VIEW].GetPtr())->GetFrameInfo();
+    auto* view = static_cast<View*>(eventData[P_VIEW].GetPtr());
+    frame_ = view->GetFrameInfo();
 
     DV_PROFILE(UpdateRenderer2D);
 
     auto* camera = static_cast<Camera*>(eventData[P_CAMERA].GetPtr());
     frustum_ = camera->GetFrustum();
     viewMask_ = camera->GetViewMask();
+    if (octant_)
+        octant_->UpdateDrawableCullData(this);
 
-    // Check visibility
-    {
-        DV_PROFILE(CheckDrawableVisibility);
+    // Check visibility in the frame graph of the view, concurrently with the occlusion of the view. Batches need
+    // the main thread, and are formed before the view checks the visibility of the scene drawables
+    TaskGraph* graph = view->GetFrameGraph();
 
-        auto* queue = GetSubsystem<WorkQueue>();
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = drawables_.Size() / numWorkItems;
+    i32 visibilityTask = graph->AddParallelFor(0, drawables_.Size(), VISIBILITY_CHECK_GRAIN, [this](i32 begin, i32 end, i32 threadIndex)
+    {
+        CheckDrawableVisibilityWork(this, drawables_.Buffer() + begin, drawables_.Buffer() + end);
+    });
 
-        Vector<Drawable2D*>::Iterator start = drawables_.Begin();
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = WI_MAX_PRIORITY;
-            item->workFunction_ = CheckDrawableVisibilityWork;
-            item->aux_ = this;
+    i32 batchTask = graph->AddMainThreadTask([this, camera](i32, i32, i32)
+    {
+        ViewBatchInfo2D& viewBatchInfo = viewBatchInfos_[camera];
 
-            Vector<Drawable2D*>::Iterator end = drawables_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
+        // Create vertex buffer
+        if (!viewBatchInfo.vertexBuffer_)
+            viewBatchInfo.vertexBuffer_ = new VertexBuffer();
 
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
+        UpdateViewBatchInfo(viewBatchInfo, camera);
 
-            start = end;
+        // Go through the drawables to form geometries & batches and calculate the total vertex / index count,
+        // but upload the actual vertex data later. The idea is that the View class copies our batch vector to
+        // its internal data structures, so we can reuse the batches for each view, provided that unique Geometry
+        // objects are used for each view to specify the draw ranges
+        batches_.Resize(viewBatchInfo.batchCount_);
+        for (unsigned i = 0; i < viewBatchInfo.batchCount_; ++i)
+        {
+            batches_[i].distance_ = viewBatchInfo.distances_[i];
+            batches_[i].material_ = viewBatchInfo.materials_[i];
+            batches_[i].geometry_ = viewBatchInfo.geometries_[i];
         }
+    });
 
-        queue->Complete(WI_MAX_PRIORITY);
-    }
-
-    ViewBatchInfo2D& viewBatchInfo = viewBatchInfos_[camera];
-
-    // Create vertex buffer
-    if (!viewBatchInfo.vertexBuffer_)
-        viewBatchInfo.vertexBuffer_ = new VertexBuffer();
-
-    UpdateViewBatchInfo(viewBatchInfo, camera);
-
-    // Go through the drawables to form geometries & batches and calculate the total vertex / index count,
-    // but upload the actual vertex data later. The idea is that the View class copies our batch vector to
-    // its internal data structures, so we can reuse the batches for each view, provided that unique Geometry
-    // objects are used for each view to specify the draw ranges
-    batches_.Resize(viewBatchInfo.batchCount_);
-    for (unsigned i = 0; i < viewBatchInfo.batchCount_; ++i)
-    {
-        batches_[i].distance_ = viewBatchInfo.distances_[i];
-        batches_[i].material_ = viewBatchInfo.materials_[i];
-        batches_[i].geometry_ = viewBatchInfo.geometries_[i];
-    }
+    graph->AddDependency(batchTask, visibilityTask);
 }
 
 void Renderer2D::GetDrawables(Vector<Drawable2D*>& drawables, Node* node)
@@ -52,7 +52,7 @@ class DV_API Renderer2D : public Drawable
 {
     DV_OBJECT(Renderer2D, Drawable);
 
-    friend void CheckDrawableVisibilityWork(const WorkItem* item, i32 threadIndex);
+    friend void CheckDrawableVisibilityWork(Renderer2D* renderer, Drawable2D** start, Drawable2D** end);
 
 public:
     /// Construct.
@@ -86,7 +86,7 @@ private:
     void OnWorldBoundingBoxUpdate() override;
     /// Create material by texture and blend mode.
     SharedPtr<Material> CreateMaterial(Texture2D* texture, BlendMode blendMode);
-    /// Handle view update begin event. Determine Drawable2D's and their batches here.
+    /// Handle view update begin event. Add the tasks which determine visible Drawable2D's and their batches to the frame graph of the view.
     void HandleBeginViewUpdate(StringHash eventType, VariantMap& eventData);
     /// Get all drawables in node.
     void GetDrawables(Vector<Drawable2D*>& drawables, Node* node);
@@ -0,0 +1,108 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace allocation_counter
+{
+
+static std::atomic<bool> enabled{false};
+static std::atomic<i64> numAllocations{0};
+
+void SetEnabled(bool value)
+{
+    enabled.store(value, std::memory_order_relaxed);
+}
+
+i64 GetNumAllocations()
+{
+    return numAllocations.load(std::memory_order_relaxed);
+}
+
+void Reset()
+{
+    numAllocations.store(0, std::memory_order_relaxed);
+}
+
+static void* Allocate(size_t size) noexcept
+{
+    if (enabled.load(std::memory_order_relaxed))
+        numAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    return malloc(size ? size : 1);
+}
+
+// The original pointer is stored before the aligned block
+static void* AllocateAligned(size_t size, size_t alignment) noexcept
+{
+    if (alignment < sizeof(void*))
+        alignment = sizeof(void*);
+
+    void* original = Allocate(size + alignment);
+    if (!original)
+        return nullptr;
+
+    uintptr_t address = ((uintptr_t)original + alignment) & ~(uintptr_t)(alignment - 1);
+    reinterpret_cast<void**>(address)[-1] = original;
+    return reinterpret_cast<void*>(address);
+}
+
+static void FreeAligned(void* ptr) noexcept
+{
+    if (ptr)
+        free(reinterpret_cast<void**>(ptr)[-1]);
+}
+
+}
+
+using namespace allocation_counter;
+
+void* operator new(size_t size)
+{
+    void* ret = Allocate(size);
+    if (!ret)
+        throw std::bad_alloc();
+    return ret;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* ret = AllocateAligned(size, (size_t)alignment);
+    if (!ret)
+        throw std::bad_alloc();
+    return ret;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
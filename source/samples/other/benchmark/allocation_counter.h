@@ -0,0 +1,19 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include <dviglo/common/primitive_types.h>
+
+using namespace dvt;
+
+// Counts heap allocations made with the operator new while counting is enabled.
+// When the engine is built as a DLL on Windows, allocations inside the engine are not counted
+namespace allocation_counter
+{
+
+void SetEnabled(bool enabled);
+i64 GetNumAllocations();
+void Reset();
+
+}
@@ -8,6 +8,7 @@
 #include "appstate_benchmark02.h"
 #include "appstate_benchmark03.h"
 #include "appstate_benchmark04.h"
+#include "appstate_benchmark05.h"
 #include "appstate_main_screen.h"
 #include "appstate_result_screen.h"
 
@@ -23,6 +24,7 @@ AppStateManager::AppStateManager()
     appStates_.Insert({APPSTATEID_BENCHMARK02, MakeShared<AppState_Benchmark02>()});
     appStates_.Insert({APPSTATEID_BENCHMARK03, MakeShared<AppState_Benchmark03>()});
     appStates_.Insert({APPSTATEID_BENCHMARK04, MakeShared<AppState_Benchmark04>()});
+    appStates_.Insert({APPSTATEID_BENCHMARK05, MakeShared<AppState_Benchmark05>()});
 }
 
 void AppStateManager::Apply()
@@ -17,6 +17,7 @@ inline constexpr AppStateId APPSTATEID_BENCHMARK01 = 3;
 inline constexpr AppStateId APPSTATEID_BENCHMARK02 = 4;
 inline constexpr AppStateId APPSTATEID_BENCHMARK03 = 5;
 inline constexpr AppStateId APPSTATEID_BENCHMARK04 = 6;
+inline constexpr AppStateId APPSTATEID_BENCHMARK05 = 7;
 
 class AppStateManager : public dv::Object
 {
@@ -38,15 +38,22 @@ void AppState_Base::UpdateCurrentFpsElement()
 
 void AppState_Base::SetupViewport()
 {
+    Renderer* renderer = GetSubsystem<Renderer>();
+
+    // Headless mode
+    if (!renderer)
+        return;
+
     Node* cameraNode = scene_->GetChild("Camera");
     Camera* camera = cameraNode->GetComponent<Camera>();
     SharedPtr<Viewport> viewport(new Viewport(scene_, camera));
-
-    Renderer* renderer = GetSubsystem<Renderer>();
     renderer->SetViewport(0, viewport);
 }
 
 void AppState_Base::DestroyViewport()
 {
-    GetSubsystem<Renderer>()->SetViewport(0, nullptr);
+    Renderer* renderer = GetSubsystem<Renderer>();
+
+    if (renderer)
+        renderer->SetViewport(0, nullptr);
 }
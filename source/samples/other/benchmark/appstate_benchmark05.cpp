@@ -0,0 +1,125 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "app_state_manager.h"
+#include "appstate_benchmark05.h"
+#include "benchmark02_woman_mover.h"
+
+#include <dviglo/graphics/animated_model.h>
+#include <dviglo/graphics/animation.h>
+#include <dviglo/graphics/animation_state.h>
+#include <dviglo/graphics/camera.h>
+#include <dviglo/graphics/light.h>
+#include <dviglo/graphics/material.h>
+#include <dviglo/graphics/model.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/graphics/static_model.h>
+#include <dviglo/graphics/zone.h>
+#include <dviglo/input/input.h>
+#include <dviglo/resource/resource_cache.h>
+#include <dviglo/scene/scene_events.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+AppState_Benchmark05::AppState_Benchmark05()
+{
+    name_ = "Skeletal Animation";
+}
+
+// Scene of the skeletal animation sample with 1000 characters instead of 30
+void AppState_Benchmark05::OnEnter()
+{
+    assert(!scene_);
+    scene_ = new Scene();
+    scene_->CreateComponent<Octree>();
+
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    Node* planeNode = scene_->CreateChild("Plane");
+    planeNode->SetScale(Vector3(100.f, 1.f, 100.f));
+    StaticModel* planeObject = planeNode->CreateComponent<StaticModel>();
+    planeObject->SetModel(cache->GetResource<Model>("Models/Plane.mdl"));
+    planeObject->SetMaterial(cache->GetResource<Material>("Materials/StoneTiled.xml"));
+
+    Node* zoneNode = scene_->CreateChild("Zone");
+    Zone* zone = zoneNode->CreateComponent<Zone>();
+    zone->SetBoundingBox(BoundingBox(-1000.f, 1000.f));
+    zone->SetAmbientColor(Color(0.5f, 0.5f, 0.5f));
+    zone->SetFogColor(Color(0.4f, 0.5f, 0.8f));
+    zone->SetFogStart(100.f);
+    zone->SetFogEnd(300.f);
+
+    Node* lightNode = scene_->CreateChild("DirectionalLight");
+    lightNode->SetDirection(Vector3(0.6f, -1.f, 0.8f));
+    Light* light = lightNode->CreateComponent<Light>();
+    light->SetLightType(LIGHT_DIRECTIONAL);
+    light->SetCastShadows(true);
+    light->SetColor(Color(0.5f, 0.5f, 0.5f));
+    light->SetShadowBias(BiasParameters(0.00025f, 0.5f));
+    light->SetShadowCascade(CascadeParameters(10.f, 50.f, 200.f, 0.f, 0.8f));
+
+    constexpr i32 NUM_MODELS = 1000;
+    const BoundingBox bounds(Vector3(-45.f, 0.f, -45.f), Vector3(45.f, 0.f, 45.f));
+    Animation* walkAnimation = cache->GetResource<Animation>("Models/Kachujin/Kachujin_Walk.ani");
+
+    for (i32 i = 0; i < NUM_MODELS; ++i)
+    {
+        Node* modelNode = scene_->CreateChild("Jill");
+        modelNode->SetPosition(Vector3(Random(-45.f, 45.f), 0.f, Random(-45.f, 45.f)));
+        modelNode->SetRotation(Quaternion(0.f, Random(360.f), 0.f));
+
+        AnimatedModel* modelObject = modelNode->CreateComponent<AnimatedModel>();
+        modelObject->SetModel(cache->GetResource<Model>("Models/Kachujin/Kachujin.mdl"));
+        modelObject->SetMaterial(cache->GetResource<Material>("Models/Kachujin/Materials/Kachujin.xml"));
+        modelObject->SetCastShadows(true);
+
+        AnimationState* state = modelObject->AddAnimationState(walkAnimation);
+        if (state)
+        {
+            state->SetWeight(1.f);
+            state->SetLooped(true);
+            state->SetTime(Random(walkAnimation->GetLength()));
+        }
+
+        Benchmark02_WomanMover* mover = modelNode->CreateComponent<Benchmark02_WomanMover>();
+        mover->SetParameters(2.f, 100.f, bounds);
+    }
+
+    // Looks at the crowd from above, so most of the characters are visible
+    Node* cameraNode = scene_->CreateChild("Camera");
+    cameraNode->SetPosition(Vector3(0.f, 30.f, -70.f));
+    cameraNode->LookAt(Vector3::ZERO);
+    Camera* camera = cameraNode->CreateComponent<Camera>();
+    camera->SetFarClip(300.f);
+
+    GetSubsystem<Input>()->SetMouseVisible(false);
+    SetupViewport();
+    SubscribeToEvent(scene_, E_SCENEUPDATE, DV_HANDLER(AppState_Benchmark05, HandleSceneUpdate));
+    fpsCounter_.Clear();
+}
+
+void AppState_Benchmark05::OnLeave()
+{
+    UnsubscribeFromAllEvents();
+    DestroyViewport();
+    scene_ = nullptr;
+}
+
+void AppState_Benchmark05::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+    float timeStep = eventData[SceneUpdate::P_TIMESTEP].GetFloat();
+
+    fpsCounter_.Update(timeStep);
+    UpdateCurrentFpsElement();
+
+    if (GetSubsystem<Input>()->GetKeyDown(KEY_ESCAPE))
+    {
+        GetSubsystem<AppStateManager>()->SetRequiredAppStateId(APPSTATEID_MAINSCREEN);
+        return;
+    }
+
+    if (fpsCounter_.GetTotalTime() >= 25.f)
+        GetSubsystem<AppStateManager>()->SetRequiredAppStateId(APPSTATEID_RESULTSCREEN);
+}
@@ -0,0 +1,20 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "appstate_base.h"
+
+class AppState_Benchmark05 : public AppState_Base
+{
+public:
+    DV_OBJECT(AppState_Benchmark05, AppState_Base);
+
+public:
+    AppState_Benchmark05();
+
+    void OnEnter() override;
+    void OnLeave() override;
+
+    void HandleSceneUpdate(dv::StringHash eventType, dv::VariantMap& eventData);
+};
@@ -22,6 +22,7 @@ static const String BENCHMARK_01_STR = "Benchmark 01";
 static const String BENCHMARK_02_STR = "Benchmark 02";
 static const String BENCHMARK_03_STR = "Benchmark 03";
 static const String BENCHMARK_04_STR = "Benchmark 04";
+static const String BENCHMARK_05_STR = "Benchmark 05";
 
 void AppState_MainScreen::HandleButtonPressed(StringHash eventType, VariantMap& eventData)
 {
@@ -36,6 +37,8 @@ void AppState_MainScreen::HandleButtonPressed(StringHash eventType, VariantMap&
         appStateManager->SetRequiredAppStateId(APPSTATEID_BENCHMARK03);
     else if (pressedButton->GetName() == BENCHMARK_04_STR)
         appStateManager->SetRequiredAppStateId(APPSTATEID_BENCHMARK04);
+    else if (pressedButton->GetName() == BENCHMARK_05_STR)
+        appStateManager->SetRequiredAppStateId(APPSTATEID_BENCHMARK05);
 }
 
 void AppState_MainScreen::CreateButton(const String& name, const String& text, Window& parent)
@@ -72,6 +75,7 @@ void AppState_MainScreen::CreateGui()
     CreateButton(BENCHMARK_02_STR, appStateManager->GetName(APPSTATEID_BENCHMARK02), *window);
     CreateButton(BENCHMARK_03_STR, appStateManager->GetName(APPSTATEID_BENCHMARK03), *window);
     CreateButton(BENCHMARK_04_STR, appStateManager->GetName(APPSTATEID_BENCHMARK04), *window);
+    CreateButton(BENCHMARK_05_STR, appStateManager->GetName(APPSTATEID_BENCHMARK05), *window);
 }
 
 void AppState_MainScreen::DestroyGui()
@@ -0,0 +1,228 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "allocation_counter.h"
+#include "benchmark_runner.h"
+
+#include <dviglo/core/core_events.h>
+#include <dviglo/core/process_utils.h>
+#include <dviglo/core/profiler.h>
+#include <dviglo/core/trace_recorder.h>
+#include <dviglo/engine/engine.h>
+#include <dviglo/graphics/graphics_events.h>
+#include <dviglo/io/log.h>
+#include <dviglo/resource/json_file.h>
+
+#include <algorithm>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+// Frames after loading of a scene, which are not measured
+static constexpr i32 WARM_UP_FRAMES = 30;
+
+// Timestep of every frame, so the same scene state is measured on every run
+static constexpr float FIXED_TIME_STEP = 1.f / 60.f;
+
+// Measured subsystem
+struct Subsystem
+{
+    // Name in the output
+    const char* name_;
+
+    // Profiler blocks, which are summed over all threads. The main thread waits for the workers inside its blocks,
+    // their blocks add the work of the workers. A block inside another block of the list is not counted twice
+    Vector<const char*> blocks_;
+
+    // Views are not updated in headless mode, so the subsystem is measured only with a window
+    bool needsWindow_;
+};
+
+static const Subsystem SUBSYSTEMS[] =
+{
+    {"scene_update", {"UpdateScene"}, false},
+    {"octree_update", {"UpdateDrawables", "ReinsertToOctree", "UpdateDrawableTransforms", "UpdateExpensiveDrawablesWork",
+        "UpdateDrawablesWork", "UpdateReinsertTransforms", "FindReinsertOctants"}, false},
+    {"view_preparation", {"UpdateViews"}, true},
+    {"animation", {"UpdateAnimation"}, false},
+    {"physics", {"UpdatePhysics"}, false},
+};
+
+static constexpr i32 NUM_SUBSYSTEMS = sizeof(SUBSYSTEMS) / sizeof(SUBSYSTEMS[0]);
+
+// Percentile of sorted values (nearest rank method)
+static float GetPercentile(const Vector<float>& sortedValues, float percent)
+{
+    if (sortedValues.Empty())
+        return 0.f;
+
+    i32 rank = CeilToInt(percent / 100.f * sortedValues.Size());
+    return sortedValues[Clamp(rank - 1, 0, sortedValues.Size() - 1)];
+}
+
+BenchmarkRunner::BenchmarkRunner(i32 numFrames, const String& outputPath, const String& tracePath) :
+    numFrames_(Max(numFrames, 1)),
+    outputPath_(outputPath),
+    tracePath_(tracePath)
+{
+    Vector<AppStateId> appStateIds = {APPSTATEID_BENCHMARK01, APPSTATEID_BENCHMARK02, APPSTATEID_BENCHMARK03};
+
+    // Benchmark04 draws sprites directly and needs a GPU
+    if (!GetSubsystem<Engine>()->IsHeadless())
+        appStateIds.Push(APPSTATEID_BENCHMARK04);
+
+    appStateIds.Push(APPSTATEID_BENCHMARK05);
+
+    for (AppStateId appStateId : appStateIds)
+    {
+        Result& result = results_.EmplaceBack();
+        result.appStateId_ = appStateId;
+        result.frameTimes_.Reserve(numFrames_);
+        result.subsystemTimes_.Resize(NUM_SUBSYSTEMS, 0.0);
+    }
+
+    // Subsystem times are taken from the trace, because the profiler shows only the main thread
+    TraceRecorder::SetEnabled(true);
+
+    GetSubsystem<AppStateManager>()->SetRequiredAppStateId(results_[0].appStateId_);
+    SubscribeToEvent(E_BEGINVIEWUPDATE, DV_HANDLER(BenchmarkRunner, HandleBeginViewUpdate));
+    SubscribeToEvent(E_ENDVIEWUPDATE, DV_HANDLER(BenchmarkRunner, HandleEndViewUpdate));
+    SubscribeToEvent(E_ENDFRAME, DV_HANDLER(BenchmarkRunner, HandleEndFrame));
+}
+
+bool BenchmarkRunner::IsMeasuredFrame() const
+{
+    // frameCounter_ is incremented at the end of the frame
+    return currentResult_ < results_.Size() && frameCounter_ >= WARM_UP_FRAMES
+        && GetSubsystem<AppStateManager>()->GetCurrentAppStateId() == results_[currentResult_].appStateId_;
+}
+
+void BenchmarkRunner::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventData)
+{
+    // View preparation should not allocate memory in steady state
+    if (IsMeasuredFrame())
+        allocation_counter::SetEnabled(true);
+}
+
+void BenchmarkRunner::HandleEndViewUpdate(StringHash eventType, VariantMap& eventData)
+{
+    allocation_counter::SetEnabled(false);
+}
+
+void BenchmarkRunner::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    // Ignore the time of the frame limiter, the next frame advances the scene by the same step on any hardware
+    GetSubsystem<Engine>()->SetNextTimeStep(FIXED_TIME_STEP);
+
+    long long frameTime = frameTimer_.GetUSec(true);
+    i64 frameBeginTicks = frameBeginTicks_;
+    frameBeginTicks_ = TraceRecorder::GetTicks();
+
+    if (currentResult_ >= results_.Size())
+        return;
+
+    Result& result = results_[currentResult_];
+    AppStateManager* appStateManager = GetSubsystem<AppStateManager>();
+
+    // Benchmarks can request the result screen or the main screen. Do not allow it
+    appStateManager->SetRequiredAppStateId(result.appStateId_);
+
+    // The benchmark will be entered at the beginning of the next frame
+    if (appStateManager->GetCurrentAppStateId() != result.appStateId_)
+        return;
+
+    if (++frameCounter_ <= WARM_UP_FRAMES)
+    {
+        allocation_counter::Reset();
+        return;
+    }
+
+    result.frameTimes_.Push(frameTime / 1000.f);
+
+    for (i32 i = 0; i < NUM_SUBSYSTEMS; ++i)
+        result.subsystemTimes_[i] += TraceRecorder::GetTotalTime(SUBSYSTEMS[i].blocks_, frameBeginTicks) / 1000000.0;
+
+    if (frameCounter_ < WARM_UP_FRAMES + numFrames_)
+        return;
+
+    result.viewUpdateAllocations_ = allocation_counter::GetNumAllocations();
+
+    DV_LOGINFO("Benchmark \"" + appStateManager->GetName(result.appStateId_) + "\" finished");
+
+    frameCounter_ = 0;
+    ++currentResult_;
+
+    if (currentResult_ < results_.Size())
+    {
+        appStateManager->SetRequiredAppStateId(results_[currentResult_].appStateId_);
+    }
+    else
+    {
+        SaveResults();
+        GetSubsystem<Engine>()->Exit();
+    }
+}
+
+void BenchmarkRunner::SaveResults()
+{
+    AppStateManager* appStateManager = GetSubsystem<AppStateManager>();
+    bool headless = GetSubsystem<Engine>()->IsHeadless();
+
+    JSONFile file;
+    JSONValue& root = file.GetRoot();
+    root.Set("headless", headless);
+    root.Set("frames", numFrames_);
+    root.Set("warm_up_frames", WARM_UP_FRAMES);
+    root.Set("time_step", FIXED_TIME_STEP);
+    root.Set("profiler", GetSubsystem<Profiler>() != nullptr);
+
+    JSONValue benchmarks;
+
+    for (Result& result : results_)
+    {
+        Vector<float> sortedFrameTimes = result.frameTimes_;
+        std::sort(sortedFrameTimes.Begin(), sortedFrameTimes.End());
+
+        float totalFrameTime = 0.f;
+        for (float frameTime : sortedFrameTimes)
+            totalFrameTime += frameTime;
+
+        JSONValue frameTimes;
+        frameTimes.Set("mean", totalFrameTime / sortedFrameTimes.Size());
+        frameTimes.Set("min", sortedFrameTimes.Front());
+        frameTimes.Set("p50", GetPercentile(sortedFrameTimes, 50.f));
+        frameTimes.Set("p95", GetPercentile(sortedFrameTimes, 95.f));
+        frameTimes.Set("p99", GetPercentile(sortedFrameTimes, 99.f));
+        frameTimes.Set("max", sortedFrameTimes.Back());
+
+        // Mean time per frame. Values which are not measured are null
+        JSONValue subsystemTimes;
+        for (i32 i = 0; i < NUM_SUBSYSTEMS; ++i)
+        {
+            if (headless && SUBSYSTEMS[i].needsWindow_)
+                subsystemTimes.Set(SUBSYSTEMS[i].name_, JSONValue());
+            else
+                subsystemTimes.Set(SUBSYSTEMS[i].name_, result.subsystemTimes_[i] / sortedFrameTimes.Size());
+        }
+
+        JSONValue benchmark;
+        benchmark.Set("name", appStateManager->GetName(result.appStateId_));
+        benchmark.Set("frame_time_ms", frameTimes);
+        benchmark.Set("subsystem_time_ms", subsystemTimes);
+        benchmark.Set("view_update_allocations", headless ? JSONValue() : JSONValue((double)result.viewUpdateAllocations_));
+        benchmarks.Push(benchmark);
+    }
+
+    root.Set("benchmarks", benchmarks);
+
+    if (outputPath_.Empty())
+        PrintLine(file.ToString("  "));
+    else if (file.SaveFile(outputPath_))
+        DV_LOGINFO("Benchmark results saved to " + outputPath_);
+
+    TraceRecorder::SetEnabled(false);
+
+    if (!tracePath_.Empty() && TraceRecorder::SaveChromeTrace(tracePath_))
+        DV_LOGINFO("Trace saved to " + tracePath_);
+}
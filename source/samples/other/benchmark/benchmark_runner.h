@@ -0,0 +1,63 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include "app_state_manager.h"
+
+#include <dviglo/core/timer.h>
+
+// Runs benchmarks one after another for a fixed number of frames with a fixed timestep
+// and saves frame times, per-subsystem CPU timings and the number of heap allocations during view updates as JSON.
+// Usage: other_benchmark -benchmark [-headless] [-benchmark_frames 1000] [-benchmark_output result.json] [-benchmark_trace trace.json]
+// Views are not updated with -headless, so "view_preparation" and "view_update_allocations" are null then.
+// They need a window. Without a display, the window can be created by SDL_VIDEODRIVER=offscreen
+// (renders with the GL driver available, e.g. software Mesa)
+class BenchmarkRunner : public dv::Object
+{
+public:
+    DV_OBJECT(BenchmarkRunner, Object);
+
+private:
+    struct Result
+    {
+        AppStateId appStateId_;
+
+        // Durations of measured frames in milliseconds
+        dv::Vector<float> frameTimes_;
+
+        // Total CPU time of each subsystem on all threads in milliseconds. Indices correspond to the subsystem table in the .cpp
+        dv::Vector<double> subsystemTimes_;
+
+        // Heap allocations between the beginning and the end of view updates
+        i64 viewUpdateAllocations_ = 0;
+    };
+
+    dv::Vector<Result> results_;
+    i32 currentResult_ = 0;
+
+    // Number of frames of the current benchmark, including warm-up
+    i32 frameCounter_ = 0;
+
+    i32 numFrames_;
+    dv::String outputPath_;
+    dv::String tracePath_;
+
+    dv::HiresTimer frameTimer_;
+
+    // Trace time at the end of the previous frame
+    i64 frameBeginTicks_ = 0;
+
+    // Whether the current frame is measured
+    bool IsMeasuredFrame() const;
+
+    void HandleBeginViewUpdate(dv::StringHash eventType, dv::VariantMap& eventData);
+    void HandleEndViewUpdate(dv::StringHash eventType, dv::VariantMap& eventData);
+    void HandleEndFrame(dv::StringHash eventType, dv::VariantMap& eventData);
+    void SaveResults();
+
+public:
+    // If outputPath is empty, results are printed to the standard output.
+    // If tracePath is not empty, the last frames of all threads are saved there in Chrome trace format
+    BenchmarkRunner(i32 numFrames, const dv::String& outputPath, const dv::String& tracePath);
+};
@@ -3,8 +3,11 @@
 // License: MIT
 
 #include "app_state_manager.h"
+#include "benchmark_runner.h"
 
 #include <dviglo/core/core_events.h>
+#include <dviglo/core/process_utils.h>
+#include <dviglo/core/string_utils.h>
 #include <dviglo/engine/application.h>
 #include <dviglo/engine/engine_defs.h>
 #include <dviglo/input/input.h>
@@ -20,6 +23,34 @@ class App : public Application
 {
     DV_OBJECT(App, Application);
 
+private:
+    // Automated mode: -benchmark [-benchmark_frames N] [-benchmark_output file.json] [-benchmark_trace file.json]
+    bool runBenchmarks_ = false;
+    i32 benchmarkFrames_ = 1000;
+    String benchmarkOutputPath_;
+    String benchmarkTracePath_;
+    SharedPtr<BenchmarkRunner> benchmarkRunner_;
+
+    void ParseBenchmarkArguments()
+    {
+        const Vector<String>& arguments = GetArguments();
+
+        for (i32 i = 0; i < arguments.Size(); ++i)
+        {
+            String argument = arguments[i].ToLower();
+            bool hasValue = i + 1 < arguments.Size();
+
+            if (argument == "-benchmark")
+                runBenchmarks_ = true;
+            else if (argument == "-benchmark_frames" && hasValue)
+                benchmarkFrames_ = ToI32(arguments[++i]);
+            else if (argument == "-benchmark_output" && hasValue)
+                benchmarkOutputPath_ = arguments[++i];
+            else if (argument == "-benchmark_trace" && hasValue)
+                benchmarkTracePath_ = arguments[++i];
+        }
+    }
+
 public:
     App()
     {
@@ -37,6 +68,12 @@ public:
         engineParameters_[EP_WINDOW_WIDTH] = 960;
         engineParameters_[EP_WINDOW_HEIGHT] = 720;
         engineParameters_[EP_FRAME_LIMITER] = false;
+
+        ParseBenchmarkArguments();
+
+        // Results are printed to the standard output, so do not mix them with the log
+        if (runBenchmarks_ && benchmarkOutputPath_.Empty())
+            engineParameters_[EP_LOG_QUIET] = true;
     }
 
     // This elements can be used anywhere in the program
@@ -61,6 +98,9 @@ public:
         GetSubsystem<Input>()->SetToggleFullscreen(false); // Block Alt+Enter
 
         CreateCurrentFpsUiElement();
+
+        if (runBenchmarks_)
+            benchmarkRunner_ = new BenchmarkRunner(benchmarkFrames_, benchmarkOutputPath_, benchmarkTracePath_);
     }
 
     void ApplyAppState(StringHash eventType, VariantMap& eventData)
@@ -0,0 +1,49 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include <dviglo/common/primitive_types.h>
+
+#include <chrono>
+
+// Results of measured functions are added here, so the compiler can not remove the measured code
+inline volatile dvt::u64 benchmarkSink = 0;
+
+// Minimal duration of one measurement in nanoseconds
+dvt::i64 GetBenchmarkMinTime();
+
+// Store the result of a measurement
+void AddBenchmarkResult(const char* group, const char* name, const char* impl, double nsPerOp);
+
+// Measure func several times and store the best time per operation.
+// func performs numOps operations and returns a value which depends on the results of the operations
+template <typename Func>
+void RunBenchmark(const char* group, const char* name, const char* impl, dvt::i32 numOps, Func func)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr dvt::i32 numMeasurements = 5;
+
+    double bestNsPerOp = 0.0;
+
+    for (dvt::i32 i = 0; i < numMeasurements; ++i)
+    {
+        dvt::i64 numCalls = 0;
+        dvt::i64 elapsed = 0;
+        Clock::time_point begin = Clock::now();
+
+        do
+        {
+            benchmarkSink = benchmarkSink + (dvt::u64)func();
+            ++numCalls;
+            elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+        }
+        while (elapsed < GetBenchmarkMinTime());
+
+        double nsPerOp = (double)elapsed / ((double)numCalls * numOps);
+        if (i == 0 || nsPerOp < bestNsPerOp)
+            bestNsPerOp = nsPerOp;
+    }
+
+    AddBenchmarkResult(group, name, impl, bestNsPerOp);
+}
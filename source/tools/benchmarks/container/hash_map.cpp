@@ -0,0 +1,182 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/containers/flat_hash_map.h>
+#include <dviglo/containers/hash_map.h>
+#include <dviglo/containers/str.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_ELEMENTS = 1000;
+
+void Benchmark_Container_HashMap()
+{
+    RunBenchmark("HashMap", "Insert", "dviglo", NUM_ELEMENTS, []
+    {
+        HashMap<i32, i32> map;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            map[i * 7919] = i;
+        return map.Size();
+    });
+
+    RunBenchmark("HashMap", "Insert", "flat", NUM_ELEMENTS, []
+    {
+        FlatHashMap<i32, i32> map;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            map[i * 7919] = i;
+        return map.Size();
+    });
+
+    RunBenchmark("HashMap", "Insert", "std", NUM_ELEMENTS, []
+    {
+        std::unordered_map<i32, i32> map;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            map[i * 7919] = i;
+        return map.size();
+    });
+
+    // Containers which are cleared and filled every frame keep their memory
+    RunBenchmark("HashMap", "Refill", "dviglo", NUM_ELEMENTS, []
+    {
+        static HashMap<i32, i32> map;
+        map.Clear();
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            map[i * 7919] = i;
+        return map.Size();
+    });
+
+    RunBenchmark("HashMap", "Refill", "flat", NUM_ELEMENTS, []
+    {
+        static FlatHashMap<i32, i32> map;
+        map.Clear();
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            map[i * 7919] = i;
+        return map.Size();
+    });
+
+    RunBenchmark("HashMap", "Refill", "std", NUM_ELEMENTS, []
+    {
+        static std::unordered_map<i32, i32> map;
+        map.clear();
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            map[i * 7919] = i;
+        return map.size();
+    });
+
+    HashMap<i32, i32> map;
+    FlatHashMap<i32, i32> flatMap;
+    std::unordered_map<i32, i32> stdMap;
+    for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        map[i * 7919] = i;
+        flatMap[i * 7919] = i;
+        stdMap[i * 7919] = i;
+    }
+
+    // Half of the keys are missing
+    RunBenchmark("HashMap", "Find", "dviglo", NUM_ELEMENTS, [&map]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+        {
+            auto it = map.Find(i * 7919 * 2);
+            if (it != map.End())
+                sum += it->second_;
+        }
+        return sum;
+    });
+
+    RunBenchmark("HashMap", "Find", "flat", NUM_ELEMENTS, [&flatMap]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+        {
+            auto it = flatMap.Find(i * 7919 * 2);
+            if (it != flatMap.End())
+                sum += it->second_;
+        }
+        return sum;
+    });
+
+    RunBenchmark("HashMap", "Find", "std", NUM_ELEMENTS, [&stdMap]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+        {
+            auto it = stdMap.find(i * 7919 * 2);
+            if (it != stdMap.end())
+                sum += it->second;
+        }
+        return sum;
+    });
+
+    RunBenchmark("HashMap", "Iterate", "dviglo", NUM_ELEMENTS, [&map]
+    {
+        i32 sum = 0;
+        for (const auto& pair : map)
+            sum += pair.second_;
+        return sum;
+    });
+
+    RunBenchmark("HashMap", "Iterate", "flat", NUM_ELEMENTS, [&flatMap]
+    {
+        i32 sum = 0;
+        for (const auto& pair : flatMap)
+            sum += pair.second_;
+        return sum;
+    });
+
+    RunBenchmark("HashMap", "Iterate", "std", NUM_ELEMENTS, [&stdMap]
+    {
+        i32 sum = 0;
+        for (const auto& pair : stdMap)
+            sum += pair.second;
+        return sum;
+    });
+
+    HashMap<String, i32> stringMap;
+    FlatHashMap<String, i32> flatStringMap;
+    std::unordered_map<std::string, i32> stdStringMap;
+    Vector<String> keys;
+    std::vector<std::string> stdKeys;
+    for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        keys.Push("SomeResourceName" + String(i));
+        stdKeys.push_back(keys.Back().c_str());
+        stringMap[keys.Back()] = i;
+        flatStringMap[keys.Back()] = i;
+        stdStringMap[stdKeys.back()] = i;
+    }
+
+    RunBenchmark("HashMap", "FindString", "dviglo", NUM_ELEMENTS, [&stringMap, &keys]
+    {
+        i32 sum = 0;
+        for (const String& key : keys)
+            sum += stringMap.Find(key)->second_;
+        return sum;
+    });
+
+    RunBenchmark("HashMap", "FindString", "flat", NUM_ELEMENTS, [&flatStringMap, &keys]
+    {
+        i32 sum = 0;
+        for (const String& key : keys)
+            sum += flatStringMap.Find(key)->second_;
+        return sum;
+    });
+
+    RunBenchmark("HashMap", "FindString", "std", NUM_ELEMENTS, [&stdStringMap, &stdKeys]
+    {
+        i32 sum = 0;
+        for (const std::string& key : stdKeys)
+            sum += stdStringMap.find(key)->second;
+        return sum;
+    });
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/containers/flat_hash_set.h>
+#include <dviglo/containers/hash_set.h>
+
+#include <unordered_set>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_ELEMENTS = 1000;
+
+void Benchmark_Container_HashSet()
+{
+    RunBenchmark("HashSet", "Insert", "dviglo", NUM_ELEMENTS, []
+    {
+        HashSet<i32> set;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            set.Insert(i * 7919);
+        return set.Size();
+    });
+
+    RunBenchmark("HashSet", "Insert", "flat", NUM_ELEMENTS, []
+    {
+        FlatHashSet<i32> set;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            set.Insert(i * 7919);
+        return set.Size();
+    });
+
+    RunBenchmark("HashSet", "Insert", "std", NUM_ELEMENTS, []
+    {
+        std::unordered_set<i32> set;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            set.insert(i * 7919);
+        return set.size();
+    });
+
+    HashSet<i32> set;
+    FlatHashSet<i32> flatSet;
+    std::unordered_set<i32> stdSet;
+    for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        set.Insert(i * 7919);
+        flatSet.Insert(i * 7919);
+        stdSet.insert(i * 7919);
+    }
+
+    // Half of the keys are missing
+    RunBenchmark("HashSet", "Contains", "dviglo", NUM_ELEMENTS, [&set]
+    {
+        i32 count = 0;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            count += set.Contains(i * 7919 * 2);
+        return count;
+    });
+
+    RunBenchmark("HashSet", "Contains", "flat", NUM_ELEMENTS, [&flatSet]
+    {
+        i32 count = 0;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            count += flatSet.Contains(i * 7919 * 2);
+        return count;
+    });
+
+    RunBenchmark("HashSet", "Contains", "std", NUM_ELEMENTS, [&stdSet]
+    {
+        i32 count = 0;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            count += (i32)stdSet.count(i * 7919 * 2);
+        return count;
+    });
+
+    RunBenchmark("HashSet", "Erase", "dviglo", NUM_ELEMENTS, [&set]
+    {
+        HashSet<i32> copy(set);
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            copy.Erase(i * 7919);
+        return copy.Size();
+    });
+
+    RunBenchmark("HashSet", "Erase", "flat", NUM_ELEMENTS, [&flatSet]
+    {
+        FlatHashSet<i32> copy(flatSet);
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            copy.Erase(i * 7919);
+        return copy.Size();
+    });
+
+    RunBenchmark("HashSet", "Erase", "std", NUM_ELEMENTS, [&stdSet]
+    {
+        std::unordered_set<i32> copy(stdSet);
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            copy.erase(i * 7919);
+        return copy.size();
+    });
+}
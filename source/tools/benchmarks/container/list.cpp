@@ -0,0 +1,57 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/containers/list.h>
+
+#include <list>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_ELEMENTS = 1000;
+
+void Benchmark_Container_List()
+{
+    RunBenchmark("List", "Push", "dviglo", NUM_ELEMENTS, []
+    {
+        List<i32> list;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            list.Push(i);
+        return list.Back();
+    });
+
+    RunBenchmark("List", "Push", "std", NUM_ELEMENTS, []
+    {
+        std::list<i32> list;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            list.push_back(i);
+        return list.back();
+    });
+
+    List<i32> list;
+    std::list<i32> stdList;
+    for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        list.Push(i);
+        stdList.push_back(i);
+    }
+
+    RunBenchmark("List", "Iterate", "dviglo", NUM_ELEMENTS, [&list]
+    {
+        i32 sum = 0;
+        for (i32 value : list)
+            sum += value;
+        return sum;
+    });
+
+    RunBenchmark("List", "Iterate", "std", NUM_ELEMENTS, [&stdList]
+    {
+        i32 sum = 0;
+        for (i32 value : stdList)
+            sum += value;
+        return sum;
+    });
+}
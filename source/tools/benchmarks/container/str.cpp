@@ -0,0 +1,126 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/containers/str.h>
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_OPS = 100;
+
+void Benchmark_Container_Str()
+{
+    // Fits in the short string buffer
+    RunBenchmark("String", "ConstructShort", "dviglo", NUM_OPS, []
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += String("Node").Length();
+        return sum;
+    });
+
+    RunBenchmark("String", "ConstructShort", "std", NUM_OPS, []
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += (i32)std::string("Node").length();
+        return sum;
+    });
+
+    RunBenchmark("String", "ConstructLong", "dviglo", NUM_OPS, []
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += String("Models/Kachujin/Kachujin_Walk.ani").Length();
+        return sum;
+    });
+
+    RunBenchmark("String", "ConstructLong", "std", NUM_OPS, []
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += (i32)std::string("Models/Kachujin/Kachujin_Walk.ani").length();
+        return sum;
+    });
+
+    RunBenchmark("String", "Append", "dviglo", NUM_OPS, []
+    {
+        String str;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            str += "Text";
+        return str.Length();
+    });
+
+    RunBenchmark("String", "Append", "std", NUM_OPS, []
+    {
+        std::string str;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            str += "Text";
+        return str.length();
+    });
+
+    String path = "Data/Models/Kachujin/Kachujin_Walk.ani";
+    std::string stdPath = path.c_str();
+
+    RunBenchmark("String", "Find", "dviglo", NUM_OPS, [&path]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += path.Find("Walk");
+        return sum;
+    });
+
+    RunBenchmark("String", "Find", "std", NUM_OPS, [&stdPath]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += (i32)stdPath.find("Walk");
+        return sum;
+    });
+
+    RunBenchmark("String", "ToLower", "dviglo", NUM_OPS, [&path]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += path.ToLower().Length();
+        return sum;
+    });
+
+    RunBenchmark("String", "ToLower", "std", NUM_OPS, [&stdPath]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+        {
+            std::string lower = stdPath;
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            sum += (i32)lower.length();
+        }
+        return sum;
+    });
+
+    String other = "Data/Models/Kachujin/Kachujin_Idle.ani";
+    std::string stdOther = other.c_str();
+
+    RunBenchmark("String", "Compare", "dviglo", NUM_OPS, [&path, &other]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += path == other;
+        return sum;
+    });
+
+    RunBenchmark("String", "Compare", "std", NUM_OPS, [&stdPath, &stdOther]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += stdPath == stdOther;
+        return sum;
+    });
+}
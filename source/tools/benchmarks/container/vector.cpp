@@ -0,0 +1,101 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/containers/vector.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_ELEMENTS = 1000;
+
+void Benchmark_Container_Vector()
+{
+    RunBenchmark("Vector", "Push", "dviglo", NUM_ELEMENTS, []
+    {
+        Vector<i32> vector;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            vector.Push(i);
+        return vector.Back();
+    });
+
+    RunBenchmark("Vector", "Push", "std", NUM_ELEMENTS, []
+    {
+        std::vector<i32> vector;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            vector.push_back(i);
+        return vector.back();
+    });
+
+    Vector<i32> vector;
+    std::vector<i32> stdVector;
+    for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        vector.Push((i * 7919) % NUM_ELEMENTS);
+        stdVector.push_back((i * 7919) % NUM_ELEMENTS);
+    }
+
+    RunBenchmark("Vector", "Iterate", "dviglo", NUM_ELEMENTS, [&vector]
+    {
+        i32 sum = 0;
+        for (i32 value : vector)
+            sum += value;
+        return sum;
+    });
+
+    RunBenchmark("Vector", "Iterate", "std", NUM_ELEMENTS, [&stdVector]
+    {
+        i32 sum = 0;
+        for (i32 value : stdVector)
+            sum += value;
+        return sum;
+    });
+
+    RunBenchmark("Vector", "Copy", "dviglo", NUM_ELEMENTS, [&vector]
+    {
+        Vector<i32> copy(vector);
+        return copy.Size();
+    });
+
+    RunBenchmark("Vector", "Copy", "std", NUM_ELEMENTS, [&stdVector]
+    {
+        std::vector<i32> copy(stdVector);
+        return copy.size();
+    });
+
+    RunBenchmark("Vector", "Sort", "dviglo", NUM_ELEMENTS, [&vector]
+    {
+        Vector<i32> copy(vector);
+        std::sort(copy.Begin(), copy.End());
+        return copy.Front();
+    });
+
+    RunBenchmark("Vector", "Sort", "std", NUM_ELEMENTS, [&stdVector]
+    {
+        std::vector<i32> copy(stdVector);
+        std::sort(copy.begin(), copy.end());
+        return copy.front();
+    });
+
+    // Vector of non-trivial elements
+    RunBenchmark("Vector", "PushVector", "dviglo", NUM_ELEMENTS, []
+    {
+        Vector<Vector<i32>> vector;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            vector.Push(Vector<i32>(2, i));
+        return vector.Size();
+    });
+
+    RunBenchmark("Vector", "PushVector", "std", NUM_ELEMENTS, []
+    {
+        std::vector<std::vector<i32>> vector;
+        for (i32 i = 0; i < NUM_ELEMENTS; ++i)
+            vector.push_back(std::vector<i32>(2, i));
+        return vector.size();
+    });
+}
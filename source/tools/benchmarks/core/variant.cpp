@@ -0,0 +1,99 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/core/variant.h>
+
+#include <string>
+#include <unordered_map>
+#include <variant>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_OPS = 100;
+
+using StdVariant = std::variant<i32, float, Vector3, std::string>;
+
+// Typical event data
+static const StringHash P_NODE("Node");
+static const StringHash P_POSITION("Position");
+static const StringHash P_TIMESTEP("TimeStep");
+static const StringHash P_NAME("Name");
+
+void Benchmark_Core_Variant()
+{
+    RunBenchmark("Variant", "CopyVector3", "dviglo", NUM_OPS, []
+    {
+        Variant variant(Vector3::ONE);
+        float sum = 0.f;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+        {
+            Variant copy(variant);
+            sum += copy.GetVector3().x_;
+        }
+        return (i32)sum;
+    });
+
+    RunBenchmark("Variant", "CopyVector3", "std", NUM_OPS, []
+    {
+        StdVariant variant(Vector3::ONE);
+        float sum = 0.f;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+        {
+            StdVariant copy(variant);
+            sum += std::get<Vector3>(copy).x_;
+        }
+        return (i32)sum;
+    });
+
+    RunBenchmark("VariantMap", "Fill", "dviglo", 4, []
+    {
+        VariantMap map;
+        map[P_NODE] = 1;
+        map[P_POSITION] = Vector3::ONE;
+        map[P_TIMESTEP] = 0.016f;
+        map[P_NAME] = "Name";
+        return map.Size();
+    });
+
+    RunBenchmark("VariantMap", "Fill", "std", 4, []
+    {
+        std::unordered_map<u32, StdVariant> map;
+        map[P_NODE.Value()] = 1;
+        map[P_POSITION.Value()] = Vector3::ONE;
+        map[P_TIMESTEP.Value()] = 0.016f;
+        map[P_NAME.Value()] = "Name";
+        return map.size();
+    });
+
+    VariantMap map;
+    map[P_NODE] = 1;
+    map[P_POSITION] = Vector3::ONE;
+    map[P_TIMESTEP] = 0.016f;
+    map[P_NAME] = "Name";
+
+    std::unordered_map<u32, StdVariant> stdMap;
+    stdMap[P_NODE.Value()] = 1;
+    stdMap[P_POSITION.Value()] = Vector3::ONE;
+    stdMap[P_TIMESTEP.Value()] = 0.016f;
+    stdMap[P_NAME.Value()] = "Name";
+
+    RunBenchmark("VariantMap", "Get", "dviglo", NUM_OPS, [&map]
+    {
+        float sum = 0.f;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += map[P_TIMESTEP].GetFloat();
+        return (i32)sum;
+    });
+
+    RunBenchmark("VariantMap", "Get", "std", NUM_OPS, [&stdMap]
+    {
+        float sum = 0.f;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += std::get<float>(stdMap[P_TIMESTEP.Value()]);
+        return (i32)sum;
+    });
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/graphics/animated_model.h>
+#include <dviglo/graphics/animation.h>
+#include <dviglo/graphics/animation_pose_cache.h>
+#include <dviglo/graphics/animation_state.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+namespace
+{
+
+constexpr i32 NUM_BONES = 40;
+
+// Bones of a humanoid are branches of a few bones each
+SharedPtr<Model> CreateModel()
+{
+    Skeleton skeleton;
+    Vector<Bone>& bones = skeleton.GetModifiableBones();
+    bones.Resize(NUM_BONES);
+
+    for (i32 i = 0; i < NUM_BONES; ++i)
+    {
+        Bone& bone = bones[i];
+        bone.name_ = "Bone" + String(i);
+        bone.nameHash_ = bone.name_;
+        bone.parentIndex_ = i % 5 ? i - 1 : 0;
+        bone.initialPosition_ = Vector3(0.f, i ? 0.3f : 0.f, 0.f);
+        bone.initialRotation_ = Quaternion(10.f * i, Vector3::UP);
+    }
+
+    skeleton.SetRootBoneIndex(0);
+
+    SharedPtr<Model> model(new Model());
+    model->SetSkeleton(skeleton);
+    model->SetBoundingBox(BoundingBox(-Vector3::ONE, Vector3::ONE));
+    return model;
+}
+
+SharedPtr<Animation> CreateAnimation()
+{
+    SharedPtr<Animation> animation(new Animation());
+    animation->SetLength(1.f);
+
+    for (i32 i = 0; i < NUM_BONES; ++i)
+    {
+        AnimationTrack* track = animation->CreateTrack("Bone" + String(i));
+        track->channelMask_ = AnimationChannels::Position | AnimationChannels::Rotation;
+
+        for (i32 j = 0; j <= 30; ++j)
+        {
+            AnimationKeyFrame keyFrame;
+            keyFrame.time_ = j / 30.f;
+            keyFrame.position_ = Vector3(0.f, 0.3f, Sin(j * 12.f) * 0.05f);
+            keyFrame.rotation_ = Quaternion(Sin(j * 12.f + i * 10.f) * 30.f, i * 5.f, 0.f);
+            track->AddKeyFrame(keyFrame);
+        }
+    }
+
+    return animation;
+}
+
+} // namespace
+
+void Benchmark_Graphics_AnimatedModel()
+{
+    // Crowd of characters which walk in a few phases. Includes the skin matrices, which need the bone world transforms
+    constexpr i32 NUM_CHARACTERS = 400;
+    constexpr i32 NUM_PHASES = 8;
+
+    SharedPtr<Model> model = CreateModel();
+    SharedPtr<Animation> walk = CreateAnimation();
+    SharedPtr<AnimationPoseCache> cache(new AnimationPoseCache());
+    cache->SetTimeStep(1.f / 30.f);
+
+    SharedPtr<Scene> scene(new Scene());
+    scene->AddComponent(new Octree(), 0, LOCAL);
+
+    Vector<AnimatedModel*> models;
+    Vector<AnimationState*> states;
+
+    for (i32 i = 0; i < NUM_CHARACTERS; ++i)
+    {
+        Node* node = scene->CreateChild("Character", LOCAL);
+        node->SetPosition(Vector3((float)(i % 20), 0.f, (float)(i / 20)));
+        auto* animatedModel = new AnimatedModel();
+        node->AddComponent(animatedModel, 0, LOCAL);
+        animatedModel->SetModel(model);
+        models.Push(animatedModel);
+    }
+
+    // Changing the skeleton mode removes the animation states
+    auto addStates = [&]
+    {
+        states.Clear();
+        for (i32 i = 0; i < NUM_CHARACTERS; ++i)
+        {
+            AnimationState* state = models[i]->AddAnimationState(walk);
+            state->SetLooped(true);
+            state->SetWeight(1.f);
+            state->SetTime((float)(i % NUM_PHASES) / NUM_PHASES);
+            states.Push(state);
+        }
+    };
+
+    addStates();
+
+    FrameInfo frame{};
+    frame.timeStep_ = 1.f / 60.f;
+
+    auto updateCrowd = [&]
+    {
+        ++frame.frameNumber_;
+        for (i32 i = 0; i < NUM_CHARACTERS; ++i)
+        {
+            states[i]->AddTime(frame.timeStep_);
+            models[i]->Update(frame);
+            models[i]->UpdateGeometry(frame);
+        }
+        return frame.frameNumber_;
+    };
+
+    RunBenchmark("AnimatedModel", "Update", "no cache", NUM_CHARACTERS, updateCrowd);
+
+    for (AnimatedModel* animatedModel : models)
+        animatedModel->SetPoseCache(cache);
+
+    RunBenchmark("AnimatedModel", "Update", "pose cache", NUM_CHARACTERS, updateCrowd);
+
+    for (AnimatedModel* animatedModel : models)
+    {
+        animatedModel->SetPoseCache(nullptr);
+        animatedModel->SetFlatSkeleton(true);
+    }
+
+    addStates();
+    RunBenchmark("AnimatedModel", "Update", "flat skeleton", NUM_CHARACTERS, updateCrowd);
+
+    for (AnimatedModel* animatedModel : models)
+        animatedModel->SetPoseCache(cache);
+
+    RunBenchmark("AnimatedModel", "Update", "flat skeleton + pose cache", NUM_CHARACTERS, updateCrowd);
+}
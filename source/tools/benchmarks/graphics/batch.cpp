@@ -0,0 +1,150 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/containers/hash_map.h>
+#include <dviglo/graphics/batch.h>
+#include <dviglo/math/random.h>
+
+#include <dviglo/common/debug_new.h>
+
+#include <algorithm>
+
+using namespace dviglo;
+
+namespace
+{
+
+bool CompareBatchesState(Batch* lhs, Batch* rhs)
+{
+    if (lhs->renderOrder_ != rhs->renderOrder_)
+        return lhs->renderOrder_ < rhs->renderOrder_;
+    else if (lhs->sortKey_ != rhs->sortKey_)
+        return lhs->sortKey_ < rhs->sortKey_;
+    else
+        return lhs->distance_ < rhs->distance_;
+}
+
+bool CompareBatchesFrontToBack(Batch* lhs, Batch* rhs)
+{
+    if (lhs->renderOrder_ != rhs->renderOrder_)
+        return lhs->renderOrder_ < rhs->renderOrder_;
+    else if (lhs->distance_ != rhs->distance_)
+        return lhs->distance_ < rhs->distance_;
+    else
+        return lhs->sortKey_ < rhs->sortKey_;
+}
+
+bool CompareBatchesBackToFront(Batch* lhs, Batch* rhs)
+{
+    if (lhs->renderOrder_ != rhs->renderOrder_)
+        return lhs->renderOrder_ < rhs->renderOrder_;
+    else if (lhs->distance_ != rhs->distance_)
+        return lhs->distance_ > rhs->distance_;
+    else
+        return lhs->sortKey_ < rhs->sortKey_;
+}
+
+// The comparison sorts with the ID remapping through hash maps, which were used before the radix sort
+void SortFrontToBack2PassComparison(Vector<Batch*>& batches)
+{
+    std::sort(batches.Begin(), batches.End(), CompareBatchesFrontToBack);
+
+    HashMap<hash32, hash32> shaderRemapping;
+    HashMap<hash16, hash16> materialRemapping;
+    HashMap<hash16, hash16> geometryRemapping;
+    hash32 freeShaderID = 0;
+    hash16 freeMaterialID = 0;
+    hash16 freeGeometryID = 0;
+
+    for (Batch* batch : batches)
+    {
+        hash32 shaderID = (hash32)(batch->sortKey_ >> 32u);
+        HashMap<hash32, hash32>::ConstIterator j = shaderRemapping.Find(shaderID);
+        if (j != shaderRemapping.End())
+            shaderID = j->second_;
+        else
+            shaderID = shaderRemapping[shaderID] = freeShaderID++ | (shaderID & 0x80000000);
+
+        hash16 materialID = (hash16)((batch->sortKey_ & 0xffff0000) >> 16u);
+        HashMap<hash16, hash16>::ConstIterator k = materialRemapping.Find(materialID);
+        if (k != materialRemapping.End())
+            materialID = k->second_;
+        else
+            materialID = materialRemapping[materialID] = freeMaterialID++;
+
+        hash16 geometryID = (hash16)(batch->sortKey_ & 0xffffu);
+        HashMap<hash16, hash16>::ConstIterator l = geometryRemapping.Find(geometryID);
+        if (l != geometryRemapping.End())
+            geometryID = l->second_;
+        else
+            geometryID = geometryRemapping[geometryID] = freeGeometryID++;
+
+        batch->sortKey_ = (((hash64)shaderID) << 32u) | (((hash64)materialID) << 16u) | geometryID;
+    }
+
+    std::sort(batches.Begin(), batches.End(), CompareBatchesState);
+}
+
+} // namespace
+
+void Benchmark_Graphics_Batch()
+{
+    constexpr i32 NUM_BATCHES = 20000;
+
+    SetRandomSeed(1);
+
+    // A scene with a few hundred materials and models, like a large level
+    BatchQueue queue;
+    queue.Clear(0);
+    queue.batches_.Resize(NUM_BATCHES);
+    Vector<hash64> sortKeys(NUM_BATCHES);
+
+    for (i32 i = 0; i < NUM_BATCHES; ++i)
+    {
+        Batch& batch = queue.batches_[i];
+        batch.sortKey_ = sortKeys[i] = (hash64)Random(20) << 48u | (hash64)Random(300) << 16u | Random(500);
+        batch.distance_ = (float)Random(50000) * 0.01f;
+        batch.renderOrder_ = DEFAULT_RENDER_ORDER;
+    }
+
+    Vector<Batch*> batches(NUM_BATCHES);
+
+    // The original sort keys are restored, because the comparison sort overwrites them
+    RunBenchmark("BatchQueue", "SortFrontToBack", "std::sort", NUM_BATCHES, [&]
+    {
+        for (i32 i = 0; i < NUM_BATCHES; ++i)
+        {
+            queue.batches_[i].sortKey_ = sortKeys[i];
+            batches[i] = &queue.batches_[i];
+        }
+        SortFrontToBack2PassComparison(batches);
+        return (i32)(batches[0] - queue.batches_.Buffer());
+    });
+
+    RunBenchmark("BatchQueue", "SortFrontToBack", "dviglo", NUM_BATCHES, [&]
+    {
+        for (i32 i = 0; i < NUM_BATCHES; ++i)
+        {
+            queue.batches_[i].sortKey_ = sortKeys[i];
+            batches[i] = &queue.batches_[i];
+        }
+        queue.SortFrontToBack2Pass(batches);
+        return (i32)(batches[0] - queue.batches_.Buffer());
+    });
+
+    RunBenchmark("BatchQueue", "SortBackToFront", "std::sort", NUM_BATCHES, [&]
+    {
+        for (i32 i = 0; i < NUM_BATCHES; ++i)
+            batches[i] = &queue.batches_[i];
+        std::sort(batches.Begin(), batches.End(), CompareBatchesBackToFront);
+        return (i32)(batches[0] - queue.batches_.Buffer());
+    });
+
+    RunBenchmark("BatchQueue", "SortBackToFront", "dviglo", NUM_BATCHES, [&]
+    {
+        queue.SortBackToFront();
+        return (i32)(queue.sortedBatches_[0] - queue.batches_.Buffer());
+    });
+}
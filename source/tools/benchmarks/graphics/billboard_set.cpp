@@ -0,0 +1,101 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/graphics/billboard_set.h>
+#include <dviglo/graphics/camera.h>
+#include <dviglo/graphics/distance_sort.h>
+#include <dviglo/graphics/graphics.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/math/random.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+#include <algorithm>
+
+using namespace dviglo;
+
+void Benchmark_Graphics_BillboardSet()
+{
+    // Sorted particles of a large effect, like smoke or sparks filling the view
+    constexpr i32 NUM_BILLBOARDS = 100000;
+
+    SetRandomSeed(1);
+
+    SharedPtr<Scene> scene(new Scene());
+    scene->AddComponent(new Octree(), 0, LOCAL);
+
+    Node* cameraNode = scene->CreateChild("Camera", LOCAL);
+    cameraNode->SetPosition(Vector3(0.f, 10.f, -50.f));
+    auto* camera = new Camera();
+    cameraNode->AddComponent(camera, 0, LOCAL);
+
+    Node* node = scene->CreateChild("Billboards", LOCAL);
+    auto* billboardSet = new BillboardSet();
+    node->AddComponent(billboardSet, 0, LOCAL);
+    billboardSet->SetSorted(true);
+    billboardSet->SetNumBillboards(NUM_BILLBOARDS);
+
+    Vector<Billboard>& billboards = billboardSet->GetBillboards();
+    for (Billboard& billboard : billboards)
+    {
+        billboard.position_ = Vector3(Random() * 100.f - 50.f, Random() * 20.f, Random() * 100.f);
+        billboard.size_ = Vector2(Random() + 0.1f, Random() + 0.1f);
+        billboard.rotation_ = Random() * 360.f;
+        billboard.color_ = Color(Random(), Random(), Random());
+        billboard.enabled_ = true;
+    }
+
+    Vector<Billboard*> sortedBillboards;
+    for (Billboard& billboard : billboards)
+    {
+        billboard.sortDistance_ = camera->GetDistanceSquared(billboard.position_);
+        sortedBillboards.Push(&billboard);
+    }
+
+    RunBenchmark("BillboardSet", "Sort", "std::sort", NUM_BILLBOARDS, [&]
+    {
+        for (i32 i = 0; i < NUM_BILLBOARDS; ++i)
+            sortedBillboards[i] = &billboards[i];
+
+        std::sort(sortedBillboards.Begin(), sortedBillboards.End(),
+            [](Billboard* lhs, Billboard* rhs) { return lhs->sortDistance_ > rhs->sortDistance_; });
+        return (i32)sortedBillboards[0]->sortDistance_;
+    });
+
+    Vector<u64> keys(NUM_BILLBOARDS);
+    Vector<u64> temp;
+
+    RunBenchmark("BillboardSet", "Sort", "dviglo", NUM_BILLBOARDS, [&]
+    {
+        for (i32 i = 0; i < NUM_BILLBOARDS; ++i)
+            keys[i] = BackToFrontSortKey(billboards[i].sortDistance_, i);
+
+        SortBackToFront(keys, temp);
+        return (i32)billboards[(u32)keys[0]].sortDistance_;
+    });
+
+#ifdef DV_OPENGL
+    // Without the graphics subsystem vertex buffers are shadowed, so the vertices are generated but not uploaded
+    GAPI gapi = Graphics::GetGAPI();
+    Graphics::SetGAPI(GAPI_OPENGL);
+
+    FrameInfo frame{};
+    frame.timeStep_ = 1.f / 60.f;
+    frame.viewSize_ = IntVector2(1920, 1080);
+    frame.camera_ = camera;
+
+    RunBenchmark("BillboardSet", "UpdateGeometry", "dviglo", NUM_BILLBOARDS, [&]
+    {
+        ++frame.frameNumber_;
+        billboardSet->Commit();
+        billboardSet->UpdateBatches(frame);
+        billboardSet->UpdateGeometry(frame);
+        return frame.frameNumber_;
+    });
+
+    Graphics::SetGAPI(gapi);
+#endif
+}
@@ -0,0 +1,162 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/work_queue.h>
+#include <dviglo/graphics/camera.h>
+#include <dviglo/graphics/occlusion_buffer.h>
+#include <dviglo/math/random.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+// Occluders of a typical scene: boxes of different sizes and a ground grid, which crosses the near plane.
+// Vertices have position, normal and texture coordinates like the vertices of static models
+namespace
+{
+
+struct OccluderVertex
+{
+    Vector3 position_;
+    Vector3 normal_;
+    Vector2 texCoord_;
+};
+
+struct Occluder
+{
+    Matrix3x4 model_;
+    const Vector<OccluderVertex>* vertices_;
+    const Vector<u16>* indices_;
+};
+
+struct OccluderScene
+{
+    Vector<OccluderVertex> boxVertices_;
+    Vector<u16> boxIndices_;
+    Vector<OccluderVertex> groundVertices_;
+    Vector<u16> groundIndices_;
+    Vector<Occluder> occluders_;
+    i32 numTriangles_ = 0;
+
+    OccluderScene()
+    {
+        for (i32 i = 0; i < 8; ++i)
+        {
+            Vector3 position(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f);
+            boxVertices_.Push({position, position.Normalized(), Vector2::ZERO});
+        }
+
+        // Quads with clockwise winding when looking from outside
+        static const u16 boxQuads[6][4] = {{0, 2, 3, 1}, {5, 7, 6, 4}, {4, 6, 2, 0}, {1, 3, 7, 5}, {2, 6, 7, 3}, {4, 0, 1, 5}};
+        for (const u16* quad : boxQuads)
+        {
+            for (u16 index : {quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]})
+                boxIndices_.Push(index);
+        }
+
+        constexpr i32 GRID_SIZE = 32;
+        for (i32 z = 0; z <= GRID_SIZE; ++z)
+        {
+            for (i32 x = 0; x <= GRID_SIZE; ++x)
+                groundVertices_.Push({Vector3((float)x - GRID_SIZE / 2, 0.f, (float)z), Vector3::UP, Vector2::ZERO});
+        }
+
+        for (i32 z = 0; z < GRID_SIZE; ++z)
+        {
+            for (i32 x = 0; x < GRID_SIZE; ++x)
+            {
+                u16 i = (u16)(z * (GRID_SIZE + 1) + x);
+                u16 row = (u16)(GRID_SIZE + 1);
+                for (u16 index : {i, (u16)(i + row), (u16)(i + row + 1), i, (u16)(i + row + 1), (u16)(i + 1)})
+                    groundIndices_.Push(index);
+            }
+        }
+
+        occluders_.Push({Matrix3x4(Vector3(0.f, -2.f, -4.f), Quaternion::IDENTITY, 4.f), &groundVertices_, &groundIndices_});
+
+        // Deterministic pseudo-random placement
+        SetRandomSeed(1);
+
+        for (i32 i = 0; i < 300; ++i)
+        {
+            Vector3 position(Random() * 80.f - 40.f, Random() * 4.f - 2.f, Random() * 80.f + 3.f);
+            Quaternion rotation(Random() * 360.f, Vector3::UP);
+            Vector3 scale(Random() * 4.f + 0.5f, Random() * 6.f + 0.5f, Random() * 4.f + 0.5f);
+            occluders_.Push({Matrix3x4(position, rotation, scale), &boxVertices_, &boxIndices_});
+        }
+
+        for (const Occluder& occluder : occluders_)
+            numTriangles_ += occluder.indices_->Size() / 3;
+    }
+
+    // Submit all occluders and rasterize them. Return number of rasterized triangles
+    i32 Draw(OcclusionBuffer* buffer) const
+    {
+        buffer->Clear();
+
+        for (const Occluder& occluder : occluders_)
+        {
+            buffer->AddTriangles(occluder.model_, occluder.vertices_->Buffer(), sizeof(OccluderVertex),
+                occluder.indices_->Buffer(), sizeof(u16), 0, occluder.indices_->Size());
+        }
+
+        buffer->DrawTriangles();
+        return (i32)buffer->GetNumTriangles();
+    }
+};
+
+} // namespace
+
+void Benchmark_Graphics_OcclusionBuffer()
+{
+    OccluderScene scene;
+
+    SharedPtr<Camera> camera(new Camera());
+    camera->SetFov(60.f);
+    camera->SetAspectRatio(16.f / 9.f);
+    camera->SetFarClip(200.f);
+
+    // Same size as the default in Renderer
+    SharedPtr<OcclusionBuffer> buffer(new OcclusionBuffer());
+    buffer->SetSize(256, 144, false);
+    buffer->SetView(camera);
+    buffer->SetMaxTriangles(M_MAX_INT);
+
+    RunBenchmark("OcclusionBuffer", "DrawTriangles", "dviglo", scene.numTriangles_, [&scene, &buffer]
+    {
+        return scene.Draw(buffer);
+    });
+
+    // Reprojection of the previous frame replaces drawing of unchanged occluders with temporal occlusion.
+    // Reported per triangle of the scene to be comparable with drawing
+    Vector<OccluderHistory> history;
+    scene.Draw(buffer);
+    buffer->StoreHistory(camera, history);
+
+    RunBenchmark("OcclusionBuffer", "Reproject", "dviglo", scene.numTriangles_, [&scene, &buffer]
+    {
+        buffer->Reproject();
+        return scene.numTriangles_;
+    });
+
+    // Same with worker threads
+    WorkQueue* queue = new WorkQueue();
+    DV_CONTEXT.RegisterSubsystem(queue);
+    queue->CreateThreads(3);
+
+    SharedPtr<OcclusionBuffer> threadedBuffer(new OcclusionBuffer());
+    threadedBuffer->SetSize(256, 144, true);
+    threadedBuffer->SetView(camera);
+    threadedBuffer->SetMaxTriangles(M_MAX_INT);
+
+    RunBenchmark("OcclusionBuffer", "DrawTrianglesThreaded", "dviglo", scene.numTriangles_, [&scene, &threadedBuffer]
+    {
+        return scene.Draw(threadedBuffer);
+    });
+
+    threadedBuffer.Reset();
+    DV_CONTEXT.RemoveSubsystem<WorkQueue>();
+}
@@ -0,0 +1,287 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/work_queue.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/math/random.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+namespace
+{
+
+// Drawable with a fixed bounding box, which does not need a scene node
+class BoxDrawable : public Drawable
+{
+    DV_OBJECT(BoxDrawable, Drawable);
+
+public:
+    explicit BoxDrawable(const BoundingBox& box) :
+        Drawable(DrawableTypes::Geometry),
+        box_(box)
+    {
+    }
+
+    void Move(const Vector3& offset)
+    {
+        box_ = BoundingBox(box_.min_ + offset, box_.max_ + offset);
+        OnMarkedDirty(nullptr);
+    }
+
+protected:
+    void OnWorldBoundingBoxUpdate() override
+    {
+        worldBoundingBox_ = box_;
+    }
+
+private:
+    BoundingBox box_;
+};
+
+// Frustum query which tests the drawables one by one without the culling data of the octants
+class ScalarFrustumOctreeQuery : public FrustumOctreeQuery
+{
+public:
+    ScalarFrustumOctreeQuery(Vector<Drawable*>& result, const Frustum& frustum) :
+        FrustumOctreeQuery(result, frustum)
+    {
+    }
+
+    void TestDrawablesBatched(Drawable** start, Drawable** end, const DrawableCullData& cullData, bool inside) override
+    {
+        TestDrawables(start, end, inside);
+    }
+};
+
+} // namespace
+
+void Benchmark_Graphics_Octree()
+{
+    constexpr i32 NUM_DRAWABLES = 100000;
+
+    DV_CONTEXT.RegisterSubsystem(new WorkQueue());
+
+    // The same level indexed with the octants and with the bounding volume hierarchy
+    SharedPtr<Scene> scene(new Scene());
+    Octree* octree = new Octree();
+    scene->AddComponent(octree, 0, LOCAL);
+    octree->SetSize(BoundingBox(-500.f, 500.f), 8);
+
+    SharedPtr<Scene> bvhScene(new Scene());
+    Octree* bvhOctree = new Octree();
+    bvhScene->AddComponent(bvhOctree, 0, LOCAL);
+    bvhOctree->SetSize(BoundingBox(-500.f, 500.f), 8);
+    bvhOctree->SetBvhEnabled(true);
+
+    // Deterministic pseudo-random placement of small objects like in a large level
+    SetRandomSeed(1);
+
+    Vector<SharedPtr<BoxDrawable>> drawables;
+    drawables.Reserve(NUM_DRAWABLES);
+    Vector<SharedPtr<BoxDrawable>> bvhDrawables;
+    bvhDrawables.Reserve(NUM_DRAWABLES);
+
+    for (i32 i = 0; i < NUM_DRAWABLES; ++i)
+    {
+        Vector3 center(Random() * 1000.f - 500.f, Random() * 20.f, Random() * 1000.f - 500.f);
+        Vector3 halfSize(Random() * 2.f + 0.25f, Random() * 4.f + 0.25f, Random() * 2.f + 0.25f);
+        BoundingBox box(center - halfSize, center + halfSize);
+
+        SharedPtr<BoxDrawable> drawable(new BoxDrawable(box));
+        octree->InsertDrawable(drawable);
+        drawables.Push(drawable);
+
+        SharedPtr<BoxDrawable> bvhDrawable(new BoxDrawable(box));
+        bvhOctree->InsertDrawable(bvhDrawable);
+        bvhDrawables.Push(bvhDrawable);
+    }
+
+    FrameInfo frame;
+    bvhOctree->Update(frame);
+
+    // Building from scratch, which happens when drawables are added or removed
+    Vector<Drawable*> buildDrawables(bvhOctree->GetBvh().GetDrawables());
+    DrawableBvh bvh;
+
+    RunBenchmark("Octree", "BvhBuild", "dviglo", NUM_DRAWABLES, [&]
+    {
+        bvh.Build(buildDrawables);
+        return bvh.GetNodes().Size();
+    });
+
+    // Camera in the middle of the level looking along the ground
+    Frustum frustum;
+    frustum.Define(60.f, 16.f / 9.f, 1.f, 0.1f, 300.f, Matrix3x4(Vector3(0.f, 2.f, -100.f), Quaternion(15.f, Vector3::UP), 1.f));
+
+    Vector<Drawable*> result;
+
+    RunBenchmark("Octree", "FrustumQuery", "scalar", NUM_DRAWABLES, [&]
+    {
+        ScalarFrustumOctreeQuery query(result, frustum);
+        octree->GetDrawables(query);
+        return result.Size();
+    });
+
+    RunBenchmark("Octree", "FrustumQuery", "dviglo", NUM_DRAWABLES, [&]
+    {
+        FrustumOctreeQuery query(result, frustum);
+        octree->GetDrawables(query);
+        return result.Size();
+    });
+
+    RunBenchmark("Octree", "FrustumQuery", "bvh", NUM_DRAWABLES, [&]
+    {
+        FrustumOctreeQuery query(result, frustum);
+        bvhOctree->GetDrawables(query);
+        return result.Size();
+    });
+
+    // Gameplay lookup around a point, which only counts the found drawables
+    Sphere sphere(Vector3(50.f, 0.f, 50.f), 40.f);
+
+    RunBenchmark("Octree", "SphereQuery", "vector", NUM_DRAWABLES, [&]
+    {
+        SphereOctreeQuery query(result, sphere);
+        octree->GetDrawables(query);
+        return result.Size();
+    });
+
+    RunBenchmark("Octree", "SphereQuery", "visitor", NUM_DRAWABLES, [&]
+    {
+        i32 count = 0;
+        octree->VisitDrawables(VolumeVisitQuery(sphere), [&count](Drawable*) { ++count; });
+        return count;
+    });
+
+    RunBenchmark("Octree", "SphereQuery", "bvh", NUM_DRAWABLES, [&]
+    {
+        i32 count = 0;
+        bvhOctree->VisitDrawables(VolumeVisitQuery(sphere), [&count](Drawable*) { ++count; });
+        return count;
+    });
+
+    // Picking ray across the level
+    Ray ray(Vector3(-400.f, 10.f, -300.f), Vector3(1.f, -0.01f, 0.8f).Normalized());
+    Vector<RayQueryResult> rayResult;
+
+    RunBenchmark("Octree", "Raycast", "dviglo", NUM_DRAWABLES, [&]
+    {
+        RayOctreeQuery query(rayResult, ray, RAY_AABB);
+        octree->Raycast(query);
+        return rayResult.Size();
+    });
+
+    RunBenchmark("Octree", "Raycast", "bvh", NUM_DRAWABLES, [&]
+    {
+        RayOctreeQuery query(rayResult, ray, RAY_AABB);
+        bvhOctree->Raycast(query);
+        return rayResult.Size();
+    });
+
+    RunBenchmark("Octree", "RaycastSingle", "dviglo", NUM_DRAWABLES, [&]
+    {
+        RayOctreeQuery query(rayResult, ray, RAY_AABB);
+        octree->RaycastSingle(query);
+        return rayResult.Size();
+    });
+
+    RunBenchmark("Octree", "RaycastSingle", "bvh", NUM_DRAWABLES, [&]
+    {
+        RayOctreeQuery query(rayResult, ray, RAY_AABB);
+        bvhOctree->RaycastSingle(query);
+        return rayResult.Size();
+    });
+
+    // Many short rays like bullets, reported per ray
+    constexpr i32 NUM_RAYS = 256;
+    Vector<Ray> rays;
+    for (i32 i = 0; i < NUM_RAYS; ++i)
+    {
+        Vector3 origin(Random() * 1000.f - 500.f, 1.f + Random() * 10.f, Random() * 1000.f - 500.f);
+        rays.Push(Ray(origin, Vector3(Random() - 0.5f, Random() * 0.2f - 0.1f, Random() - 0.5f).Normalized()));
+    }
+    Vector<RayQueryResult> batchResults;
+
+    RunBenchmark("Octree", "RaycastBatch", "one by one", NUM_RAYS, [&]
+    {
+        i32 numHits = 0;
+        for (const Ray& batchRay : rays)
+        {
+            RayOctreeQuery query(rayResult, batchRay, RAY_AABB, 100.f);
+            octree->RaycastSingle(query);
+            numHits += rayResult.Size();
+        }
+        return numHits;
+    });
+
+    RunBenchmark("Octree", "RaycastBatch", "dviglo", NUM_RAYS, [&]
+    {
+        octree->RaycastSingle(rays, batchResults, RAY_AABB, 100.f);
+        return batchResults.Size();
+    });
+
+    // All drawables move back and forth, so that about half of them change the octant, and the hierarchy is refit
+    // or rebuilt every second update. Reported per moved drawable
+    float direction = 1.f;
+
+    RunBenchmark("Octree", "Update", "dviglo", NUM_DRAWABLES, [&]
+    {
+        for (BoxDrawable* drawable : drawables)
+            drawable->Move(Vector3(3.f * direction, 0.f, 0.f));
+        direction = -direction;
+
+        octree->Update(frame);
+        return octree->GetNumDrawables();
+    });
+
+    direction = 1.f;
+
+    RunBenchmark("Octree", "Update", "bvh", NUM_DRAWABLES, [&]
+    {
+        for (BoxDrawable* drawable : bvhDrawables)
+            drawable->Move(Vector3(3.f * direction, 0.f, 0.f));
+        direction = -direction;
+
+        bvhOctree->Update(frame);
+        return bvhOctree->GetNumDrawables();
+    });
+
+    // Every hundredth drawable moves, which only refits the hierarchy. Reported per moved drawable
+    i32 moveStart = 0;
+
+    RunBenchmark("Octree", "UpdateFew", "dviglo", NUM_DRAWABLES / 100, [&]
+    {
+        for (i32 i = moveStart; i < drawables.Size(); i += 100)
+            drawables[i]->Move(Vector3(3.f * direction, 0.f, 0.f));
+        moveStart = (moveStart + 1) % 100;
+        direction = -direction;
+
+        octree->Update(frame);
+        return octree->GetNumDrawables();
+    });
+
+    moveStart = 0;
+
+    RunBenchmark("Octree", "UpdateFew", "bvh", NUM_DRAWABLES / 100, [&]
+    {
+        for (i32 i = moveStart; i < bvhDrawables.Size(); i += 100)
+            bvhDrawables[i]->Move(Vector3(3.f * direction, 0.f, 0.f));
+        moveStart = (moveStart + 1) % 100;
+        direction = -direction;
+
+        bvhOctree->Update(frame);
+        return bvhOctree->GetNumDrawables();
+    });
+
+    bvhDrawables.Clear();
+    bvhScene.Reset();
+    drawables.Clear();
+    scene.Reset();
+    DV_CONTEXT.RemoveSubsystem<WorkQueue>();
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/graphics/octree.h>
+#include <dviglo/graphics/particle_effect.h>
+#include <dviglo/graphics/particle_emitter.h>
+#include <dviglo/math/random.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+namespace
+{
+
+// One particle at a time with the particle state in an array of structures, like before the structure of arrays update
+struct ScalarParticle
+{
+    Vector3 velocity_;
+    Vector2 size_;
+    float timer_;
+    float timeToLive_;
+    float scale_;
+    float rotationSpeed_;
+    i32 colorIndex_;
+    i32 texIndex_;
+};
+
+void UpdateScalar(Vector<ScalarParticle>& particles, Vector<Billboard>& billboards, ParticleEffect* effect, float timeStep)
+{
+    for (i32 i = 0; i < particles.Size(); ++i)
+    {
+        ScalarParticle& particle = particles[i];
+        Billboard& billboard = billboards[i];
+
+        if (!billboard.enabled_)
+            continue;
+
+        if (particle.timer_ >= particle.timeToLive_)
+        {
+            billboard.enabled_ = false;
+            continue;
+        }
+        particle.timer_ += timeStep;
+
+        const Vector3& constantForce = effect->GetConstantForce();
+        if (constantForce != Vector3::ZERO)
+            particle.velocity_ += timeStep * constantForce;
+
+        float dampingForce = effect->GetDampingForce();
+        if (dampingForce != 0.0f)
+        {
+            Vector3 force = -dampingForce * particle.velocity_;
+            particle.velocity_ += timeStep * force;
+        }
+        billboard.position_ += timeStep * particle.velocity_;
+        billboard.direction_ = particle.velocity_.Normalized();
+
+        billboard.rotation_ += timeStep * particle.rotationSpeed_;
+
+        float sizeAdd = effect->GetSizeAdd();
+        float sizeMul = effect->GetSizeMul();
+        if (sizeAdd != 0.0f || sizeMul != 1.0f)
+        {
+            particle.scale_ += timeStep * sizeAdd;
+            if (particle.scale_ < 0.0f)
+                particle.scale_ = 0.0f;
+            if (sizeMul != 1.0f)
+                particle.scale_ *= (timeStep * (sizeMul - 1.0f)) + 1.0f;
+            billboard.size_ = particle.size_ * particle.scale_;
+        }
+
+        i32& index = particle.colorIndex_;
+        const Vector<ColorFrame>& colorFrames = effect->GetColorFrames();
+        if (index < colorFrames.Size())
+        {
+            if (index < colorFrames.Size() - 1)
+            {
+                if (particle.timer_ >= colorFrames[index + 1].time_)
+                    ++index;
+            }
+            if (index < colorFrames.Size() - 1)
+                billboard.color_ = colorFrames[index].Interpolate(colorFrames[index + 1], particle.timer_);
+            else
+                billboard.color_ = colorFrames[index].color_;
+        }
+    }
+}
+
+} // namespace
+
+void Benchmark_Graphics_ParticleEmitter()
+{
+    constexpr i32 NUM_PARTICLES = 100000;
+    constexpr float TIME_STEP = 1.f / 60.f;
+
+    // Smoke-like effect with gravity, damping, growth and fading. The particles live for the whole benchmark
+    SharedPtr<ParticleEffect> effect(new ParticleEffect());
+    effect->SetNumParticles(NUM_PARTICLES);
+    effect->SetUpdateInvisible(true);
+    effect->SetConstantForce(Vector3(0.f, 1.f, 0.f));
+    effect->SetDampingForce(0.5f);
+    effect->SetSizeAdd(0.2f);
+    effect->SetSizeMul(1.01f);
+    effect->AddColorTime(Color::WHITE, 0.f);
+    effect->AddColorTime(Color(0.5f, 0.5f, 0.5f, 0.f), 1e6f);
+
+    SharedPtr<Scene> scene(new Scene());
+    scene->AddComponent(new Octree(), 0, LOCAL);
+    Node* node = scene->CreateChild("Emitter", LOCAL);
+    auto* emitter = new ParticleEmitter();
+    node->AddComponent(emitter, 0, LOCAL);
+    emitter->SetEffect(effect);
+    emitter->SetEmitting(false);
+
+    SetRandomSeed(1);
+
+    VariantVector particlesAttr;
+    particlesAttr.Push(NUM_PARTICLES);
+    Vector<ScalarParticle> particles(NUM_PARTICLES);
+
+    for (ScalarParticle& particle : particles)
+    {
+        particle = ScalarParticle{Vector3(Random() - 0.5f, Random() * 5.f, Random() - 0.5f), Vector2(1.f, 1.f), 0.f, 1e6f,
+            1.f, Random() * 10.f, 0, 0};
+
+        particlesAttr.Push(particle.velocity_);
+        particlesAttr.Push(particle.size_);
+        particlesAttr.Push(particle.timer_);
+        particlesAttr.Push(particle.timeToLive_);
+        particlesAttr.Push(particle.scale_);
+        particlesAttr.Push(particle.rotationSpeed_);
+        particlesAttr.Push(particle.colorIndex_);
+        particlesAttr.Push(particle.texIndex_);
+    }
+
+    emitter->SetParticlesAttr(particlesAttr);
+
+    Vector<Billboard>& billboards = emitter->GetBillboards();
+    for (Billboard& billboard : billboards)
+        billboard.enabled_ = true;
+
+    Vector<Billboard> scalarBillboards = billboards;
+    FrameInfo frame{};
+
+    RunBenchmark("ParticleEmitter", "Update", "scalar", NUM_PARTICLES, [&]
+    {
+        UpdateScalar(particles, scalarBillboards, effect, TIME_STEP);
+        return (i32)scalarBillboards[0].position_.y_;
+    });
+
+    RunBenchmark("ParticleEmitter", "Update", "dviglo", NUM_PARTICLES, [&]
+    {
+        scene->Update(TIME_STEP);
+        emitter->Update(frame);
+        return (i32)billboards[0].position_.y_;
+    });
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/graphics/geometry.h>
+#include <dviglo/graphics/triangle_bvh.h>
+#include <dviglo/math/random.h>
+#include <dviglo/math/ray.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+void Benchmark_Graphics_TriangleBvh()
+{
+    // Dense bumpy ground like a terrain or a detailed static model, picked with rays from a camera above it
+    constexpr i32 SIZE = 180;
+    constexpr i32 INDEX_COUNT = (SIZE - 1) * (SIZE - 1) * 6;
+    constexpr i32 NUM_RAYS = 64;
+
+    SetRandomSeed(1);
+
+    SharedArrayPtr<byte> vertexData(new byte[SIZE * SIZE * sizeof(Vector3)]);
+    auto* vertices = (Vector3*)vertexData.Get();
+    for (i32 z = 0; z < SIZE; ++z)
+    {
+        for (i32 x = 0; x < SIZE; ++x)
+            vertices[z * SIZE + x] = Vector3((float)x, Sin((float)x * 10.f) * Cos((float)z * 7.f) * 3.f + Random(), (float)z);
+    }
+
+    SharedArrayPtr<byte> indexData(new byte[INDEX_COUNT * sizeof(u16)]);
+    auto* indices = (u16*)indexData.Get();
+    for (i32 z = 0; z < SIZE - 1; ++z)
+    {
+        for (i32 x = 0; x < SIZE - 1; ++x)
+        {
+            u16 i = (u16)(z * SIZE + x);
+            *indices++ = i;
+            *indices++ = (u16)(i + SIZE);
+            *indices++ = (u16)(i + 1);
+            *indices++ = (u16)(i + 1);
+            *indices++ = (u16)(i + SIZE);
+            *indices++ = (u16)(i + SIZE + 1);
+        }
+    }
+
+    Geometry geometry;
+    geometry.SetRawVertexData(vertexData, VertexElements::Position);
+    geometry.SetRawIndexData(indexData, sizeof(u16));
+    geometry.SetDrawRange(TRIANGLE_LIST, 0, INDEX_COUNT, false);
+
+    Vector<Ray> rays;
+    for (i32 i = 0; i < NUM_RAYS; ++i)
+    {
+        Vector3 target(Random() * SIZE, 0.f, Random() * SIZE);
+        Vector3 origin(SIZE * 0.5f, 50.f, -20.f);
+        rays.Push(Ray(origin, (target - origin).Normalized()));
+    }
+
+    RunBenchmark("TriangleBvh", "Raycast", "brute force", NUM_RAYS, [&]
+    {
+        float sum = 0.f;
+        Vector3 normal;
+        for (const Ray& ray : rays)
+            sum += ray.HitDistance(vertexData.Get(), sizeof(Vector3), indexData.Get(), sizeof(u16), 0, INDEX_COUNT, &normal);
+        return (i32)sum;
+    });
+
+    RunBenchmark("TriangleBvh", "Raycast", "bvh", NUM_RAYS, [&]
+    {
+        float sum = 0.f;
+        Vector3 normal;
+        for (const Ray& ray : rays)
+            sum += geometry.GetHitDistance(ray, &normal);
+        return (i32)sum;
+    });
+
+    // Reported per triangle
+    TriangleBvh bvh;
+
+    RunBenchmark("TriangleBvh", "Build", "dviglo", INDEX_COUNT / 3, [&]
+    {
+        bvh.Build(vertexData.Get(), sizeof(Vector3), indexData.Get(), sizeof(u16), 0, INDEX_COUNT);
+        return bvh.GetNumTriangles();
+    });
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+// Microbenchmarks of engine containers, strings and math compared with the standard library,
+// and of some engine subsystems.
+// Usage: benchmarks [-quick] [-output result.json]
+// Results are printed as JSON: time of one operation in nanoseconds for each implementation
+
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace dvt;
+
+void Benchmark_Container_HashMap();
+void Benchmark_Container_HashSet();
+void Benchmark_Container_List();
+void Benchmark_Container_Str();
+void Benchmark_Container_Vector();
+void Benchmark_Core_Variant();
+void Benchmark_Graphics_AnimatedModel();
+void Benchmark_Graphics_Batch();
+void Benchmark_Graphics_BillboardSet();
+void Benchmark_Graphics_OcclusionBuffer();
+void Benchmark_Graphics_Octree();
+void Benchmark_Graphics_ParticleEmitter();
+void Benchmark_Graphics_TriangleBvh();
+void Benchmark_Math_BoundingBox();
+void Benchmark_Math_Matrix3x4();
+void Benchmark_Math_Quaternion();
+void Benchmark_Math_StringHash();
+
+void Run()
+{
+    Benchmark_Container_HashMap();
+    Benchmark_Container_HashSet();
+    Benchmark_Container_List();
+    Benchmark_Container_Str();
+    Benchmark_Container_Vector();
+    Benchmark_Core_Variant();
+    Benchmark_Graphics_AnimatedModel();
+    Benchmark_Graphics_Batch();
+    Benchmark_Graphics_BillboardSet();
+    Benchmark_Graphics_OcclusionBuffer();
+    Benchmark_Graphics_Octree();
+    Benchmark_Graphics_ParticleEmitter();
+    Benchmark_Graphics_TriangleBvh();
+    Benchmark_Math_BoundingBox();
+    Benchmark_Math_Matrix3x4();
+    Benchmark_Math_Quaternion();
+    Benchmark_Math_StringHash();
+}
+
+struct BenchmarkResult
+{
+    const char* group;
+    const char* name;
+    const char* impl;
+    double nsPerOp;
+};
+
+static std::vector<BenchmarkResult> results;
+
+// 50 ms is enough for stable results, 1 ms only checks that everything works
+static i64 minTime = 50'000'000;
+
+i64 GetBenchmarkMinTime()
+{
+    return minTime;
+}
+
+void AddBenchmarkResult(const char* group, const char* name, const char* impl, double nsPerOp)
+{
+    results.push_back({group, name, impl, nsPerOp});
+    fprintf(stderr, "%-12s %-24s %-8s %10.2f ns\n", group, name, impl, nsPerOp);
+}
+
+static std::string ToJSON()
+{
+    std::string ret = "{\"benchmarks\":[";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "%s\n{\"group\":\"%s\",\"name\":\"%s\",\"impl\":\"%s\",\"ns_per_op\":%.3f}",
+            i ? "," : "", results[i].group, results[i].name, results[i].impl, results[i].nsPerOp);
+        ret += buffer;
+    }
+
+    ret += "\n]}\n";
+    return ret;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* outputPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-quick"))
+            minTime = 1'000'000;
+        else if (!strcmp(argv[i], "-output") && i + 1 < argc)
+            outputPath = argv[++i];
+    }
+
+    Run();
+
+    std::string json = ToJSON();
+
+    if (!outputPath)
+    {
+        fputs(json.c_str(), stdout);
+        return 0;
+    }
+
+    FILE* file = fopen(outputPath, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open %s\n", outputPath);
+        return 1;
+    }
+
+    fputs(json.c_str(), file);
+    fclose(file);
+    return 0;
+}
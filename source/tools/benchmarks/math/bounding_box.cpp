@@ -0,0 +1,59 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/math/bounding_box.h>
+#include <dviglo/math/matrix3x4.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_OPS = 100;
+
+// Transform all 8 corners, which is what a straightforward implementation does
+static BoundingBox TransformedScalar(const BoundingBox& box, const Matrix3x4& transform)
+{
+    BoundingBox result;
+
+    for (i32 i = 0; i < 8; ++i)
+    {
+        Vector3 corner(i & 1 ? box.max_.x_ : box.min_.x_, i & 2 ? box.max_.y_ : box.min_.y_, i & 4 ? box.max_.z_ : box.min_.z_);
+        result.Merge(transform * corner);
+    }
+
+    return result;
+}
+
+void Benchmark_Math_BoundingBox()
+{
+    BoundingBox box(Vector3(-1.f, -2.f, -3.f), Vector3(1.f, 2.f, 3.f));
+    Matrix3x4 transform(Vector3(1.f, 2.f, 3.f), Quaternion(30.f, Vector3::UP), 0.5f);
+
+    RunBenchmark("BoundingBox", "Transformed", "dviglo", NUM_OPS, [&box, &transform]
+    {
+        float sum = 0.f;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += box.Transformed(transform).max_.x_;
+        return (i32)sum;
+    });
+
+    RunBenchmark("BoundingBox", "Transformed", "corners", NUM_OPS, [&box, &transform]
+    {
+        float sum = 0.f;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += TransformedScalar(box, transform).max_.x_;
+        return (i32)sum;
+    });
+
+    BoundingBox other(Vector3(0.5f, 0.5f, 0.5f), Vector3(2.f, 2.f, 2.f));
+
+    RunBenchmark("BoundingBox", "IsInside", "dviglo", NUM_OPS, [&box, &other]
+    {
+        i32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += box.IsInside(other);
+        return sum;
+    });
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/math/matrix3x4.h>
+
+#include <cstring>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_OPS = 100;
+
+// The standard library has no matrices, so the engine is compared with plain scalar code
+static void MultiplyScalar(const float* a, const float* b, float* result)
+{
+    for (i32 row = 0; row < 3; ++row)
+    {
+        for (i32 col = 0; col < 4; ++col)
+        {
+            float value = a[row * 4 + 0] * b[0 * 4 + col] + a[row * 4 + 1] * b[1 * 4 + col] + a[row * 4 + 2] * b[2 * 4 + col];
+            if (col == 3)
+                value += a[row * 4 + 3];
+            result[row * 4 + col] = value;
+        }
+    }
+}
+
+void Benchmark_Math_Matrix3x4()
+{
+    Matrix3x4 matrix(Vector3(1.f, 2.f, 3.f), Quaternion(30.f, Vector3::UP), 0.5f);
+    Vector3 point(1.f, 2.f, 3.f);
+
+    RunBenchmark("Matrix3x4", "Multiply", "dviglo", NUM_OPS, [&matrix]
+    {
+        Matrix3x4 result = matrix;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            result = result * matrix;
+        return (i32)result.m03_;
+    });
+
+    RunBenchmark("Matrix3x4", "Multiply", "scalar", NUM_OPS, [&matrix]
+    {
+        float result[12];
+        float temp[12];
+        memcpy(result, matrix.Data(), sizeof(result));
+        for (i32 i = 0; i < NUM_OPS; ++i)
+        {
+            MultiplyScalar(result, matrix.Data(), temp);
+            memcpy(result, temp, sizeof(result));
+        }
+        return (i32)result[3];
+    });
+
+    RunBenchmark("Matrix3x4", "TransformPoint", "dviglo", NUM_OPS, [&matrix, &point]
+    {
+        Vector3 result = point;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            result = matrix * result;
+        return (i32)result.x_;
+    });
+
+    RunBenchmark("Matrix3x4", "Inverse", "dviglo", NUM_OPS, [&matrix]
+    {
+        float sum = 0.f;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += matrix.Inverse().m03_;
+        return (i32)sum;
+    });
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/math/quaternion.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_OPS = 100;
+
+// The standard library has no quaternions, so the engine is compared with plain scalar code
+static Quaternion MultiplyScalar(const Quaternion& a, const Quaternion& b)
+{
+    return Quaternion(
+        a.w_ * b.w_ - a.x_ * b.x_ - a.y_ * b.y_ - a.z_ * b.z_,
+        a.w_ * b.x_ + a.x_ * b.w_ + a.y_ * b.z_ - a.z_ * b.y_,
+        a.w_ * b.y_ + a.y_ * b.w_ + a.z_ * b.x_ - a.x_ * b.z_,
+        a.w_ * b.z_ + a.z_ * b.w_ + a.x_ * b.y_ - a.y_ * b.x_);
+}
+
+void Benchmark_Math_Quaternion()
+{
+    Quaternion rotation(1.f, Vector3(1.f, 2.f, 3.f).Normalized());
+    Vector3 vector(1.f, 2.f, 3.f);
+
+    RunBenchmark("Quaternion", "Multiply", "dviglo", NUM_OPS, [&rotation]
+    {
+        Quaternion result = rotation;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            result = result * rotation;
+        return (i32)(result.w_ * 100.f);
+    });
+
+    RunBenchmark("Quaternion", "Multiply", "scalar", NUM_OPS, [&rotation]
+    {
+        Quaternion result = rotation;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            result = MultiplyScalar(result, rotation);
+        return (i32)(result.w_ * 100.f);
+    });
+
+    RunBenchmark("Quaternion", "RotateVector", "dviglo", NUM_OPS, [&rotation, &vector]
+    {
+        Vector3 result = vector;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            result = rotation * result;
+        return (i32)result.x_;
+    });
+
+    RunBenchmark("Quaternion", "Slerp", "dviglo", NUM_OPS, [&rotation]
+    {
+        Quaternion result = Quaternion::IDENTITY;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            result = result.Slerp(rotation, 0.5f);
+        return (i32)(result.w_ * 100.f);
+    });
+}
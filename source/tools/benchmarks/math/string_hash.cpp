@@ -0,0 +1,36 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../benchmark.h"
+
+#include <dviglo/math/string_hash.h>
+
+#include <string_view>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static constexpr i32 NUM_OPS = 100;
+
+void Benchmark_Math_StringHash()
+{
+    String name = "Models/Kachujin/Kachujin_Walk.ani";
+    std::string_view stdName(name.c_str(), name.Length());
+
+    RunBenchmark("StringHash", "Calculate", "dviglo", NUM_OPS, [&name]
+    {
+        u32 sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += StringHash(name).Value();
+        return sum;
+    });
+
+    RunBenchmark("StringHash", "Calculate", "std", NUM_OPS, [&stdName]
+    {
+        size_t sum = 0;
+        for (i32 i = 0; i < NUM_OPS; ++i)
+            sum += std::hash<std::string_view>()(stdName);
+        return sum;
+    });
+}
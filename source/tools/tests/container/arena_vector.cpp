@@ -0,0 +1,74 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/containers/arena_vector.h>
+
+#include <cstdint>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+void Test_Container_ArenaVector()
+{
+    ArenaAllocator allocator(1024);
+    assert(allocator.GetCapacity() == 0);
+    assert(allocator.GetNumHeapAllocations() == 0);
+
+    // Alignment
+    {
+        allocator.Allocate(1, 1);
+        void* ptr = allocator.Allocate(8, 64);
+        assert(((uintptr_t)ptr & 63) == 0);
+        assert(allocator.GetNumHeapAllocations() == 1);
+    }
+
+    // Growing past the block size creates new blocks
+    {
+        ArenaVector<i32> vector(&allocator);
+        for (i32 i = 0; i < 1000; ++i)
+            vector.Push(i);
+
+        assert(vector.Size() == 1000);
+        for (i32 i = 0; i < 1000; ++i)
+            assert(vector[i] == i);
+
+        i32 sum = 0;
+        for (i32 value : vector)
+            sum += value;
+        assert(sum == 999 * 1000 / 2);
+
+        ArenaVector<i32> copy(vector);
+        assert(copy.Size() == 1000 && copy.Back() == 999);
+        assert(copy.Buffer() != vector.Buffer());
+        assert(copy.GetAllocator() == &allocator);
+    }
+
+    assert(allocator.GetNumHeapAllocations() > 1);
+    i32 usedSize = allocator.GetUsedSize();
+
+    // After the reset the blocks are merged, so the same usage does not allocate
+    allocator.Reset();
+    assert(allocator.GetUsedSize() == 0);
+    assert(allocator.GetCapacity() >= usedSize);
+    i32 numHeapAllocations = allocator.GetNumHeapAllocations();
+
+    for (i32 frame = 0; frame < 10; ++frame)
+    {
+        allocator.Allocate(1, 1);
+        allocator.Allocate(8, 64);
+
+        ArenaVector<i32> vector(&allocator);
+        for (i32 i = 0; i < 1000; ++i)
+            vector.Push(i);
+
+        ArenaVector<i32> copy(vector);
+        assert(copy.Size() == 1000);
+
+        allocator.Reset();
+    }
+
+    assert(allocator.GetNumHeapAllocations() == numHeapAllocations);
+}
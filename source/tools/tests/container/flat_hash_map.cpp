@@ -0,0 +1,120 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/containers/flat_hash_map.h>
+#include <dviglo/containers/str.h>
+
+#include <random>
+#include <unordered_map>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+void Test_Container_FlatHashMap()
+{
+    {
+        FlatHashMap<i32, i32> map;
+        assert(map.Empty());
+        assert(map.Begin() == map.End());
+        assert(map.Find(1) == map.End());
+        assert(!map.Erase(1));
+        const FlatHashMap<i32, i32>& constMap = map;
+        assert(constMap[1] == nullptr);
+
+        map[1] = 10;
+        map[2] = 20;
+        assert(map.Size() == 2);
+        assert(map[1] == 10);
+
+        bool exists;
+        map.Insert(MakePair(2, 30), exists);
+        assert(exists);
+        assert(map[2] == 30);
+        map.Insert(MakePair(3, 40), exists);
+        assert(!exists);
+
+        i32 value = 0;
+        assert(map.TryGetValue(3, value) && value == 40);
+        assert(!map.TryGetValue(4, value));
+
+        i32 sum = 0;
+        for (const auto& pair : map)
+            sum += pair.first_;
+        assert(sum == 6);
+
+        FlatHashMap<i32, i32> copy(map);
+        assert(copy.Size() == 3 && copy[2] == 30);
+
+        // Erase odd keys while iterating
+        for (FlatHashMap<i32, i32>::Iterator i = map.Begin(); i != map.End();)
+        {
+            if (i->first_ % 2)
+                i = map.Erase(i);
+            else
+                ++i;
+        }
+        assert(map.Size() == 1 && map.Contains(2));
+
+        map.Clear();
+        assert(map.Empty());
+        assert(map.Capacity() > 0);
+        assert(copy.Size() == 3);
+
+        FlatHashMap<i32, i32> moved(std::move(copy));
+        assert(moved.Size() == 3);
+        assert(copy.Empty());
+    }
+
+    // Non-trivial values survive rehashing
+    {
+        FlatHashMap<String, String> map;
+        for (i32 i = 0; i < 1000; ++i)
+            map["Key" + String(i)] = "Value" + String(i);
+
+        const FlatHashMap<String, String>& constMap = map;
+        assert(map.Size() == 1000);
+        for (i32 i = 0; i < 1000; ++i)
+            assert(*constMap["Key" + String(i)] == "Value" + String(i));
+
+        Vector<String> keys = map.Keys();
+        assert(keys.Size() == 1000);
+    }
+
+    // Random inserts and erases leave many deleted slots. Compare with the standard library
+    {
+        FlatHashMap<i32, i32> map;
+        std::unordered_map<i32, i32> reference;
+        std::mt19937 random(1);
+
+        for (i32 i = 0; i < 100000; ++i)
+        {
+            i32 key = (i32)(random() % 500);
+
+            if (random() % 2)
+            {
+                map[key] = i;
+                reference[key] = i;
+            }
+            else
+            {
+                assert(map.Erase(key) == (reference.erase(key) > 0));
+            }
+
+            assert(map.Size() == (i32)reference.size());
+        }
+
+        // Capacity is not increased by deleted slots
+        assert(map.Capacity() <= 1024);
+
+        i32 count = 0;
+        for (const auto& pair : map)
+        {
+            assert(reference.at(pair.first_) == pair.second_);
+            ++count;
+        }
+        assert(count == map.Size());
+    }
+}
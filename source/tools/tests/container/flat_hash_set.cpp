@@ -0,0 +1,72 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/containers/flat_hash_set.h>
+
+#include <random>
+#include <unordered_set>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+void Test_Container_FlatHashSet()
+{
+    {
+        FlatHashSet<i32> set{1, 2, 3};
+        assert(set.Size() == 3);
+        assert(set.Contains(2));
+        assert(!set.Contains(4));
+
+        bool exists;
+        set.Insert(3, exists);
+        assert(exists);
+        set.Insert(4, exists);
+        assert(!exists);
+
+        i32 sum = 0;
+        for (i32 key : set)
+            sum += key;
+        assert(sum == 10);
+
+        assert(set.Erase(1));
+        assert(!set.Erase(1));
+        assert(set.Size() == 3);
+
+        set.Clear();
+        assert(set.Empty());
+        assert(set.Begin() == set.End());
+    }
+
+    {
+        FlatHashSet<i32> set;
+        std::unordered_set<i32> reference;
+        std::mt19937 random(2);
+        bool exists;
+
+        for (i32 i = 0; i < 100000; ++i)
+        {
+            i32 key = (i32)(random() % 2000);
+
+            if (random() % 3)
+            {
+                set.Insert(key, exists);
+                assert(exists == !reference.insert(key).second);
+            }
+            else
+                assert(set.Erase(key) == (reference.erase(key) > 0));
+
+            assert(set.Size() == (i32)reference.size());
+        }
+
+        for (i32 key : reference)
+            assert(set.Contains(key));
+
+        FlatHashSet<i32> copy(set);
+        assert(copy.Size() == set.Size());
+        for (i32 key : set)
+            assert(copy.Contains(key));
+    }
+}
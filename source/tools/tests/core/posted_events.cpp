@@ -0,0 +1,115 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/core_events.h>
+#include <dviglo/core/task_graph.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+namespace
+{
+
+DV_EVENT(E_TESTPOSTED, TestPosted)
+{
+    DV_PARAM(P_VALUE, Value); // i32
+}
+
+class PostedEventSender : public Object
+{
+    DV_OBJECT(PostedEventSender, Object);
+};
+
+class PostedEventReceiver : public Object
+{
+    DV_OBJECT(PostedEventReceiver, Object);
+
+public:
+    PostedEventReceiver()
+    {
+        SubscribeToEvent(E_TESTPOSTED, DV_HANDLER(PostedEventReceiver, HandleTestPosted));
+        SubscribeToTypedEvent(&PostedEventReceiver::HandleUpdate);
+    }
+
+    void HandleTestPosted(StringHash eventType, VariantMap& eventData)
+    {
+        values_[GetEventSender()].Push(eventData[TestPosted::P_VALUE].GetI32());
+    }
+
+    void HandleUpdate(UpdateEvent& event)
+    {
+        ++numUpdates_;
+    }
+
+    HashMap<Object*, Vector<i32>> values_;
+    i32 numUpdates_ = 0;
+};
+
+} // namespace
+
+void Test_Core_PostedEvents()
+{
+    const i32 numSenders = 8;
+    const i32 numValues = 100;
+
+    SharedPtr<WorkQueue> queue(new WorkQueue());
+    queue->CreateThreads(3);
+
+    Vector<SharedPtr<PostedEventSender>> senders;
+    for (i32 i = 0; i < numSenders; ++i)
+        senders.Push(SharedPtr<PostedEventSender>(new PostedEventSender()));
+
+    SharedPtr<PostedEventReceiver> receiver(new PostedEventReceiver());
+
+    // Each sender posts from one worker, so its events must arrive in posting order
+    queue->ParallelFor(0, numSenders, 1, [&](i32 begin, i32 end, i32 threadIndex)
+    {
+        for (i32 i = begin; i < end; ++i)
+        {
+            for (i32 j = 0; j < numValues; ++j)
+            {
+                VariantMap eventData;
+                eventData[TestPosted::P_VALUE] = j;
+                senders[i]->PostEvent(E_TESTPOSTED, eventData);
+            }
+        }
+    });
+
+    // Events of one sender posted from different threads, ordered by a dependency
+    SharedPtr<TaskGraph> graph(new TaskGraph(queue));
+    PostedEventSender* sender = senders[0];
+    i32 first = graph->AddTask([sender](i32, i32, i32) { sender->PostEvent(E_TESTPOSTED, TestPosted::P_VALUE, numValues); });
+    i32 second = graph->AddTask([sender](i32, i32, i32) { sender->PostTypedEvent(UpdateEvent{0.f}); });
+    i32 third = graph->AddTask([sender](i32, i32, i32) { sender->PostEvent(E_TESTPOSTED, TestPosted::P_VALUE, numValues + 1); });
+    graph->AddDependency(second, first);
+    graph->AddDependency(third, second);
+    graph->Run();
+    graph->Wait();
+
+    // Nothing is delivered before the main thread sends posted events
+    assert(receiver->values_.Empty());
+    DV_CONTEXT.SendPostedEvents();
+
+    for (i32 i = 0; i < numSenders; ++i)
+    {
+        const Vector<i32>& values = receiver->values_[senders[i]];
+        assert(values.Size() == (i ? numValues : numValues + 2));
+        for (i32 j = 0; j < values.Size(); ++j)
+            assert(values[j] == j);
+    }
+
+    assert(receiver->numUpdates_ == 1);
+
+    // Events of a destroyed sender are dropped
+    receiver->values_.Clear();
+    senders[1]->PostEvent(E_TESTPOSTED, TestPosted::P_VALUE, 0);
+    senders[2]->PostEvent(E_TESTPOSTED, TestPosted::P_VALUE, 0);
+    senders[1].Reset();
+    DV_CONTEXT.SendPostedEvents();
+    assert(receiver->values_.Size() == 1);
+    assert(receiver->values_.Contains(senders[2]));
+}
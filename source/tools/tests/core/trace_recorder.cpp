@@ -0,0 +1,110 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/core/profiler.h>
+#include <dviglo/core/task_graph.h>
+#include <dviglo/core/trace_recorder.h>
+#include <dviglo/resource/json_file.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+void Test_Core_TraceRecorder()
+{
+    SharedPtr<WorkQueue> queue(new WorkQueue());
+    queue->CreateThreads(3);
+
+    TraceRecorder::Clear();
+
+    // Nothing is recorded while disabled
+    {
+        AutoTraceScope scope("DisabledScope");
+    }
+    assert(!TraceRecorder::GetChromeTrace().Contains("DisabledScope"));
+
+    TraceRecorder::SetEnabled(true);
+    TraceRecorder::SetThreadName("Test \"main\" thread");
+
+    {
+        AutoTraceScope scope("MainScope");
+    }
+
+    std::atomic<i32> counter{0};
+    queue->ParallelFor(0, 1000, 10, [&counter](i32 begin, i32 end, i32 threadIndex)
+    {
+        AutoTraceScope scope("WorkerScope");
+        counter.fetch_add(end - begin);
+    });
+    assert(counter.load() == 1000);
+
+#ifdef DV_PROFILING
+    queue->ParallelFor(0, 100, 10, [](i32 begin, i32 end, i32 threadIndex)
+    {
+        DV_PROFILE(ProfiledWorkerScope);
+    });
+#endif
+
+    TraceRecorder::SetEnabled(false);
+
+    String trace = TraceRecorder::GetChromeTrace();
+    assert(trace.StartsWith("{\"traceEvents\":["));
+    assert(trace.Contains("\"name\":\"MainScope\",\"ph\":\"X\""));
+    assert(trace.Contains("\"name\":\"WorkerScope\",\"ph\":\"X\""));
+    assert(trace.Contains("\"thread_name\""));
+    assert(trace.Contains("Test \\\"main\\\" thread"));
+    assert(!trace.Contains("DisabledScope"));
+#ifdef DV_PROFILING
+    assert(trace.Contains("ProfiledWorkerScope"));
+#endif
+
+    // Trace is valid JSON
+    JSONFile file;
+    assert(file.FromString(trace));
+    const JSONArray& events = file.GetRoot().Get("traceEvents").GetArray();
+    assert(!events.Empty());
+
+    for (const JSONValue& event : events)
+    {
+        if (event.Get("ph").GetString() != "X")
+            continue;
+
+        assert(event.Get("ts").IsNumber() && event.Get("ts").GetDouble() >= 0.0);
+        assert(event.Get("dur").IsNumber() && event.Get("dur").GetDouble() >= 0.0);
+    }
+
+    // Scopes which ended long ago are filtered out
+    assert(!TraceRecorder::GetChromeTrace(1e-6f).Contains("MainScope"));
+
+    TraceRecorder::Clear();
+    assert(!TraceRecorder::GetChromeTrace().Contains("WorkerScope"));
+
+    // Total time sums the scopes of all threads. Nested scopes are counted once, scopes which ended before
+    // the specified time are not counted
+    i64 base = TraceRecorder::GetTicks() - 1000;
+    TraceRecorder::Record("Outer", base, base + 10);
+    TraceRecorder::Record("Inner", base + 20, base + 30);
+    TraceRecorder::Record("Outer", base + 15, base + 50);
+    TraceRecorder::Record("Inner", base + 60, base + 65);
+    TraceRecorder::Record("Other", base + 70, base + 100);
+
+    i64 workBegin = TraceRecorder::GetTicks();
+    std::atomic<i64> workTicks{0};
+    queue->ParallelFor(0, 100, 1, [&workTicks](i32 begin, i32 end, i32 threadIndex)
+    {
+        i64 beginTicks = TraceRecorder::GetTicks();
+        i64 endTicks = TraceRecorder::GetTicks();
+        TraceRecorder::Record("Inner", beginTicks, endTicks);
+        workTicks.fetch_add(endTicks - beginTicks);
+    });
+
+    assert(TraceRecorder::GetTotalTime({"Outer", "Inner"}, workBegin) == workTicks.load());
+    assert(TraceRecorder::GetTotalTime({"Outer", "Inner"}, base + 11) == 35 + 5 + workTicks.load());
+    assert(TraceRecorder::GetTotalTime({"Inner"}, base + 11) == 10 + 5 + workTicks.load());
+    assert(TraceRecorder::GetTotalTime({"Outer"}, base) == 10 + 35);
+    assert(TraceRecorder::GetTotalTime({"Missing"}, base) == 0);
+
+    TraceRecorder::Clear();
+}
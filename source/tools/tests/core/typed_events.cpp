@@ -0,0 +1,150 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/core_events.h>
+#include <dviglo/scene/scene.h>
+#include <dviglo/scene/scene_events.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+namespace
+{
+
+class TestReceiver : public Object
+{
+    DV_OBJECT(TestReceiver, Object);
+
+public:
+    void SubscribeToLegacyUpdate()
+    {
+        SubscribeToEvent(E_UPDATE, DV_HANDLER(TestReceiver, HandleLegacyUpdate));
+    }
+
+    void HandleUpdate(UpdateEvent& event)
+    {
+        ++numTyped_;
+        lastTimeStep_ = event.timeStep_;
+    }
+
+    void HandleLegacyUpdate(StringHash eventType, VariantMap& eventData)
+    {
+        ++numLegacy_;
+        lastTimeStep_ = eventData[Update::P_TIMESTEP].GetFloat();
+    }
+
+    i32 numTyped_ = 0;
+    i32 numLegacy_ = 0;
+    float lastTimeStep_ = 0.f;
+};
+
+class TestSender : public Object
+{
+    DV_OBJECT(TestSender, Object);
+};
+
+} // namespace
+
+void Test_Core_TypedEvents()
+{
+    SharedPtr<TestSender> sender(new TestSender());
+    SharedPtr<TestSender> otherSender(new TestSender());
+    SharedPtr<TestReceiver> receiver(new TestReceiver());
+    SharedPtr<TestReceiver> specificReceiver(new TestReceiver());
+    SharedPtr<TestReceiver> legacyReceiver(new TestReceiver());
+
+    receiver->SubscribeToTypedEvent(&TestReceiver::HandleUpdate);
+    specificReceiver->SubscribeToTypedEvent(sender.Get(), &TestReceiver::HandleUpdate);
+
+    UpdateEvent event{0.5f};
+    sender->SendTypedEvent(event);
+    otherSender->SendTypedEvent(event);
+    assert(receiver->numTyped_ == 2);
+    assert(specificReceiver->numTyped_ == 1);
+    assert(specificReceiver->lastTimeStep_ == 0.5f);
+
+    // Subscribers which use VariantMap receive typed events too, and typed handlers receive VariantMap events
+    legacyReceiver->SubscribeToLegacyUpdate();
+    event.timeStep_ = 0.25f;
+    sender->SendTypedEvent(event);
+    assert(legacyReceiver->numLegacy_ == 1);
+    assert(legacyReceiver->lastTimeStep_ == 0.25f);
+    sender->SendEvent(E_UPDATE, Update::P_TIMESTEP, 1.f);
+    assert(legacyReceiver->numLegacy_ == 2);
+    assert(receiver->numTyped_ == 4);
+    assert(receiver->lastTimeStep_ == 1.f);
+    assert(specificReceiver->numTyped_ == 3);
+
+    // Typed and VariantMap handlers of the same object coexist
+    receiver->SubscribeToLegacyUpdate();
+    sender->SendTypedEvent(event);
+    assert(receiver->numTyped_ == 5);
+    assert(receiver->numLegacy_ == 1);
+    receiver->UnsubscribeFromEvent(E_UPDATE);
+    sender->SendTypedEvent(event);
+    assert(receiver->numTyped_ == 5);
+    assert(!receiver->HasSubscribedToEvent(E_UPDATE));
+
+    // Unsubscribing during send and destroying the sender of a specific subscription
+    receiver->SubscribeToTypedEvent<UpdateEvent>([&](UpdateEvent&) { receiver->UnsubscribeFromAllEvents(); });
+    sender->SendTypedEvent(event);
+    assert(!receiver->HasEventHandlers());
+    sender.Reset();
+    assert(!specificReceiver->HasEventHandlers());
+    otherSender->SendTypedEvent(event);
+    assert(specificReceiver->numTyped_ == 6);
+
+    // Typed and VariantMap subscribers are called in the same order as by SendEvent()
+    SharedPtr<TestSender> orderSender(new TestSender());
+    SharedPtr<TestReceiver> a(new TestReceiver());
+    SharedPtr<TestReceiver> b(new TestReceiver());
+    SharedPtr<TestReceiver> c(new TestReceiver());
+    SharedPtr<TestReceiver> d(new TestReceiver());
+    String order;
+    a->SubscribeToEvent(E_UPDATE, [&](StringHash, VariantMap&) { order += "a"; });
+    b->SubscribeToTypedEvent<UpdateEvent>([&](UpdateEvent&) { order += "b"; });
+    c->SubscribeToTypedEvent<UpdateEvent>(orderSender.Get(), [&](UpdateEvent&) { order += "C"; });
+    d->SubscribeToEvent(orderSender.Get(), E_UPDATE, [&](StringHash, VariantMap&) { order += "D"; });
+    c->SubscribeToTypedEvent<UpdateEvent>([&](UpdateEvent&) { order += "c"; });
+    d->SubscribeToEvent(E_UPDATE, [&](StringHash, VariantMap&) { order += "d"; });
+    a->SubscribeToTypedEvent<UpdateEvent>(orderSender.Get(), [&](UpdateEvent&) { order += "A"; });
+
+    orderSender->SendTypedEvent(event);
+    assert(order == "CDAab");
+    order.Clear();
+    orderSender->SendEvent(E_UPDATE, Update::P_TIMESTEP, 1.f);
+    assert(order == "CDAab");
+
+    // Resubscribing does not move the handler to the end
+    b->SubscribeToTypedEvent<UpdateEvent>([&](UpdateEvent&) { order += "B"; });
+    order.Clear();
+    otherSender->SendTypedEvent(event);
+    assert(order == "aBcd");
+
+    // Changes of typed handlers are written back to the VariantMap
+    b->SubscribeToTypedEvent<UpdateEvent>([&](UpdateEvent& e) { e.timeStep_ *= 2.f; });
+    VariantMap eventData;
+    eventData[Update::P_TIMESTEP] = 1.f;
+    otherSender->SendEvent(E_UPDATE, eventData);
+    assert(eventData[Update::P_TIMESTEP].GetFloat() == 2.f);
+    a->UnsubscribeFromAllEvents();
+    b->UnsubscribeFromAllEvents();
+    c->UnsubscribeFromAllEvents();
+    d->UnsubscribeFromAllEvents();
+
+    // Engine objects which use typed handlers receive VariantMap events. The scene updates itself on E_UPDATE and sends
+    // typed E_SCENEUPDATE to a VariantMap subscriber
+    SharedPtr<Scene> scene(new Scene());
+    float sceneTimeStep = 0.f;
+    legacyReceiver->SubscribeToEvent(scene, E_SCENEUPDATE, [&](StringHash, VariantMap& sceneEventData)
+    {
+        assert(sceneEventData[SceneUpdate::P_SCENE].GetPtr() == scene.Get());
+        sceneTimeStep = sceneEventData[SceneUpdate::P_TIMESTEP].GetFloat();
+    });
+    otherSender->SendEvent(E_UPDATE, Update::P_TIMESTEP, 0.5f);
+    assert(sceneTimeStep == 0.5f);
+}
@@ -0,0 +1,203 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/core/task_graph.h>
+#include <dviglo/core/thread.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+static void IncrementWork(const WorkItem* item, i32 threadIndex)
+{
+    static_cast<std::atomic<i32>*>(item->aux_)->fetch_add(1);
+}
+
+void Test_Core_WorkQueue()
+{
+    SharedPtr<WorkQueue> queue(new WorkQueue());
+    queue->CreateThreads(3);
+
+    std::atomic<i32> counter{0};
+    Vector<SharedPtr<WorkItem>> items;
+
+    for (i32 i = 0; i < 1000; ++i)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->workFunction_ = IncrementWork;
+        item->aux_ = &counter;
+        item->priority_ = i % 2 ? WI_MAX_PRIORITY : 0;
+        queue->AddWorkItem(item);
+        items.Push(item);
+    }
+
+    // Items which were not taken yet can be removed
+    Vector<SharedPtr<WorkItem>> toRemove;
+    for (i32 i = 0; i < items.Size(); i += 10)
+        toRemove.Push(items[i]);
+
+    i32 removed = queue->RemoveWorkItems(toRemove);
+    assert(removed >= 0 && removed <= toRemove.Size());
+
+    // Complete(WI_MAX_PRIORITY) must finish all high-priority items
+    queue->Complete(WI_MAX_PRIORITY);
+    assert(queue->IsCompleted(WI_MAX_PRIORITY));
+
+    queue->Complete(0);
+    assert(queue->IsCompleted(0));
+    assert(counter == 1000 - removed);
+
+    WorkQueueStats stats = queue->GetTotalStats();
+    assert(stats.executed_ == 1000 - removed);
+}
+
+void Test_Core_TaskGraph()
+{
+    SharedPtr<WorkQueue> queue(new WorkQueue());
+    queue->CreateThreads(3);
+
+    // Every item is processed exactly once
+    {
+        Vector<i32> values(10000, 0);
+
+        queue->ParallelFor(0, values.Size(), 16, [&values](i32 begin, i32 end, i32 threadIndex)
+        {
+            for (i32 i = begin; i < end; ++i)
+                ++values[i];
+        });
+
+        for (i32 value : values)
+            assert(value == 1);
+    }
+
+    // Tasks start only after their dependencies are finished
+    {
+        Vector<i32> values(1000, 0);
+        std::atomic<i32> sum{0};
+        std::atomic<i32> product{0};
+
+        SharedPtr<TaskGraph> graph(new TaskGraph(queue));
+
+        i32 fill = graph->AddParallelFor(0, values.Size(), 10, [&values](i32 begin, i32 end, i32 threadIndex)
+        {
+            for (i32 i = begin; i < end; ++i)
+                values[i] = i;
+        });
+
+        i32 accumulate = graph->AddParallelFor(0, values.Size(), 10, [&values, &sum](i32 begin, i32 end, i32 threadIndex)
+        {
+            i32 partial = 0;
+            for (i32 i = begin; i < end; ++i)
+                partial += values[i];
+            sum += partial;
+        });
+
+        i32 multiply = graph->AddTask([&sum, &product](i32, i32, i32)
+        {
+            product = sum * 2;
+        });
+
+        graph->AddDependency(accumulate, fill);
+        graph->AddDependency(multiply, accumulate);
+
+        // The graph can be reused
+        for (i32 i = 0; i < 3; ++i)
+        {
+            sum = 0;
+            product = 0;
+            graph->Run();
+            graph->Wait();
+            assert(graph->IsFinished(multiply));
+            assert(sum == 999 * 1000 / 2);
+            assert(product == 999 * 1000);
+        }
+    }
+
+    // A task sets the range of a parallel task, main thread tasks run between the worker tasks
+    {
+        Vector<i32> values;
+        std::atomic<i32> sum{0};
+        i32 mainSum = -1;
+        bool onMainThread = false;
+
+        SharedPtr<TaskGraph> graph(new TaskGraph(queue));
+
+        i32 accumulate = graph->AddParallelFor(10, [&values, &sum](i32 begin, i32 end, i32 threadIndex)
+        {
+            i32 partial = 0;
+            for (i32 i = begin; i < end; ++i)
+                partial += values[i];
+            sum += partial;
+        });
+
+        i32 fill = graph->AddTask([&values, &graph, accumulate](i32, i32, i32)
+        {
+            values.Resize(1000);
+            for (i32 i = 0; i < values.Size(); ++i)
+                values[i] = i;
+            graph->SetRange(accumulate, 0, values.Size());
+        });
+
+        i32 read = graph->AddMainThreadTask([&sum, &mainSum, &onMainThread](i32, i32, i32)
+        {
+            mainSum = sum;
+            onMainThread = Thread::IsMainThread();
+        });
+
+        graph->AddDependency(accumulate, fill);
+        graph->AddDependency(read, accumulate);
+
+        graph->Run();
+        graph->Wait(read);
+        assert(onMainThread);
+        assert(mainSum == 999 * 1000 / 2);
+        graph->Wait();
+    }
+
+    // The main thread can wait for a part of a parallel task
+    {
+        Vector<i32> values(1000, 0);
+
+        SharedPtr<TaskGraph> graph(new TaskGraph(queue));
+        i32 fill = graph->AddParallelFor(0, values.Size(), 10, [&values](i32 begin, i32 end, i32 threadIndex)
+        {
+            for (i32 i = begin; i < end; ++i)
+                values[i] = i + 1;
+        });
+
+        graph->Run();
+        for (i32 i = 0; i < values.Size(); i += 7)
+        {
+            graph->Wait(fill, i);
+            assert(values[i] == i + 1);
+        }
+        graph->Wait();
+    }
+
+    // Nested ParallelFor from a worker thread runs in the worker with its own index
+    {
+        std::atomic<i32> mismatches{0};
+
+        queue->ParallelFor(0, 64, 1, [&queue, &mismatches](i32 begin, i32 end, i32 threadIndex)
+        {
+            if (threadIndex != WorkQueue::GetThreadIndex())
+                ++mismatches;
+
+            // The main thread splits the nested range between all threads
+            if (!threadIndex)
+                return;
+
+            queue->ParallelFor(0, 100, 1, [&mismatches, threadIndex](i32, i32, i32 nestedIndex)
+            {
+                if (nestedIndex != threadIndex)
+                    ++mismatches;
+            });
+        });
+
+        assert(mismatches == 0);
+    }
+
+    assert(queue->IsCompleted(0));
+}
@@ -0,0 +1,386 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/work_queue.h>
+#include <dviglo/graphics/animated_model.h>
+#include <dviglo/graphics/animation.h>
+#include <dviglo/graphics/animation_pose_cache.h>
+#include <dviglo/graphics/animation_state.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+namespace
+{
+
+constexpr i32 NUM_BONES = 5;
+
+// Chain of bones
+SharedPtr<Model> CreateModel()
+{
+    Skeleton skeleton;
+    Vector<Bone>& bones = skeleton.GetModifiableBones();
+    bones.Resize(NUM_BONES);
+
+    for (i32 i = 0; i < NUM_BONES; ++i)
+    {
+        Bone& bone = bones[i];
+        bone.name_ = "Bone" + String(i);
+        bone.nameHash_ = bone.name_;
+        bone.parentIndex_ = i ? i - 1 : 0;
+        bone.initialPosition_ = Vector3(0.f, i ? 1.f : 0.f, 0.f);
+        bone.initialRotation_ = Quaternion(10.f * i, Vector3::UP);
+        bone.initialScale_ = Vector3::ONE;
+
+        // Collision information for the bone bounding box
+        if (i == 1)
+        {
+            bone.collisionMask_ = BONECOLLISION_BOX;
+            bone.boundingBox_ = BoundingBox(Vector3(-0.2f, 0.f, -0.2f), Vector3(0.2f, 1.f, 0.2f));
+        }
+        else
+        {
+            bone.collisionMask_ = BONECOLLISION_SPHERE;
+            bone.radius_ = 0.5f;
+        }
+    }
+
+    skeleton.SetRootBoneIndex(0);
+
+    SharedPtr<Model> model(new Model());
+    model->SetSkeleton(skeleton);
+    model->SetBoundingBox(BoundingBox(-Vector3::ONE, Vector3::ONE));
+    return model;
+}
+
+// Animates all bones except the last one
+SharedPtr<Animation> CreateAnimation(float phase)
+{
+    SharedPtr<Animation> animation(new Animation());
+    animation->SetLength(2.f);
+
+    for (i32 i = 0; i < NUM_BONES - 1; ++i)
+    {
+        AnimationTrack* track = animation->CreateTrack("Bone" + String(i));
+        track->channelMask_ = AnimationChannels::Position | AnimationChannels::Rotation | AnimationChannels::Scale;
+
+        for (i32 j = 0; j < 5; ++j)
+        {
+            AnimationKeyFrame keyFrame;
+            keyFrame.time_ = j * 0.5f;
+            keyFrame.position_ = Vector3(Sin(j * 40.f + phase), 1.f, Cos(j * 30.f + i * 20.f));
+            keyFrame.rotation_ = Quaternion(j * 25.f + phase, i * 15.f, j * 5.f);
+            keyFrame.scale_ = Vector3::ONE * (1.f + j * 0.1f);
+            track->AddKeyFrame(keyFrame);
+        }
+    }
+
+    return animation;
+}
+
+struct Character
+{
+    AnimatedModel* model_;
+    AnimationState* walk_;
+    AnimationState* wave_;
+};
+
+Character CreateCharacter(Scene* scene, Model* model, Animation* walk, Animation* wave, AnimationPoseCache* cache,
+    bool flatSkeleton = false)
+{
+    Node* node = scene->CreateChild("Character", LOCAL);
+    node->SetTransform(Vector3(1.f, 2.f, 3.f), Quaternion(30.f, Vector3::UP));
+    auto* animatedModel = new AnimatedModel();
+    node->AddComponent(animatedModel, 0, LOCAL);
+    animatedModel->SetFlatSkeleton(flatSkeleton);
+    animatedModel->SetModel(model);
+    animatedModel->SetPoseCache(cache);
+
+    Character character{animatedModel, animatedModel->AddAnimationState(walk), animatedModel->AddAnimationState(wave)};
+    character.walk_->SetLooped(true);
+    character.walk_->SetWeight(1.f);
+    character.wave_->SetLayer(1);
+    return character;
+}
+
+// Bone transforms of a model sharing poses must be the same as of a model which evaluates the animations at the
+// quantized time positions by itself
+void CheckBones(const Character& character, const Character& reference)
+{
+    const Vector<Bone>& bones = character.model_->GetSkeleton().GetBones();
+    const Vector<Bone>& referenceBones = reference.model_->GetSkeleton().GetBones();
+
+    for (i32 i = 0; i < NUM_BONES; ++i)
+    {
+        assert(bones[i].node_->GetPosition() == referenceBones[i].node_->GetPosition());
+        assert(bones[i].node_->GetRotation() == referenceBones[i].node_->GetRotation());
+        assert(bones[i].node_->GetScale() == referenceBones[i].node_->GetScale());
+        assert(bones[i].node_->GetWorldTransform().Equals(referenceBones[i].node_->GetWorldTransform()));
+    }
+}
+
+// The transforms are multiplied in a different order than in the bone nodes, so they may differ a little
+bool NearlyEquals(const Vector3& lhs, const Vector3& rhs)
+{
+    return (lhs - rhs).Length() < 0.0001f;
+}
+
+bool NearlyEquals(const Matrix3x4& lhs, const Matrix3x4& rhs)
+{
+    for (i32 i = 0; i < 12; ++i)
+    {
+        if (Abs(lhs.Data()[i] - rhs.Data()[i]) > 0.0001f)
+            return false;
+    }
+
+    return true;
+}
+
+// Bones in flat arrays must have the same transforms as bone nodes
+void CheckFlatBones(const Character& character, const Character& reference)
+{
+    const Vector<Matrix3x4>& transforms = character.model_->GetBoneTransforms();
+    const Vector<Bone>& referenceBones = reference.model_->GetSkeleton().GetBones();
+    const Matrix3x4& worldTransform = character.model_->GetNode()->GetWorldTransform();
+    assert(transforms.Size() == NUM_BONES);
+
+    for (i32 i = 0; i < NUM_BONES; ++i)
+        assert(NearlyEquals(worldTransform * transforms[i], referenceBones[i].node_->GetWorldTransform()));
+
+    const BoundingBox& box = character.model_->GetWorldBoundingBox();
+    const BoundingBox& referenceBox = reference.model_->GetWorldBoundingBox();
+    assert(NearlyEquals(box.min_, referenceBox.min_) && NearlyEquals(box.max_, referenceBox.max_));
+}
+
+void TestFlatSkeleton(Model* model, Animation* walk, Animation* wave)
+{
+    SharedPtr<Scene> scene(new Scene());
+    scene->AddComponent(new Octree(), 0, LOCAL);
+
+    Character character = CreateCharacter(scene, model, walk, wave, nullptr, true);
+    Character reference = CreateCharacter(scene, model, walk, wave, nullptr);
+    assert(character.model_->IsFlatSkeleton());
+    assert(!character.model_->GetNode()->GetNumChildren());
+
+    // Partial weight with the bone weights set recursively by the parent indices
+    for (const Character& c : {character, reference})
+    {
+        c.walk_->SetTime(0.7f);
+        c.wave_->SetWeight(0.5f);
+        c.wave_->SetTime(0.3f);
+        c.wave_->SetBoneWeight(String("Bone1"), 0.2f, true);
+    }
+
+    assert(character.wave_->GetBoneWeight(StringHash("Bone0")) == 1.f);
+    assert(character.wave_->GetBoneWeight(StringHash("Bone3")) == 0.2f);
+
+    FrameInfo frame{};
+    frame.frameNumber_ = 1;
+    frame.timeStep_ = 1.f / 60.f;
+
+    auto update = [&](float time)
+    {
+        ++frame.frameNumber_;
+        character.walk_->SetTime(time);
+        reference.walk_->SetTime(time);
+        character.model_->Update(frame);
+        reference.model_->Update(frame);
+    };
+
+    update(0.7f);
+    CheckFlatBones(character, reference);
+
+    character.wave_->SetBlendMode(ABM_ADDITIVE);
+    reference.wave_->SetBlendMode(ABM_ADDITIVE);
+    update(1.1f);
+    CheckFlatBones(character, reference);
+
+    // Node created on demand follows the bone
+    Node* boneNode = character.model_->GetOrCreateBoneNode("Bone3");
+    assert(boneNode && boneNode->GetParent() == character.model_->GetNode());
+    assert(character.model_->GetOrCreateBoneNode("Bone3") == boneNode);
+    assert(!character.model_->GetOrCreateBoneNode("Tail"));
+
+    Node* attachment = boneNode->CreateChild("Weapon", LOCAL);
+    attachment->SetPosition(Vector3(0.f, 0.f, 1.f));
+    Node* referenceAttachment = reference.model_->GetSkeleton().GetBone(3)->node_->CreateChild("Weapon", LOCAL);
+    referenceAttachment->SetPosition(Vector3(0.f, 0.f, 1.f));
+
+    update(1.3f);
+    CheckFlatBones(character, reference);
+    assert(NearlyEquals(attachment->GetWorldPosition(), referenceAttachment->GetWorldPosition()));
+
+    // Bone which is not animated follows its node, like a ragdoll body. Physics sets the world transform after the
+    // animation update, then the bone transforms and the bounding box are updated without applying the animations
+    character.model_->GetSkeleton().GetBone(2)->animated_ = false;
+    reference.model_->GetSkeleton().GetBone(2)->animated_ = false;
+    Node* ragdollNode = character.model_->GetOrCreateBoneNode("Bone2");
+    Node* referenceRagdollNode = reference.model_->GetSkeleton().GetBone(2)->node_;
+    update(1.5f);
+
+    ragdollNode->SetWorldTransform(Vector3(0.5f, 2.f, 0.f), Quaternion(45.f, Vector3::FORWARD), 1.5f);
+    referenceRagdollNode->SetWorldTransform(Vector3(0.5f, 2.f, 0.f), Quaternion(45.f, Vector3::FORWARD), 1.5f);
+    update(1.5f);
+    CheckFlatBones(character, reference);
+    assert(NearlyEquals(attachment->GetWorldPosition(), referenceAttachment->GetWorldPosition()));
+
+    ragdollNode->SetWorldPosition(Vector3(1.f, 3.f, 0.f));
+    referenceRagdollNode->SetWorldPosition(Vector3(1.f, 3.f, 0.f));
+    update(1.5f);
+    CheckFlatBones(character, reference);
+
+    // Evaluated poses can be shared between the modes
+    character.model_->GetSkeleton().GetBone(2)->animated_ = true;
+    reference.model_->GetSkeleton().GetBone(2)->animated_ = true;
+    SharedPtr<AnimationPoseCache> cache(new AnimationPoseCache());
+    character.model_->SetPoseCache(cache);
+    reference.model_->SetPoseCache(cache);
+    update(0.4f);
+    assert(cache->GetNumPoses() == 1 && cache->GetNumSharedPoses() == 1);
+    CheckFlatBones(character, reference);
+
+    // Switching the mode recreates the skeleton
+    reference.model_->SetFlatSkeleton(true);
+    assert(reference.model_->GetNode()->GetNumChildren() == 0);
+    assert(reference.model_->GetNumAnimationStates() == 0);
+    assert(reference.model_->GetBoneTransforms().Size() == NUM_BONES);
+
+    character.model_->SetFlatSkeleton(false);
+    assert(character.model_->GetNode()->GetNumChildren() == 1);
+    assert(character.model_->GetBoneTransforms().Empty());
+}
+
+} // namespace
+
+void Test_Graphics_AnimatedModel()
+{
+    SharedPtr<Model> model = CreateModel();
+    SharedPtr<Animation> walk = CreateAnimation(0.f);
+    SharedPtr<Animation> wave = CreateAnimation(90.f);
+
+    TestFlatSkeleton(model, walk, wave);
+
+    SharedPtr<AnimationPoseCache> cache(new AnimationPoseCache());
+    cache->SetTimeStep(0.1f);
+
+    SharedPtr<Scene> scene(new Scene());
+    scene->AddComponent(new Octree(), 0, LOCAL);
+
+    // Groups of characters with different animation settings. Within a group the time positions differ a little
+    Vector<Character> characters;
+    Vector<Character> references;
+
+    for (i32 i = 0; i < 60; ++i)
+    {
+        Character character = CreateCharacter(scene, model, walk, wave, cache);
+        Character reference = CreateCharacter(scene, model, walk, wave, nullptr);
+
+        i32 group = i % 4;
+        float time = 0.53f + group * 0.3f + (i / 4) * 0.002f;
+        character.walk_->SetTime(time);
+        reference.walk_->SetTime(cache->QuantizeTime(time));
+
+        // Waving on the upper layer with partial weight
+        if (group == 2)
+        {
+            character.wave_->SetWeight(0.5f);
+            character.wave_->SetTime(0.25f);
+            reference.wave_->SetWeight(0.5f);
+            reference.wave_->SetTime(cache->QuantizeTime(0.25f));
+        }
+
+        // Additive with a per-bone weight
+        if (group == 3)
+        {
+            for (AnimationState* state : {character.wave_, reference.wave_})
+            {
+                state->SetBlendMode(ABM_ADDITIVE);
+                state->SetWeight(1.f);
+                state->SetBoneWeight(1, 0.3f);
+            }
+        }
+
+        // Bone which is not animated, for example controlled by physics
+        if (i == 59)
+        {
+            character.model_->GetSkeleton().GetBone(2)->animated_ = false;
+            reference.model_->GetSkeleton().GetBone(2)->animated_ = false;
+        }
+
+        characters.Push(character);
+        references.Push(reference);
+    }
+
+    FrameInfo frame{};
+    frame.frameNumber_ = 1;
+    frame.timeStep_ = 1.f / 60.f;
+
+    for (i32 i = 0; i < characters.Size(); ++i)
+    {
+        characters[i].model_->Update(frame);
+        references[i].model_->Update(frame);
+        CheckBones(characters[i], references[i]);
+    }
+
+    // One pose for each group and for the character with a bone which is not animated
+    assert(cache->GetNumPoses() == 5);
+    assert(cache->GetNumSharedPoses() == characters.Size() - 5);
+
+    // Next frame in worker threads
+    DV_CONTEXT.RegisterSubsystem(new WorkQueue());
+    WorkQueue* queue = DV_CONTEXT.GetSubsystem<WorkQueue>();
+    queue->CreateThreads(3);
+
+    ++frame.frameNumber_;
+    for (i32 i = 0; i < characters.Size(); ++i)
+    {
+        characters[i].walk_->AddTime(0.05f);
+        references[i].walk_->SetTime(cache->QuantizeTime(characters[i].walk_->GetTime()));
+    }
+
+    // Like Octree::Update()
+    scene->BeginThreadedUpdate();
+    queue->ParallelFor(0, characters.Size(), 1, [&](i32 begin, i32 end, i32 /*threadIndex*/)
+    {
+        for (i32 i = begin; i < end; ++i)
+        {
+            characters[i].model_->Update(frame);
+            references[i].model_->Update(frame);
+        }
+    });
+    scene->EndThreadedUpdate();
+
+    for (i32 i = 0; i < characters.Size(); ++i)
+        CheckBones(characters[i], references[i]);
+
+    // Next frame by the octree. The characters are moved, so the animation depends on their new world transforms
+    ++frame.frameNumber_;
+    for (i32 i = 0; i < characters.Size(); ++i)
+    {
+        characters[i].walk_->AddTime(0.05f);
+        references[i].walk_->SetTime(cache->QuantizeTime(characters[i].walk_->GetTime()));
+        characters[i].model_->GetNode()->Translate(Vector3(0.f, 0.f, 0.1f * i));
+        references[i].model_->GetNode()->Translate(Vector3(0.f, 0.f, 0.1f * i));
+        assert(characters[i].model_->IsUpdateExpensive());
+    }
+
+    scene->GetComponent<Octree>()->Update(frame);
+
+    DV_CONTEXT.RemoveSubsystem<WorkQueue>();
+
+    for (i32 i = 0; i < characters.Size(); ++i)
+    {
+        assert(!characters[i].model_->IsUpdateExpensive());
+        CheckBones(characters[i], references[i]);
+    }
+
+    // Threads may evaluate the same pose at the same time, then only one of the poses is stored
+    assert(cache->GetNumPoses() + cache->GetNumSharedPoses() <= characters.Size());
+    assert(cache->GetNumPoses() < characters.Size() / 2);
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/graphics/batch.h>
+#include <dviglo/math/random.h>
+
+#include <dviglo/common/debug_new.h>
+
+#include <algorithm>
+#include <map>
+
+using namespace dviglo;
+
+namespace
+{
+
+// Sort key with IDs from small pools, so that many batches share the shader, material or geometry
+hash64 RandomSortKey()
+{
+    hash64 shader = Random(6) | (Random(4) == 0 ? 0x8000u : 0u);
+    hash64 lightQueue = Random(3);
+    hash64 material = Random(40) * 77;
+    hash64 geometry = Random(100) * 13;
+    return shader << 48u | lightQueue << 32u | material << 16u | geometry;
+}
+
+// Sorting by distance and then by state with the IDs remapped in the order of distance
+Vector<Batch*> SortFrontToBack2PassReference(Vector<Batch*> batches)
+{
+    std::sort(batches.Begin(), batches.End(), [](Batch* lhs, Batch* rhs)
+    {
+        if (lhs->renderOrder_ != rhs->renderOrder_)
+            return lhs->renderOrder_ < rhs->renderOrder_;
+        return lhs->distance_ < rhs->distance_;
+    });
+
+    std::map<hash32, hash32> shaders;
+    std::map<hash16, hash16> materials;
+    std::map<hash16, hash16> geometries;
+    std::map<Batch*, hash64> sortKeys;
+
+    for (Batch* batch : batches)
+    {
+        hash32 shaderID = (hash32)(batch->sortKey_ >> 32u);
+        if (!shaders.count(shaderID))
+        {
+            hash32 id = (hash32)shaders.size() | (shaderID & 0x80000000u);
+            shaders[shaderID] = id;
+        }
+
+        hash16 materialID = (hash16)(batch->sortKey_ >> 16u);
+        if (!materials.count(materialID))
+        {
+            hash16 id = (hash16)materials.size();
+            materials[materialID] = id;
+        }
+
+        hash16 geometryID = (hash16)batch->sortKey_;
+        if (!geometries.count(geometryID))
+        {
+            hash16 id = (hash16)geometries.size();
+            geometries[geometryID] = id;
+        }
+
+        sortKeys[batch] = (hash64)shaders[shaderID] << 32u | (hash64)materials[materialID] << 16u | geometries[geometryID];
+    }
+
+    std::sort(batches.Begin(), batches.End(), [&sortKeys](Batch* lhs, Batch* rhs)
+    {
+        if (lhs->renderOrder_ != rhs->renderOrder_)
+            return lhs->renderOrder_ < rhs->renderOrder_;
+        if (sortKeys[lhs] != sortKeys[rhs])
+            return sortKeys[lhs] < sortKeys[rhs];
+        return lhs->distance_ < rhs->distance_;
+    });
+
+    return batches;
+}
+
+} // namespace
+
+void Test_Graphics_Batch()
+{
+    SetRandomSeed(1);
+
+    constexpr i32 NUM_BATCHES = 1009;
+
+    // Front to back with unique distances, some of them negative
+    {
+        BatchQueue queue;
+        queue.Clear(0);
+        queue.batches_.Resize(NUM_BATCHES);
+
+        for (i32 i = 0; i < NUM_BATCHES; ++i)
+        {
+            Batch& batch = queue.batches_[i];
+            batch.sortKey_ = RandomSortKey();
+            batch.distance_ = (float)((i * 389) % NUM_BATCHES) * 0.5f - 100.f;
+            batch.renderOrder_ = Random(8) == 0 ? (i8)(Random(3) * 100 - 100) : DEFAULT_RENDER_ORDER;
+        }
+
+        Vector<Batch*> batches;
+        for (Batch& batch : queue.batches_)
+            batches.Push(&batch);
+
+        queue.SortFrontToBack();
+        assert(queue.sortedBatches_ == SortFrontToBack2PassReference(batches));
+    }
+
+    // Back to front keeps the order of the batches at the same distance
+    {
+        BatchQueue queue;
+        queue.Clear(0);
+        queue.batches_.Resize(NUM_BATCHES);
+
+        for (i32 i = 0; i < NUM_BATCHES; ++i)
+        {
+            Batch& batch = queue.batches_[i];
+            batch.distance_ = (float)Random(50) - 5.f;
+            batch.renderOrder_ = Random(8) == 0 ? (i8)(Random(3) * 100 - 100) : DEFAULT_RENDER_ORDER;
+        }
+
+        queue.SortBackToFront();
+        assert(queue.sortedBatches_.Size() == NUM_BATCHES);
+
+        for (i32 i = 1; i < NUM_BATCHES; ++i)
+        {
+            Batch* prev = queue.sortedBatches_[i - 1];
+            Batch* batch = queue.sortedBatches_[i];
+            if (prev->renderOrder_ != batch->renderOrder_)
+                assert(prev->renderOrder_ < batch->renderOrder_);
+            else if (prev->distance_ != batch->distance_)
+                assert(prev->distance_ > batch->distance_);
+            else
+                assert(prev < batch);
+        }
+    }
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/work_queue.h>
+#include <dviglo/graphics/billboard_set.h>
+#include <dviglo/graphics/camera.h>
+#include <dviglo/graphics/distance_sort.h>
+#include <dviglo/graphics/geometry.h>
+#include <dviglo/graphics/graphics.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/graphics_api/vertex_buffer.h>
+#include <dviglo/math/random.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace dviglo;
+
+namespace
+{
+
+void CheckSortKeys()
+{
+    const float distances[] = {3.f, -1.f, 0.f, 100.f, 3.f, -50.f, 0.5f, M_INFINITY, 3.f};
+    constexpr i32 count = (i32)(sizeof(distances) / sizeof(distances[0]));
+
+    Vector<u64> keys;
+    Vector<u64> temp;
+    for (i32 i = 0; i < count; ++i)
+        keys.Push(BackToFrontSortKey(distances[i], i));
+
+    SortBackToFront(keys, temp);
+
+    // Equal distances keep their order
+    const i32 expected[] = {7, 3, 0, 4, 8, 6, 2, 1, 5};
+    for (i32 i = 0; i < count; ++i)
+        assert((i32)(u32)keys[i] == expected[i]);
+}
+
+// Update the vertex buffer and return a copy of the vertices
+Vector<float> UpdateVertices(BillboardSet* billboardSet, const FrameInfo& frame)
+{
+    billboardSet->Commit();
+    billboardSet->UpdateBatches(frame);
+    billboardSet->UpdateGeometry(frame);
+
+    VertexBuffer* vertexBuffer = billboardSet->GetBatches()[0].geometry_->GetVertexBuffer(0);
+    i32 numFloats = vertexBuffer->GetVertexCount() * vertexBuffer->GetVertexSize() / (i32)sizeof(float);
+    Vector<float> vertices(numFloats);
+    memcpy(vertices.Buffer(), vertexBuffer->GetShadowData(), numFloats * sizeof(float));
+    return vertices;
+}
+
+// Compare vertices generated in worker threads with vertices generated by the main thread and check the order of the
+// billboards from the farthest to the nearest
+void CheckVertices(BillboardSet* billboardSet, const FrameInfo& frame, i32 vertexSize)
+{
+    Vector<float> vertices = UpdateVertices(billboardSet, frame);
+
+    DV_CONTEXT.RegisterSubsystem(new WorkQueue());
+    DV_CONTEXT.GetSubsystem<WorkQueue>()->CreateThreads(3);
+    Vector<float> threadedVertices = UpdateVertices(billboardSet, frame);
+    DV_CONTEXT.RemoveSubsystem<WorkQueue>();
+
+    // Packed colors may look like NaNs, so the vertices are compared as bytes
+    assert(vertices.Size() == threadedVertices.Size());
+    assert(!memcmp(vertices.Buffer(), threadedVertices.Buffer(), vertices.Size() * sizeof(float)));
+
+    Vector<const Billboard*> expected;
+    for (const Billboard& billboard : billboardSet->GetBillboards())
+    {
+        if (billboard.enabled_)
+            expected.Push(&billboard);
+    }
+
+    std::stable_sort(expected.Begin(), expected.End(), [&](const Billboard* lhs, const Billboard* rhs)
+    {
+        return frame.camera_->GetDistanceSquared(lhs->position_) > frame.camera_->GetDistanceSquared(rhs->position_);
+    });
+
+    for (i32 i = 0; i < expected.Size(); ++i)
+    {
+        const float* quad = &vertices[i * 4 * vertexSize];
+        for (i32 j = 0; j < 4; ++j)
+        {
+            const float* vertex = quad + j * vertexSize;
+            assert(Vector3(vertex[0], vertex[1], vertex[2]) == expected[i]->position_);
+        }
+    }
+}
+
+} // namespace
+
+void Test_Graphics_BillboardSet()
+{
+    SetRandomSeed(1);
+
+    CheckSortKeys();
+
+#ifdef DV_OPENGL
+    // Without the graphics subsystem vertex buffers are shadowed, so they can be locked and read back
+    GAPI gapi = Graphics::GetGAPI();
+    Graphics::SetGAPI(GAPI_OPENGL);
+
+    {
+        SharedPtr<Scene> scene(new Scene());
+        scene->AddComponent(new Octree(), 0, LOCAL);
+
+        Node* cameraNode = scene->CreateChild("Camera", LOCAL);
+        cameraNode->SetPosition(Vector3(5.f, 10.f, -30.f));
+        auto* camera = new Camera();
+        cameraNode->AddComponent(camera, 0, LOCAL);
+
+        Node* node = scene->CreateChild("Billboards", LOCAL);
+        auto* billboardSet = new BillboardSet();
+        node->AddComponent(billboardSet, 0, LOCAL);
+        billboardSet->SetSorted(true);
+        billboardSet->SetNumBillboards(5000);
+
+        // Some of the billboards are disabled and some have equal distances to the camera
+        Vector<Billboard>& billboards = billboardSet->GetBillboards();
+        for (i32 i = 0; i < billboards.Size(); ++i)
+        {
+            Billboard& billboard = billboards[i];
+            billboard.position_ = i % 7 ? Vector3(Random() * 100.f - 50.f, Random() * 20.f, Random() * 100.f) :
+                Vector3::ZERO;
+            billboard.size_ = Vector2(Random() + 0.1f, Random() + 0.1f);
+            billboard.rotation_ = Random() * 360.f;
+            billboard.direction_ = Vector3(Random(), 1.f, Random()).Normalized();
+            billboard.color_ = Color(Random(), Random(), Random());
+            billboard.enabled_ = i % 5 != 0;
+        }
+
+        FrameInfo frame{};
+        frame.frameNumber_ = 1;
+        frame.timeStep_ = 1.f / 60.f;
+        frame.viewSize_ = IntVector2(1280, 720);
+        frame.camera_ = camera;
+
+        CheckVertices(billboardSet, frame, 8);
+
+        billboardSet->SetFaceCameraMode(FC_DIRECTION);
+        ++frame.frameNumber_;
+        CheckVertices(billboardSet, frame, 11);
+    }
+
+    Graphics::SetGAPI(gapi);
+#endif
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include <dviglo/graphics/drawable.h>
+#include <dviglo/scene/node.h>
+
+// Drawable with a manually set bounding box, which does not need a scene node. In a scene node the box is in the local
+// space of the node
+class BoxDrawable : public dviglo::Drawable
+{
+    DV_OBJECT(BoxDrawable, Drawable);
+
+public:
+    explicit BoxDrawable(dviglo::DrawableTypes drawableType = dviglo::DrawableTypes::Geometry) :
+        Drawable(drawableType)
+    {
+    }
+
+    void SetBox(const dviglo::BoundingBox& box)
+    {
+        box_ = box;
+        OnMarkedDirty(nullptr);
+    }
+
+protected:
+    void OnWorldBoundingBoxUpdate() override
+    {
+        worldBoundingBox_ = node_ ? box_.Transformed(node_->GetWorldTransform()) : box_;
+    }
+
+private:
+    dviglo::BoundingBox box_;
+};
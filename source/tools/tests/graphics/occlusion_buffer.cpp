@@ -0,0 +1,197 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+#include "box_drawable.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/work_queue.h>
+#include <dviglo/graphics/camera.h>
+#include <dviglo/graphics/occlusion_buffer.h>
+#include <dviglo/scene/node.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+// Draw a wall at z = 10, which covers the left half of the view
+static void DrawWall(OcclusionBuffer* buffer, Camera* camera)
+{
+    static const Vector3 vertices[] =
+    {
+        Vector3(-100.f, -100.f, 10.f), Vector3(-100.f, 100.f, 10.f), Vector3(0.f, 100.f, 10.f),
+        Vector3(-100.f, -100.f, 10.f), Vector3(0.f, 100.f, 10.f), Vector3(0.f, -100.f, 10.f),
+    };
+
+    buffer->SetView(camera);
+    buffer->SetCullMode(CULL_NONE);
+    buffer->Clear();
+    buffer->AddTriangles(Matrix3x4::IDENTITY, vertices, sizeof(Vector3), 0, 6);
+    buffer->DrawTriangles();
+    buffer->BuildDepthHierarchy();
+}
+
+static void TestWall(OcclusionBuffer* buffer)
+{
+    // Behind the wall
+    assert(!buffer->IsVisible(BoundingBox(Vector3(-3.f, -1.f, 20.f), Vector3(-2.f, 1.f, 21.f))));
+    // Behind, but not covered
+    assert(buffer->IsVisible(BoundingBox(Vector3(2.f, -1.f, 20.f), Vector3(3.f, 1.f, 21.f))));
+    // In front of the wall
+    assert(buffer->IsVisible(BoundingBox(Vector3(-3.f, -1.f, 5.f), Vector3(-2.f, 1.f, 6.f))));
+}
+
+// Reproject the wall after a small camera movement
+static void TestReprojection()
+{
+    SharedPtr<Node> node(new Node());
+    SharedPtr<Camera> camera(new Camera());
+    node->AddComponent(camera, 0, LOCAL);
+    camera->SetAspectRatio(2.f);
+
+    SharedPtr<OcclusionBuffer> buffer(new OcclusionBuffer());
+    assert(buffer->SetSize(128, 64, false));
+    assert(!buffer->Reproject());
+
+    Vector<OccluderHistory> occluders;
+    DrawWall(buffer, camera);
+    buffer->StoreHistory(camera, occluders);
+    assert(buffer->HasHistory(camera));
+
+    node->SetPosition(Vector3(0.5f, 0.2f, 1.f));
+    node->SetRotation(Quaternion(2.f, Vector3::UP));
+    buffer->SetView(camera);
+    assert(buffer->Reproject());
+    assert(buffer->GetHistoryAge() == 1);
+    buffer->BuildDepthHierarchy();
+    TestWall(buffer);
+    buffer->StoreHistory(camera, occluders);
+
+    // Erased depth is not reprojected
+    BoundingBox wallBox(Vector3(-100.f, -100.f, 10.f), Vector3(0.f, 100.f, 10.f));
+    assert(buffer->IsHistoryValid(wallBox));
+    buffer->InvalidateHistory(wallBox);
+    assert(!buffer->IsHistoryValid(wallBox));
+    assert(!buffer->IsHistoryValid(BoundingBox(Vector3(-3.f, -1.f, 10.f), Vector3(-2.f, 1.f, 10.f))));
+    assert(buffer->Reproject());
+    assert(buffer->IsHistoryValid(wallBox));
+    buffer->BuildDepthHierarchy();
+    assert(buffer->IsVisible(BoundingBox(Vector3(-3.f, -1.f, 20.f), Vector3(-2.f, 1.f, 21.f))));
+
+    // Clearing restarts the history
+    buffer->Clear();
+    assert(buffer->GetHistoryAge() == 0);
+}
+
+// An occluder that was not drawn in the last frame stays in the history while its depth is reprojected
+static void TestOccluderHistory()
+{
+    // Walls at z = 10 on the left and on the right
+    static const Vector3 vertices[] =
+    {
+        Vector3(-100.f, -100.f, 10.f), Vector3(-100.f, 100.f, 10.f), Vector3(-5.f, 100.f, 10.f),
+        Vector3(-100.f, -100.f, 10.f), Vector3(-5.f, 100.f, 10.f), Vector3(-5.f, -100.f, 10.f),
+        Vector3(5.f, -100.f, 10.f), Vector3(5.f, 100.f, 10.f), Vector3(100.f, 100.f, 10.f),
+        Vector3(5.f, -100.f, 10.f), Vector3(100.f, 100.f, 10.f), Vector3(100.f, -100.f, 10.f),
+    };
+
+    BoundingBox leftBox(Vector3(-100.f, -100.f, 10.f), Vector3(-5.f, 100.f, 10.f));
+    BoundingBox rightBox(Vector3(5.f, -100.f, 10.f), Vector3(100.f, 100.f, 10.f));
+    BoundingBox behindLeft(Vector3(-15.f, -1.f, 20.f), Vector3(-14.f, 1.f, 21.f));
+    BoundingBox behindRight(Vector3(14.f, -1.f, 20.f), Vector3(15.f, 1.f, 21.f));
+
+    SharedPtr<Node> node(new Node());
+    SharedPtr<Camera> camera(new Camera());
+    node->AddComponent(camera, 0, LOCAL);
+    camera->SetAspectRatio(2.f);
+
+    SharedPtr<BoxDrawable> left(new BoxDrawable());
+    SharedPtr<BoxDrawable> right(new BoxDrawable());
+    node->AddComponent(left, 0, LOCAL);
+    node->AddComponent(right, 0, LOCAL);
+    left->SetOccluder(true);
+    right->SetOccluder(true);
+    left->SetBox(leftBox);
+    right->SetBox(rightBox);
+
+    SharedPtr<OcclusionBuffer> buffer(new OcclusionBuffer());
+    assert(buffer->SetSize(128, 64, false));
+    buffer->SetView(camera);
+    buffer->SetCullMode(CULL_NONE);
+    buffer->Clear();
+    buffer->AddTriangles(Matrix3x4::IDENTITY, vertices, sizeof(Vector3), 0, 12);
+    buffer->DrawTriangles();
+    buffer->BuildDepthHierarchy();
+
+    Vector<OccluderHistory> occluders;
+    occluders.Push(OccluderHistory{WeakPtr<Drawable>(left.Get()), leftBox});
+    occluders.Push(OccluderHistory{WeakPtr<Drawable>(right.Get()), rightBox});
+    buffer->StoreHistory(camera, occluders);
+
+    // The next frame does not draw the right wall (for example, it is out of the triangle budget),
+    // but its reprojected depth is still in the buffer
+    occluders.Clear();
+    buffer->SetView(camera);
+    assert(buffer->ReprojectOccluders(occluders));
+    assert(occluders.Size() == 2);
+    buffer->BuildDepthHierarchy();
+    assert(!buffer->IsVisible(behindRight));
+    buffer->StoreHistory(camera, occluders);
+
+    // When the right wall moves, its old depth is erased
+    right->SetBox(BoundingBox(Vector3(5.f, -100.f, 50.f), Vector3(100.f, 100.f, 50.f)));
+    occluders.Clear();
+    buffer->SetView(camera);
+    assert(buffer->ReprojectOccluders(occluders));
+    assert(occluders.Size() == 1);
+    assert(occluders[0].drawable_ == left);
+    buffer->BuildDepthHierarchy();
+    assert(buffer->IsVisible(behindRight));
+    assert(!buffer->IsVisible(behindLeft));
+}
+
+void Test_Graphics_OcclusionBuffer()
+{
+    SharedPtr<Camera> camera(new Camera());
+    camera->SetAspectRatio(2.f);
+
+    SharedPtr<OcclusionBuffer> buffer(new OcclusionBuffer());
+    assert(buffer->SetSize(128, 64, false));
+    DrawWall(buffer, camera);
+    TestWall(buffer);
+
+    // Only the left half of the pixels is covered
+    const int* data = buffer->GetBuffer();
+    for (int y = 0; y < 64; ++y)
+    {
+        assert(data[y * 128 + 63] < (int)16777216.f);
+        assert(data[y * 128 + 64] == (int)16777216.f);
+    }
+
+    // Narrow buffers are rasterized without SIMD
+    SharedPtr<OcclusionBuffer> narrowBuffer(new OcclusionBuffer());
+    assert(narrowBuffer->SetSize(4, 2, false));
+    DrawWall(narrowBuffer, camera);
+    assert(narrowBuffer->GetBuffer()[0] < (int)16777216.f);
+    assert(narrowBuffer->GetBuffer()[3] == (int)16777216.f);
+
+    // Worker threads give the same result
+    WorkQueue* queue = new WorkQueue();
+    DV_CONTEXT.RegisterSubsystem(queue);
+    queue->CreateThreads(3);
+
+    SharedPtr<OcclusionBuffer> threadedBuffer(new OcclusionBuffer());
+    assert(threadedBuffer->SetSize(128, 64, true));
+    assert(threadedBuffer->IsThreaded());
+    DrawWall(threadedBuffer, camera);
+    TestWall(threadedBuffer);
+
+    for (int i = 0; i < 128 * 64; ++i)
+        assert(threadedBuffer->GetBuffer()[i] == data[i]);
+
+    threadedBuffer.Reset();
+    DV_CONTEXT.RemoveSubsystem<WorkQueue>();
+
+    TestReprojection();
+    TestOccluderHistory();
+}
@@ -0,0 +1,389 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+#include "box_drawable.h"
+
+#include <dviglo/core/context.h>
+#include <dviglo/core/work_queue.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/math/random.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+#include <algorithm>
+
+using namespace dviglo;
+
+namespace
+{
+
+// Frustum query which tests the drawables one by one without the culling data of the octants
+class ScalarFrustumOctreeQuery : public FrustumOctreeQuery
+{
+public:
+    ScalarFrustumOctreeQuery(Vector<Drawable*>& result, const Frustum& frustum, DrawableTypes drawableTypes, mask32 viewMask) :
+        FrustumOctreeQuery(result, frustum, drawableTypes, viewMask)
+    {
+    }
+
+    void TestDrawablesBatched(Drawable** start, Drawable** end, const DrawableCullData& cullData, bool inside) override
+    {
+        TestDrawables(start, end, inside);
+    }
+};
+
+struct OctreeScene
+{
+    SharedPtr<Scene> scene_;
+    Octree* octree_;
+    Vector<SharedPtr<BoxDrawable>> drawables_;
+
+    explicit OctreeScene(bool bvh = false)
+    {
+        scene_ = new Scene();
+        octree_ = new Octree();
+        scene_->AddComponent(octree_, 0, LOCAL);
+        octree_->SetSize(BoundingBox(-100.f, 100.f), 6);
+        octree_->SetBvhEnabled(bvh);
+        SetRandomSeed(1);
+    }
+
+    // Random box, mostly small. Some of the boxes are outside the octree
+    BoundingBox RandomBox()
+    {
+        Vector3 center(Random() * 240.f - 120.f, Random() * 240.f - 120.f, Random() * 240.f - 120.f);
+        Vector3 halfSize = Vector3::ONE * (Random() < 0.9f ? Random() * 2.f : Random() * 50.f);
+        return BoundingBox(center - halfSize, center + halfSize);
+    }
+
+    void Add(i32 count)
+    {
+        for (i32 i = 0; i < count; ++i)
+        {
+            SharedPtr<BoxDrawable> drawable(new BoxDrawable(Random() < 0.8f ? DrawableTypes::Geometry : DrawableTypes::Light));
+            drawable->SetBox(RandomBox());
+            drawable->SetViewMask(Random() < 0.5f ? DEFAULT_VIEWMASK : 0x2u);
+            octree_->InsertDrawable(drawable);
+            drawables_.Push(drawable);
+        }
+    }
+
+    void Update()
+    {
+        FrameInfo frame;
+        frame.timeStep_ = 0.f;
+        octree_->Update(frame);
+    }
+
+    // Compare the octree query with the query without the culling data. If the octree is up to date,
+    // also compare with testing every drawable
+    void Check(const Frustum& frustum, DrawableTypes drawableTypes, mask32 viewMask, bool updated)
+    {
+        Vector<Drawable*> result;
+        FrustumOctreeQuery query(result, frustum, drawableTypes, viewMask);
+        octree_->GetDrawables(query);
+        std::sort(result.Begin(), result.End());
+
+        Vector<Drawable*> scalarResult;
+        ScalarFrustumOctreeQuery scalarQuery(scalarResult, frustum, drawableTypes, viewMask);
+        octree_->GetDrawables(scalarQuery);
+        std::sort(scalarResult.Begin(), scalarResult.End());
+        assert(result == scalarResult);
+
+        if (!updated)
+            return;
+
+        Vector<Drawable*> expected;
+        for (BoxDrawable* drawable : drawables_)
+        {
+            if (drawable->GetOctant() && !!(drawable->GetDrawableType() & drawableTypes) && (drawable->GetViewMask() & viewMask) &&
+                frustum.IsInsideFast(drawable->GetWorldBoundingBox()) != OUTSIDE)
+                expected.Push(drawable);
+        }
+
+        std::sort(expected.Begin(), expected.End());
+        assert(result == expected);
+    }
+
+    // Compare a visitor query with the octree query for the same volume
+    template <typename VisitQuery>
+    void CheckVisitor(OctreeQuery& octreeQuery, const VisitQuery& visitQuery)
+    {
+        octree_->GetDrawables(octreeQuery);
+        std::sort(octreeQuery.result_.Begin(), octreeQuery.result_.End());
+
+        Vector<Drawable*> result;
+        octree_->VisitDrawables(visitQuery, [&result](Drawable* drawable) { result.Push(drawable); });
+        std::sort(result.Begin(), result.End());
+        assert(result == octreeQuery.result_);
+    }
+
+    void CheckAll(bool updated = true)
+    {
+        Frustum frustum;
+        frustum.Define(60.f, 1.5f, 1.f, 0.5f, 150.f, Matrix3x4(Vector3(10.f, 5.f, -60.f), Quaternion(20.f, Vector3::UP), 1.f));
+        Check(frustum, DrawableTypes::Any, DEFAULT_VIEWMASK, updated);
+        Check(frustum, DrawableTypes::Geometry, 0x1u, updated);
+        Check(frustum, DrawableTypes::Light, 0x2u, updated);
+
+        // Frustum which contains whole octants
+        Frustum box;
+        box.Define(BoundingBox(-60.f, 60.f));
+        Check(box, DrawableTypes::Any, DEFAULT_VIEWMASK, updated);
+
+        Vector<Drawable*> result;
+        ScalarFrustumOctreeQuery frustumQuery(result, frustum, DrawableTypes::Geometry, 0x1u);
+        CheckVisitor(frustumQuery, VolumeVisitQuery(frustum, DrawableTypes::Geometry, 0x1u));
+
+        Sphere sphere(Vector3(20.f, -10.f, 5.f), 50.f);
+        SphereOctreeQuery sphereQuery(result, sphere, DrawableTypes::Any, 0x2u);
+        CheckVisitor(sphereQuery, VolumeVisitQuery(sphere, DrawableTypes::Any, 0x2u));
+
+        BoundingBox boundingBox(Vector3(-80.f, -20.f, -30.f), Vector3(10.f, 40.f, 70.f));
+        BoxOctreeQuery boxQuery(result, boundingBox, DrawableTypes::Light);
+        CheckVisitor(boxQuery, VolumeVisitQuery(boundingBox, DrawableTypes::Light));
+
+        Vector3 point(30.f, 40.f, -20.f);
+        PointOctreeQuery pointQuery(result, point);
+        CheckVisitor(pointQuery, PointVisitQuery(point));
+
+        // Filter is called only for the drawables of matching types
+        i32 numFiltered = 0;
+        VolumeVisitQuery filteredQuery(sphere, DrawableTypes::Geometry, DEFAULT_VIEWMASK, [](Drawable* drawable)
+        {
+            assert(drawable->GetDrawableType() == DrawableTypes::Geometry);
+            return drawable->GetViewMask() == 0x2u;
+        });
+        octree_->VisitDrawables(filteredQuery, [&numFiltered](Drawable* drawable)
+        {
+            assert(drawable->GetViewMask() == 0x2u);
+            ++numFiltered;
+        });
+
+        SphereOctreeQuery maskQuery(result, sphere, DrawableTypes::Geometry, 0x2u);
+        octree_->GetDrawables(maskQuery);
+        i32 numExpected = 0;
+        for (Drawable* drawable : result)
+            numExpected += drawable->GetViewMask() == 0x2u ? 1 : 0;
+        assert(numFiltered == numExpected);
+    }
+
+    // Return hit drawables and the closest hit distance of rays from different directions
+    Vector<Pair<Drawable*, float>> Raycast()
+    {
+        Vector<Pair<Drawable*, float>> hits;
+        Vector<RayQueryResult> result;
+
+        for (i32 i = 0; i < 20; ++i)
+        {
+            Vector3 origin(Random() * 200.f - 100.f, Random() * 200.f - 100.f, -150.f);
+            Vector3 target(Random() * 100.f - 50.f, Random() * 100.f - 50.f, 0.f);
+            Ray ray(origin, (target - origin).Normalized());
+
+            RayOctreeQuery query(result, ray, RAY_AABB, 250.f, DrawableTypes::Geometry);
+            octree_->Raycast(query);
+            for (const RayQueryResult& hit : result)
+                hits.Push(MakePair(hit.drawable_, hit.distance_));
+
+            // Any of the closest drawables may be returned, for example when the ray starts inside several of them
+            i32 numHits = result.Size();
+            octree_->RaycastSingle(query);
+            if (result.Size())
+            {
+                assert(hits.Contains(MakePair(result[0].drawable_, result[0].distance_)));
+                assert(numHits && hits[hits.Size() - numHits].second_ == result[0].distance_);
+            }
+            hits.Push(MakePair((Drawable*)nullptr, result.Size() ? result[0].distance_ : M_INFINITY));
+        }
+
+        // Hits with equal distances may be in any order
+        std::sort(hits.Begin(), hits.End());
+        return hits;
+    }
+
+    // Compare batched raycasts with raycasts one by one
+    void CheckRaycastBatch()
+    {
+        Vector<Ray> rays;
+        for (i32 i = 0; i < 100; ++i)
+        {
+            Vector3 origin(Random() * 200.f - 100.f, Random() * 200.f - 100.f, -150.f);
+            Vector3 target(Random() * 100.f - 50.f, Random() * 100.f - 50.f, 0.f);
+            rays.Push(Ray(origin, (target - origin).Normalized()));
+        }
+
+        Vector<RayQueryResult> results;
+        octree_->RaycastSingle(rays, results, RAY_AABB, 250.f, DrawableTypes::Geometry, 0x2u);
+        assert(results.Size() == rays.Size());
+
+        i32 numHits = 0;
+        Vector<RayQueryResult> result;
+
+        for (i32 i = 0; i < rays.Size(); ++i)
+        {
+            RayOctreeQuery query(result, rays[i], RAY_AABB, 250.f, DrawableTypes::Geometry, 0x2u);
+            octree_->RaycastSingle(query);
+
+            if (result.Empty())
+            {
+                assert(!results[i].drawable_ && results[i].distance_ == M_INFINITY);
+                continue;
+            }
+
+            assert(!(results[i] != result[0]));
+            ++numHits;
+        }
+
+        assert(numHits > 10);
+    }
+};
+
+} // namespace
+
+void Test_Graphics_Octree()
+{
+    DV_CONTEXT.RegisterSubsystem(new WorkQueue());
+
+    {
+        OctreeScene scene;
+        scene.Add(3000);
+        scene.CheckAll();
+
+        // Moved drawables are tested individually until the octree is updated
+        for (i32 i = 0; i < scene.drawables_.Size(); i += 3)
+            scene.drawables_[i]->SetBox(scene.RandomBox());
+        scene.CheckAll(false);
+        scene.Update();
+        scene.CheckAll();
+
+        for (i32 i = 0; i < scene.drawables_.Size(); i += 5)
+            scene.drawables_[i]->SetViewMask(scene.drawables_[i]->GetViewMask() == 0x2u ? 0x1u : 0x2u);
+        scene.CheckAll();
+
+        // Removal moves the last drawable of the octant to the removed position
+        for (i32 i = 0; i < scene.drawables_.Size(); i += 4)
+            scene.octree_->RemoveManualDrawable(scene.drawables_[i]);
+        scene.CheckAll();
+
+        for (i32 i = 0; i < scene.drawables_.Size(); i += 7)
+            scene.drawables_[i]->SetEnabled(false);
+        scene.CheckAll();
+
+        // Resizing moves all drawables to the root
+        scene.octree_->SetSize(BoundingBox(-150.f, 150.f), 7);
+        scene.CheckAll(false);
+        scene.Update();
+        scene.CheckAll();
+
+        i32 numInOctree = 0;
+        for (Drawable* drawable : scene.drawables_)
+        {
+            assert(!drawable->GetOctant() || drawable->GetOctant()->GetRoot() == scene.octree_);
+            numInOctree += drawable->GetOctant() ? 1 : 0;
+        }
+        assert(scene.octree_->GetNumDrawables() == numInOctree);
+    }
+
+    // Bounding volume hierarchy gives the same results as the octants
+    {
+        OctreeScene scene(true);
+        scene.Add(3000);
+        scene.Update();
+        assert(scene.octree_->GetBvh().GetNumDrawables() == scene.drawables_.Size());
+        scene.CheckAll();
+
+        // Drawables are queried from the root octant until the hierarchy is rebuilt
+        for (i32 i = 0; i < scene.drawables_.Size(); i += 4)
+            scene.octree_->RemoveManualDrawable(scene.drawables_[i]);
+        scene.CheckAll();
+        scene.Update();
+        assert(scene.octree_->GetBvh().GetNumDrawables() == scene.octree_->GetNumDrawables());
+        scene.CheckAll();
+
+        // Few moved drawables refit the hierarchy, many rebuild it
+        for (i32 i = 1; i < scene.drawables_.Size(); i += 50)
+            scene.drawables_[i]->SetBox(scene.RandomBox());
+        scene.Update();
+        scene.CheckAll();
+
+        for (BoxDrawable* drawable : scene.drawables_)
+            drawable->SetBox(scene.RandomBox());
+        scene.Update();
+        scene.CheckAll();
+
+        unsigned seed = GetRandomSeed();
+        Vector<Pair<Drawable*, float>> bvhHits = scene.Raycast();
+        assert(bvhHits.Size() > 20);
+
+        // Disabling reinserts the drawables to the octants
+        scene.octree_->SetBvhEnabled(false);
+        scene.Update();
+        scene.CheckAll();
+        assert(scene.octree_->GetBvh().GetNumDrawables() == 0);
+
+        SetRandomSeed(seed);
+        assert(scene.Raycast() == bvhHits);
+        scene.CheckRaycastBatch();
+    }
+
+    // Reinsertion and building of the hierarchy in worker threads. Most drawables move to other octants, which creates
+    // and deletes octants
+    DV_CONTEXT.GetSubsystem<WorkQueue>()->CreateThreads(3);
+
+    for (bool bvh : {false, true})
+    {
+        OctreeScene scene(bvh);
+        scene.Add(3000);
+        scene.Update();
+
+        for (i32 frame = 0; frame < 4; ++frame)
+        {
+            for (i32 i = frame % 2; i < scene.drawables_.Size(); i += 2)
+                scene.drawables_[i]->SetBox(scene.RandomBox());
+            scene.Update();
+            scene.CheckAll();
+            scene.CheckRaycastBatch();
+            assert(scene.octree_->GetNumDrawables() == scene.drawables_.Size());
+        }
+
+        // Removing all drawables deletes all child octants
+        for (BoxDrawable* drawable : scene.drawables_)
+            scene.octree_->RemoveManualDrawable(drawable);
+        assert(scene.octree_->GetNumDrawables() == 0);
+    }
+
+    // Drawables in scene nodes with a shared parent. Moving the parent marks their world transforms and bounding boxes
+    // dirty. They are calculated on the main thread before the worker threads read them
+    {
+        OctreeScene scene;
+        Node* parent = scene.scene_->CreateChild();
+
+        for (i32 i = 0; i < 1000; ++i)
+        {
+            Node* node = parent->CreateChild();
+            node->SetPosition(Vector3(Random() * 160.f - 80.f, Random() * 160.f - 80.f, Random() * 160.f - 80.f));
+            SharedPtr<BoxDrawable> drawable(new BoxDrawable());
+            drawable->SetBox(BoundingBox(-3.f, 3.f));
+            node->AddComponent(drawable, 0, LOCAL);
+            scene.drawables_.Push(drawable);
+        }
+
+        scene.Update();
+        scene.CheckAll();
+
+        for (i32 frame = 0; frame < 4; ++frame)
+        {
+            // Small moves, so that the drawables are found in their old octants before the update
+            parent->Translate(Vector3(Random() - 0.5f, Random() - 0.5f, Random() - 0.5f));
+            parent->Rotate(Quaternion(Random() - 0.5f, Vector3::UP));
+            scene.CheckRaycastBatch();
+            scene.Update();
+            scene.CheckAll();
+            assert(scene.octree_->GetNumDrawables() == scene.drawables_.Size());
+        }
+    }
+
+    DV_CONTEXT.RemoveSubsystem<WorkQueue>();
+}
@@ -0,0 +1,239 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/graphics/octree.h>
+#include <dviglo/graphics/particle_effect.h>
+#include <dviglo/graphics/particle_emitter.h>
+#include <dviglo/math/random.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+namespace
+{
+
+// Particle state for the scalar reference
+struct ReferenceParticle
+{
+    Vector3 velocity_;
+    Vector2 size_;
+    float timer_;
+    float timeToLive_;
+    float scale_;
+    float rotationSpeed_;
+    i32 colorIndex_;
+    i32 texIndex_;
+};
+
+// Update of one particle at a time
+void UpdateReference(Vector<ReferenceParticle>& particles, Vector<Billboard>& billboards, ParticleEffect* effect,
+    Node* node, bool relative, bool scaled, float timeStep)
+{
+    Vector3 relativeConstantForce = node->GetWorldRotation().Inverse() * effect->GetConstantForce();
+    Vector3 scaleVector = Vector3::ONE;
+    if (scaled && !relative)
+        scaleVector = node->GetWorldScale();
+
+    for (i32 i = 0; i < particles.Size(); ++i)
+    {
+        ReferenceParticle& particle = particles[i];
+        Billboard& billboard = billboards[i];
+
+        if (!billboard.enabled_)
+            continue;
+
+        if (particle.timer_ >= particle.timeToLive_)
+        {
+            billboard.enabled_ = false;
+            continue;
+        }
+        particle.timer_ += timeStep;
+
+        const Vector3& constantForce = effect->GetConstantForce();
+        if (constantForce != Vector3::ZERO)
+        {
+            if (relative)
+                particle.velocity_ += timeStep * relativeConstantForce;
+            else
+                particle.velocity_ += timeStep * constantForce;
+        }
+
+        float dampingForce = effect->GetDampingForce();
+        if (dampingForce != 0.0f)
+        {
+            Vector3 force = -dampingForce * particle.velocity_;
+            particle.velocity_ += timeStep * force;
+        }
+        billboard.position_ += timeStep * particle.velocity_ * scaleVector;
+        billboard.direction_ = particle.velocity_.Normalized();
+
+        billboard.rotation_ += timeStep * particle.rotationSpeed_;
+
+        float sizeAdd = effect->GetSizeAdd();
+        float sizeMul = effect->GetSizeMul();
+        if (sizeAdd != 0.0f || sizeMul != 1.0f)
+        {
+            particle.scale_ += timeStep * sizeAdd;
+            if (particle.scale_ < 0.0f)
+                particle.scale_ = 0.0f;
+            if (sizeMul != 1.0f)
+                particle.scale_ *= (timeStep * (sizeMul - 1.0f)) + 1.0f;
+            billboard.size_ = particle.size_ * particle.scale_;
+        }
+
+        i32& index = particle.colorIndex_;
+        const Vector<ColorFrame>& colorFrames = effect->GetColorFrames();
+        if (index < colorFrames.Size())
+        {
+            if (index < colorFrames.Size() - 1)
+            {
+                if (particle.timer_ >= colorFrames[index + 1].time_)
+                    ++index;
+            }
+            if (index < colorFrames.Size() - 1)
+                billboard.color_ = colorFrames[index].Interpolate(colorFrames[index + 1], particle.timer_);
+            else
+                billboard.color_ = colorFrames[index].color_;
+        }
+
+        i32& texIndex = particle.texIndex_;
+        const Vector<TextureFrame>& textureFrames = effect->GetTextureFrames();
+        if (textureFrames.Size() && texIndex < textureFrames.Size() - 1)
+        {
+            if (particle.timer_ >= textureFrames[texIndex + 1].time_)
+            {
+                billboard.uv_ = textureFrames[texIndex + 1].uv_;
+                ++texIndex;
+            }
+        }
+    }
+}
+
+void CheckEmitter(bool relative, bool scaled, float sizeAdd, float sizeMul, float dampingForce)
+{
+    // Not a multiple of four
+    constexpr i32 NUM_PARTICLES = 1001;
+    constexpr float TIME_STEP = 1.f / 30.f;
+
+    SharedPtr<Scene> scene(new Scene());
+    scene->AddComponent(new Octree(), 0, LOCAL);
+    Node* node = scene->CreateChild("Emitter", LOCAL);
+    node->SetPosition(Vector3(1.f, 2.f, 3.f));
+    node->SetRotation(Quaternion(30.f, 60.f, 10.f));
+    node->SetScale(Vector3(0.5f, 2.f, 1.5f));
+
+    SharedPtr<ParticleEffect> effect(new ParticleEffect());
+    effect->SetNumParticles(NUM_PARTICLES);
+    effect->SetUpdateInvisible(true);
+    effect->SetRelative(relative);
+    effect->SetScaled(scaled);
+    effect->SetConstantForce(Vector3(0.f, -9.81f, 1.f));
+    effect->SetDampingForce(dampingForce);
+    effect->SetSizeAdd(sizeAdd);
+    effect->SetSizeMul(sizeMul);
+    effect->AddColorTime(Color::WHITE, 0.f);
+    effect->AddColorTime(Color::RED, 0.5f);
+    effect->AddColorTime(Color(0.f, 0.f, 1.f, 0.f), 1.5f);
+    effect->AddTextureTime(Rect(0.f, 0.f, 0.5f, 0.5f), 0.f);
+    effect->AddTextureTime(Rect(0.5f, 0.f, 1.f, 0.5f), 0.4f);
+    effect->AddTextureTime(Rect(0.f, 0.5f, 0.5f, 1.f), 1.f);
+
+    auto* emitter = new ParticleEmitter();
+    node->AddComponent(emitter, 0, LOCAL);
+    emitter->SetEffect(effect);
+    emitter->SetEmitting(false);
+
+    // Random state, some particles are disabled and some are about to expire
+    VariantVector particlesAttr;
+    particlesAttr.Push(NUM_PARTICLES);
+    Vector<ReferenceParticle> particles(NUM_PARTICLES);
+
+    for (ReferenceParticle& particle : particles)
+    {
+        particle.velocity_ = Vector3(Random() * 4.f - 2.f, Random() * 10.f, Random() * 4.f - 2.f);
+        particle.size_ = Vector2(Random() + 0.1f, Random() + 0.1f);
+        particle.timer_ = Random() * 2.f;
+        particle.timeToLive_ = particle.timer_ + Random() * 3.f;
+        particle.scale_ = Random() * 2.f;
+        particle.rotationSpeed_ = Random() * 100.f - 50.f;
+        particle.colorIndex_ = particle.timer_ < 0.5f ? 0 : (particle.timer_ < 1.5f ? 1 : 2);
+        particle.texIndex_ = particle.timer_ < 0.4f ? 0 : (particle.timer_ < 1.f ? 1 : 2);
+
+        particlesAttr.Push(particle.velocity_);
+        particlesAttr.Push(particle.size_);
+        particlesAttr.Push(particle.timer_);
+        particlesAttr.Push(particle.timeToLive_);
+        particlesAttr.Push(particle.scale_);
+        particlesAttr.Push(particle.rotationSpeed_);
+        particlesAttr.Push(particle.colorIndex_);
+        particlesAttr.Push(particle.texIndex_);
+    }
+
+    emitter->SetParticlesAttr(particlesAttr);
+    assert(emitter->GetNumParticles() == NUM_PARTICLES);
+
+    Vector<Billboard>& billboards = emitter->GetBillboards();
+    for (Billboard& billboard : billboards)
+    {
+        billboard.position_ = Vector3(Random() * 10.f, Random() * 10.f, Random() * 10.f);
+        billboard.rotation_ = Random() * 360.f;
+        billboard.enabled_ = Random() < 0.8f;
+    }
+
+    // Also runs of disabled particles longer than a group of four
+    for (i32 i = 100; i < 120; ++i)
+        billboards[i].enabled_ = false;
+
+    Vector<Billboard> referenceBillboards = billboards;
+    FrameInfo frame{};
+
+    for (i32 i = 0; i < 40; ++i)
+    {
+        scene->Update(TIME_STEP);
+        emitter->Update(frame);
+        UpdateReference(particles, referenceBillboards, effect, node, relative, scaled, TIME_STEP);
+    }
+
+    const ParticleArrays& arrays = emitter->GetParticles();
+    i32 numEnabled = 0;
+
+    for (i32 i = 0; i < NUM_PARTICLES; ++i)
+    {
+        const Billboard& billboard = billboards[i];
+        const Billboard& expected = referenceBillboards[i];
+        assert(billboard.enabled_ == expected.enabled_);
+        assert(billboard.position_ == expected.position_);
+        assert(billboard.direction_ == expected.direction_);
+        assert(billboard.rotation_ == expected.rotation_);
+        assert(billboard.size_ == expected.size_);
+        assert(billboard.color_ == expected.color_);
+        assert(billboard.uv_ == expected.uv_);
+
+        const ReferenceParticle& particle = particles[i];
+        assert(Vector3(arrays.velocityX_[i], arrays.velocityY_[i], arrays.velocityZ_[i]) == particle.velocity_);
+        assert(arrays.timer_[i] == particle.timer_);
+        assert(arrays.scale_[i] == particle.scale_);
+        assert(arrays.colorIndex_[i] == particle.colorIndex_);
+        assert(arrays.texIndex_[i] == particle.texIndex_);
+
+        numEnabled += billboard.enabled_ ? 1 : 0;
+    }
+
+    // Some particles have expired, some are still alive
+    assert(numEnabled > 0 && numEnabled < NUM_PARTICLES * 8 / 10);
+}
+
+} // namespace
+
+void Test_Graphics_ParticleEmitter()
+{
+    SetRandomSeed(1);
+
+    CheckEmitter(false, true, 0.5f, 1.2f, 0.3f);
+    CheckEmitter(true, false, -1.f, 1.f, 0.f);
+    CheckEmitter(false, false, 0.f, 1.f, 1.5f);
+}
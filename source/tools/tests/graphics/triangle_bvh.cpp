@@ -0,0 +1,235 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/graphics/animated_model.h>
+#include <dviglo/graphics/geometry.h>
+#include <dviglo/graphics/model.h>
+#include <dviglo/graphics/octree_query.h>
+#include <dviglo/math/random.h>
+#include <dviglo/math/ray.h>
+#include <dviglo/scene/scene.h>
+
+#include <dviglo/common/debug_new.h>
+
+#include <cstddef>
+
+using namespace dviglo;
+
+namespace
+{
+
+struct Vertex
+{
+    Vector3 position_;
+    Vector2 uv_;
+};
+
+// Bumpy grid with some vertices shared by several triangles
+SharedArrayPtr<byte> CreateGrid(i32 size, float height)
+{
+    SharedArrayPtr<byte> data(new byte[size * size * sizeof(Vertex)]);
+    auto* vertices = (Vertex*)data.Get();
+
+    for (i32 z = 0; z < size; ++z)
+    {
+        for (i32 x = 0; x < size; ++x)
+        {
+            Vertex& vertex = vertices[z * size + x];
+            vertex.position_ = Vector3((float)x, Random() * height, (float)z);
+            vertex.uv_ = Vector2((float)x / size, (float)z / size);
+        }
+    }
+
+    return data;
+}
+
+SharedArrayPtr<byte> CreateGridIndices(i32 size)
+{
+    SharedArrayPtr<byte> data(new byte[(size - 1) * (size - 1) * 6 * sizeof(u16)]);
+    auto* indices = (u16*)data.Get();
+
+    for (i32 z = 0; z < size - 1; ++z)
+    {
+        for (i32 x = 0; x < size - 1; ++x)
+        {
+            u16 i = (u16)(z * size + x);
+            *indices++ = i;
+            *indices++ = (u16)(i + size);
+            *indices++ = (u16)(i + 1);
+            *indices++ = (u16)(i + 1);
+            *indices++ = (u16)(i + size);
+            *indices++ = (u16)(i + size + 1);
+        }
+    }
+
+    return data;
+}
+
+// Compare with testing every triangle. Rays start above the grid and go down, some of them miss the grid
+void CheckRays(const Geometry& geometry, const byte* vertexData, const byte* indexData, i32 indexCount, float size)
+{
+    i32 numHits = 0;
+    i32 numOtherNormals = 0;
+
+    for (i32 i = 0; i < 200; ++i)
+    {
+        Vector3 origin(Random() * size * 1.2f - size * 0.1f, 20.f, Random() * size * 1.2f - size * 0.1f);
+        Vector3 direction(Random() - 0.5f, -1.f, Random() - 0.5f);
+        Ray ray(origin, direction.Normalized());
+
+        Vector3 expectedNormal;
+        Vector2 expectedUV;
+        float expected = indexData ?
+            ray.HitDistance(vertexData, sizeof(Vertex), indexData, sizeof(u16), 0, indexCount, &expectedNormal, &expectedUV,
+                offsetof(Vertex, uv_)) :
+            ray.HitDistance(vertexData, sizeof(Vertex), 0, indexCount, &expectedNormal, &expectedUV, offsetof(Vertex, uv_));
+
+        Vector3 normal;
+        Vector2 uv;
+        float distance = geometry.GetHitDistance(ray, &normal, &uv);
+        assert(distance == expected);
+        assert(geometry.GetHitDistance(ray) == expected);
+
+        if (distance < M_INFINITY)
+        {
+            // Another triangle may be found if the hit point is on a shared edge
+            assert((uv - expectedUV).Length() < 0.001f);
+            numOtherNormals += normal.Equals(expectedNormal) ? 0 : 1;
+            ++numHits;
+        }
+    }
+
+    assert(numHits > 50);
+    assert(numOtherNormals < 3);
+}
+
+// Animated model without bone hitboxes tests the triangles of the bind pose. With hitboxes RAY_TRIANGLE tests them,
+// RAY_TRIANGLE_UV still tests the triangles
+void CheckAnimatedModelRays(Geometry* geometry, const byte* vertexData, const byte* indexData, i32 indexCount, float size)
+{
+    Skeleton skeleton;
+    Vector<Bone>& bones = skeleton.GetModifiableBones();
+    bones.Resize(1);
+    bones[0].name_ = "Root";
+    bones[0].nameHash_ = bones[0].name_;
+    bones[0].parentIndex_ = 0;
+    bones[0].initialScale_ = Vector3::ONE;
+    bones[0].collisionMask_ = BONECOLLISION_NONE;
+    skeleton.SetRootBoneIndex(0);
+
+    SharedPtr<Model> model(new Model());
+    model->SetNumGeometries(1);
+    model->SetGeometry(0, 0, geometry);
+    model->SetBoundingBox(BoundingBox(Vector3(0.f, 0.f, 0.f), Vector3(size, 10.f, size)));
+    model->SetSkeleton(skeleton);
+
+    SharedPtr<Scene> scene(new Scene());
+    Node* node = scene->CreateChild("Model", LOCAL);
+    node->SetPosition(Vector3(5.f, -2.f, 3.f));
+    node->SetRotation(Quaternion(20.f, Vector3::UP));
+    auto* animatedModel = new AnimatedModel();
+    node->AddComponent(animatedModel, 0, LOCAL);
+    animatedModel->SetModel(model);
+
+    i32 numHits = 0;
+    Vector<RayQueryResult> results;
+
+    for (i32 i = 0; i < 100; ++i)
+    {
+        Vector3 origin(Random() * size, 20.f, Random() * size);
+        Ray ray(origin, Vector3(Random() - 0.5f, -1.f, Random() - 0.5f).Normalized());
+        Ray localRay = ray.Transformed(node->GetWorldTransform().Inverse());
+        float expected = localRay.HitDistance(vertexData, sizeof(Vertex), indexData, sizeof(u16), 0, indexCount);
+
+        for (RayQueryLevel level : {RAY_TRIANGLE, RAY_TRIANGLE_UV})
+        {
+            results.Clear();
+            animatedModel->ProcessRayQuery(RayOctreeQuery(results, ray, level), results);
+            assert(results.Size() == (expected < M_INFINITY ? 1 : 0));
+            if (results.Size())
+                assert(Equals(results[0].distance_, expected) && results[0].subObject_ == 0);
+        }
+
+        numHits += expected < M_INFINITY ? 1 : 0;
+    }
+
+    assert(numHits > 50);
+
+    Bone* bone = animatedModel->GetSkeleton().GetBone(0);
+    bone->collisionMask_ = BONECOLLISION_SPHERE;
+    bone->radius_ = size;
+    Ray ray(node->GetWorldTransform() * Vector3(size * 0.5f, 100.f, size * 0.5f), Vector3::DOWN);
+    Ray localRay = ray.Transformed(node->GetWorldTransform().Inverse());
+    float expectedTriangle = localRay.HitDistance(vertexData, sizeof(Vertex), indexData, sizeof(u16), 0, indexCount);
+    float expectedSphere = ray.HitDistance(Sphere(bone->node_->GetWorldPosition(), size));
+    assert(expectedTriangle < M_INFINITY && expectedSphere < expectedTriangle);
+
+    results.Clear();
+    animatedModel->ProcessRayQuery(RayOctreeQuery(results, ray, RAY_TRIANGLE), results);
+    assert(results.Size() == 1 && Equals(results[0].distance_, expectedSphere));
+    results.Clear();
+    animatedModel->ProcessRayQuery(RayOctreeQuery(results, ray, RAY_TRIANGLE_UV), results);
+    assert(results.Size() == 1 && Equals(results[0].distance_, expectedTriangle));
+}
+
+} // namespace
+
+void Test_Graphics_TriangleBvh()
+{
+    SetRandomSeed(1);
+
+    constexpr i32 SIZE = 40;
+    constexpr i32 INDEX_COUNT = (SIZE - 1) * (SIZE - 1) * 6;
+
+    {
+        Geometry geometry;
+        SharedArrayPtr<byte> vertexData = CreateGrid(SIZE, 3.f);
+        SharedArrayPtr<byte> indexData = CreateGridIndices(SIZE);
+        geometry.SetRawVertexData(vertexData, VertexElements::Position | VertexElements::TexCoord1);
+        geometry.SetRawIndexData(indexData, sizeof(u16));
+        geometry.SetDrawRange(TRIANGLE_LIST, 0, INDEX_COUNT, false);
+        CheckRays(geometry, vertexData, indexData, INDEX_COUNT, SIZE);
+
+        // New raw data and a new draw range rebuild the hierarchy
+        vertexData = CreateGrid(SIZE, 10.f);
+        geometry.SetRawVertexData(vertexData, VertexElements::Position | VertexElements::TexCoord1);
+        CheckRays(geometry, vertexData, indexData, INDEX_COUNT, SIZE);
+
+        geometry.SetDrawRange(TRIANGLE_LIST, 0, INDEX_COUNT / 2, false);
+        CheckRays(geometry, vertexData, indexData, INDEX_COUNT / 2, SIZE);
+    }
+
+    {
+        SharedPtr<Geometry> geometry(new Geometry());
+        SharedArrayPtr<byte> vertexData = CreateGrid(SIZE, 3.f);
+        SharedArrayPtr<byte> indexData = CreateGridIndices(SIZE);
+        geometry->SetRawVertexData(vertexData, VertexElements::Position | VertexElements::TexCoord1);
+        geometry->SetRawIndexData(indexData, sizeof(u16));
+        geometry->SetDrawRange(TRIANGLE_LIST, 0, INDEX_COUNT, false);
+        CheckAnimatedModelRays(geometry, vertexData, indexData, INDEX_COUNT, SIZE);
+    }
+
+    // Non-indexed triangles, which do not share vertices
+    {
+        constexpr i32 VERTEX_COUNT = 3000;
+        SharedArrayPtr<byte> vertexData(new byte[VERTEX_COUNT * sizeof(Vertex)]);
+        auto* vertices = (Vertex*)vertexData.Get();
+
+        for (i32 i = 0; i < VERTEX_COUNT; i += 3)
+        {
+            Vector3 center(Random() * SIZE, Random() * 5.f, Random() * SIZE);
+            for (i32 j = 0; j < 3; ++j)
+            {
+                vertices[i + j].position_ = center + Vector3(Random() * 6.f - 3.f, Random() * 6.f - 3.f, Random() * 6.f - 3.f);
+                vertices[i + j].uv_ = Vector2(Random(), Random());
+            }
+        }
+
+        Geometry geometry;
+        geometry.SetRawVertexData(vertexData, VertexElements::Position | VertexElements::TexCoord1);
+        geometry.SetDrawRange(TRIANGLE_LIST, 0, 0, 0, VERTEX_COUNT);
+        CheckRays(geometry, vertexData, nullptr, VERTEX_COUNT, SIZE);
+    }
+}
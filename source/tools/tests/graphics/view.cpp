@@ -0,0 +1,99 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+#include "../windowed_engine.h"
+
+#include <dviglo/graphics/graphics_events.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+// Heap allocations are counted only while View::Update() runs. Array and nothrow forms of the operator new
+// are not replaced, the standard library forwards them to these ones. FlatHashMap uses the aligned form
+static std::atomic<bool> countAllocations{false};
+static std::atomic<i64> numAllocations{0};
+
+void* operator new(size_t size)
+{
+    if (countAllocations.load(std::memory_order_relaxed))
+        numAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* ret = malloc(size ? size : 1);
+    if (!ret)
+        throw std::bad_alloc();
+    return ret;
+}
+
+// The original pointer is stored before the aligned block
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    size_t align = Max((size_t)alignment, sizeof(void*));
+    void* original = operator new(size + align);
+    uintptr_t address = ((uintptr_t)original + align) & ~(uintptr_t)(align - 1);
+    reinterpret_cast<void**>(address)[-1] = original;
+    return reinterpret_cast<void*>(address);
+}
+
+static void FreeAligned(void* ptr)
+{
+    if (ptr)
+        free(reinterpret_cast<void**>(ptr)[-1]);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+
+void Test_Graphics_View()
+{
+    Engine* engine = GetWindowedEngine();
+    if (!engine)
+    {
+        std::cout << "Test_Graphics_View() skipped: no graphics driver" << std::endl;
+        return;
+    }
+
+    SharedPtr<Scene> scene = CreateWindowedScene();
+
+    i32 numViewUpdates = 0;
+    scene->SubscribeToEvent(E_BEGINVIEWUPDATE, [&](StringHash, VariantMap&)
+    {
+        countAllocations = true;
+        ++numViewUpdates;
+    });
+    scene->SubscribeToEvent(E_ENDVIEWUPDATE, [&](StringHash, VariantMap&) { countAllocations = false; });
+
+    // Containers reach their final capacity in the first frames
+    for (i32 i = 0; i < 10; ++i)
+    {
+        engine->SetNextTimeStep(1.f / 60.f);
+        engine->RunFrame();
+    }
+
+    // View preparation does not allocate memory in steady state. Temporary data fits the blocks of the frame allocator
+    Renderer* renderer = DV_CONTEXT.GetSubsystem<Renderer>();
+    i32 numFrameHeapAllocations = renderer->GetNumFrameHeapAllocations();
+    numAllocations = 0;
+    numViewUpdates = 0;
+    for (i32 i = 0; i < 10; ++i)
+    {
+        engine->SetNextTimeStep(1.f / 60.f);
+        engine->RunFrame();
+    }
+
+    assert(numViewUpdates == 10);
+    assert(numAllocations == 0);
+    assert(renderer->GetNumFrameHeapAllocations() == numFrameHeapAllocations);
+
+    scene->UnsubscribeFromAllEvents();
+    renderer->SetViewport(0, nullptr);
+}
@@ -4,14 +4,48 @@
 
 #include <iostream>
 
+void Test_Container_ArenaVector();
+void Test_Container_FlatHashMap();
+void Test_Container_FlatHashSet();
 void Test_Container_Str();
+void Test_Core_PostedEvents();
+void Test_Core_TaskGraph();
+void Test_Core_TraceRecorder();
+void Test_Core_TypedEvents();
+void Test_Core_WorkQueue();
+void Test_Graphics_AnimatedModel();
+void Test_Graphics_Batch();
+void Test_Graphics_BillboardSet();
+void Test_Graphics_OcclusionBuffer();
+void Test_Graphics_Octree();
+void Test_Graphics_ParticleEmitter();
+void Test_Graphics_TriangleBvh();
+void Test_Graphics_View();
 void Test_Math_BigInt();
+void Test_Math_Polyhedron();
 void test_third_party_sdl();
 
 void Run()
 {
+    Test_Container_ArenaVector();
+    Test_Container_FlatHashMap();
+    Test_Container_FlatHashSet();
     Test_Container_Str();
+    Test_Core_PostedEvents();
+    Test_Core_TaskGraph();
+    Test_Core_TraceRecorder();
+    Test_Core_TypedEvents();
+    Test_Core_WorkQueue();
+    Test_Graphics_AnimatedModel();
+    Test_Graphics_Batch();
+    Test_Graphics_BillboardSet();
+    Test_Graphics_OcclusionBuffer();
+    Test_Graphics_Octree();
+    Test_Graphics_ParticleEmitter();
+    Test_Graphics_TriangleBvh();
+    Test_Graphics_View();
     Test_Math_BigInt();
+    Test_Math_Polyhedron();
     test_third_party_sdl();
 }
 
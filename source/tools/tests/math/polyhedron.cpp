@@ -0,0 +1,49 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#include "../force_assert.h"
+
+#include <dviglo/math/bounding_box.h>
+#include <dviglo/math/plane.h>
+#include <dviglo/math/polyhedron.h>
+
+#include <dviglo/common/debug_new.h>
+
+using namespace dviglo;
+
+void Test_Math_Polyhedron()
+{
+    Polyhedron polyhedron;
+
+    for (i32 i = 0; i < 3; ++i)
+    {
+        polyhedron.Define(BoundingBox(Vector3(-1.f, -1.f, -1.f), Vector3(1.f, 1.f, 1.f)));
+        assert(polyhedron.faces_.Size() == 6);
+
+        // The face at x = 1 is clipped completely and is replaced by a new quad face
+        polyhedron.Clip(Plane(Vector3(-1.f, 0.f, 0.f), Vector3(0.5f, 0.f, 0.f)));
+        assert(polyhedron.faces_.Size() == 6);
+        assert(polyhedron.faces_.Back().Size() == 4);
+
+        // Same for the face at x = -1
+        polyhedron.Clip(Plane(Vector3(1.f, 0.f, 0.f), Vector3(0.f, 0.f, 0.f)));
+        assert(polyhedron.faces_.Size() == 6);
+        assert(polyhedron.faces_.Back().Size() == 4);
+
+        BoundingBox box(polyhedron);
+        assert(box.min_.Equals(Vector3(0.f, -1.f, -1.f)));
+        assert(box.max_.Equals(Vector3(0.5f, 1.f, 1.f)));
+
+        for (const Vector<Vector3>& face : polyhedron.faces_)
+            assert(face.Size() >= 3);
+    }
+
+    polyhedron.Clip(Plane(Vector3(1.f, 0.f, 0.f), Vector3(2.f, 0.f, 0.f)));
+    assert(polyhedron.Empty());
+
+    polyhedron.AddFace(Vector3::ZERO, Vector3::ONE, Vector3::UP);
+    assert(polyhedron.faces_.Size() == 1 && polyhedron.faces_[0].Size() == 3);
+
+    polyhedron.Clear();
+    assert(polyhedron.Empty());
+}
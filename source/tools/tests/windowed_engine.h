@@ -0,0 +1,102 @@
+// Copyright (c) 2022-2023 the Dviglo project
+// License: MIT
+
+#pragma once
+
+#include <dviglo/core/context.h>
+#include <dviglo/engine/engine.h>
+#include <dviglo/engine/engine_defs.h>
+#include <dviglo/graphics/camera.h>
+#include <dviglo/graphics/light.h>
+#include <dviglo/graphics/material.h>
+#include <dviglo/graphics/model.h>
+#include <dviglo/graphics/octree.h>
+#include <dviglo/graphics/renderer.h>
+#include <dviglo/graphics/static_model.h>
+#include <dviglo/math/random.h>
+#include <dviglo/resource/resource_cache.h>
+#include <dviglo/scene/scene.h>
+
+#include <SDL3/SDL_hints.h>
+
+// Engine with a small window for the tests which need rendering. The window is created by the offscreen video driver,
+// so it is not shown. The engine is shared by all the tests, as the context keeps it alive anyway.
+// Returns null if there is no graphics driver. Then the tests which need rendering are skipped
+inline dviglo::Engine* GetWindowedEngine()
+{
+    using namespace dviglo;
+
+    static SharedPtr<Engine> engine;
+    static bool initialized = false;
+
+    if (!initialized)
+    {
+        initialized = true;
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+
+        VariantMap parameters;
+        parameters[EP_LOG_NAME] = "";
+        parameters[EP_LOG_QUIET] = true;
+        parameters[EP_SOUND] = false;
+        parameters[EP_WINDOW_WIDTH] = 320;
+        parameters[EP_WINDOW_HEIGHT] = 240;
+        // The tests are in bin/tool
+        parameters[EP_RESOURCE_PREFIX_PATHS] = "..";
+        parameters[EP_AUTOLOAD_PATHS] = "";
+
+        engine = new Engine();
+        if (!engine->Initialize(parameters))
+            engine.Reset();
+    }
+
+    return engine;
+}
+
+// Scene with shadowed lights and many objects, which is shown in the viewport 0
+inline dviglo::SharedPtr<dviglo::Scene> CreateWindowedScene()
+{
+    using namespace dviglo;
+
+    ResourceCache* cache = DV_CONTEXT.GetSubsystem<ResourceCache>();
+    SharedPtr<Scene> scene(new Scene());
+    scene->CreateComponent<Octree>();
+    SetRandomSeed(1);
+
+    Node* planeNode = scene->CreateChild("Plane");
+    planeNode->SetScale(Vector3(100.f, 1.f, 100.f));
+    StaticModel* plane = planeNode->CreateComponent<StaticModel>();
+    plane->SetModel(cache->GetResource<Model>("Models/Plane.mdl"));
+    plane->SetMaterial(cache->GetResource<Material>("Materials/StoneTiled.xml"));
+
+    for (i32 i = 0; i < 100; ++i)
+    {
+        Node* mushroomNode = scene->CreateChild("Mushroom");
+        mushroomNode->SetPosition(Vector3(Random(-45.f, 45.f), 0.f, Random(-45.f, 45.f)));
+        mushroomNode->SetRotation(Quaternion(0.f, Random(360.f), 0.f));
+        mushroomNode->SetScale(0.5f + Random(2.f));
+        StaticModel* mushroom = mushroomNode->CreateComponent<StaticModel>();
+        mushroom->SetModel(cache->GetResource<Model>("Models/Mushroom.mdl"));
+        mushroom->SetMaterial(cache->GetResource<Material>("Materials/Mushroom.xml"));
+        mushroom->SetCastShadows(true);
+    }
+
+    Node* lightNode = scene->CreateChild("DirectionalLight");
+    lightNode->SetDirection(Vector3(0.6f, -1.f, 0.8f));
+    Light* light = lightNode->CreateComponent<Light>();
+    light->SetLightType(LIGHT_DIRECTIONAL);
+    light->SetCastShadows(true);
+
+    Node* pointLightNode = scene->CreateChild("PointLight");
+    pointLightNode->SetPosition(Vector3(0.f, 5.f, 10.f));
+    Light* pointLight = pointLightNode->CreateComponent<Light>();
+    pointLight->SetRange(20.f);
+    pointLight->SetCastShadows(true);
+
+    Node* cameraNode = scene->CreateChild("Camera");
+    cameraNode->SetPosition(Vector3(0.f, 5.f, -20.f));
+    cameraNode->SetRotation(Quaternion(15.f, 0.f, 0.f));
+    Camera* camera = cameraNode->CreateComponent<Camera>();
+
+    DV_CONTEXT.GetSubsystem<Renderer>()->SetViewport(0, new Viewport(scene, camera));
+    return scene;
+}